@@ -11,6 +11,8 @@ struct option long_options[] = {
     {"python", required_argument, 0, 'p'},
     {"verbose", no_argument, 0, 'v'},
     {"unbuffered", no_argument, 0, 'U'},
+    {"log-file", required_argument, 0, OPT_LOG_FILE},
+    {"trace", required_argument, 0, OPT_TRACE},
     {"update-base", no_argument, 0, OPT_ALWAYS_UPDATE_BASE},
     {"fail-fast", no_argument, 0, OPT_FAIL_FAST},
     {"task-timeout", required_argument, 0, OPT_TASK_TIMEOUT},
@@ -39,6 +41,8 @@ const char *long_options_help[] = {
     "Override version of Python in configuration",
     "Increase output verbosity",
     "Disable line buffering",
+    "Append structured log records to file",
+    "Write stage timings to file (Chrome trace format)",
     "Update conda installation prior to STASIS environment creation",
     "On error, immediately terminate all tasks",
     "Terminate task after timeout is reached (#s, #m, #h)",
@@ -22,6 +22,8 @@
 #define OPT_WHEEL_BUILDER 1014
 #define OPT_WHEEL_BUILDER_MANYLINUX_IMAGE 1015
 #define OPT_FORCE_REPEATABLE 1016
+#define OPT_LOG_FILE 1017
+#define OPT_TRACE 1018
 
 extern struct option long_options[];
 void usage(char *progname);
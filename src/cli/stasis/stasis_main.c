@@ -4,6 +4,7 @@
 #include <limits.h>
 #include "core.h"
 #include "delivery.h"
+#include "trace.h"
 
 // local includes
 #include "args.h"
@@ -163,9 +164,51 @@ static void check_conda_prefix_length(const struct Delivery *ctx) {
     }
 }
 
+static int is_remote_uri(const char *uri) {
+    return !isempty((char *) uri) && strstr(uri, "://") && !startswith(uri, "file://");
+}
+
+static void get_based_on_path(const struct Delivery *ctx, char *result, const size_t maxlen) {
+    snprintf(result, maxlen, "%s/%s-based_on.yml", ctx->storage.tmpdir, ctx->info.release_name);
+}
+
+static void prefetch_remote_files(const struct Delivery *ctx, char *installer_url) {
+    // The installer and a remote base environment configuration are fetched
+    // concurrently. Failures are left for the regular code paths to report.
+    struct DownloadRequest req[2] = {0};
+    char installer_path[PATH_MAX] = {0};
+    char based_on_path[PATH_MAX] = {0};
+    size_t count = 0;
+
+    if (!is_remote_uri(ctx->meta.based_on)) {
+        return;
+    }
+
+    snprintf(installer_path, sizeof(installer_path), "%s/%s", ctx->storage.tmpdir, path_basename(installer_url));
+    if (access(installer_path, F_OK)) {
+        req[count].url = installer_url;
+        req[count].filename = installer_path;
+        count++;
+    }
+    get_based_on_path(ctx, based_on_path, sizeof(based_on_path));
+    req[count].url = ctx->meta.based_on;
+    req[count].filename = based_on_path;
+    count++;
+
+    msg(STASIS_MSG_L2, "Prefetching %zu file(s)\n", count);
+    download_batch(req, count);
+    for (size_t i = 0; i < count; i++) {
+        if (HTTP_ERROR(req[i].http_code)) {
+            SYSDEBUG("prefetch failed: %ld: %s: %s", req[i].http_code, req[i].errmsg, req[i].url);
+            remove(req[i].filename);
+        }
+    }
+}
+
 static void setup_conda(struct Delivery *ctx, char *installer_url, const size_t maxlen) {
     msg(STASIS_MSG_L1, "Conda setup\n");
     delivery_get_conda_installer_url(ctx, installer_url, maxlen);
+    prefetch_remote_files(ctx, installer_url);
     msg(STASIS_MSG_L2, "Downloading: %s\n", installer_url);
     if (delivery_get_conda_installer(ctx, installer_url)) {
         SYSERROR("download failed: %s", installer_url);
@@ -228,6 +271,16 @@ static void configure_conda_base(struct Delivery *ctx, char *envs[]) {
 
     msg(STASIS_MSG_L2, "Based on: %s\n", ctx->meta.based_on);
 
+    // Use the copy fetched by setup_conda(), if any
+    char based_on_path[PATH_MAX] = {0};
+    char *based_on = ctx->meta.based_on;
+    if (is_remote_uri(ctx->meta.based_on)) {
+        get_based_on_path(ctx, based_on_path, sizeof(based_on_path));
+        if (!access(based_on_path, F_OK)) {
+            based_on = based_on_path;
+        }
+    }
+
     for (size_t i = 0; envs[i] != NULL; i += 2) {
         char *title = envs[i];
         char *env = envs[i+1];
@@ -238,7 +291,7 @@ static void configure_conda_base(struct Delivery *ctx, char *envs[]) {
                 exit(1);
             }
 
-            if (conda_env_create_from_uri(env, ctx->meta.based_on, ctx->meta.python)) {
+            if (conda_env_create_from_uri(env, based_on, ctx->meta.python)) {
                 SYSERROR("unable to install %s environment using configuration file", title);
                 exit(1);
             }
@@ -252,6 +305,9 @@ static void configure_conda_base(struct Delivery *ctx, char *envs[]) {
     }
     // The base environment configuration not used past this point
     remove(mission_base);
+    if (based_on == based_on_path) {
+        remove(based_on_path);
+    }
 }
 
 static void configure_conda_purge(struct Delivery *ctx, char *envs[]) {
@@ -599,6 +655,16 @@ int main(const int argc, char *argv[]) {
                 setvbuf(stdout, NULL, _IONBF, 0);
                 setvbuf(stderr, NULL, _IONBF, 0);
                 break;
+            case OPT_LOG_FILE:
+                if (log_sink_open(optarg)) {
+                    exit(1);
+                }
+                break;
+            case OPT_TRACE:
+                if (trace_open(optarg)) {
+                    exit(1);
+                }
+                break;
             case 'v':
                 globals.verbose = true;
                 LOG_LEVEL++;
@@ -675,20 +741,20 @@ int main(const int argc, char *argv[]) {
 
     SYSDEBUG("LOG_LEVEL is %s", log_get_level_str());
 
-    setup_python_version_override(&ctx, python_override_version);
-    configure_stasis_ini(&ctx, &config_input);
-    check_system_path();
+    TRACE_CALL(TRACE_CAT_STAGE, setup_python_version_override, &ctx, python_override_version);
+    TRACE_CALL(TRACE_CAT_STAGE, configure_stasis_ini, &ctx, &config_input);
+    TRACE_CALL(TRACE_CAT_STAGE, check_system_path);
 
     msg(STASIS_MSG_L1, "Setup\n");
 
     tpl_setup_vars(&ctx);
     tpl_setup_funcs(&ctx);
 
-    configure_delivery_ini(&ctx, &delivery_input);
-    configure_delivery_context(&ctx);
-    check_requirements(&ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, configure_delivery_ini, &ctx, &delivery_input);
+    TRACE_CALL(TRACE_CAT_STAGE, configure_delivery_context, &ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, check_requirements, &ctx);
 
-    configure_jfrog_cli(&ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, configure_jfrog_cli, &ctx);
     runtime_apply(ctx.runtime.environ);
     safe_strncpy(env_name, ctx.info.release_name, sizeof(env_name));
     safe_strncpy(env_name_testing, env_name, sizeof(env_name_testing));
@@ -700,27 +766,27 @@ int main(const int argc, char *argv[]) {
         NULL, NULL,
     };
 
-    check_release_history(&ctx);
-    sync_release_history(&ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, check_release_history, &ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, sync_release_history, &ctx);
 
-    check_conda_install_prefix(&ctx);
-    check_conda_prefix_length(&ctx);
-    setup_conda(&ctx, installer_url, sizeof(installer_url));
-    configure_conda_base(&ctx, envs);
-    configure_conda_purge(&ctx, envs);
-    setup_activate_test_env(&ctx, env_name_testing);
+    TRACE_CALL(TRACE_CAT_STAGE, check_conda_install_prefix, &ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, check_conda_prefix_length, &ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, setup_conda, &ctx, installer_url, sizeof(installer_url));
+    TRACE_CALL(TRACE_CAT_STAGE, configure_conda_base, &ctx, envs);
+    TRACE_CALL(TRACE_CAT_STAGE, configure_conda_purge, &ctx, envs);
+    TRACE_CALL(TRACE_CAT_STAGE, setup_activate_test_env, &ctx, env_name_testing);
 
-    configure_tool_versions(&ctx);
-    install_packaging_tools();
-    configure_package_overlay(&ctx, env_name);
-    configure_deferred_packages(&ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, configure_tool_versions, &ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, install_packaging_tools);
+    TRACE_CALL(TRACE_CAT_STAGE, configure_package_overlay, &ctx, env_name);
+    TRACE_CALL(TRACE_CAT_STAGE, configure_deferred_packages, &ctx);
 
     show_overview(&ctx);
-    run_tests(&ctx);
-    build_conda_recipes(&ctx);
-    build_wheel_packages(&ctx);
-    generate_release(&ctx, env_name, env_name_testing, user_disabled_docker);
-    transfer_artifacts(&ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, run_tests, &ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, build_conda_recipes, &ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, build_wheel_packages, &ctx);
+    TRACE_CALL(TRACE_CAT_STAGE, generate_release, &ctx, env_name, env_name_testing, user_disabled_docker);
+    TRACE_CALL(TRACE_CAT_STAGE, transfer_artifacts, &ctx);
 
     msg(STASIS_MSG_L1, "Cleaning up\n");
     delivery_free(&ctx);
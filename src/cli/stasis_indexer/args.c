@@ -8,6 +8,7 @@ struct option long_options[] = {
     {"unbuffered", no_argument, 0, 'U'},
     {"web", no_argument, 0, 'w'},
     {"micromamba-download-url", required_argument, 0, OPT_MICROMAMBA_DOWNLOAD_URL},
+    {"rebuild", no_argument, 0, OPT_REBUILD},
     {0, 0, 0, 0},
 };
 
@@ -18,6 +19,7 @@ const char *long_options_help[] = {
     "Disable line buffering",
     "Generate HTML indexes (requires pandoc)",
     "Set micromamba download URL",
+    "Regenerate indexes whose inputs did not change",
     NULL,
 };
 
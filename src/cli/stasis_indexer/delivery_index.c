@@ -0,0 +1,393 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+#include "core.h"
+#include "delivery_index.h"
+
+struct DeliveryIndexView {
+    struct Delivery delivery;
+    char *platform[DELIVERY_PLATFORM_MAX + 1];
+};
+
+// Delivery members stored in the index (platform is handled separately)
+static const struct {
+    enum DeliveryIndexField field;
+    size_t offset;
+} delivery_index_members[] = {
+    {DELIVERY_INDEX_NAME, offsetof(struct Delivery, meta.name)},
+    {DELIVERY_INDEX_VERSION, offsetof(struct Delivery, meta.version)},
+    {DELIVERY_INDEX_PYTHON, offsetof(struct Delivery, meta.python)},
+    {DELIVERY_INDEX_PYTHON_COMPACT, offsetof(struct Delivery, meta.python_compact)},
+    {DELIVERY_INDEX_MISSION, offsetof(struct Delivery, meta.mission)},
+    {DELIVERY_INDEX_CODENAME, offsetof(struct Delivery, meta.codename)},
+    {DELIVERY_INDEX_ARCH, offsetof(struct Delivery, system.arch)},
+    {DELIVERY_INDEX_TIME, offsetof(struct Delivery, info.time_str_epoch)},
+    {DELIVERY_INDEX_RELEASE_FMT, offsetof(struct Delivery, rules.release_fmt)},
+    {DELIVERY_INDEX_RELEASE_NAME, offsetof(struct Delivery, info.release_name)},
+    {DELIVERY_INDEX_BUILD_NAME_FMT, offsetof(struct Delivery, rules.build_name_fmt)},
+    {DELIVERY_INDEX_BUILD_NAME, offsetof(struct Delivery, info.build_name)},
+    {DELIVERY_INDEX_BUILD_NUMBER_FMT, offsetof(struct Delivery, rules.build_number_fmt)},
+    {DELIVERY_INDEX_BUILD_NUMBER, offsetof(struct Delivery, info.build_number)},
+    {DELIVERY_INDEX_CONDA_INSTALLER_BASEURL, offsetof(struct Delivery, conda.installer_baseurl)},
+    {DELIVERY_INDEX_CONDA_INSTALLER_NAME, offsetof(struct Delivery, conda.installer_name)},
+    {DELIVERY_INDEX_CONDA_INSTALLER_VERSION, offsetof(struct Delivery, conda.installer_version)},
+    {DELIVERY_INDEX_CONDA_INSTALLER_PLATFORM, offsetof(struct Delivery, conda.installer_platform)},
+    {DELIVERY_INDEX_CONDA_INSTALLER_ARCH, offsetof(struct Delivery, conda.installer_arch)},
+};
+
+#define DELIVERY_MEMBER(CTX, OFFSET) (*(char **) ((char *) (CTX) + (OFFSET)))
+
+/**
+ * A record while the index is being updated. Strings point into the
+ * mapped index, or into a freshly parsed delivery context.
+ */
+struct DeliveryIndexEntry {
+    const char *field[DELIVERY_INDEX_FIELDS];
+    int rc;
+    off_t size;
+    struct timespec mtime;
+};
+
+static void delivery_index_unmap(struct DeliveryIndex *index) {
+    if (index->map) {
+        munmap(index->map, index->map_size);
+    }
+    index->map = NULL;
+    index->map_size = 0;
+    index->records = NULL;
+    index->strings = NULL;
+    index->count = 0;
+}
+
+/**
+ * Map an index file, verifying every offset it contains
+ * @return 0 on success, -1 if the file is missing or invalid
+ */
+static int delivery_index_map(struct DeliveryIndex *index) {
+    const int fd = open(index->filename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(struct DeliveryIndexHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    const struct DeliveryIndexHeader *header = map;
+    const struct DeliveryIndexRecord *records = (const void *) (header + 1);
+    const char *strings = (const char *) (records + header->count);
+    const size_t size = sizeof(*header) + header->count * sizeof(*records) + header->strings_size;
+    int valid = !memcmp(header->magic, DELIVERY_INDEX_MAGIC, sizeof(header->magic))
+                && header->format == DELIVERY_INDEX_FORMAT
+                && header->count <= (st.st_size - sizeof(*header)) / sizeof(*records)
+                && header->strings_size <= (uint64_t) st.st_size
+                && size == (size_t) st.st_size
+                && (!header->strings_size || strings[header->strings_size - 1] == '\0');
+    for (size_t i = 0; valid && i < header->count; i++) {
+        valid = records[i].field[DELIVERY_INDEX_METAFILE] != 0;
+        for (size_t f = 0; valid && f < DELIVERY_INDEX_FIELDS; f++) {
+            if (records[i].field[f] > header->strings_size) {
+                valid = 0;
+                break;
+            }
+        }
+    }
+    if (!valid) {
+        SYSWARN("%s: invalid delivery index. Ignoring.", index->filename);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    index->map = map;
+    index->map_size = st.st_size;
+    index->records = records;
+    index->strings = strings;
+    index->count = header->count;
+    return 0;
+}
+
+struct DeliveryIndex *delivery_index_open(const char *filename, const int load) {
+    struct DeliveryIndex *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+    index->filename = strdup(filename);
+    if (!index->filename) {
+        guard_free(index);
+        return NULL;
+    }
+    if (load) {
+        delivery_index_map(index);
+    }
+    return index;
+}
+
+const char *delivery_index_get(const struct DeliveryIndex *index, const size_t record, const enum DeliveryIndexField field) {
+    const uint32_t offset = index->records[record].field[field];
+    return offset ? &index->strings[offset - 1] : NULL;
+}
+
+// qsort callback to sort index entries. Keep in sync with sort_by_latest_rc().
+static int delivery_index_entry_cmpfn(const void *a, const void *b) {
+    const struct DeliveryIndexEntry *aa = a;
+    const struct DeliveryIndexEntry *bb = b;
+    if (aa->rc != bb->rc) {
+        return aa->rc > bb->rc ? -1 : 1;
+    }
+
+    const char *platform_a = aa->field[DELIVERY_INDEX_PLATFORM + DELIVERY_PLATFORM_RELEASE];
+    const char *platform_b = bb->field[DELIVERY_INDEX_PLATFORM + DELIVERY_PLATFORM_RELEASE];
+    const int platform = strcmp(platform_a ? platform_a : "", platform_b ? platform_b : "");
+    if (platform) {
+        return platform;
+    }
+
+    const char *python_a = aa->field[DELIVERY_INDEX_PYTHON_COMPACT];
+    const char *python_b = bb->field[DELIVERY_INDEX_PYTHON_COMPACT];
+    const unsigned long pyc_a = python_a ? strtoul(python_a, NULL, 10) : 0;
+    const unsigned long pyc_b = python_b ? strtoul(python_b, NULL, 10) : 0;
+    if (pyc_a != pyc_b) {
+        return pyc_a > pyc_b ? -1 : 1;
+    }
+
+    // Stable output for identical keys
+    const char *release_a = aa->field[DELIVERY_INDEX_RELEASE_NAME];
+    const char *release_b = bb->field[DELIVERY_INDEX_RELEASE_NAME];
+    const int release = strcmp(release_a ? release_a : "", release_b ? release_b : "");
+    if (release) {
+        return release;
+    }
+    return strcmp(aa->field[DELIVERY_INDEX_METAFILE], bb->field[DELIVERY_INDEX_METAFILE]);
+}
+
+static void delivery_index_entry_from_delivery(struct DeliveryIndexEntry *entry, const struct Delivery *ctx) {
+    for (size_t i = 0; i < sizeof(delivery_index_members) / sizeof(*delivery_index_members); i++) {
+        entry->field[delivery_index_members[i].field] = DELIVERY_MEMBER(ctx, delivery_index_members[i].offset);
+    }
+    for (size_t i = 0; ctx->system.platform && i < DELIVERY_PLATFORM_MAX && ctx->system.platform[i]; i++) {
+        entry->field[DELIVERY_INDEX_PLATFORM + i] = ctx->system.platform[i];
+    }
+    entry->rc = ctx->meta.rc;
+}
+
+static int delivery_index_write(const char *filename, const struct DeliveryIndexEntry *entries, const size_t count) {
+    struct DeliveryIndexRecord *records = calloc(count ? count : 1, sizeof(*records));
+    if (!records) {
+        SYSERROR("unable to allocate bytes for delivery index records");
+        return -1;
+    }
+
+    // Build the string table
+    size_t strings_size = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t f = 0; f < DELIVERY_INDEX_FIELDS; f++) {
+            if (entries[i].field[f]) {
+                strings_size += strlen(entries[i].field[f]) + 1;
+            }
+        }
+    }
+    if (strings_size > UINT32_MAX) {
+        SYSERROR("delivery index string table is too large");
+        guard_free(records);
+        return -1;
+    }
+    char *strings = malloc(strings_size ? strings_size : 1);
+    if (!strings) {
+        SYSERROR("unable to allocate bytes for delivery index strings");
+        guard_free(records);
+        return -1;
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t f = 0; f < DELIVERY_INDEX_FIELDS; f++) {
+            const char *value = entries[i].field[f];
+            if (!value) {
+                continue;
+            }
+            const size_t len = strlen(value) + 1;
+            memcpy(strings + used, value, len);
+            records[i].field[f] = (uint32_t) used + 1;
+            used += len;
+        }
+        records[i].rc = entries[i].rc;
+        records[i].size = entries[i].size;
+        records[i].mtime_sec = entries[i].mtime.tv_sec;
+        records[i].mtime_nsec = entries[i].mtime.tv_nsec;
+    }
+
+    struct DeliveryIndexHeader header = {
+        .format = DELIVERY_INDEX_FORMAT,
+        .count = (uint32_t) count,
+        .strings_size = strings_size,
+    };
+    memcpy(header.magic, DELIVERY_INDEX_MAGIC, sizeof(header.magic));
+
+    int status = -1;
+    char tempfile[PATH_MAX] = {0};
+    snprintf(tempfile, sizeof(tempfile), "%s.XXXXXX", filename);
+    const int fd = mkstemp(tempfile);
+    FILE *fp = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (!fp) {
+        SYSERROR("unable to create temporary file: %s: %s", tempfile, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+            remove(tempfile);
+        }
+        goto cleanup;
+    }
+    fchmod(fd, 0644);
+    if (fwrite(&header, sizeof(header), 1, fp) != 1
+        || (count && fwrite(records, sizeof(*records), count, fp) != count)
+        || (strings_size && fwrite(strings, strings_size, 1, fp) != 1)
+        || fflush(fp)) {
+        SYSERROR("unable to write %s: %s", tempfile, strerror(errno));
+        fclose(fp);
+        remove(tempfile);
+        goto cleanup;
+    }
+    fclose(fp);
+    if (rename(tempfile, filename) < 0) {
+        SYSERROR("unable to replace %s: %s", filename, strerror(errno));
+        remove(tempfile);
+        goto cleanup;
+    }
+    status = 0;
+
+    cleanup:
+    guard_free(records);
+    guard_free(strings);
+    return status;
+}
+
+int delivery_index_update(struct DeliveryIndex *index, struct StrList *metafiles) {
+    const size_t total = strlist_count(metafiles);
+    struct DeliveryIndexEntry *entries = calloc(total ? total : 1, sizeof(*entries));
+    struct Delivery **parsed = calloc(total + 1, sizeof(*parsed));
+    struct StrList *names = strlist_init_mode(STRLIST_MODE_INTERN);
+    int status = -1;
+    if (!entries || !parsed || !names) {
+        SYSERROR("unable to allocate bytes for delivery index update");
+        goto cleanup;
+    }
+
+    // Existing records by metadata file name
+    for (size_t i = 0; i < index->count; i++) {
+        strlist_append(&names, (char *) delivery_index_get(index, i, DELIVERY_INDEX_METAFILE));
+    }
+
+    size_t count = 0;
+    size_t unchanged = 0;
+    index->parsed = 0;
+    for (size_t i = 0; i < total; i++) {
+        char *path = strlist_item(metafiles, i);
+        struct stat st;
+        if (stat(path, &st) < 0) {
+            SYSWARN("%s: %s", path, strerror(errno));
+            continue;
+        }
+
+        struct DeliveryIndexEntry *entry = &entries[count];
+        size_t record = 0;
+        if (strlist_find(names, path_basename(path), &record)
+            && index->records[record].size == st.st_size
+            && index->records[record].mtime_sec == st.st_mtim.tv_sec
+            && index->records[record].mtime_nsec == st.st_mtim.tv_nsec) {
+            // Unchanged
+            for (size_t f = 0; f < DELIVERY_INDEX_FIELDS; f++) {
+                entry->field[f] = delivery_index_get(index, record, f);
+            }
+            entry->rc = index->records[record].rc;
+            unchanged++;
+        } else {
+            struct Delivery *ctx = calloc(1, sizeof(*ctx));
+            if (!ctx) {
+                SYSERROR("unable to allocate bytes for delivery context");
+                goto cleanup;
+            }
+            parsed[index->parsed++] = ctx;
+            if (load_metadata(ctx, path)) {
+                SYSWARN("%s: unable to read metadata", path);
+                continue;
+            }
+            delivery_index_entry_from_delivery(entry, ctx);
+            entry->field[DELIVERY_INDEX_METAFILE] = path_basename(path);
+        }
+        entry->size = st.st_size;
+        entry->mtime = st.st_mtim;
+        count++;
+    }
+
+    if (unchanged == count && count == index->count) {
+        status = 0;
+        goto cleanup;
+    }
+
+    qsort(entries, count, sizeof(*entries), delivery_index_entry_cmpfn);
+    if (delivery_index_write(index->filename, entries, count)) {
+        goto cleanup;
+    }
+    delivery_index_unmap(index);
+    if (delivery_index_map(index)) {
+        SYSERROR("unable to load delivery index: %s", index->filename);
+        goto cleanup;
+    }
+    status = 0;
+
+    cleanup:
+    for (size_t i = 0; parsed && parsed[i]; i++) {
+        delivery_free(parsed[i]);
+        guard_free(parsed[i]);
+    }
+    guard_free(parsed);
+    guard_free(entries);
+    guard_strlist_free(&names);
+    return status;
+}
+
+struct Delivery **delivery_index_deliveries(struct DeliveryIndex *index, const struct Delivery *base) {
+    guard_free(index->views);
+    index->views = calloc(index->count ? index->count : 1, sizeof(*index->views));
+    struct Delivery **result = calloc(index->count + 1, sizeof(*result));
+    if (!index->views || !result) {
+        SYSERROR("unable to allocate bytes for delivery contexts");
+        guard_free(index->views);
+        guard_free(result);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < index->count; i++) {
+        struct DeliveryIndexView *view = &index->views[i];
+        struct Delivery *ctx = &view->delivery;
+        ctx->storage = base->storage;
+        for (size_t m = 0; m < sizeof(delivery_index_members) / sizeof(*delivery_index_members); m++) {
+            DELIVERY_MEMBER(ctx, delivery_index_members[m].offset) = (char *) delivery_index_get(index, i, delivery_index_members[m].field);
+        }
+        for (size_t p = 0; p < DELIVERY_PLATFORM_MAX; p++) {
+            view->platform[p] = (char *) delivery_index_get(index, i, DELIVERY_INDEX_PLATFORM + p);
+            if (!view->platform[p]) {
+                break;
+            }
+        }
+        ctx->system.platform = view->platform[0] ? view->platform : NULL;
+        ctx->meta.rc = index->records[i].rc;
+        result[i] = ctx;
+    }
+    return result;
+}
+
+void delivery_index_free(struct DeliveryIndex **index) {
+    if (!*index) {
+        return;
+    }
+    delivery_index_unmap(*index);
+    guard_free((*index)->views);
+    guard_free((*index)->filename);
+    guard_free(*index);
+}
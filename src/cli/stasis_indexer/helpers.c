@@ -8,24 +8,21 @@
 #include "helpers.h"
 
 struct StrList *get_architectures(struct Delivery **ctx, const size_t nelem) {
-    struct StrList *architectures = strlist_init();
+    // Interned lists discard duplicate records
+    struct StrList *architectures = strlist_init_mode(STRLIST_MODE_INTERN);
     for (size_t i = 0; i < nelem; i++) {
         if (ctx[i]->system.arch) {
-            if (!strstr_array(architectures->data, ctx[i]->system.arch)) {
-                strlist_append(&architectures, ctx[i]->system.arch);
-            }
+            strlist_append(&architectures, ctx[i]->system.arch);
         }
     }
     return architectures;
 }
 
 struct StrList *get_platforms(struct Delivery **ctx, const size_t nelem) {
-    struct StrList *platforms = strlist_init();
+    struct StrList *platforms = strlist_init_mode(STRLIST_MODE_INTERN);
     for (size_t i = 0; i < nelem; i++) {
         if (ctx[i]->system.platform) {
-            if (!strstr_array(platforms->data, ctx[i]->system.platform[DELIVERY_PLATFORM_RELEASE])) {
-                strlist_append(&platforms, ctx[i]->system.platform[DELIVERY_PLATFORM_RELEASE]);
-            }
+            strlist_append(&platforms, ctx[i]->system.platform[DELIVERY_PLATFORM_RELEASE]);
         }
     }
     return platforms;
@@ -87,64 +84,88 @@ int get_pandoc_version(size_t *result) {
     return 0;
 }
 
-int pandoc_exec(const char *in_file, const char *out_file, const char *css_file, const char *title) {
-    if (!find_program("pandoc")) {
-        SYSWARN("pandoc is not installed: unable to generate HTML indexes");
-        return 0;
+struct ProcessHandle *pandoc_spawn(const char *in_file, const char *out_file, const char *css_file, const char *title) {
+    // The installed version doesn't change during a run. Only ask once.
+    static int pandoc_version_status = -2;
+    static size_t pandoc_version = 0;
+    if (pandoc_version_status == -2) {
+        pandoc_version_status = get_pandoc_version(&pandoc_version);
     }
 
-    char pandoc_versioned_args[255] = {0};
-    size_t pandoc_version = 0;
-    if (!get_pandoc_version(&pandoc_version)) {
+    char *argv[32] = {0};
+    size_t argc = 0;
+    argv[argc++] = "pandoc";
+    if (!pandoc_version_status) {
         // < 2.19
         if (pandoc_version < 0x02130000) {
-            safe_strncat(pandoc_versioned_args, "--self-contained ", sizeof(pandoc_versioned_args));
+            argv[argc++] = "--self-contained";
         } else {
             // >= 2.19
-            safe_strncat(pandoc_versioned_args, "--embed-resources ", sizeof(pandoc_versioned_args));
+            argv[argc++] = "--embed-resources";
         }
 
         // >= 1.15.0.4
         if (pandoc_version >= 0x010f0004) {
-            safe_strncat(pandoc_versioned_args, "--standalone ", sizeof(pandoc_versioned_args));
+            argv[argc++] = "--standalone";
         }
 
         // >= 1.10.0.1
         if (pandoc_version >= 0x010a0001) {
-            safe_strncat(pandoc_versioned_args, "-f gfm+autolink_bare_uris ", sizeof(pandoc_versioned_args));
+            argv[argc++] = "-f";
+            argv[argc++] = "gfm+autolink_bare_uris";
         }
 
         // > 3.1.9
         if (pandoc_version > 0x03010900) {
-            safe_strncat(pandoc_versioned_args, "-f gfm+alerts ", sizeof(pandoc_versioned_args));
+            argv[argc++] = "-f";
+            argv[argc++] = "gfm+alerts";
         }
     }
 
-    // Converts a markdown file to html
-    char cmd[STASIS_BUFSIZ] = {0};
-    safe_strncpy(cmd, "pandoc ", sizeof(cmd));
-
-    safe_strncat(cmd, pandoc_versioned_args, sizeof(cmd));
-
     if (css_file && strlen(css_file)) {
-        safe_strncat(cmd, "--css ", sizeof(cmd));
-        safe_strncat(cmd, css_file, sizeof(cmd));
-    }
-    safe_strncat(cmd, " ", sizeof(cmd));
-    safe_strncat(cmd, "--metadata title=\"", sizeof(cmd));
-    safe_strncat(cmd, title, sizeof(cmd));
-    safe_strncat(cmd, "\" ", sizeof(cmd));
-    safe_strncat(cmd, "-o ", sizeof(cmd));
-    safe_strncat(cmd, out_file, sizeof(cmd));
-    safe_strncat(cmd, " ", sizeof(cmd));
-    safe_strncat(cmd, in_file, sizeof(cmd));
+        argv[argc++] = "--css";
+        argv[argc++] = (char *) css_file;
+    }
+
+    char *title_arg = NULL;
+    if (asprintf(&title_arg, "title=%s", title) < 0) {
+        SYSERROR("unable to allocate bytes for pandoc title");
+        return NULL;
+    }
+    argv[argc++] = "--metadata";
+    argv[argc++] = title_arg;
+    argv[argc++] = "-o";
+    argv[argc++] = (char *) out_file;
+    argv[argc++] = (char *) in_file;
 
     if (globals.verbose) {
-        puts(cmd);
+        for (size_t i = 0; i < argc; i++) {
+            printf("%s%s", argv[i], i + 1 < argc ? " " : "\n");
+        }
+    }
+
+    // Converts a markdown file to html
+    struct ProcessHandle *result = shell_spawn(argv, SHELL_CAPTURE_MERGE);
+    guard_free(title_arg);
+    return result;
+}
+
+int pandoc_exec(const char *in_file, const char *out_file, const char *css_file, const char *title) {
+    if (!find_program("pandoc")) {
+        SYSWARN("pandoc is not installed: unable to generate HTML indexes");
+        return 0;
     }
 
-    // This might be negative when killed by a signal.
-    return system(cmd);
+    struct ProcessHandle *proc = pandoc_spawn(in_file, out_file, css_file, title);
+    if (!proc) {
+        return -1;
+    }
+    const int result = shell_wait(proc);
+    if (result && proc->output.out_len) {
+        fprintf(stderr, "%s", proc->output.out);
+    }
+    shell_handle_free(&proc);
+    return result;
 }
 
 
@@ -218,7 +239,7 @@ int sort_by_latest_rc(const void *a, const void *b) {
     unsigned pyc_b = strtoul(bb->meta.python_compact, &err, 10);
     if (pyc_a > pyc_b) {
         return -1;
-    } else if (pyc_b < pyc_a) {
+    } else if (pyc_a < pyc_b) {
         return 1;
     } else {
         return 0;
@@ -236,7 +257,13 @@ struct Delivery **get_latest_deliveries(struct Delivery **ctx, size_t nelem, siz
     }
 
     latest = get_latest_rc(ctx, nelem);
-    qsort(ctx, nelem, sizeof(*ctx), sort_by_latest_rc);
+    // Records from the delivery index are already in order
+    for (size_t i = 1; i < nelem; i++) {
+        if (sort_by_latest_rc(&ctx[i - 1], &ctx[i]) > 0) {
+            qsort(ctx, nelem, sizeof(*ctx), sort_by_latest_rc);
+            break;
+        }
+    }
     for (size_t i = 0; i < nelem; i++) {
         if (ctx[i]->meta.rc == latest) {
             result[n] = ctx[i];
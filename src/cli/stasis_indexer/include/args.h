@@ -4,6 +4,7 @@
 #include <getopt.h>
 
 #define OPT_MICROMAMBA_DOWNLOAD_URL 1000
+#define OPT_REBUILD 1001
 
 extern struct option long_options[];
 void usage(char *name);
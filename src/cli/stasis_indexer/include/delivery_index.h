@@ -0,0 +1,134 @@
+#ifndef DELIVERY_INDEX_H
+#define DELIVERY_INDEX_H
+
+#include <stdint.h>
+#include "helpers.h"
+
+//! Identifies a delivery index file
+#define DELIVERY_INDEX_MAGIC "STASISDI"
+//! Incremented when the layout of DeliveryIndexRecord changes
+#define DELIVERY_INDEX_FORMAT 1
+
+//! String fields of a delivery record
+enum DeliveryIndexField {
+    DELIVERY_INDEX_METAFILE = 0,
+    DELIVERY_INDEX_NAME,
+    DELIVERY_INDEX_VERSION,
+    DELIVERY_INDEX_PYTHON,
+    DELIVERY_INDEX_PYTHON_COMPACT,
+    DELIVERY_INDEX_MISSION,
+    DELIVERY_INDEX_CODENAME,
+    DELIVERY_INDEX_PLATFORM,
+    DELIVERY_INDEX_PLATFORM_LAST = DELIVERY_INDEX_PLATFORM + DELIVERY_PLATFORM_MAX - 1,
+    DELIVERY_INDEX_ARCH,
+    DELIVERY_INDEX_TIME,
+    DELIVERY_INDEX_RELEASE_FMT,
+    DELIVERY_INDEX_RELEASE_NAME,
+    DELIVERY_INDEX_BUILD_NAME_FMT,
+    DELIVERY_INDEX_BUILD_NAME,
+    DELIVERY_INDEX_BUILD_NUMBER_FMT,
+    DELIVERY_INDEX_BUILD_NUMBER,
+    DELIVERY_INDEX_CONDA_INSTALLER_BASEURL,
+    DELIVERY_INDEX_CONDA_INSTALLER_NAME,
+    DELIVERY_INDEX_CONDA_INSTALLER_VERSION,
+    DELIVERY_INDEX_CONDA_INSTALLER_PLATFORM,
+    DELIVERY_INDEX_CONDA_INSTALLER_ARCH,
+    DELIVERY_INDEX_FIELDS,
+};
+
+struct DeliveryIndexHeader {
+    char magic[8]; ///< DELIVERY_INDEX_MAGIC
+    uint32_t format; ///< DELIVERY_INDEX_FORMAT
+    uint32_t count; ///< Number of records
+    uint64_t strings_size; ///< Size of the string table following the records
+};
+
+struct DeliveryIndexRecord {
+    uint32_t field[DELIVERY_INDEX_FIELDS]; ///< Offset of each string in the string table + 1 (0 is NULL)
+    int32_t rc; ///< Build iteration
+    uint32_t reserved;
+    int64_t size; ///< Size of the metadata file
+    int64_t mtime_sec; ///< Modification time of the metadata file
+    int64_t mtime_nsec;
+};
+
+struct DeliveryIndex {
+    char *filename; ///< Path to the index file
+    void *map; ///< Memory-mapped index file
+    size_t map_size;
+    const struct DeliveryIndexRecord *records; ///< Sorted records
+    const char *strings; ///< String table
+    size_t count; ///< Number of records
+    size_t parsed; ///< Number of metadata files parsed by delivery_index_update()
+    struct DeliveryIndexView *views; ///< Storage for delivery_index_deliveries()
+};
+
+/**
+ * Open a delivery index
+ *
+ * A delivery index holds the fields of every *.stasis metadata file the
+ * indexer needs. Records are sorted by release candidate (descending),
+ * platform, and Python version (descending), the order used by
+ * get_latest_deliveries().
+ *
+ * ```c
+ * struct DeliveryIndex *index = delivery_index_open("/dest/.stasis_indexer.records", 1);
+ * if (!index || delivery_index_update(index, metafiles)) {
+ *     // error
+ * }
+ * struct Delivery **deliveries = delivery_index_deliveries(index, &ctx);
+ * for (size_t i = 0; i < index->count; i++) {
+ *     puts(deliveries[i]->info.release_name);
+ * }
+ * guard_free(deliveries);
+ * delivery_index_free(&index);
+ * ```
+ *
+ * @param filename path to index file (need not exist)
+ * @param load zero to ignore the existing index
+ * @return pointer to DeliveryIndex, or NULL on error
+ */
+struct DeliveryIndex *delivery_index_open(const char *filename, int load);
+
+/**
+ * Bring the index up to date with a list of metadata files
+ *
+ * Only metadata files that are new, or whose size or modification time
+ * changed, are parsed. Records of files not in the list are dropped. The
+ * index file is rewritten only when a record changed.
+ *
+ * @param index pointer to DeliveryIndex
+ * @param metafiles paths to *.stasis files
+ * @return 0 on success, -1 on error
+ */
+int delivery_index_update(struct DeliveryIndex *index, struct StrList *metafiles);
+
+/**
+ * Return a string field of a record
+ * @param index pointer to DeliveryIndex
+ * @param record record number
+ * @param field DELIVERY_INDEX_*
+ * @return string, or NULL if the field is not set
+ */
+const char *delivery_index_get(const struct DeliveryIndex *index, size_t record, enum DeliveryIndexField field);
+
+/**
+ * Present the records as delivery contexts
+ *
+ * The delivery contexts share the storage paths of `base`, and their
+ * strings point into the index. They must not be modified or passed to
+ * delivery_free(), and are valid until delivery_index_free() is called.
+ *
+ * @param index pointer to DeliveryIndex
+ * @param base delivery context providing storage paths
+ * @return array of index->count Delivery pointers (free the array only), or NULL on error
+ */
+struct Delivery **delivery_index_deliveries(struct DeliveryIndex *index, const struct Delivery *base);
+
+/**
+ * Release a DeliveryIndex
+ * @param index pointer to DeliveryIndex pointer (set to NULL)
+ */
+void delivery_index_free(struct DeliveryIndex **index);
+
+#endif //DELIVERY_INDEX_H
@@ -3,6 +3,7 @@
 
 #include "delivery.h"
 #include "conda.h"
+#include "content_manifest.h"
 
 #define ARRAY_COUNT_DYNAMIC(X, COUNTER) \
     do { \
@@ -17,8 +18,10 @@
 struct StrList *get_architectures(struct Delivery **ctx, size_t nelem);
 struct StrList *get_platforms(struct Delivery **ctx, size_t nelem);
 int get_pandoc_version(size_t *result);
+struct ProcessHandle *pandoc_spawn(const char *in_file, const char *out_file, const char *css_file, const char *title);
 int pandoc_exec(const char *in_file, const char *out_file, const char *css_file, const char *title);
 int get_latest_rc(struct Delivery **ctx, size_t nelem);
+int sort_by_latest_rc(const void *a, const void *b);
 struct Delivery **get_latest_deliveries(struct Delivery **ctx, size_t nelem, size_t *result_nelem);
 int get_files(struct StrList **out, const char *path, const char *pattern, ...);
 struct StrList *get_docker_images(struct Delivery *ctx, char *pattern);
@@ -3,6 +3,6 @@
 
 #include "helpers.h"
 
-int indexer_make_website(struct Delivery **ctx);
+int indexer_make_website(struct Delivery **ctx, struct ContentManifest *manifest);
 
 #endif //WEBSITE_H
@@ -19,7 +19,59 @@ static int is_file_in_listing(struct StrList *list, const char *pattern) {
     return 0;
 }
 
-static int write_report_output(struct Delivery *ctx, FILE *destfp, const char *xmlfilename) {
+/**
+ * Path to the markdown report generated from a junit xml file
+ */
+static void report_destination(const struct Delivery *ctx, char *dest, size_t maxlen, const char *xmlfilename) {
+    snprintf(dest, maxlen, "%s/%s", ctx->storage.results_dir, path_basename((char *) xmlfilename));
+    if (endswith(dest, ".xml")) {
+        dest[strlen(dest) - 4] = '\0';
+    }
+    safe_strncat(dest, ".md", maxlen);
+}
+
+/**
+ * Restore a report generated by the previous run when the junit xml file did not change
+ * @return 1 if the report was restored, 0 if it must be generated
+ */
+static int report_reuse(const struct Delivery *ctx, FILE *destfp, const char *xmlfilename, struct ContentManifest *manifest, char digest[SHA256_HEX_SIZE]) {
+    *digest = '\0';
+    if (!manifest) {
+        return 0;
+    }
+
+    char *salt = NULL;
+    if (asprintf(&salt, "junitxml %s %s", VERSION, ctx->info.release_name) < 0) {
+        SYSERROR("unable to allocate bytes for report salt");
+        return 0;
+    }
+    char *inputs[] = {(char *) xmlfilename};
+    const int status = content_manifest_digest(manifest, inputs, 1, salt, digest);
+    guard_free(salt);
+    if (status) {
+        *digest = '\0';
+        return 0;
+    }
+
+    char dest[PATH_MAX] = {0};
+    const char *row = NULL;
+    report_destination(ctx, dest, sizeof(dest), xmlfilename);
+    if (!content_manifest_reuse(manifest, dest, digest, &row) || !row) {
+        return 0;
+    }
+    if (globals.verbose) {
+        printf("%s: unchanged\n", xmlfilename);
+    }
+    fputs(row, destfp);
+    return 1;
+}
+
+static int write_report_output(struct Delivery *ctx, FILE *destfp, const char *xmlfilename, struct ContentManifest *manifest) {
+    char digest[SHA256_HEX_SIZE] = {0};
+    if (report_reuse(ctx, destfp, xmlfilename, manifest, digest)) {
+        return 0;
+    }
+
     struct JUNIT_Testsuite *testsuite = junitxml_testsuite_read(xmlfilename);
     if (testsuite) {
         if (globals.verbose) {
@@ -61,13 +113,20 @@ static int write_report_output(struct Delivery *ctx, FILE *destfp, const char *x
         replace_text(short_name, "results-", "", 0);
         guard_free(short_name_pattern);
 
-        fprintf(destfp, "|%s ([log](%s.md)) ([xml](%s.xml))|%0.4f|%d|%d|%d|%d|%d|\n",
+        char *row = NULL;
+        if (asprintf(&row, "|%s ([log](%s.md)) ([xml](%s.xml))|%0.4f|%d|%d|%d|%d|%d|\n",
                 short_name,
                 bname,
                 bname,
                 testsuite->time, testsuite->tests,
                 testsuite->passed, testsuite->failures,
-                testsuite->skipped, testsuite->errors);
+                testsuite->skipped, testsuite->errors) < 0) {
+            SYSERROR("unable to allocate bytes for summary row");
+            guard_free(bname);
+            junitxml_testsuite_free(&testsuite);
+            return -1;
+        }
+        fputs(row, destfp);
 
         snprintf(result_outfile, sizeof(result_outfile) - strlen(bname), "%s.md", bname);
         guard_free(bname);
@@ -75,6 +134,8 @@ static int write_report_output(struct Delivery *ctx, FILE *destfp, const char *x
         FILE *resultfp = fopen(result_outfile, "w+");
         if (!resultfp) {
             SYSERROR("Unable to open %s for writing", result_outfile);
+            guard_free(row);
+            junitxml_testsuite_free(&testsuite);
             return -1;
         }
 
@@ -106,13 +167,20 @@ static int write_report_output(struct Delivery *ctx, FILE *destfp, const char *x
         }
         junitxml_testsuite_free(&testsuite);
         fclose(resultfp);
+
+        if (manifest && *digest) {
+            char dest[PATH_MAX] = {0};
+            report_destination(ctx, dest, sizeof(dest), xmlfilename);
+            content_manifest_store(manifest, dest, digest, row);
+        }
+        guard_free(row);
     } else {
         SYSWARN("bad test suite: %s: %s", strerror(errno), xmlfilename);
     }
     return 0;
 }
 
-int indexer_junitxml_report(struct Delivery **ctx, const size_t nelem) {
+int indexer_junitxml_report(struct Delivery **ctx, const size_t nelem, struct ContentManifest *manifest) {
     char indexfile[PATH_MAX] = {0};
     snprintf(indexfile, sizeof(indexfile), "%s/README.md", (*ctx)->storage.results_dir);
 
@@ -155,7 +223,7 @@ int indexer_junitxml_report(struct Delivery **ctx, const size_t nelem) {
                     continue;
                 }
                 if (!fnmatch(pattern, filename, 0)) {
-                    if (write_report_output(ctx[d], indexfp, filename)) {
+                    if (write_report_output(ctx[d], indexfp, filename, manifest)) {
                         // warn only
                         SYSERROR("Unable to write xml report file using %s", filename);
                     }
@@ -1,7 +1,48 @@
 #include "core.h"
 #include "readmes.h"
 
-int indexer_readmes(struct Delivery **ctx, const size_t nelem) {
+/**
+ * Restore the README generated by the previous run when the delivery metadata and docker archives did not change
+ * @return 1 if the README was restored, 0 if it must be generated
+ */
+static int readme_reuse(const struct Delivery *ctx, const char *indexfile, struct ContentManifest *manifest, char digest[SHA256_HEX_SIZE]) {
+    *digest = '\0';
+    if (!manifest) {
+        return 0;
+    }
+
+    struct StrList *metafiles = NULL;
+    if (get_files(&metafiles, ctx->storage.meta_dir, "*.stasis")) {
+        guard_strlist_free(&metafiles);
+        return 0;
+    }
+
+    // The README links to docker archives by name. listdir() order depends on the file system.
+    char *docker_listing = NULL;
+    struct StrList *docker_images = listdir(ctx->storage.docker_artifact_dir);
+    if (docker_images) {
+        strlist_sort(docker_images, STASIS_SORT_ALPHA);
+        docker_listing = join(docker_images->data, "\n");
+        guard_strlist_free(&docker_images);
+    }
+
+    char *salt = NULL;
+    int status = -1;
+    if (asprintf(&salt, "readme %s %s\n%s", VERSION, ctx->rules.release_fmt ? ctx->rules.release_fmt : "",
+                 docker_listing ? docker_listing : "") >= 0) {
+        status = content_manifest_digest(manifest, metafiles->data, strlist_count(metafiles), salt, digest);
+    }
+    guard_free(salt);
+    guard_free(docker_listing);
+    guard_strlist_free(&metafiles);
+    if (status) {
+        *digest = '\0';
+        return 0;
+    }
+    return content_manifest_reuse(manifest, indexfile, digest, NULL);
+}
+
+int indexer_readmes(struct Delivery **ctx, const size_t nelem, struct ContentManifest *manifest) {
     size_t nelem_real = 0;
     struct Delivery **latest_deliveries = get_latest_deliveries(ctx, nelem, &nelem_real);
     if (!latest_deliveries) {
@@ -14,6 +55,15 @@ int indexer_readmes(struct Delivery **ctx, const size_t nelem) {
     char indexfile[PATH_MAX] = {0};
     snprintf(indexfile, sizeof(indexfile), "%s/README.md", (*ctx)->storage.delivery_dir);
 
+    char digest[SHA256_HEX_SIZE] = {0};
+    if (readme_reuse(*ctx, indexfile, manifest, digest)) {
+        if (globals.verbose) {
+            printf("%s: unchanged\n", indexfile);
+        }
+        guard_free(latest_deliveries);
+        return 0;
+    }
+
     FILE *indexfp = fopen(indexfile, "w+");
     if (!indexfp) {
         SYSERROR("Unable to open %s for writing", indexfile);
@@ -124,6 +174,9 @@ int indexer_readmes(struct Delivery **ctx, const size_t nelem) {
     guard_strlist_free(&archs);
     guard_strlist_free(&platforms);
     fclose(indexfp);
+    if (manifest && *digest) {
+        content_manifest_store(manifest, indexfile, digest, NULL);
+    }
 
     // "latest_deliveries" is an array of pointers to ctxs[]. Do not free the contents of the array.
     guard_free(latest_deliveries);
@@ -6,12 +6,17 @@
 #include "website.h"
 #include "readmes.h"
 #include "delivery.h"
+#include "delivery_index.h"
 
 int indexer_combine_rootdirs(const char *dest, char **rootdirs, const size_t rootdirs_total) {
-    char cmd[PATH_MAX] = {0};
     char destdir_bare[PATH_MAX] = {0};
     char destdir_with_output[PATH_MAX] = {0};
     char *destdir = destdir_bare;
+    char *exclude[] = {"tools/", "tmp/", "build/", NULL};
+    struct SyncOptions opts = {
+        .flags = SYNC_DELETE | (globals.verbose ? SYNC_VERBOSE : 0),
+        .exclude = exclude,
+    };
 
     safe_strncpy(destdir_bare, dest, sizeof(destdir_bare));
 
@@ -23,7 +28,12 @@ int indexer_combine_rootdirs(const char *dest, char **rootdirs, const size_t roo
         destdir = destdir_with_output;
     }
 
-    snprintf(cmd, sizeof(cmd), "rsync -ah%s --delete --exclude 'tools/' --exclude 'tmp/' --exclude 'build/' ", globals.verbose ? "v" : "q");
+    char **srcdirs = calloc(rootdirs_total + 1, sizeof(*srcdirs));
+    if (!srcdirs) {
+        SYSERROR("unable to allocate memory for source directories");
+        return -1;
+    }
+    size_t srcdirs_total = 0;
     for (size_t i = 0; i < rootdirs_total; i++) {
         char srcdir_bare[PATH_MAX] = {0};
         char srcdir_with_output[PATH_MAX] = {0};
@@ -42,17 +52,25 @@ int indexer_combine_rootdirs(const char *dest, char **rootdirs, const size_t roo
         if (!access(srcdir_with_output, F_OK)) {
             srcdir = srcdir_with_output;
         }
-        snprintf(cmd + strlen(cmd), sizeof(cmd) - strlen(cmd) - non_format_len("'%s'/ "), "'%s'/ ", srcdir);
-    }
-    snprintf(cmd + strlen(cmd), sizeof(cmd) - strlen(cmd) - non_format_len(" %s/"), " %s/", destdir);
-
-    if (globals.verbose) {
-        puts(cmd);
+        srcdirs[srcdirs_total] = strdup(srcdir);
+        if (!srcdirs[srcdirs_total]) {
+            SYSERROR("unable to allocate memory for source directory");
+            guard_array_free(srcdirs);
+            return -1;
+        }
+        srcdirs_total++;
     }
 
-    if (system(cmd)) {
+    struct SyncStats stats = {0};
+    const int status = sync_trees(srcdirs, srcdirs_total, destdir, &opts, &stats);
+    guard_array_free(srcdirs);
+    if (status) {
         return -1;
     }
+    if (globals.verbose) {
+        printf("%zu file(s) copied (%zu bytes), %zu up to date, %zu deleted\n",
+               stats.files_copied, stats.bytes_copied, stats.files_skipped, stats.files_deleted);
+    }
     return 0;
 }
 
@@ -168,6 +186,7 @@ int main(const int argc, char *argv[]) {
     char *destdir = NULL;
     char **rootdirs = NULL;
     int do_html = 0;
+    int do_rebuild = 0;
     int c = 0;
     int option_index = 0;
     while ((c = getopt_long(argc, argv, "hd:vUw", long_options, &option_index)) != -1) {
@@ -204,6 +223,9 @@ int main(const int argc, char *argv[]) {
                     exit(1);
                 }
                 break;
+            case OPT_REBUILD:
+                do_rebuild = 1;
+                break;
             case '?':
             default:
                 exit(1);
@@ -342,6 +364,15 @@ int main(const int argc, char *argv[]) {
 
     indexer_init_dirs(&ctx, workdir);
 
+    // Indexes generated by the previous run are reused from the destination directory when their inputs are unchanged
+    const char *content_manifest_name = ".stasis_indexer.manifest";
+    char content_manifest_path[PATH_MAX] = {0};
+    snprintf(content_manifest_path, sizeof(content_manifest_path), "%s/%s", destdir, content_manifest_name);
+    struct ContentManifest *content_manifest = content_manifest_open(content_manifest_path, do_rebuild ? NULL : destdir, ctx.storage.output_dir);
+    if (!content_manifest) {
+        SYSWARN("Unable to open content manifest: %s", content_manifest_path);
+    }
+
     msg(STASIS_MSG_L1, "%s delivery root %s\n",
         rootdirs_total > 1 ? "Merging" : "Indexing",
         rootdirs_total > 1 ? "directories" : "directory");
@@ -386,50 +417,48 @@ int main(const int argc, char *argv[]) {
         delivery_free(&ctx);
         exit(1);
     }
-    strlist_sort(metafiles, STASIS_SORT_LEN_ASCENDING);
 
-    struct Delivery **local = calloc(strlist_count(metafiles) + 1, sizeof(*local));
-    if (!local) {
-        SYSERROR("Unable to allocate bytes for local delivery context array");
+    // Metadata files parsed by a previous run are read back from a sorted binary index
+    const char *delivery_index_name = ".stasis_indexer.records";
+    char delivery_index_path[PATH_MAX] = {0};
+    snprintf(delivery_index_path, sizeof(delivery_index_path), "%s/%s", destdir, delivery_index_name);
+    struct DeliveryIndex *delivery_index = delivery_index_open(delivery_index_path, !do_rebuild);
+    if (!delivery_index || delivery_index_update(delivery_index, metafiles)) {
+        SYSERROR("Unable to index metadata: %s", delivery_index_path);
         exit(1);
     }
+    if (globals.verbose) {
+        printf("%zu metadata file(s) parsed, %zu indexed\n", delivery_index->parsed, delivery_index->count);
+    }
 
-    for (size_t i = 0; i < strlist_count(metafiles); i++) {
-        char *item = strlist_item(metafiles, i);
-        // Copy the pre-filled contents of the main delivery context
-        local[i] = delivery_duplicate(&ctx);
-        if (!local[i]) {
-            SYSERROR("Unable to duplicate delivery context %zu", i);
-            exit(1);
-        }
-        if (globals.verbose) {
-            puts(item);
-        }
-        load_metadata(local[i], item);
+    const size_t local_total = delivery_index->count;
+    struct Delivery **local = delivery_index_deliveries(delivery_index, &ctx);
+    if (!local) {
+        SYSERROR("Unable to allocate bytes for local delivery context array");
+        exit(1);
     }
-    qsort(local, strlist_count(metafiles), sizeof(*local), callback_sort_deliveries_cmpfn);
 
     msg(STASIS_MSG_L1, "Generating links to latest release iteration\n");
-    if (indexer_symlinks(local, strlist_count(metafiles))) {
+    if (indexer_symlinks(local, local_total)) {
         SYSERROR("Link generation failed");
         exit(1);
     }
 
     msg(STASIS_MSG_L1, "Generating README.md\n");
-    if (indexer_readmes(local, strlist_count(metafiles))) {
+    if (indexer_readmes(local, local_total, content_manifest)) {
         SYSERROR("README indexing operation failed");
         exit(1);
     }
 
     msg(STASIS_MSG_L1, "Indexing test results\n");
-    if (indexer_junitxml_report(local, strlist_count(metafiles))) {
+    if (indexer_junitxml_report(local, local_total, content_manifest)) {
         SYSERROR("Test result indexing operation failed");
         exit(1);
     }
 
     if (do_html) {
         msg(STASIS_MSG_L1, "Generating HTML indexes\n");
-        if (indexer_make_website(local)) {
+        if (indexer_make_website(local, content_manifest)) {
             SYSERROR("Site creation failed");
             exit(1);
         }
@@ -444,7 +473,7 @@ int main(const int argc, char *argv[]) {
             rmtree(workdir);
             exit(1);
         }
-        fprintf(revisionfp, "%d\n", get_latest_rc(local, strlist_count(metafiles)));
+        fprintf(revisionfp, "%d\n", get_latest_rc(local, local_total));
         fclose(revisionfp);
         popd();
     } else {
@@ -476,34 +505,46 @@ int main(const int argc, char *argv[]) {
     }
 
     msg(STASIS_MSG_L1, "Copying indexed delivery to '%s'\n", destdir);
-    char cmd[PATH_MAX] = {0};
-    snprintf(cmd, sizeof(cmd), "rsync -ah%s --delete --exclude 'tmp/' --exclude 'tools/' '%s/' '%s/'", globals.verbose ? "v" : "q", workdir, destdir);
+    char content_manifest_exclude[PATH_MAX] = {0};
+    snprintf(content_manifest_exclude, sizeof(content_manifest_exclude), "/%s", content_manifest_name);
+    char delivery_index_exclude[PATH_MAX] = {0};
+    snprintf(delivery_index_exclude, sizeof(delivery_index_exclude), "/%s", delivery_index_name);
+    char *sync_exclude[] = {"tmp/", "tools/", content_manifest_exclude, delivery_index_exclude, NULL};
+    struct SyncOptions sync_opts = {
+        .flags = SYNC_DELETE | (globals.verbose ? SYNC_VERBOSE : 0),
+        .exclude = sync_exclude,
+    };
+    const int sync_status = sync_tree(workdir, destdir, &sync_opts, NULL);
     guard_free(destdir);
 
-    if (globals.verbose) {
-        puts(cmd);
-    }
-
-    if (system(cmd)) {
+    if (sync_status) {
         SYSERROR("Copy operation failed");
         rmtree(workdir);
         exit(1);
     }
 
+    if (content_manifest) {
+        if (globals.verbose) {
+            printf("%zu index(es) reused, %zu generated\n", content_manifest->reused, content_manifest->stored);
+        }
+        if (content_manifest_save(content_manifest)) {
+            SYSWARN("Unable to write content manifest: %s", content_manifest_path);
+        }
+        content_manifest_free(&content_manifest);
+    }
+
     msg(STASIS_MSG_L1, "Removing work directory: %s\n", workdir);
-    if (rmtree(workdir)) {
+    if (rmtree_ex(workdir, RMTREE_PARALLEL)) {
         SYSERROR("Failed to remove work directory: %s", strerror(errno));
     }
 
     guard_free(destdir);
     guard_array_free(rootdirs);
     guard_free(m.micromamba_prefix);
-    delivery_free(&ctx);
-    for (size_t i = 0; i < strlist_count(metafiles); i++) {
-        delivery_free(local[i]);
-        guard_free(local[i]);
-    }
+    // "local" is an array of pointers into the delivery index. Do not free the contents of the array.
     guard_free(local);
+    delivery_index_free(&delivery_index);
+    delivery_free(&ctx);
     guard_strlist_free(&metafiles);
     globals_free();
 
@@ -1,7 +1,147 @@
 #include "core.h"
 #include "website.h"
 
-int indexer_make_website(struct Delivery **ctx) {
+static void page_destination(char *dest, size_t maxlen, const char *src) {
+    // Replace *.md extension with *.html.
+    safe_strncpy(dest, src, maxlen);
+    gen_file_extension_str(dest, maxlen, ".html");
+}
+
+static void page_finished(const char *src, struct ProcessHandle *proc, struct ContentManifest *manifest, const char *digest) {
+    if (proc->returncode) {
+        SYSWARN("Unable to convert %s", src);
+        if (proc->output.out_len) {
+            fprintf(stderr, "%s", proc->output.out);
+        }
+        return;
+    }
+
+    char dest[PATH_MAX] = {0};
+    page_destination(dest, sizeof(dest), src);
+    if (file_replace_text(dest, ".md", ".html", 0)) {
+        // inform-only
+        SYSWARN("%s: failed to rewrite *.md urls with *.html extension", dest);
+        return;
+    }
+    if (manifest && *digest) {
+        content_manifest_store(manifest, dest, digest, NULL);
+    }
+}
+
+/**
+ * Restore a page converted by the previous run when neither the markdown nor the stylesheet changed
+ * @return 1 if the page was restored, 0 if it must be converted
+ */
+static int page_reuse(struct ContentManifest *manifest, const char *src, const char *css_filename, char digest[SHA256_HEX_SIZE]) {
+    *digest = '\0';
+    if (!manifest) {
+        return 0;
+    }
+
+    char salt[255] = {0};
+    snprintf(salt, sizeof(salt), "pandoc %s", VERSION);
+    char *inputs[] = {(char *) src, (char *) css_filename};
+    if (content_manifest_digest(manifest, inputs, css_filename ? 2 : 1, salt, digest)) {
+        *digest = '\0';
+        return 0;
+    }
+
+    char dest[PATH_MAX] = {0};
+    page_destination(dest, sizeof(dest), src);
+    return content_manifest_reuse(manifest, dest, digest, NULL);
+}
+
+/**
+ * Convert markdown pages to html with several pandoc processes at once
+ */
+static void convert_pages(struct StrList *pages, const char *css_filename, struct ContentManifest *manifest) {
+    const size_t count = strlist_count(pages);
+    if (!count) {
+        return;
+    }
+    if (!find_program("pandoc")) {
+        SYSWARN("pandoc is not installed: unable to generate HTML indexes");
+        return;
+    }
+
+    size_t jobs = globals.cpu_limit > 0 ? (size_t) globals.cpu_limit : (size_t) get_cpu_count();
+    if (!jobs) {
+        jobs = 1;
+    }
+    if (jobs > count) {
+        jobs = count;
+    }
+
+    struct ProcessHandle **procs = calloc(jobs, sizeof(*procs));
+    size_t *slot_page = calloc(jobs, sizeof(*slot_page));
+    char (*slot_digest)[SHA256_HEX_SIZE] = calloc(jobs, sizeof(*slot_digest));
+    if (!procs || !slot_page || !slot_digest) {
+        SYSERROR("unable to allocate bytes for pandoc processes");
+        guard_free(procs);
+        guard_free(slot_page);
+        guard_free(slot_digest);
+        return;
+    }
+
+    size_t next = 0;
+    size_t running = 0;
+    while (next < count || running) {
+        // Keep every slot busy
+        for (size_t slot = 0; slot < jobs && next < count; slot++) {
+            if (procs[slot]) {
+                continue;
+            }
+            // Skip pages restored from the previous run
+            while (next < count && page_reuse(manifest, strlist_item(pages, next), css_filename, slot_digest[slot])) {
+                if (globals.verbose) {
+                    printf("%s: unchanged\n", strlist_item(pages, next));
+                }
+                next++;
+            }
+            if (next >= count) {
+                break;
+            }
+            const size_t page = next++;
+            const char *src = strlist_item(pages, page);
+            char dest[PATH_MAX] = {0};
+            page_destination(dest, sizeof(dest), src);
+
+            procs[slot] = pandoc_spawn(src, dest, css_filename, "STASIS");
+            if (!procs[slot]) {
+                SYSWARN("Unable to convert %s", src);
+                continue;
+            }
+            slot_page[slot] = page;
+            running++;
+        }
+        if (!running) {
+            continue;
+        }
+
+        struct ProcessHandle *done = shell_wait_any(procs, jobs);
+        if (!done) {
+            SYSERROR("unable to wait for pandoc");
+            break;
+        }
+        for (size_t slot = 0; slot < jobs; slot++) {
+            if (procs[slot] == done) {
+                page_finished(strlist_item(pages, slot_page[slot]), done, manifest, slot_digest[slot]);
+                shell_handle_free(&procs[slot]);
+                running--;
+                break;
+            }
+        }
+    }
+
+    for (size_t slot = 0; slot < jobs; slot++) {
+        shell_handle_free(&procs[slot]);
+    }
+    guard_free(procs);
+    guard_free(slot_page);
+    guard_free(slot_digest);
+}
+
+int indexer_make_website(struct Delivery **ctx, struct ContentManifest *manifest) {
     char *css_filename = calloc(PATH_MAX, sizeof(*css_filename));
     if (!css_filename) {
         SYSERROR("unable to allocate string for CSS file path: %s", strerror(errno));
@@ -15,6 +155,7 @@ int indexer_make_website(struct Delivery **ctx) {
     strlist_append(&dirs, (*ctx)->storage.delivery_dir);
     strlist_append(&dirs, (*ctx)->storage.results_dir);
 
+    struct StrList *pages = strlist_init();
     struct StrList *inputs = NULL;
     for (size_t i = 0; i < strlist_count(dirs); i++) {
         const char *pattern = "*.md";
@@ -28,25 +169,11 @@ int indexer_make_website(struct Delivery **ctx) {
         for (size_t x = 0; x < strlist_count(inputs); x++) {
             char *filename = path_basename(strlist_item(inputs, x));
             char fullpath_src[PATH_MAX] = {0};
-            char fullpath_dest[PATH_MAX] = {0};
             snprintf(fullpath_src, sizeof(fullpath_src), "%s/%s", root, filename);
             if (access(fullpath_src, F_OK)) {
                 continue;
             }
-
-            // Replace *.md extension with *.html.
-            safe_strncpy(fullpath_dest, fullpath_src, sizeof(fullpath_dest));
-            gen_file_extension_str(fullpath_dest, sizeof(fullpath_dest), ".html");
-
-            // Convert markdown to html
-            if (pandoc_exec(fullpath_src, fullpath_dest, have_css ? css_filename : NULL, "STASIS")) {
-                SYSWARN("Unable to convert %s", fullpath_src);
-            }
-
-            if (file_replace_text(fullpath_dest, ".md", ".html", 0)) {
-                // inform-only
-                SYSWARN("%s: failed to rewrite *.md urls with *.html extension", fullpath_dest);
-            }
+            strlist_append(&pages, fullpath_src);
 
             // Link the nearest README.html to index.html
             if (!strcmp(filename, "README.md")) {
@@ -61,6 +188,11 @@ int indexer_make_website(struct Delivery **ctx) {
         }
         guard_strlist_free(&inputs);
     }
+
+    // Convert markdown to html
+    convert_pages(pages, have_css ? css_filename : NULL, manifest);
+
+    guard_strlist_free(&pages);
     guard_free(css_filename);
     guard_strlist_free(&dirs);
 
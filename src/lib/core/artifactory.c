@@ -1,3 +1,5 @@
+#include <dirent.h>
+#include <fnmatch.h>
 #include "artifactory.h"
 
 int artifactory_download_cli(char *dest,
@@ -212,7 +214,7 @@ int jfrt_auth_init(struct JFRT_Auth *auth_ctx) {
     return 0;
 }
 
-int jfrog_cli(struct JFRT_Auth *auth, const char *subsystem, const char *task, char *args) {
+static int jfrog_cli_ex(struct JFRT_Auth *auth, const char *subsystem, const char *task, char *args, const char *f_stdout) {
     struct Process proc;
     char cmd[STASIS_BUFSIZ];
     char cmd_redacted[STASIS_BUFSIZ];
@@ -265,14 +267,23 @@ int jfrog_cli(struct JFRT_Auth *auth, const char *subsystem, const char *task, c
         msg(STASIS_MSG_L2, "Executing: %s\n", cmd_redacted);
     }
 
+    if (f_stdout) {
+        safe_strncpy(proc.f_stdout, f_stdout, sizeof(proc.f_stdout));
+    }
     if (!globals.verbose) {
-        safe_strncpy(proc.f_stdout, "/dev/null", sizeof(proc.f_stdout));
+        if (!f_stdout) {
+            safe_strncpy(proc.f_stdout, "/dev/null", sizeof(proc.f_stdout));
+        }
 
         safe_strncpy(proc.f_stderr, "/dev/null", sizeof(proc.f_stderr));
     }
     return shell(&proc, cmd);
 }
 
+int jfrog_cli(struct JFRT_Auth *auth, const char *subsystem, const char *task, char *args) {
+    return jfrog_cli_ex(auth, subsystem, task, args, NULL);
+}
+
 static int jfrog_cli_rt(struct JFRT_Auth *auth, char *task, char *args) {
     return jfrog_cli(auth, "rt", task, args);
 }
@@ -457,6 +468,891 @@ int jfrog_cli_rt_upload(struct JFRT_Auth *auth, struct JFRT_Upload *ctx, char *s
     return status;
 }
 
+struct JFRT_UploadFiles *jfrt_upload_files_init() {
+    return calloc(1, sizeof(struct JFRT_UploadFiles));
+}
+
+void jfrt_upload_files_free(struct JFRT_UploadFiles **files) {
+    if (!files || !*files) {
+        return;
+    }
+    for (size_t i = 0; i < (*files)->num_used; i++) {
+        guard_free((*files)->file[i].src);
+        guard_free((*files)->file[i].target);
+    }
+    guard_free((*files)->file);
+    guard_free(*files);
+}
+
+static int upload_files_append(struct JFRT_UploadFiles *files, const char *src, const char *target) {
+    if (files->num_used == files->num_alloc) {
+        const size_t num_alloc = files->num_alloc ? files->num_alloc * 2 : 64;
+        struct JFRT_UploadFile *tmp = realloc(files->file, num_alloc * sizeof(*tmp));
+        if (!tmp) {
+            return -1;
+        }
+        files->file = tmp;
+        files->num_alloc = num_alloc;
+    }
+    struct JFRT_UploadFile *file = &files->file[files->num_used];
+    memset(file, 0, sizeof(*file));
+    file->src = strdup(src);
+    file->target = strdup(target);
+    if (!file->src || !file->target) {
+        guard_free(file->src);
+        guard_free(file->target);
+        return -1;
+    }
+    file->status = -1;
+    files->num_used++;
+    return 0;
+}
+
+static int upload_excluded(const char *path, const char *exclusions) {
+    if (isempty((char *) exclusions)) {
+        return 0;
+    }
+    int excluded = 0;
+    char *data = strdup(exclusions);
+    if (!data) {
+        return 0;
+    }
+    char *pos = data;
+    char *token;
+    while (!excluded && (token = strsep(&pos, ";"))) {
+        excluded = !isempty(token) && !fnmatch(token, path, 0);
+    }
+    guard_free(data);
+    return excluded;
+}
+
+struct UploadWalk {
+    struct JFRT_UploadFiles *files;
+    const struct JFRT_Upload *ctx;
+    const char *base; ///< Directory the pattern is relative to
+    const char *pattern; ///< Pattern relative to base
+    const char *repo_path;
+    ssize_t count; ///< Number of files added
+};
+
+static int upload_walk(struct UploadWalk *walk, const char *path) {
+    DIR *dp = opendir(path);
+    if (!dp) {
+        SYSERROR("%s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct StrList *entries = strlist_init();
+    if (!entries) {
+        closedir(dp);
+        return -1;
+    }
+    struct dirent *rec;
+    while ((rec = readdir(dp))) {
+        if (!strcmp(rec->d_name, ".") || !strcmp(rec->d_name, "..")) {
+            continue;
+        }
+        strlist_append(&entries, rec->d_name);
+    }
+    closedir(dp);
+    // Upload in a stable order
+    strlist_sort(entries, STASIS_SORT_ALPHA);
+
+    int status = 0;
+    const size_t base_len = strlen(walk->base);
+    for (size_t i = 0; !status && i < strlist_count(entries); i++) {
+        char filename[PATH_MAX] = {0};
+        snprintf(filename, sizeof(filename), "%s/%s", path, strlist_item(entries, i));
+        const char *relative = filename + base_len + 1;
+
+        struct stat st;
+        if (lstat(filename, &st)) {
+            continue;
+        }
+        if (S_ISLNK(st.st_mode)) {
+            // Upload the files links point to, but never descend through a
+            // link to a directory. It may lead back into the tree.
+            if (stat(filename, &st) || S_ISDIR(st.st_mode)) {
+                continue;
+            }
+        }
+        if (S_ISDIR(st.st_mode)) {
+            if (walk->ctx->recursive) {
+                status = upload_walk(walk, filename);
+            }
+            continue;
+        }
+        if (!S_ISREG(st.st_mode)
+            || fnmatch(walk->pattern, relative, walk->ctx->recursive ? 0 : FNM_PATHNAME)
+            || upload_excluded(filename, walk->ctx->exclusions)) {
+            continue;
+        }
+
+        char target[PATH_MAX] = {0};
+        const char *target_name = walk->ctx->flat ? path_basename(filename) : relative;
+        snprintf(target, sizeof(target), "%s%s%s", walk->repo_path, endswith((char *) walk->repo_path, "/") ? "" : "/", target_name);
+        if (upload_files_append(walk->files, filename, target)) {
+            status = -1;
+            break;
+        }
+        walk->count++;
+    }
+    guard_strlist_free(&entries);
+    return status;
+}
+
+ssize_t jfrt_upload_files_add(struct JFRT_UploadFiles *files, const struct JFRT_Upload *ctx, const char *src, const char *repo_path) {
+    if (isempty((char *) src)) {
+        SYSERROR("src argument must be a valid file system path");
+        return -1;
+    }
+    if (isempty((char *) repo_path)) {
+        SYSERROR("repo_path argument must be a valid artifactory repository path");
+        return -1;
+    }
+
+    // Split the pattern at the first component containing a wildcard
+    char base[PATH_MAX] = {0};
+    char pattern[PATH_MAX] = {0};
+    const char *wild = strpbrk(src, "*?[");
+    if (wild) {
+        const char *sep = wild;
+        while (sep > src && *sep != '/') {
+            sep--;
+        }
+        if (*sep == '/') {
+            snprintf(base, sizeof(base), "%.*s", (int) (sep - src), src);
+            snprintf(pattern, sizeof(pattern), "%s", sep + 1);
+        } else {
+            snprintf(base, sizeof(base), ".");
+            snprintf(pattern, sizeof(pattern), "%s", src);
+        }
+    } else {
+        struct stat st;
+        if (stat(src, &st)) {
+            SYSERROR("%s: %s", src, strerror(errno));
+            return -1;
+        }
+        snprintf(base, sizeof(base), "%s", src);
+        if (S_ISDIR(st.st_mode)) {
+            snprintf(pattern, sizeof(pattern), "*");
+        } else {
+            char dir[PATH_MAX] = {0};
+            snprintf(dir, sizeof(dir), "%s", src);
+            snprintf(pattern, sizeof(pattern), "%s", path_basename(dir));
+            snprintf(base, sizeof(base), "%s", path_dirname(dir));
+        }
+    }
+    if (isempty(base)) {
+        // Pattern is relative to the file system root
+        snprintf(base, sizeof(base), "/");
+    }
+    // jf reports absolute source paths
+    char *base_real = realpath(base, NULL);
+    if (!base_real) {
+        SYSERROR("%s: %s", base, strerror(errno));
+        return -1;
+    }
+    snprintf(base, sizeof(base), "%s", base_real);
+    guard_free(base_real);
+
+    struct UploadWalk walk = {
+        .files = files,
+        .ctx = ctx,
+        .base = base,
+        .pattern = pattern,
+        .repo_path = repo_path,
+    };
+    // Descend into every directory so patterns like "dir*/*.whl" can match
+    struct JFRT_Upload ctx_walk = *ctx;
+    if (strchr(pattern, '/')) {
+        ctx_walk.recursive = true;
+        walk.ctx = &ctx_walk;
+    }
+    if (upload_walk(&walk, !strcmp(base, "/") ? "" : base)) {
+        return -1;
+    }
+    return walk.count;
+}
+
+static void json_write_str(FILE *fp, const char *key, const char *value) {
+    fprintf(fp, "\"%s\": \"", key);
+    for (const char *ch = value; *ch; ch++) {
+        if (*ch == '"' || *ch == '\\') {
+            fputc('\\', fp);
+            fputc(*ch, fp);
+        } else if (*ch == '\n') {
+            fputs("\\n", fp);
+        } else if (*ch == '\t') {
+            fputs("\\t", fp);
+        } else if ((unsigned char) *ch < ' ') {
+            fprintf(fp, "\\u%04x", (unsigned char) *ch);
+        } else {
+            fputc(*ch, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+// Write a file spec "pattern" that matches `path` literally. jf treats "*?[]" as
+// wildcards and "()" as placeholder groups.
+static void json_write_pattern(FILE *fp, const char *path) {
+    char *pattern = calloc(strlen(path) * 2 + 1, sizeof(*pattern));
+    if (!pattern) {
+        json_write_str(fp, "pattern", path);
+        return;
+    }
+    size_t len = 0;
+    for (const char *ch = path; *ch; ch++) {
+        if (strchr("*?[]()", *ch)) {
+            pattern[len++] = '\\';
+        }
+        pattern[len++] = *ch;
+    }
+    json_write_str(fp, "pattern", pattern);
+    guard_free(pattern);
+}
+
+// Read a JSON string value beginning after its opening quote
+static char *json_read_str(const char *data, const char **end) {
+    char *value = calloc(strlen(data) + 1, sizeof(*value));
+    if (!value) {
+        return NULL;
+    }
+    size_t len = 0;
+    const char *ch = data;
+    for (; *ch && *ch != '"'; ch++) {
+        if (*ch == '\\' && ch[1]) {
+            ch++;
+            if (*ch == 'n') {
+                value[len++] = '\n';
+                continue;
+            }
+            if (*ch == 't') {
+                value[len++] = '\t';
+                continue;
+            }
+            if (*ch == 'u' && isxdigit((unsigned char) ch[1]) && isxdigit((unsigned char) ch[2])
+                && isxdigit((unsigned char) ch[3]) && isxdigit((unsigned char) ch[4])) {
+                // Only the control characters written by json_write_str() are expected here
+                char hex[5] = {ch[1], ch[2], ch[3], ch[4], 0};
+                value[len++] = (char) strtol(hex, NULL, 16);
+                ch += 4;
+                continue;
+            }
+        }
+        value[len++] = *ch;
+    }
+    *end = ch;
+    return value;
+}
+
+typedef void (JSONPairFn)(const char *key, const char *value, void *data);
+
+#define JSON_DEPTH_MAX 64
+
+static const char *json_skip_ws(const char *ch) {
+    while (isspace((unsigned char) *ch)) {
+        ch++;
+    }
+    return ch;
+}
+
+// Skip a JSON string beginning at its opening quote.
+// Returns the character after the closing quote, or NULL if it is unterminated
+static const char *json_skip_str(const char *ch) {
+    for (ch++; *ch; ch++) {
+        if (*ch == '\\') {
+            if (!*++ch) {
+                break;
+            }
+        } else if (*ch == '"') {
+            return ch + 1;
+        }
+    }
+    return NULL;
+}
+
+// Step over the separator following a member or element.
+// Returns the next member or element, `close` at the end of the container, or NULL if malformed
+static const char *json_next(const char *ch, const char close) {
+    if (!ch) {
+        return NULL;
+    }
+    ch = json_skip_ws(ch);
+    if (*ch == ',') {
+        return json_skip_ws(ch + 1);
+    }
+    return *ch == close ? ch : NULL;
+}
+
+// Read a member name and the colon following it.
+// Returns the beginning of the member's value, or NULL if malformed (name is not allocated)
+static const char *json_read_name(const char *ch, char **name) {
+    *name = NULL;
+    if (*ch != '"') {
+        return NULL;
+    }
+    const char *end = NULL;
+    *name = json_read_str(ch + 1, &end);
+    if (!*name) {
+        return NULL;
+    }
+    ch = json_skip_ws(*end ? end + 1 : end);
+    if (*end != '"' || *ch != ':') {
+        guard_free(*name);
+        return NULL;
+    }
+    return json_skip_ws(ch + 1);
+}
+
+// Skip any JSON value. Returns the character after it, or NULL if malformed
+static const char *json_skip_value(const char *ch, const int depth) {
+    ch = json_skip_ws(ch);
+    if (*ch == '"') {
+        return json_skip_str(ch);
+    }
+    if (*ch == '{' || *ch == '[') {
+        const char close = *ch == '{' ? '}' : ']';
+        if (depth > JSON_DEPTH_MAX) {
+            return NULL;
+        }
+        ch = json_skip_ws(ch + 1);
+        while (ch && *ch != close) {
+            if (close == '}') {
+                ch = json_skip_str(ch);
+                ch = ch ? json_skip_ws(ch) : NULL;
+                if (!ch || *ch != ':') {
+                    return NULL;
+                }
+                ch++;
+            }
+            ch = json_next(json_skip_value(ch, depth + 1), close);
+        }
+        return ch ? ch + 1 : NULL;
+    }
+    // A number, true, false, or null
+    const char *start = ch;
+    while (*ch && !strchr(",:{}[]\" \t\r\n", *ch)) {
+        ch++;
+    }
+    return ch > start ? ch : NULL;
+}
+
+// Read the object beginning at `ch`, and call fn if it has a `key` string member.
+// Nested objects are skipped. Returns the character after the object, or NULL if malformed
+static const char *json_read_record(const char *ch, const char *key, const char *value_key, JSONPairFn *fn, void *arg) {
+    char *key_value = NULL;
+    char *value = NULL;
+
+    ch = json_skip_ws(ch + 1);
+    while (ch && *ch != '}') {
+        char *name = NULL;
+        ch = json_read_name(ch, &name);
+        if (!ch) {
+            break;
+        }
+        char **dest = NULL;
+        if (!strcmp(name, key)) {
+            dest = &key_value;
+        } else if (!strcmp(name, value_key)) {
+            dest = &value;
+        }
+        guard_free(name);
+
+        if (dest && *ch == '"') {
+            const char *end = NULL;
+            guard_free(*dest);
+            *dest = json_read_str(ch + 1, &end);
+            ch = *dest && *end == '"' ? end + 1 : NULL;
+        } else {
+            ch = json_skip_value(ch, 1);
+        }
+        ch = json_next(ch, '}');
+    }
+    if (ch && key_value) {
+        fn(key_value, value ? value : "", arg);
+    }
+    guard_free(key_value);
+    guard_free(value);
+    return ch ? ch + 1 : NULL;
+}
+
+// Read each object in the array beginning at `ch`.
+// Returns the character after the array, or NULL if malformed
+static const char *json_read_records(const char *ch, const char *key, const char *value_key, JSONPairFn *fn, void *arg) {
+    ch = json_skip_ws(ch + 1);
+    while (ch && *ch != ']') {
+        if (*ch == '{') {
+            ch = json_read_record(ch, key, value_key, fn, arg);
+        } else {
+            ch = json_skip_value(ch, 1);
+        }
+        ch = json_next(ch, ']');
+    }
+    return ch ? ch + 1 : NULL;
+}
+
+// Call fn for each record in a JSON document that has a `key` string member,
+// with the value of its `value_key` string member (empty if absent).
+// Records are the objects of a top-level array (jf rt search), or of the
+// "files" array of a top-level object (jf rt upload --detailed-summary).
+static int json_read_pairs(const char *filename, const char *key, const char *value_key, JSONPairFn *fn, void *arg) {
+    char **lines = file_readlines(filename, 0, 0, NULL);
+    if (!lines) {
+        return -1;
+    }
+    char *data = join(lines, "");
+    guard_array_free(lines);
+    if (!data) {
+        return -1;
+    }
+
+    const char *ch = json_skip_ws(data);
+    if (*ch == '[') {
+        ch = json_read_records(ch, key, value_key, fn, arg);
+    } else if (*ch == '{') {
+        ch = json_skip_ws(ch + 1);
+        while (ch && *ch != '}') {
+            char *name = NULL;
+            ch = json_read_name(ch, &name);
+            if (!ch) {
+                break;
+            }
+            if (!strcmp(name, "files") && *ch == '[') {
+                ch = json_read_records(ch, key, value_key, fn, arg);
+            } else {
+                ch = json_skip_value(ch, 1);
+            }
+            guard_free(name);
+            ch = json_next(ch, '}');
+        }
+    } else {
+        ch = NULL;
+    }
+    guard_free(data);
+    return ch ? 0 : -1;
+}
+
+static void upload_files_summary(const char *source, const char *sha256, void *arg) {
+    // Each uploaded file appears in "files" as {"source": ..., "target": ..., "sha256": ...}
+    struct JFRT_UploadFiles *files = arg;
+    for (size_t i = 0; i < files->num_used; i++) {
+        if (!files->file[i].skipped && !strcmp(files->file[i].src, source)) {
+            files->file[i].status = 0;
+            snprintf(files->file[i].sha256, sizeof(files->file[i].sha256), "%s", sha256);
+            break;
+        }
+    }
+}
+
+static int upload_tempfile(char *filename, size_t maxlen, const char *name) {
+    snprintf(filename, maxlen, "%s/%s.XXXXXX", globals.tmpdir ? globals.tmpdir : "/tmp", name);
+    const int fd = mkstemp(filename);
+    if (fd < 0) {
+        SYSERROR("%s: %s", filename, strerror(errno));
+    }
+    return fd;
+}
+
+//! Header of an upload manifest file
+#define UPLOAD_MANIFEST_HEADER "# stasis upload manifest 1"
+
+struct UploadManifestEntry {
+    char *target; ///< Remote path
+    char sha256[SHA256_HEX_SIZE]; ///< SHA-256 of the file uploaded to target
+};
+
+struct UploadManifest {
+    struct UploadManifestEntry *entry;
+    size_t num_used;
+    size_t num_alloc;
+    size_t num_sorted; ///< Entries before this index are sorted by target
+};
+
+static int upload_manifest_cmp(const void *a, const void *b) {
+    const struct UploadManifestEntry *aa = a;
+    const struct UploadManifestEntry *bb = b;
+    return strcmp(aa->target, bb->target);
+}
+
+static void upload_manifest_free(struct UploadManifest **manifest) {
+    if (!manifest || !*manifest) {
+        return;
+    }
+    for (size_t i = 0; i < (*manifest)->num_used; i++) {
+        guard_free((*manifest)->entry[i].target);
+    }
+    guard_free((*manifest)->entry);
+    guard_free(*manifest);
+}
+
+static struct UploadManifestEntry *upload_manifest_find(struct UploadManifest *manifest, const char *target) {
+    const struct UploadManifestEntry key = {.target = (char *) target};
+    struct UploadManifestEntry *entry = bsearch(&key, manifest->entry, manifest->num_sorted, sizeof(key), upload_manifest_cmp);
+    for (size_t i = manifest->num_sorted; !entry && i < manifest->num_used; i++) {
+        if (!strcmp(manifest->entry[i].target, target)) {
+            entry = &manifest->entry[i];
+        }
+    }
+    return entry;
+}
+
+static int upload_manifest_set(struct UploadManifest *manifest, const char *target, const char *sha256) {
+    struct UploadManifestEntry *entry = upload_manifest_find(manifest, target);
+    if (!entry) {
+        if (manifest->num_used == manifest->num_alloc) {
+            const size_t num_alloc = manifest->num_alloc ? manifest->num_alloc * 2 : 64;
+            struct UploadManifestEntry *tmp = realloc(manifest->entry, num_alloc * sizeof(*tmp));
+            if (!tmp) {
+                SYSERROR("Unable to extend upload manifest: %s", strerror(errno));
+                return -1;
+            }
+            manifest->entry = tmp;
+            manifest->num_alloc = num_alloc;
+        }
+        entry = &manifest->entry[manifest->num_used];
+        entry->target = strdup(target);
+        if (!entry->target) {
+            return -1;
+        }
+        manifest->num_used++;
+    }
+    snprintf(entry->sha256, sizeof(entry->sha256), "%s", sha256);
+    return 0;
+}
+
+static struct UploadManifest *upload_manifest_load(const char *filename) {
+    struct UploadManifest *manifest = calloc(1, sizeof(*manifest));
+    if (!manifest) {
+        return NULL;
+    }
+    if (access(filename, F_OK)) {
+        // Nothing has been uploaded yet
+        return manifest;
+    }
+    char **lines = file_readlines(filename, 0, 0, NULL);
+    if (!lines) {
+        upload_manifest_free(&manifest);
+        return NULL;
+    }
+    for (size_t i = 0; lines[i] != NULL; i++) {
+        char *line = strip(lines[i]);
+        if (!i && strcmp(line, UPLOAD_MANIFEST_HEADER) != 0) {
+            SYSWARN("%s: not an upload manifest, ignoring it", filename);
+            break;
+        }
+        // "<sha256> <target>"
+        char *target = strchr(line, ' ');
+        if (startswith(line, "#") || !target || target - line != SHA256_HEX_SIZE - 1) {
+            continue;
+        }
+        *target++ = '\0';
+        if (upload_manifest_set(manifest, target, line)) {
+            guard_array_free(lines);
+            upload_manifest_free(&manifest);
+            return NULL;
+        }
+    }
+    guard_array_free(lines);
+    qsort(manifest->entry, manifest->num_used, sizeof(*manifest->entry), upload_manifest_cmp);
+    manifest->num_sorted = manifest->num_used;
+    return manifest;
+}
+
+static int upload_manifest_save(struct UploadManifest *manifest, const char *filename) {
+    char tmpfile[PATH_MAX] = {0};
+    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", filename);
+    char *dir = strdup(filename);
+    if (!dir) {
+        return -1;
+    }
+    const int status = mkdirs(path_dirname(dir), 0755);
+    guard_free(dir);
+    if (status) {
+        SYSERROR("Unable to create directory for upload manifest: %s", strerror(errno));
+        return -1;
+    }
+
+    FILE *fp = fopen(tmpfile, "w");
+    if (!fp) {
+        SYSERROR("%s: %s", tmpfile, strerror(errno));
+        return -1;
+    }
+    qsort(manifest->entry, manifest->num_used, sizeof(*manifest->entry), upload_manifest_cmp);
+    manifest->num_sorted = manifest->num_used;
+    fprintf(fp, "%s\n", UPLOAD_MANIFEST_HEADER);
+    for (size_t i = 0; i < manifest->num_used; i++) {
+        fprintf(fp, "%s %s\n", manifest->entry[i].sha256, manifest->entry[i].target);
+    }
+    if (fclose(fp) || rename(tmpfile, filename)) {
+        SYSERROR("%s: %s", filename, strerror(errno));
+        remove(tmpfile);
+        return -1;
+    }
+    return 0;
+}
+
+static void upload_files_verified(const char *path, const char *sha256, void *arg) {
+    // Each file found appears as {"path": ..., "sha256": ..., ...}
+    struct JFRT_UploadFiles *files = arg;
+    for (size_t i = 0; i < files->num_used; i++) {
+        struct JFRT_UploadFile *file = &files->file[i];
+        if (file->skipped && !strcmp(file->target, path) && !strcmp(file->digest, sha256)) {
+            file->skipped = 2;
+        }
+    }
+}
+
+// Confirm that the files the manifest marked unchanged are present in the
+// repository with the same SHA-256. Files that are not are uploaded.
+static int upload_files_verify(struct JFRT_Auth *auth, struct JFRT_UploadFiles *files) {
+    char spec[PATH_MAX] = {0};
+    char result[PATH_MAX] = {0};
+    const int fd_spec = upload_tempfile(spec, sizeof(spec), "jfrog_search_spec");
+    if (fd_spec < 0) {
+        return -1;
+    }
+    const int fd_result = upload_tempfile(result, sizeof(result), "jfrog_search_result");
+    if (fd_result < 0) {
+        close(fd_spec);
+        remove(spec);
+        return -1;
+    }
+    close(fd_result);
+
+    FILE *fp = fdopen(fd_spec, "w");
+    if (!fp) {
+        close(fd_spec);
+        remove(spec);
+        remove(result);
+        return -1;
+    }
+    fprintf(fp, "{\n  \"files\": [\n");
+    for (size_t i = 0, n = 0; i < files->num_used; i++) {
+        if (!files->file[i].skipped) {
+            continue;
+        }
+        fprintf(fp, "%s    {", n++ ? ",\n" : "");
+        json_write_pattern(fp, files->file[i].target);
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+
+    struct StrList *arg_map = strlist_init();
+    if (!arg_map) {
+        remove(spec);
+        remove(result);
+        return -1;
+    }
+    jfrt_register_opt_str(spec, "spec", &arg_map);
+    char *args = join(arg_map->data, " ");
+    guard_strlist_free(&arg_map);
+    if (!args) {
+        remove(spec);
+        remove(result);
+        return -1;
+    }
+
+    int status = jfrog_cli_ex(auth, "rt", "search", args, result);
+    guard_free(args);
+    if (!status) {
+        status = json_read_pairs(result, "path", "sha256", upload_files_verified, files);
+    }
+    remove(spec);
+    remove(result);
+
+    for (size_t i = 0; i < files->num_used; i++) {
+        struct JFRT_UploadFile *file = &files->file[i];
+        if (status || file->skipped == 1) {
+            // Unconfirmed, upload it again
+            file->skipped = 0;
+        } else if (file->skipped) {
+            file->skipped = 1;
+        }
+    }
+    return status;
+}
+
+// Mark the files whose SHA-256 matches the one recorded for their target
+static size_t upload_files_unchanged(struct JFRT_Auth *auth, struct JFRT_Upload *ctx, struct JFRT_UploadFiles *files, struct UploadManifest *manifest) {
+    // Files left out of the upload would be missing from the build info, and
+    // would not receive the new properties. jf's checksum deploy already
+    // avoids sending their contents again.
+    const int keep = !isempty(ctx->build_name) || !isempty(ctx->target_props);
+    size_t unchanged = 0;
+    for (size_t i = 0; i < files->num_used; i++) {
+        struct JFRT_UploadFile *file = &files->file[i];
+        file->skipped = 0;
+        if (sha256_file(file->src, file->digest)) {
+            file->digest[0] = '\0';
+            continue;
+        }
+        const struct UploadManifestEntry *entry = upload_manifest_find(manifest, file->target);
+        if (entry && !strcmp(entry->sha256, file->digest)) {
+            file->skipped = !keep;
+            unchanged++;
+        }
+    }
+    if (keep) {
+        if (unchanged) {
+            msg(STASIS_MSG_L3, "Uploading %zu unchanged file(s) to attach them to the build\n", unchanged);
+        }
+        return 0;
+    }
+    if (unchanged && ctx->manifest_verify) {
+        if (upload_files_verify(auth, files)) {
+            SYSWARN("Unable to confirm unchanged files with the repository. Uploading them again.");
+        }
+        unchanged = 0;
+        for (size_t i = 0; i < files->num_used; i++) {
+            unchanged += files->file[i].skipped != 0;
+        }
+    }
+    return unchanged;
+}
+
+int jfrog_cli_rt_upload_files(struct JFRT_Auth *auth, struct JFRT_Upload *ctx, struct JFRT_UploadFiles *files) {
+    if (!files->num_used) {
+        return 0;
+    }
+
+    struct UploadManifest *manifest = NULL;
+    size_t unchanged = 0;
+    if (ctx->manifest) {
+        manifest = upload_manifest_load(ctx->manifest);
+        if (!manifest) {
+            SYSERROR("Unable to read upload manifest: %s", ctx->manifest);
+            return -1;
+        }
+        unchanged = upload_files_unchanged(auth, ctx, files, manifest);
+        if (unchanged) {
+            msg(STASIS_MSG_L3, "Skipping %zu unchanged file(s)\n", unchanged);
+        }
+    }
+
+    for (size_t i = 0; i < files->num_used; i++) {
+        struct JFRT_UploadFile *file = &files->file[i];
+        if (!manifest) {
+            file->skipped = 0;
+            file->digest[0] = '\0';
+        }
+        file->status = file->skipped ? 0 : -1;
+        file->sha256[0] = '\0';
+        if (file->skipped) {
+            snprintf(file->sha256, sizeof(file->sha256), "%s", file->digest);
+        }
+    }
+
+    int status = 0;
+    if (unchanged < files->num_used) {
+        char spec[PATH_MAX] = {0};
+        char summary[PATH_MAX] = {0};
+        const int fd_spec = upload_tempfile(spec, sizeof(spec), "jfrog_upload_spec");
+        if (fd_spec < 0) {
+            upload_manifest_free(&manifest);
+            return -1;
+        }
+        const int fd_summary = upload_tempfile(summary, sizeof(summary), "jfrog_upload_summary");
+        if (fd_summary < 0) {
+            close(fd_spec);
+            remove(spec);
+            upload_manifest_free(&manifest);
+            return -1;
+        }
+        close(fd_summary);
+
+        FILE *fp = fdopen(fd_spec, "w");
+        if (!fp) {
+            close(fd_spec);
+            remove(spec);
+            remove(summary);
+            upload_manifest_free(&manifest);
+            return -1;
+        }
+        fprintf(fp, "{\n  \"files\": [\n");
+        for (size_t i = 0, n = 0; i < files->num_used; i++) {
+            if (files->file[i].skipped) {
+                continue;
+            }
+            fprintf(fp, "%s    {", n++ ? ",\n" : "");
+            json_write_pattern(fp, files->file[i].src);
+            fprintf(fp, ", ");
+            json_write_str(fp, "target", files->file[i].target);
+            fprintf(fp, ", \"flat\": \"true\"");
+            if (ctx->explode) {
+                fprintf(fp, ", \"explode\": \"true\"");
+            }
+            if (!isempty(ctx->target_props)) {
+                fprintf(fp, ", ");
+                json_write_str(fp, "targetProps", ctx->target_props);
+            }
+            fprintf(fp, "}");
+        }
+        fprintf(fp, "\n  ]\n}\n");
+        fclose(fp);
+
+        struct StrList *arg_map = strlist_init();
+        if (!arg_map) {
+            remove(spec);
+            remove(summary);
+            upload_manifest_free(&manifest);
+            return -1;
+        }
+        jfrt_register_opt_str(spec, "spec", &arg_map);
+        jfrt_register_opt_str(ctx->build_name, "build-name", &arg_map);
+        jfrt_register_opt_str(ctx->build_number, "build-number", &arg_map);
+        jfrt_register_opt_str(ctx->module, "module", &arg_map);
+        jfrt_register_opt_str(ctx->project, "project", &arg_map);
+        jfrt_register_opt_bool(ctx->quiet, "quiet", &arg_map);
+        jfrt_register_opt_bool(ctx->dry_run, "dry-run", &arg_map);
+        jfrt_register_opt_bool(ctx->fail_no_op, "fail-no-op", &arg_map);
+        // Required to learn the outcome of each file
+        jfrt_register_opt_bool(true, "detailed-summary", &arg_map);
+        jfrt_register_opt_int(ctx->retries, "retries", &arg_map);
+        jfrt_register_opt_int(ctx->retry_wait_time, "retry-wait-time", &arg_map);
+        jfrt_register_opt_int(ctx->threads, "threads", &arg_map);
+
+        char *args = join(arg_map->data, " ");
+        guard_strlist_free(&arg_map);
+        if (!args) {
+            remove(spec);
+            remove(summary);
+            upload_manifest_free(&manifest);
+            return -1;
+        }
+
+        status = jfrog_cli_ex(auth, "rt", "upload", args, summary);
+        guard_free(args);
+        json_read_pairs(summary, "source", "sha256", upload_files_summary, files);
+        remove(spec);
+        remove(summary);
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < files->num_used; i++) {
+        const struct JFRT_UploadFile *file = &files->file[i];
+        if (file->status) {
+            SYSERROR("Upload failed: %s -> %s", file->src, file->target);
+            failed++;
+        } else if (manifest && !file->skipped && !isempty((char *) file->digest)
+                   && (isempty((char *) file->sha256) || !strcmp(file->sha256, file->digest))) {
+            // Record what the target holds now
+            upload_manifest_set(manifest, file->target, file->digest);
+        }
+    }
+    if (manifest && !ctx->dry_run) {
+        upload_manifest_save(manifest, ctx->manifest);
+    }
+    upload_manifest_free(&manifest);
+
+    if (status && !failed) {
+        // jf failed, but every file was reported as uploaded
+        return -1;
+    }
+    return failed;
+}
+
 int jfrog_cli_rt_search(struct JFRT_Auth *auth, struct JFRT_Search *ctx, char *repo_path, char *pattern) {
     char cmd[STASIS_BUFSIZ] = {0};
 
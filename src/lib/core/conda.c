@@ -811,10 +811,20 @@ int conda_env_remove(char *name) {
     return conda_exec(env_command);
 }
 
-int conda_env_export(char *name, char *output_dir, char *output_filename) {
-    char env_command[PATH_MAX];
+static const char *conda_env_export_format() {
+    // The answer only changes when a different conda is found on PATH, so ask each one once
+    static char conda_path[PATH_MAX] = {0};
+    static const char *env_format = NULL;
+    const char *program = find_program("conda");
+    if (!program) {
+        return NULL;
+    }
+    if (!strcmp(conda_path, program)) {
+        return env_format;
+    }
+
     int vr = 0;
-    const char *env_format = NULL;
+    env_format = NULL;
     char *version = shell_output("conda --version", &vr);
     if (version) {
         const size_t v_offset = strlen("conda ");
@@ -823,11 +833,40 @@ int conda_env_export(char *name, char *output_dir, char *output_filename) {
         }
         guard_free(version);
     }
+    safe_strncpy(conda_path, program, sizeof(conda_path));
+    return env_format;
+}
+
+int conda_env_export(char *name, char *output_dir, char *output_filename) {
+    char env_command[PATH_MAX];
+    const char *env_format = conda_env_export_format();
 
     snprintf(env_command, sizeof(env_command), "env export %s -n %s -f %s/%s.yml", env_format ? env_format : "", name, output_dir, output_filename);
     return conda_exec(env_command);
 }
 
+struct ProcessHandle *conda_env_export_async(char *name, char *output_dir, char *output_filename) {
+    char output_path[PATH_MAX];
+    const char *env_format = conda_env_export_format();
+    char *argv[9] = {0};
+    size_t argc = 0;
+
+    snprintf(output_path, sizeof(output_path), "%s/%s.yml", output_dir, output_filename);
+    argv[argc++] = "conda";
+    argv[argc++] = "env";
+    argv[argc++] = "export";
+    if (env_format) {
+        argv[argc++] = (char *) env_format;
+    }
+    argv[argc++] = "-n";
+    argv[argc++] = name;
+    argv[argc++] = "-f";
+    argv[argc++] = output_path;
+
+    msg(STASIS_MSG_L3, "Executing: conda env export %s -n %s -f %s\n", env_format ? env_format : "", name, output_path);
+    return shell_spawn(argv, SHELL_CAPTURE_MERGE);
+}
+
 char *conda_get_active_environment() {
     const char *name = getenv("CONDA_DEFAULT_ENV");
     if (!name) {
@@ -0,0 +1,387 @@
+/**
+ * @file content_manifest.c
+ */
+#include <fcntl.h>
+#include "content_manifest.h"
+#include "copy.h"
+#include "utils.h"
+
+/**
+ * Convert `path` to a manifest key (relative to the manifest root when possible)
+ */
+static void manifest_key(const struct ContentManifest *manifest, const char *path, char *key, size_t maxlen) {
+    const size_t root_len = strlen(manifest->root);
+    if (!strncmp(path, manifest->root, root_len) && (path[root_len] == '/' || manifest->root[root_len - 1] == '/')) {
+        path += root_len;
+        while (*path == '/') {
+            path++;
+        }
+    }
+    safe_strncpy(key, path, maxlen);
+}
+
+static void manifest_join(char *dest, size_t maxlen, const char *base, const char *key) {
+    if (*key == '/') {
+        safe_strncpy(dest, key, maxlen);
+        return;
+    }
+    const size_t len = strlen(base);
+    snprintf(dest, maxlen, "%s%s%s", base, len && base[len - 1] == '/' ? "" : "/", key);
+}
+
+/**
+ * Find the record of `key`, adding it when `create` is set
+ * @return index of the record, or -1
+ */
+static ssize_t manifest_record(struct StrList *paths, void **records, size_t *alloc, size_t record_size, const char *key, int create) {
+    size_t index = 0;
+    if (strlist_find(paths, key, &index)) {
+        return (ssize_t) index;
+    }
+    if (!create) {
+        return -1;
+    }
+
+    // Make room for the record first, so a failure leaves the key unrecorded
+    index = strlist_count(paths);
+    if (index >= *alloc) {
+        const size_t count = *alloc ? *alloc * 2 : 256;
+        char *tmp = realloc(*records, count * record_size);
+        if (!tmp) {
+            return -1;
+        }
+        memset(tmp + *alloc * record_size, 0, (count - *alloc) * record_size);
+        *records = tmp;
+        *alloc = count;
+    }
+    strlist_append(&paths, (char *) key);
+    if (strlist_count(paths) != index + 1) {
+        SYSERROR("unable to record %s", key);
+        return -1;
+    }
+    return (ssize_t) index;
+}
+
+static struct ContentManifestInput *manifest_input(struct ContentManifest *manifest, const char *key, int create) {
+    const ssize_t index = manifest_record(manifest->input_paths, (void **) &manifest->inputs, &manifest->inputs_alloc,
+                                          sizeof(*manifest->inputs), key, create);
+    return index < 0 ? NULL : &manifest->inputs[index];
+}
+
+static struct ContentManifestOutput *manifest_output(struct ContentManifest *manifest, const char *key, int create) {
+    const ssize_t index = manifest_record(manifest->output_paths, (void **) &manifest->outputs, &manifest->outputs_alloc,
+                                          sizeof(*manifest->outputs), key, create);
+    return index < 0 ? NULL : &manifest->outputs[index];
+}
+
+static struct ContentManifestOutput *manifest_prev_output(struct ContentManifest *manifest, const char *key, int create) {
+    const ssize_t index = manifest_record(manifest->prev_output_paths, (void **) &manifest->prev_outputs, &manifest->prev_outputs_alloc,
+                                          sizeof(*manifest->prev_outputs), key, create);
+    return index < 0 ? NULL : &manifest->prev_outputs[index];
+}
+
+/**
+ * Values may contain any character. Tabs, newlines and backslashes are escaped.
+ */
+static void manifest_write_value(FILE *fp, const char *value) {
+    for (const char *p = value; *p; p++) {
+        if (*p == '\\') {
+            fputs("\\\\", fp);
+        } else if (*p == '\t') {
+            fputs("\\t", fp);
+        } else if (*p == '\n') {
+            fputs("\\n", fp);
+        } else {
+            fputc(*p, fp);
+        }
+    }
+}
+
+static void manifest_unescape(char *value) {
+    char *out = value;
+    for (char *p = value; *p; p++) {
+        if (*p == '\\' && p[1]) {
+            p++;
+            *out++ = *p == 't' ? '\t' : *p == 'n' ? '\n' : *p;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+}
+
+/**
+ * Split a line into at most `max` tab separated fields
+ * @return number of fields
+ */
+static size_t manifest_split(char *line, char **fields, size_t max) {
+    size_t count = 0;
+    line[strcspn(line, "\n")] = '\0';
+    while (count < max) {
+        fields[count++] = line;
+        char *tab = count < max ? strchr(line, '\t') : NULL;
+        if (!tab) {
+            break;
+        }
+        *tab = '\0';
+        line = tab + 1;
+    }
+    return count;
+}
+
+static void manifest_load(struct ContentManifest *manifest) {
+    FILE *fp = fopen(manifest->filename, "r");
+    if (!fp) {
+        return;
+    }
+
+    char *line = NULL;
+    size_t line_alloc = 0;
+    if (getline(&line, &line_alloc, fp) < 0 || strncmp(line, CONTENT_MANIFEST_HEADER, strlen(CONTENT_MANIFEST_HEADER)) != 0) {
+        SYSWARN("%s: not a content manifest. Ignoring.", manifest->filename);
+        guard_free(line);
+        fclose(fp);
+        return;
+    }
+
+    while (getline(&line, &line_alloc, fp) >= 0) {
+        char *fields[6] = {0};
+        const size_t count = manifest_split(line, fields, sizeof(fields) / sizeof(*fields));
+        if (!strcmp(fields[0], "I") && count == 6 && strlen(fields[4]) == SHA256_HEX_SIZE - 1) {
+            struct ContentManifestInput *input = manifest_input(manifest, fields[5], 1);
+            if (!input) {
+                break;
+            }
+            input->size = (off_t) strtoll(fields[1], NULL, 10);
+            input->mtime.tv_sec = (time_t) strtoll(fields[2], NULL, 10);
+            input->mtime.tv_nsec = strtol(fields[3], NULL, 10);
+            safe_strncpy(input->hash, fields[4], sizeof(input->hash));
+        } else if (!strcmp(fields[0], "O") && count >= 3 && strlen(fields[1]) == SHA256_HEX_SIZE - 1) {
+            struct ContentManifestOutput *output = manifest_prev_output(manifest, fields[2], 1);
+            if (!output) {
+                break;
+            }
+            safe_strncpy(output->digest, fields[1], sizeof(output->digest));
+            guard_free(output->value);
+            if (count > 3) {
+                manifest_unescape(fields[3]);
+                output->value = strdup(fields[3]);
+            }
+        }
+    }
+    guard_free(line);
+    fclose(fp);
+}
+
+struct ContentManifest *content_manifest_open(const char *filename, const char *prev_root, const char *root) {
+    struct ContentManifest *manifest = calloc(1, sizeof(*manifest));
+    if (!manifest) {
+        return NULL;
+    }
+    manifest->filename = strdup(filename);
+    manifest->prev_root = prev_root ? strdup(prev_root) : NULL;
+    manifest->root = strdup(root);
+    manifest->input_paths = strlist_init_mode(STRLIST_MODE_INTERN);
+    manifest->prev_output_paths = strlist_init_mode(STRLIST_MODE_INTERN);
+    manifest->output_paths = strlist_init_mode(STRLIST_MODE_INTERN);
+    if (!manifest->filename || (prev_root && !manifest->prev_root) || !manifest->root
+        || !manifest->input_paths || !manifest->prev_output_paths || !manifest->output_paths) {
+        content_manifest_free(&manifest);
+        return NULL;
+    }
+
+    manifest_load(manifest);
+    return manifest;
+}
+
+int content_manifest_digest(struct ContentManifest *manifest, char **inputs, size_t count, const char *salt, char digest[SHA256_HEX_SIZE]) {
+    struct SHA256 ctx;
+    sha256_init(&ctx);
+    if (salt) {
+        sha256_update(&ctx, salt, strlen(salt));
+    }
+    sha256_update(&ctx, "", 1);
+
+    for (size_t i = 0; i < count; i++) {
+        const char *path = inputs[i];
+        char key[PATH_MAX] = {0};
+        manifest_key(manifest, path, key, sizeof(key));
+        sha256_update(&ctx, key, strlen(key) + 1);
+
+        struct stat st;
+        if (stat(path, &st) < 0) {
+            if (errno != ENOENT) {
+                SYSERROR("%s: %s", path, strerror(errno));
+                return -1;
+            }
+            sha256_update(&ctx, "-", 2);
+            continue;
+        }
+
+        struct ContentManifestInput *input = manifest_input(manifest, key, 1);
+        if (!input) {
+            SYSERROR("unable to allocate bytes for manifest input record");
+            return -1;
+        }
+        if (!*input->hash || input->size != st.st_size
+            || input->mtime.tv_sec != st.st_mtim.tv_sec || input->mtime.tv_nsec != st.st_mtim.tv_nsec) {
+            // New or modified
+            if (sha256_file(path, input->hash)) {
+                SYSERROR("unable to hash %s: %s", path, strerror(errno));
+                input->hash[0] = '\0';
+                return -1;
+            }
+            input->size = st.st_size;
+            input->mtime = st.st_mtim;
+        }
+        input->seen = 1;
+        sha256_update(&ctx, input->hash, sizeof(input->hash));
+    }
+
+    unsigned char result[SHA256_DIGEST_SIZE];
+    sha256_final(&ctx, result);
+    sha256_hex(result, digest);
+    return 0;
+}
+
+int content_manifest_reuse(struct ContentManifest *manifest, const char *output, const char *digest, const char **value) {
+    if (!manifest->prev_root) {
+        return 0;
+    }
+
+    char key[PATH_MAX] = {0};
+    manifest_key(manifest, output, key, sizeof(key));
+    const struct ContentManifestOutput *prev = manifest_prev_output(manifest, key, 0);
+    if (!prev || strcmp(prev->digest, digest) != 0) {
+        return 0;
+    }
+
+    char src[PATH_MAX] = {0};
+    char dest[PATH_MAX] = {0};
+    manifest_join(src, sizeof(src), manifest->prev_root, key);
+    manifest_join(dest, sizeof(dest), manifest->root, key);
+    struct stat st;
+    if (lstat(src, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+
+    char dest_dir[PATH_MAX] = {0};
+    safe_strncpy(dest_dir, dest, sizeof(dest_dir));
+    if (access(path_dirname(dest_dir), F_OK) && mkdirs(dest_dir, 0755)) {
+        return 0;
+    }
+    // copy2 follows an existing symbolic link at the destination
+    unlink(dest);
+    if (copy2(src, dest, CT_PERM)) {
+        SYSWARN("unable to reuse %s: %s", src, strerror(errno));
+        return 0;
+    }
+    // Consumers of the output see it as unchanged
+    const struct timespec times[2] = {{.tv_sec = 0, .tv_nsec = UTIME_OMIT}, st.st_mtim};
+    utimensat(AT_FDCWD, dest, times, 0);
+
+    if (content_manifest_store(manifest, key, digest, prev->value)) {
+        return 0;
+    }
+    if (value) {
+        *value = prev->value;
+    }
+    manifest->stored--;
+    manifest->reused++;
+    return 1;
+}
+
+int content_manifest_store(struct ContentManifest *manifest, const char *output, const char *digest, const char *value) {
+    char key[PATH_MAX] = {0};
+    manifest_key(manifest, output, key, sizeof(key));
+    struct ContentManifestOutput *record = manifest_output(manifest, key, 1);
+    if (!record) {
+        SYSERROR("unable to allocate bytes for manifest output record");
+        return -1;
+    }
+    safe_strncpy(record->digest, digest, sizeof(record->digest));
+    guard_free(record->value);
+    if (value) {
+        record->value = strdup(value);
+        if (!record->value) {
+            SYSERROR("unable to allocate bytes for manifest output value");
+            return -1;
+        }
+    }
+    manifest->stored++;
+    return 0;
+}
+
+int content_manifest_save(struct ContentManifest *manifest) {
+    char tempfile[PATH_MAX] = {0};
+    snprintf(tempfile, sizeof(tempfile), "%s.XXXXXX", manifest->filename);
+    const int fd = mkstemp(tempfile);
+    if (fd < 0) {
+        SYSERROR("unable to create temporary file: %s: %s", tempfile, strerror(errno));
+        return -1;
+    }
+    FILE *fp = fdopen(fd, "w");
+    if (!fp) {
+        close(fd);
+        remove(tempfile);
+        return -1;
+    }
+
+    fprintf(fp, "%s\n", CONTENT_MANIFEST_HEADER);
+    for (size_t i = 0; i < strlist_count(manifest->input_paths); i++) {
+        const struct ContentManifestInput *input = &manifest->inputs[i];
+        // Forget files that are no longer used
+        if (!input->seen) {
+            continue;
+        }
+        fprintf(fp, "I\t%lld\t%lld\t%ld\t%s\t%s\n",
+                (long long) input->size, (long long) input->mtime.tv_sec, (long) input->mtime.tv_nsec,
+                input->hash, strlist_item(manifest->input_paths, i));
+    }
+    for (size_t i = 0; i < strlist_count(manifest->output_paths); i++) {
+        const struct ContentManifestOutput *output = &manifest->outputs[i];
+        fprintf(fp, "O\t%s\t%s", output->digest, strlist_item(manifest->output_paths, i));
+        if (output->value) {
+            fputc('\t', fp);
+            manifest_write_value(fp, output->value);
+        }
+        fputc('\n', fp);
+    }
+
+    if (fflush(fp) || ferror(fp)) {
+        SYSERROR("unable to write %s: %s", tempfile, strerror(errno));
+        fclose(fp);
+        remove(tempfile);
+        return -1;
+    }
+    fclose(fp);
+    if (rename(tempfile, manifest->filename) < 0) {
+        SYSERROR("unable to replace %s: %s", manifest->filename, strerror(errno));
+        remove(tempfile);
+        return -1;
+    }
+    return 0;
+}
+
+void content_manifest_free(struct ContentManifest **manifest) {
+    struct ContentManifest *m = *manifest;
+    if (!m) {
+        return;
+    }
+    for (size_t i = 0; i < strlist_count(m->output_paths); i++) {
+        guard_free(m->outputs[i].value);
+    }
+    for (size_t i = 0; i < strlist_count(m->prev_output_paths); i++) {
+        guard_free(m->prev_outputs[i].value);
+    }
+    guard_free(m->inputs);
+    guard_free(m->outputs);
+    guard_free(m->prev_outputs);
+    guard_strlist_free(&m->input_paths);
+    guard_strlist_free(&m->output_paths);
+    guard_strlist_free(&m->prev_output_paths);
+    guard_free(m->filename);
+    guard_free(m->prev_root);
+    guard_free(m->root);
+    guard_free(*manifest);
+}
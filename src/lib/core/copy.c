@@ -1,7 +1,150 @@
 #include "copy.h"
 
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#define STASIS_HAVE_SENDFILE 1
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define STASIS_HAVE_COPY_FILE_RANGE 1
+#endif
+#endif
+
+const char *copy_method_str(enum CopyMethod method) {
+    switch (method) {
+        case COPY_METHOD_SYMLINK:
+            return "symlink";
+        case COPY_METHOD_HARDLINK:
+            return "hardlink";
+        case COPY_METHOD_MKNOD:
+            return "mknod";
+        case COPY_METHOD_REFLINK:
+            return "reflink";
+        case COPY_METHOD_COPY_FILE_RANGE:
+            return "copy_file_range";
+        case COPY_METHOD_SENDFILE:
+            return "sendfile";
+        case COPY_METHOD_BUFFER:
+            return "buffer";
+        default:
+            return "none";
+    }
+}
+
+/**
+ * Determine whether an accelerated copy failed because the kernel or file
+ * system doesn't support it, in which case the next method should be tried.
+ */
+static int copy_unsupported(int err) {
+    return err == ENOSYS || err == EXDEV || err == EINVAL || err == EOPNOTSUPP
+           || err == ENOTTY || err == EPERM || err == ENOTSUP || err == EBADF;
+}
+
+/**
+ * Copy `size` bytes from `fd_in` to `fd_out`
+ *
+ * Methods are tried from fastest to slowest. A method that stops early hands
+ * over to the next one at the current file offsets.
+ *
+ * @return 0 on success, -1 on error
+ */
+static int copy_data(const int fd_in, const int fd_out, const size_t size, size_t *copied, enum CopyMethod *method) {
+    *copied = 0;
+    *method = COPY_METHOD_BUFFER;
+
+#if defined(FICLONE)
+    // Share the source file's extents (btrfs, xfs, ...). Nothing is copied.
+    if (size && ioctl(fd_out, FICLONE, fd_in) == 0) {
+        *copied = size;
+        *method = COPY_METHOD_REFLINK;
+        return 0;
+    }
+#endif
+
+#if defined(STASIS_HAVE_COPY_FILE_RANGE)
+    // In-kernel copy. Remote and copy-on-write file systems may offload it.
+    while (*copied < size) {
+        const ssize_t n = copy_file_range(fd_in, NULL, fd_out, NULL, size - *copied, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && !(*copied == 0 && copy_unsupported(errno))) {
+            return -1;
+        }
+        if (n <= 0) {
+            break;
+        }
+        *copied += (size_t) n;
+        *method = COPY_METHOD_COPY_FILE_RANGE;
+    }
+#endif
+
+#if defined(STASIS_HAVE_SENDFILE)
+    // In-kernel copy through the page cache
+    while (*copied < size) {
+        const ssize_t n = sendfile(fd_out, fd_in, NULL, size - *copied);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && !(*copied == 0 && copy_unsupported(errno))) {
+            return -1;
+        }
+        if (n <= 0) {
+            break;
+        }
+        *copied += (size_t) n;
+        *method = COPY_METHOD_SENDFILE;
+    }
+#endif
+
+    if (*copied < size) {
+        const size_t bufsize = COPY_BUFFER_SIZE;
+        char *buf = malloc(bufsize);
+        if (!buf) {
+            return -1;
+        }
+        *method = COPY_METHOD_BUFFER;
+        while (1) {
+            ssize_t nread = read(fd_in, buf, bufsize);
+            if (nread < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nread < 0) {
+                guard_free(buf);
+                return -1;
+            }
+            if (nread == 0) {
+                break;
+            }
+            for (ssize_t offset = 0; offset < nread;) {
+                const ssize_t nwritten = write(fd_out, buf + offset, nread - offset);
+                if (nwritten < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (nwritten < 0) {
+                    guard_free(buf);
+                    return -1;
+                }
+                offset += nwritten;
+                *copied += (size_t) nwritten;
+            }
+        }
+        guard_free(buf);
+    }
+    return 0;
+}
+
 int copy2(const char *src, const char *dest, unsigned int op) {
+    return copy2_ex(src, dest, op, NULL);
+}
+
+int copy2_ex(const char *src, const char *dest, unsigned int op, enum CopyMethod *method_used) {
     struct stat src_stat, dnamest;
+    enum CopyMethod method = COPY_METHOD_NONE;
+
+    if (method_used) {
+        *method_used = COPY_METHOD_NONE;
+    }
 
     SYSDEBUG("Stat source file: %s", src);
     if (lstat(src, &src_stat) < 0) {
@@ -34,45 +177,52 @@ int copy2(const char *src, const char *dest, unsigned int op) {
             // silent
             return -1;
         }
+        method = COPY_METHOD_SYMLINK;
     } else if (S_ISREG(src_stat.st_mode) && src_stat.st_nlink > 2 && src_stat.st_dev == dnamest.st_dev) {
         if (link(src, dest) < 0) {
             SYSERROR("unable to link: %s, %s", src, strerror(errno));
             return -1;
         }
+        method = COPY_METHOD_HARDLINK;
     } else if (S_ISFIFO(src_stat.st_mode) || S_ISBLK(src_stat.st_mode) || S_ISCHR(src_stat.st_mode) || S_ISSOCK(src_stat.st_mode)) {
         if (mknod(dest, src_stat.st_mode, src_stat.st_rdev) < 0) {
             SYSERROR("unable to mknod: %s, %s", dest, strerror(errno));
             return -1;
         }
+        method = COPY_METHOD_MKNOD;
     } else if (S_ISREG(src_stat.st_mode)) {
-        char buf[STASIS_BUFSIZ] = {0};
-        size_t bytes_read;
         SYSDEBUG("Opening source file for reading");
-        FILE *fp1 = fopen(src, "rb");
-        if (!fp1) {
+        const int fd_in = open(src, O_RDONLY | O_CLOEXEC);
+        if (fd_in < 0) {
             SYSERROR("unable to open source file for reading: %s, %s", src, strerror(errno));
             return -1;
         }
 
         SYSDEBUG("Opening destination file for writing");
-        FILE *fp2 = fopen(dest, "w+b");
-        if (!fp2) {
+        const int fd_out = open(dest, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (fd_out < 0) {
             SYSERROR("unable to open destination file for writing: %s, %s", dest, strerror(errno));
-            fclose(fp1);
+            close(fd_in);
             return -1;
         }
 
         size_t bytes_written = 0;
-        while ((bytes_read = fread(buf, sizeof(char), sizeof(buf), fp1)) != 0) {
-            bytes_written += fwrite(buf, sizeof(char), bytes_read, fp2);
+        const int result = copy_data(fd_in, fd_out, (size_t) src_stat.st_size, &bytes_written, &method);
+        close(fd_in);
+        if (close(fd_out) < 0 && !result) {
+            SYSERROR("unable to close destination file: %s, %s", dest, strerror(errno));
+            return -1;
+        }
+        if (result) {
+            SYSERROR("unable to copy data: %s -> %s, %s", src, dest, strerror(errno));
+            return -1;
         }
-        fclose(fp1);
-        fclose(fp2);
 
         if (bytes_written != (size_t) src_stat.st_size) {
             SYSDEBUG("%s: SHORT WRITE (expected %zu bytes, but wrote %zu bytes)", dest, src_stat.st_size, bytes_written);
             return -1;
         }
+        SYSDEBUG("%s: copied %zu bytes using %s", dest, bytes_written, copy_method_str(method));
 
         if (op & CT_OWNER && chown(dest, src_stat.st_uid, src_stat.st_gid) < 0) {
             SYSERROR("unable to change owner: %s, %s", dest, strerror(errno));
@@ -86,5 +236,8 @@ int copy2(const char *src, const char *dest, unsigned int op) {
         return -1;
     }
     SYSDEBUG("Data copied");
+    if (method_used) {
+        *method_used = method;
+    }
     return 0;
 }
@@ -78,23 +78,93 @@ int docker_build(const char *dirpath, const char *args, int engine) {
     return docker_exec(cmd, 0);
 }
 
+struct DockerCompressor {
+    const char *name; ///< Program name
+    const char *ext; ///< File name extension of its output
+    const char *opt_threads; ///< Format of the option setting the thread count (NULL if single-threaded)
+    const char *parallel; ///< Multi-threaded, option-compatible replacement (may be NULL)
+};
+
+static const struct DockerCompressor docker_compressors[] = {
+    {"zstd", "zst", "-T%ld", NULL},
+    {"pzstd", "zst", "-p %ld", NULL},
+    {"xz", "xz", "-T%ld", NULL},
+    {"gzip", "gz", NULL, "pigz"},
+    {"pigz", "gz", "-p %ld", NULL},
+    {"bzip2", "bz2", NULL, "pbzip2"},
+    {"pbzip2", "bz2", "-p%ld", NULL},
+    {"lbzip2", "bz2", "-n %ld", NULL},
+};
+
+static const struct DockerCompressor *docker_compressor_find(const char *name) {
+    for (size_t i = 0; i < sizeof(docker_compressors) / sizeof(*docker_compressors); i++) {
+        if (!strcmp(docker_compressors[i].name, name)) {
+            return &docker_compressors[i];
+        }
+    }
+    return NULL;
+}
+
+int docker_compression_command(const char *program, long threads, char *cmd, size_t cmd_maxlen, char *ext, size_t ext_maxlen) {
+    char **parts = split((char *) program, " ", 0);
+    if (!parts || isempty(parts[0])) {
+        guard_array_free(parts);
+        return -1;
+    }
+
+    char name[PATH_MAX] = {0};
+    safe_strncpy(name, path_basename(parts[0]), sizeof(name));
+    const struct DockerCompressor *compressor = docker_compressor_find(name);
+    const char *args = strchr(program, ' ');
+    args = args ? args : "";
+
+    if (compressor && compressor->parallel && threads > 1 && find_program(compressor->parallel)) {
+        // Same options, more threads
+        compressor = docker_compressor_find(compressor->parallel);
+        safe_strncpy(name, compressor->name, sizeof(name));
+    } else {
+        safe_strncpy(name, parts[0], sizeof(name));
+    }
+
+    char opt_threads[255] = {0};
+    if (compressor && compressor->opt_threads && threads > 0) {
+        // Respect a thread count given by the configuration
+        int have_threads = 0;
+        for (size_t i = 1; parts[i] != NULL; i++) {
+            if (!strncmp(parts[i], compressor->opt_threads, 2) || startswith(parts[i], "--threads") || startswith(parts[i], "--processes")) {
+                have_threads = 1;
+                break;
+            }
+        }
+        if (!have_threads) {
+            opt_threads[0] = ' ';
+            snprintf(opt_threads + 1, sizeof(opt_threads) - 1, compressor->opt_threads, threads);
+        }
+    }
+    guard_array_free(parts);
+
+    snprintf(cmd, cmd_maxlen, "%s%s%s", name, opt_threads, args);
+    if (compressor) {
+        safe_strncpy(ext, compressor->ext, ext_maxlen);
+    } else {
+        char *ext_name = path_basename(name);
+        safe_strncpy(ext, ext_name, ext_maxlen);
+    }
+    return 0;
+}
+
 int docker_save(const char *image, const char *destdir, const char *compression_program) {
     char cmd[PATH_MAX] = {0};
 
     if (compression_program && strlen(compression_program)) {
         char ext[255] = {0};
-        if (startswith(compression_program, "zstd")) {
-            safe_strncpy(ext, "zst", sizeof(ext));
-        } else if (startswith(compression_program, "xz")) {
-            safe_strncpy(ext, "xz", sizeof(ext));
-        } else if (startswith(compression_program, "gzip")) {
-            safe_strncpy(ext, "gz", sizeof(ext));
-        } else if (startswith(compression_program, "bzip2")) {
-            safe_strncpy(ext, "bz2", sizeof(ext));
-        } else {
-            safe_strncpy(ext, compression_program, sizeof(ext));
+        char compressor[255] = {0};
+        const long threads = globals.cpu_limit > 0 ? globals.cpu_limit : get_cpu_count();
+        if (docker_compression_command(compression_program, threads, compressor, sizeof(compressor), ext, sizeof(ext))) {
+            SYSERROR("invalid compression program: %s", compression_program);
+            return -1;
         }
-        snprintf(cmd, sizeof(cmd), "save \"%s\" | %s > \"%s/%s.tar.%s\"", image, compression_program, destdir, image, ext);
+        snprintf(cmd, sizeof(cmd), "save \"%s\" | %s > \"%s/%s.tar.%s\"", image, compressor, destdir, image, ext);
     } else {
         snprintf(cmd, sizeof(cmd), "save \"%s\" -o \"%s/%s.tar\"", image, destdir, image);
 
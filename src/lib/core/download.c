@@ -2,121 +2,694 @@
 // Created by jhunk on 10/5/23.
 //
 
+#include <ctype.h>
+#include <pthread.h>
+#include <strings.h>
+#include <sys/stat.h>
 #include "download.h"
 #include "core.h"
+#include "copy.h"
+#include "sha256.h"
+
+struct DownloadSession {
+    int initialized;
+    CURLSH *share; ///< Connection cache, DNS cache and TLS sessions shared by all handles
+    pthread_mutex_t lock[CURL_LOCK_DATA_LAST]; ///< One lock per shared data type
+};
+
+static struct DownloadSession session;
+static pthread_mutex_t session_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct DownloadSettings {
+    size_t timeout;
+    size_t max_retries;
+    size_t max_retry_seconds;
+    size_t cache_ttl; ///< Seconds a cached file is used without revalidation
+    int offline; ///< Serve files from the cache only
+};
+
+static void session_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    (void) handle;
+    (void) access;
+    (void) userptr;
+    pthread_mutex_lock(&session.lock[data]);
+}
+
+static void session_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    (void) handle;
+    (void) userptr;
+    pthread_mutex_unlock(&session.lock[data]);
+}
+
+static int session_init() {
+    int status = 0;
+    pthread_mutex_lock(&session_init_lock);
+    if (session.initialized) {
+        goto done;
+    }
+
+    SYSDEBUG("Initializing curl session");
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+        SYSERROR("unable to initialize curl");
+        status = -1;
+        goto done;
+    }
+    session.share = curl_share_init();
+    if (!session.share) {
+        SYSERROR("unable to initialize curl share handle");
+        curl_global_cleanup();
+        status = -1;
+        goto done;
+    }
+    for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&session.lock[i], NULL);
+    }
+    curl_share_setopt(session.share, CURLSHOPT_LOCKFUNC, session_lock);
+    curl_share_setopt(session.share, CURLSHOPT_UNLOCKFUNC, session_unlock);
+    curl_share_setopt(session.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(session.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(session.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    session.initialized = 1;
+
+    done:
+    pthread_mutex_unlock(&session_init_lock);
+    return status;
+}
+
+void download_session_cleanup(void) {
+    pthread_mutex_lock(&session_init_lock);
+    if (session.initialized) {
+        SYSDEBUG("Releasing curl session");
+        curl_share_cleanup(session.share);
+        session.share = NULL;
+        for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&session.lock[i]);
+        }
+        curl_global_cleanup();
+        session.initialized = 0;
+    }
+    pthread_mutex_unlock(&session_init_lock);
+}
+
+static size_t getenv_size(const char *key, const size_t default_value) {
+    size_t value = default_value;
+    const char *value_str = getenv(key);
+    if (value_str) {
+        errno = 0;
+        value = strtoul(value_str, NULL, 10);
+        if (value == ULONG_MAX && errno == ERANGE) {
+            SYSERROR("%s must be a positive integer. Using default (%zu).", key, default_value);
+            value = default_value;
+        }
+    }
+    return value;
+}
+
+static void get_settings(struct DownloadSettings *settings) {
+    SYSDEBUG("Setting timeout");
+    settings->timeout = getenv_size("STASIS_DOWNLOAD_TIMEOUT", 30L);
+    SYSDEBUG("Setting max_retries");
+    settings->max_retries = getenv_size("STASIS_DOWNLOAD_RETRY_MAX", 5);
+    SYSDEBUG("Setting max_retry_seconds");
+    settings->max_retry_seconds = getenv_size("STASIS_DOWNLOAD_RETRY_SECONDS", 3);
+    SYSDEBUG("Setting cache_ttl");
+    settings->cache_ttl = getenv_size("STASIS_DOWNLOAD_CACHE_TTL", 0);
+    const char *offline = getenv("STASIS_DOWNLOAD_OFFLINE");
+    settings->offline = !isempty((char *) offline) && strcmp(offline, "0") != 0;
+}
+
+CURL *download_handle(void) {
+    if (session_init()) {
+        return NULL;
+    }
+    CURL *c = curl_easy_init();
+    if (!c) {
+        return NULL;
+    }
+
+    struct DownloadSettings settings;
+    get_settings(&settings);
+
+    char user_agent[STASIS_NAME_MAX] = {0};
+    snprintf(user_agent, sizeof(user_agent), "stasis/%s", STASIS_VERSION);
+
+    curl_easy_setopt(c, CURLOPT_SHARE, session.share);
+    curl_easy_setopt(c, CURLOPT_VERBOSE, 0L);
+    curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 1L);
+    // libcurl copies string options
+    curl_easy_setopt(c, CURLOPT_USERAGENT, user_agent);
+    curl_easy_setopt(c, CURLOPT_CONNECTTIMEOUT, (long) settings.timeout);
+    return c;
+}
 
 size_t download_writer(void *fp, size_t size, size_t nmemb, void *stream) {
     size_t bytes = fwrite(fp, size, nmemb, (FILE *) stream);
     return bytes;
 }
 
-long download(char *url, const char *filename, char **errmsg) {
-    SYSDEBUG("ARGS follow");
-    SYSDEBUG("url=%s", url);
-    SYSDEBUG("filename=%s", filename);
-    SYSDEBUG("errmsg=%s (NULL is OK)", *errmsg);
-    long http_code = -1;
-    char user_agent[STASIS_NAME_MAX] = {0};
-    snprintf(user_agent, sizeof(user_agent), "stasis/%s", STASIS_VERSION);
+struct DownloadCacheEntry {
+    char body[PATH_MAX]; ///< Cached response body
+    char meta[PATH_MAX]; ///< Validators of the cached response
+    char etag[STASIS_NAME_MAX];
+    char last_modified[STASIS_NAME_MAX];
+    long http_code;
+    time_t time; ///< When the response was last fetched or revalidated
+    int exists;
+};
 
-    SYSDEBUG("Setting timeout");
-    size_t timeout_default = 30L;
-    size_t timeout = timeout_default;
-    const char *timeout_str = getenv("STASIS_DOWNLOAD_TIMEOUT");
-    if (timeout_str) {
-        timeout = strtoul(timeout_str, NULL, 10);
-        if (timeout == ULONG_MAX && errno == ERANGE) {
-            SYSERROR("STASIS_DOWNLOAD_TIMEOUT must be a positive integer. Using default (%zu).", timeout);
-            timeout = timeout_default;
+struct DownloadTransfer {
+    struct DownloadRequest *request;
+    CURL *handle;
+    FILE *fp;
+    int pending; ///< Non-zero if the transfer must be (re)started
+    int cacheable; ///< Non-zero if the response may be stored in the cache
+    struct DownloadCacheEntry cache;
+    struct curl_slist *headers; ///< Conditional request headers
+    char part[PATH_MAX + 8]; ///< Destination of the data until the transfer completes
+    struct SHA256 sha256; ///< Digest of the data in part
+    curl_off_t resume_from; ///< Size of part when the attempt started
+    int resumable; ///< Non-zero if an interrupted transfer can be resumed (HTTP)
+    char etag[STASIS_NAME_MAX]; ///< ETag of the response
+    char last_modified[STASIS_NAME_MAX]; ///< Last-Modified of the response
+    curl_off_t range_start; ///< First byte of a partial response, or -1
+    curl_off_t range_total; ///< Size of the whole file reported by a partial response, or -1
+};
+
+static void cache_value(char *dest, const size_t maxlen, const char *value) {
+    while (isblank(*value)) {
+        value++;
+    }
+    snprintf(dest, maxlen, "%s", value);
+    strip(dest);
+}
+
+static int cache_lookup(struct DownloadCacheEntry *entry, const char *url) {
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    char key[SHA256_HEX_SIZE];
+    struct SHA256 ctx;
+
+    memset(entry, 0, sizeof(*entry));
+    sha256_init(&ctx);
+    sha256_update(&ctx, url, strlen(url));
+    sha256_final(&ctx, digest);
+    sha256_hex(digest, key);
+    snprintf(entry->body, sizeof(entry->body), "%s/%s", globals.download_cache_dir, key);
+    snprintf(entry->meta, sizeof(entry->meta), "%s/%s.meta", globals.download_cache_dir, key);
+
+    FILE *fp = fopen(entry->meta, "r");
+    if (!fp) {
+        return -1;
+    }
+    char line[STASIS_BUFSIZ] = {0};
+    int url_match = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        strip(line);
+        char *value = strchr(line, ' ');
+        if (!value) {
+            continue;
+        }
+        *value++ = '\0';
+        if (!strcmp(line, "url")) {
+            url_match = !strcmp(value, url);
+        } else if (!strcmp(line, "etag")) {
+            cache_value(entry->etag, sizeof(entry->etag), value);
+        } else if (!strcmp(line, "last_modified")) {
+            cache_value(entry->last_modified, sizeof(entry->last_modified), value);
+        } else if (!strcmp(line, "http_code")) {
+            entry->http_code = strtol(value, NULL, 10);
+        } else if (!strcmp(line, "time")) {
+            entry->time = (time_t) strtoll(value, NULL, 10);
         }
     }
+    fclose(fp);
 
-    SYSDEBUG("Setting max_retries");
-    const size_t max_retries_default = 5;
-    size_t max_retries = max_retries_default;
-    const char *max_retries_str = getenv("STASIS_DOWNLOAD_RETRY_MAX");
-    if (max_retries_str) {
-        max_retries = strtoul(max_retries_str, NULL, 10);
-        if (max_retries == ULONG_MAX && errno == ERANGE) {
-            SYSERROR("STASIS_DOWNLOAD_RETRY_MAX must be a positive integer. Using default (%zu).", max_retries);
-            max_retries = max_retries_default;
+    entry->exists = url_match && entry->http_code > 0 && !access(entry->body, F_OK);
+    return entry->exists ? 0 : -1;
+}
+
+static int cache_write_meta(const struct DownloadCacheEntry *entry, const char *url) {
+    char tmp[PATH_MAX + 32] = {0};
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", entry->meta, getpid());
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, "url %s\n", url);
+    fprintf(fp, "etag %s\n", entry->etag);
+    fprintf(fp, "last_modified %s\n", entry->last_modified);
+    fprintf(fp, "http_code %ld\n", entry->http_code);
+    fprintf(fp, "time %lld\n", (long long) entry->time);
+    if (fclose(fp) || rename(tmp, entry->meta)) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static int cache_store(struct DownloadTransfer *transfer) {
+    struct DownloadCacheEntry *entry = &transfer->cache;
+    const struct DownloadRequest *req = transfer->request;
+
+    if (mkdirs(globals.download_cache_dir, 0755)) {
+        return -1;
+    }
+    char tmp[PATH_MAX + 32] = {0};
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", entry->body, getpid());
+    if (copy2(req->filename, tmp, CT_PERM) || rename(tmp, entry->body)) {
+        remove(tmp);
+        return -1;
+    }
+    snprintf(entry->etag, sizeof(entry->etag), "%s", transfer->etag);
+    snprintf(entry->last_modified, sizeof(entry->last_modified), "%s", transfer->last_modified);
+    // A complete resumed response is stored as the whole file it is
+    entry->http_code = req->http_code == 206 ? 200 : req->http_code;
+    entry->time = time(NULL);
+    entry->exists = 1;
+    return cache_write_meta(entry, req->url);
+}
+
+static void cache_remove(struct DownloadCacheEntry *entry) {
+    remove(entry->meta);
+    remove(entry->body);
+    entry->exists = 0;
+}
+
+/**
+ * Move the partial file into place once its digest matches the expected digest
+ * @return 0 on success, -1 on error (errmsg is set)
+ */
+static int transfer_finish(struct DownloadTransfer *transfer, const char *digest) {
+    struct DownloadRequest *req = transfer->request;
+
+    snprintf(req->digest, sizeof(req->digest), "%s", digest);
+    if (req->sha256 && !HTTP_ERROR(req->http_code) && strcasecmp(req->sha256, digest) != 0) {
+        snprintf(req->errmsg, sizeof(req->errmsg), "sha256 mismatch: expected %s, got %s", req->sha256, digest);
+        remove(transfer->part);
+        return -1;
+    }
+    if (rename(transfer->part, req->filename)) {
+        snprintf(req->errmsg, sizeof(req->errmsg), "%s: %s", req->filename, strerror(errno));
+        remove(transfer->part);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Does the partial file hold the whole response body?
+ * A partial content response qualifies when it continued the partial file
+ * (which always begins at offset 0) up to the total size reported by the server.
+ * @return non-zero if complete
+ */
+static int transfer_complete(const struct DownloadTransfer *transfer) {
+    const struct DownloadRequest *req = transfer->request;
+    if (req->http_code == 200) {
+        return 1;
+    }
+    struct stat st;
+    return req->http_code == 206
+           && transfer->range_start == transfer->resume_from
+           && transfer->range_total > 0
+           && !stat(transfer->part, &st)
+           && (curl_off_t) st.st_size == transfer->range_total;
+}
+
+static int cache_restore(struct DownloadTransfer *transfer) {
+    struct DownloadRequest *req = transfer->request;
+    char digest[SHA256_HEX_SIZE] = {0};
+
+    if (copy2(transfer->cache.body, transfer->part, CT_PERM) || sha256_file(transfer->part, digest)) {
+        snprintf(req->errmsg, sizeof(req->errmsg), "%s: unable to restore cached file", req->filename);
+        remove(transfer->part);
+        return -1;
+    }
+    req->http_code = transfer->cache.http_code;
+    if (transfer_finish(transfer, digest)) {
+        req->http_code = -1;
+        return -1;
+    }
+    req->cached = 1;
+    return 0;
+}
+
+static size_t download_header(char *buffer, size_t size, size_t nitems, void *userdata) {
+    struct DownloadTransfer *transfer = userdata;
+    const size_t len = size * nitems;
+    char line[STASIS_BUFSIZ] = {0};
+    memcpy(line, buffer, len < sizeof(line) - 1 ? len : sizeof(line) - 1);
+
+    if (startswith(line, "HTTP/")) {
+        // A new response begins (i.e. after a redirect)
+        transfer->etag[0] = '\0';
+        transfer->last_modified[0] = '\0';
+        transfer->range_start = -1;
+        transfer->range_total = -1;
+    } else if (!strncasecmp(line, "Content-Range:", 14)) {
+        long long start = 0;
+        long long end = 0;
+        long long total = 0;
+        if (sscanf(line + 14, " bytes %lld-%lld/%lld", &start, &end, &total) == 3) {
+            transfer->range_start = (curl_off_t) start;
+            transfer->range_total = (curl_off_t) total;
         }
+    } else if (!strncasecmp(line, "ETag:", 5)) {
+        cache_value(transfer->etag, sizeof(transfer->etag), line + 5);
+    } else if (!strncasecmp(line, "Last-Modified:", 14)) {
+        cache_value(transfer->last_modified, sizeof(transfer->last_modified), line + 14);
     }
+    return len;
+}
 
-    SYSDEBUG("Setting max_retry_seconds");
-    const size_t max_retry_seconds_default = 3;
-    size_t max_retry_seconds = max_retry_seconds_default;
-    const char *max_retry_seconds_str = getenv("STASIS_DOWNLOAD_RETRY_SECONDS");
-    if (max_retry_seconds_str) {
-        max_retry_seconds = strtoul(max_retry_seconds_str, NULL, 10);
-        if (max_retry_seconds == ULONG_MAX && errno == ERANGE) {
-            SYSERROR("STASIS_DOWNLOAD_RETRY_SECONDS must be a positive integer. Using default (%zu).", max_retry_seconds);
-            max_retry_seconds = max_retry_seconds_default;
+static size_t transfer_writer(void *data, size_t size, size_t nmemb, void *userdata) {
+    struct DownloadTransfer *transfer = userdata;
+    const size_t len = size * nmemb;
+    if (fwrite(data, 1, len, transfer->fp) != len) {
+        return 0;
+    }
+    sha256_update(&transfer->sha256, data, len);
+    return len;
+}
+
+static int sha256_seed(struct SHA256 *ctx, FILE *fp) {
+    char buf[STASIS_BUFSIZ];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        sha256_update(ctx, buf, len);
+    }
+    return ferror(fp) ? -1 : 0;
+}
+
+static int transfer_start(CURLM *multi, struct DownloadTransfer *transfer, const int progress) {
+    struct DownloadRequest *req = transfer->request;
+
+    // Resume from the data written by a failed attempt
+    struct stat st;
+    transfer->resume_from = 0;
+    sha256_init(&transfer->sha256);
+    if (transfer->resumable && req->attempts && !stat(transfer->part, &st) && st.st_size > 0) {
+        transfer->fp = fopen(transfer->part, "a+b");
+        if (transfer->fp && !sha256_seed(&transfer->sha256, transfer->fp)) {
+            transfer->resume_from = st.st_size;
+        } else if (transfer->fp) {
+            fclose(transfer->fp);
+            transfer->fp = NULL;
+            sha256_init(&transfer->sha256);
+        }
+    }
+    if (!transfer->resume_from) {
+        transfer->fp = fopen(transfer->part, "wb");
+    }
+    if (!transfer->fp) {
+        snprintf(req->errmsg, sizeof(req->errmsg), "%s.part: %s", req->filename, strerror(errno));
+        return -1;
+    }
+    if (!transfer->handle) {
+        transfer->handle = download_handle();
+        if (!transfer->handle) {
+            snprintf(req->errmsg, sizeof(req->errmsg), "unable to initialize curl handle");
+            fclose(transfer->fp);
+            transfer->fp = NULL;
+            return -1;
         }
     }
 
+    SYSDEBUG("Configuring curl");
+    curl_easy_setopt(transfer->handle, CURLOPT_URL, req->url);
+    curl_easy_setopt(transfer->handle, CURLOPT_WRITEFUNCTION, transfer_writer);
+    curl_easy_setopt(transfer->handle, CURLOPT_WRITEDATA, transfer);
+    curl_easy_setopt(transfer->handle, CURLOPT_NOPROGRESS, progress ? 0L : 1L);
+    curl_easy_setopt(transfer->handle, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(transfer->handle, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) transfer->resume_from);
 
-    SYSDEBUG("Initializing curl context");
-    curl_global_init(CURL_GLOBAL_ALL);
-    CURL *c = curl_easy_init();
-    for (size_t retry = 0; retry < max_retries; retry++) {
-        if (retry) {
-            SYSWARN("[RETRY %zu/%zu] %s: %s", retry + 1, max_retries, *errmsg, url);
+    if (transfer->resumable) {
+        curl_easy_setopt(transfer->handle, CURLOPT_HEADERFUNCTION, download_header);
+        curl_easy_setopt(transfer->handle, CURLOPT_HEADERDATA, transfer);
+
+        char header[STASIS_NAME_MAX * 2] = {0};
+        curl_slist_free_all(transfer->headers);
+        transfer->headers = NULL;
+        if (transfer->resume_from) {
+            // The server sends the whole file if it changed. curl then fails with
+            // CURLE_RANGE_ERROR and the next attempt starts over.
+            const char *validator = !isempty(transfer->etag) ? transfer->etag : transfer->last_modified;
+            if (!isempty((char *) validator)) {
+                snprintf(header, sizeof(header), "If-Range: %s", validator);
+                transfer->headers = curl_slist_append(transfer->headers, header);
+            }
+        } else if (transfer->cache.exists) {
+            // Revalidate the cached file
+            if (!isempty(transfer->cache.etag)) {
+                snprintf(header, sizeof(header), "If-None-Match: %s", transfer->cache.etag);
+                transfer->headers = curl_slist_append(transfer->headers, header);
+            }
+            if (!isempty(transfer->cache.last_modified)) {
+                snprintf(header, sizeof(header), "If-Modified-Since: %s", transfer->cache.last_modified);
+                transfer->headers = curl_slist_append(transfer->headers, header);
+            }
         }
+        curl_easy_setopt(transfer->handle, CURLOPT_HTTPHEADER, transfer->headers);
+    }
 
-        SYSDEBUG("Configuring curl");
-        curl_easy_setopt(c, CURLOPT_URL, url);
-        curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, download_writer);
-        FILE *fp = fopen(filename, "wb");
-        if (!fp) {
-            return -1;
+    SYSDEBUG("curl_multi_add_handle(): \n\turl=%s\n\tfilename=%s\n\tresume_from=%lld",
+        req->url, req->filename, (long long) transfer->resume_from);
+    req->attempts++;
+    transfer->pending = 0;
+    if (curl_multi_add_handle(multi, transfer->handle) != CURLM_OK) {
+        snprintf(req->errmsg, sizeof(req->errmsg), "unable to start transfer");
+        fclose(transfer->fp);
+        transfer->fp = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void transfer_retry(struct DownloadTransfer *transfer, const size_t max_retries) {
+    struct DownloadRequest *req = transfer->request;
+    req->http_code = -1;
+    if (req->attempts < max_retries) {
+        SYSWARN("[RETRY %zu/%zu] %s: %s", req->attempts + 1, max_retries, req->errmsg, req->url);
+        transfer->pending = 1;
+    } else {
+        remove(transfer->part);
+    }
+}
+
+static void transfer_done(CURLM *multi, struct DownloadTransfer *transfer, const CURLcode curl_code, const size_t max_retries) {
+    struct DownloadRequest *req = transfer->request;
+
+    curl_multi_remove_handle(multi, transfer->handle);
+    fclose(transfer->fp);
+    transfer->fp = NULL;
+
+    SYSDEBUG("curl status code: %d", curl_code);
+    if (curl_code != CURLE_OK) {
+        SYSDEBUG("curl failed with code: %s", curl_easy_strerror(curl_code));
+        snprintf(req->errmsg, sizeof(req->errmsg), "%s", curl_easy_strerror(curl_code));
+        if (curl_code == CURLE_RANGE_ERROR) {
+            // The partial data cannot be resumed
+            remove(transfer->part);
         }
+        transfer_retry(transfer, max_retries);
+        return;
+    }
+
+    // Retry loop succeeded, no error
+    req->errmsg[0] = '\0';
+    curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &req->http_code);
+    SYSDEBUG("HTTP code: %li", req->http_code);
 
-        curl_easy_setopt(c, CURLOPT_VERBOSE, 0L);
-        curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_setopt(c, CURLOPT_USERAGENT, user_agent);
-        curl_easy_setopt(c, CURLOPT_NOPROGRESS, 0L);
-        curl_easy_setopt(c, CURLOPT_WRITEDATA, fp);
-        curl_easy_setopt(c, CURLOPT_CONNECTTIMEOUT, timeout);
+    if (transfer->resume_from && req->http_code == 416) {
+        // The partial file does not match the remote file
+        snprintf(req->errmsg, sizeof(req->errmsg), "unable to resume transfer: HTTP %ld", req->http_code);
+        remove(transfer->part);
+        transfer_retry(transfer, max_retries);
+        return;
+    }
 
-        SYSDEBUG("curl_easy_perform(): \n\turl=%s\n\tfilename=%s\n\tuser agent=%s\n\ttimeout=%zu", url, filename, user_agent, timeout);
-        const CURLcode curl_code = curl_easy_perform(c);
-        SYSDEBUG("curl status code: %d", curl_code);
+    if (req->http_code == 304 && transfer->cache.exists) {
+        SYSDEBUG("Not modified, using cached file: %s", req->url);
+        if (cache_restore(transfer)) {
+            // The cached file is unusable. Fetch the whole file.
+            cache_remove(&transfer->cache);
+            transfer_retry(transfer, max_retries);
+            return;
+        }
+        transfer->cache.time = time(NULL);
+        if (cache_write_meta(&transfer->cache, req->url)) {
+            SYSWARN("%s: unable to update download cache", transfer->cache.meta);
+        }
+        return;
+    }
 
-        if (curl_code != CURLE_OK) {
-            SYSDEBUG("curl failed with code: %s", curl_easy_strerror(curl_code));
-            const size_t errmsg_maxlen = 256;
-            if (!*errmsg) {
-                SYSDEBUG("allocating memory for error message");
-                *errmsg = calloc(errmsg_maxlen, sizeof(char));
-                if (!*errmsg) {
-                    SYSERROR("unable to allocate memory for error message");
-                    goto cleanup;
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    char digest_hex[SHA256_HEX_SIZE] = {0};
+    sha256_final(&transfer->sha256, digest);
+    sha256_hex(digest, digest_hex);
+    const int complete = transfer_complete(transfer);
+    if (transfer_finish(transfer, digest_hex)) {
+        transfer_retry(transfer, max_retries);
+        return;
+    }
+
+    if (transfer->cacheable && complete) {
+        if (cache_store(transfer)) {
+            SYSWARN("%s: unable to update download cache", transfer->cache.body);
+        }
+    }
+}
+
+int download_batch(struct DownloadRequest *requests, const size_t count) {
+    if (!count) {
+        return 0;
+    }
+    if (session_init()) {
+        return -1;
+    }
+
+    struct DownloadSettings settings;
+    get_settings(&settings);
+    if (!settings.max_retries) {
+        settings.max_retries = 1;
+    }
+
+    struct DownloadTransfer *transfers = calloc(count, sizeof(*transfers));
+    if (!transfers) {
+        SYSERROR("unable to allocate transfer records");
+        return -1;
+    }
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
+        SYSERROR("unable to initialize curl multi handle");
+        guard_free(transfers);
+        return -1;
+    }
+
+    const time_t now = time(NULL);
+    for (size_t i = 0; i < count; i++) {
+        struct DownloadRequest *req = &requests[i];
+        struct DownloadTransfer *transfer = &transfers[i];
+        req->http_code = -1;
+        req->errmsg[0] = '\0';
+        req->attempts = 0;
+        req->cached = 0;
+        req->digest[0] = '\0';
+        transfer->request = req;
+        transfer->pending = 1;
+        transfer->range_start = -1;
+        transfer->range_total = -1;
+        snprintf(transfer->part, sizeof(transfer->part), "%s.part", req->filename);
+
+        transfer->resumable = startswith(req->url, "http://") || startswith(req->url, "https://");
+        transfer->cacheable = transfer->resumable && globals.download_cache_dir;
+        if (!transfer->cacheable) {
+            continue;
+        }
+        cache_lookup(&transfer->cache, req->url);
+        if (transfer->cache.exists
+            && (settings.offline || (settings.cache_ttl && now - transfer->cache.time < (time_t) settings.cache_ttl))) {
+            SYSDEBUG("Using cached file: %s", req->url);
+            transfer->pending = 0;
+            if (cache_restore(transfer)) {
+                SYSERROR("%s", req->errmsg);
+                if (!settings.offline) {
+                    // The cached file is unusable. Fetch the whole file.
+                    cache_remove(&transfer->cache);
+                    req->errmsg[0] = '\0';
+                    transfer->pending = 1;
+                }
+            }
+        } else if (settings.offline) {
+            snprintf(req->errmsg, sizeof(req->errmsg), "not in download cache (STASIS_DOWNLOAD_OFFLINE is set)");
+            transfer->pending = 0;
+        }
+    }
+
+    // A single transfer keeps the progress meter. Concurrent meters would garble the terminal.
+    const int progress = count == 1;
+    size_t pending = count;
+    for (size_t round = 0; pending; round++) {
+        if (round) {
+            sleep(settings.max_retry_seconds);
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (transfers[i].pending) {
+                if (transfer_start(multi, &transfers[i], progress)) {
+                    SYSERROR("%s", requests[i].errmsg);
+                    transfers[i].pending = 0;
                 }
             }
-            snprintf(*errmsg, errmsg_maxlen, "%s", curl_easy_strerror(curl_code));
-            curl_easy_reset(c);
-            fclose(fp);
-            sleep(max_retry_seconds);
-            continue;
         }
 
-        cleanup:
-        SYSDEBUG("Cleaning up");
-        // Data written. Clean up.
-        fclose(fp);
+        int running = 0;
+        do {
+            if (curl_multi_perform(multi, &running) != CURLM_OK) {
+                break;
+            }
+            if (running) {
+                curl_multi_poll(multi, NULL, 0, 1000, NULL);
+            }
 
-        if (CURLE_OK && *errmsg) {
-            // Retry loop succeeded, no error
-            *errmsg[0] = '\0';
+            CURLMsg *info;
+            int queued;
+            while ((info = curl_multi_info_read(multi, &queued))) {
+                if (info->msg != CURLMSG_DONE) {
+                    continue;
+                }
+                struct DownloadTransfer *transfer = NULL;
+                curl_easy_getinfo(info->easy_handle, CURLINFO_PRIVATE, (char **) &transfer);
+                transfer_done(multi, transfer, info->data.result, settings.max_retries);
+            }
+        } while (running);
+
+        pending = 0;
+        for (size_t i = 0; i < count; i++) {
+            pending += transfers[i].pending != 0;
+        }
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (transfers[i].fp) {
+            // The multi handle failed before the transfer completed
+            curl_multi_remove_handle(multi, transfers[i].handle);
+            fclose(transfers[i].fp);
+            remove(transfers[i].part);
+        }
+        if (transfers[i].handle) {
+            curl_easy_cleanup(transfers[i].handle);
         }
+        curl_slist_free_all(transfers[i].headers);
+        failed += requests[i].http_code < 0;
+    }
+    curl_multi_cleanup(multi);
+    guard_free(transfers);
+    return failed;
+}
+
+long download(char *url, const char *filename, char **errmsg) {
+    SYSDEBUG("ARGS follow");
+    SYSDEBUG("url=%s", url);
+    SYSDEBUG("filename=%s", filename);
+    SYSDEBUG("errmsg=%s (NULL is OK)", *errmsg);
 
-        curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &http_code);
-        SYSDEBUG("HTTP code: %li", http_code);
+    struct DownloadRequest req = {.url = url, .filename = filename};
+    if (download_batch(&req, 1) < 0) {
+        return -1;
+    }
 
-        break;
+    if (req.errmsg[0]) {
+        if (!*errmsg) {
+            SYSDEBUG("allocating memory for error message");
+            *errmsg = calloc(STASIS_DOWNLOAD_ERRMSG_MAX, sizeof(char));
+            if (!*errmsg) {
+                SYSERROR("unable to allocate memory for error message");
+                return req.http_code;
+            }
+        }
+        snprintf(*errmsg, STASIS_DOWNLOAD_ERRMSG_MAX, "%s", req.errmsg);
+    } else if (*errmsg) {
+        // Retry loop succeeded, no error
+        *errmsg[0] = '\0';
     }
-    curl_easy_cleanup(c);
-    curl_global_cleanup();
-    return http_code;
-}
\ No newline at end of file
+    return req.http_code;
+}
@@ -7,6 +7,84 @@
 
 //extern char **__environ;
 
+#define RUNTIME_INDEX_MIN_ALLOC 64
+
+/**
+ * Length of the variable name in a `KEY=VALUE` record
+ */
+static size_t runtime_key_len(const char *record) {
+    const char *sep = strchr(record, '=');
+    return sep ? (size_t) (sep - record) : strlen(record);
+}
+
+/**
+ * Find the position of a variable in `env->vars`
+ * @param env `RuntimeEnv` structure
+ * @param key variable name
+ * @param key_len length of `key`
+ * @return position of the record, or -1 if not found
+ */
+static ssize_t runtime_index_lookup(RuntimeEnv *env, const char *key, size_t key_len) {
+    const size_t mask = env->index_alloc - 1;
+    for (size_t slot = strhash(key, key_len) & mask; env->index[slot]; slot = (slot + 1) & mask) {
+        const size_t pos = env->index[slot] - 1;
+        const char *record = env->vars->data[pos];
+        if (runtime_key_len(record) == key_len && !strncmp(record, key, key_len)) {
+            return (ssize_t) pos;
+        }
+    }
+    return -1;
+}
+
+static void runtime_index_insert(RuntimeEnv *env, size_t pos) {
+    const char *record = env->vars->data[pos];
+    const size_t key_len = runtime_key_len(record);
+    const size_t mask = env->index_alloc - 1;
+    size_t slot;
+    for (slot = strhash(record, key_len) & mask; env->index[slot]; slot = (slot + 1) & mask) {}
+    env->index[slot] = pos + 1;
+}
+
+/**
+ * Resize and repopulate the variable index. The load factor is kept at or below 50%.
+ * @param env `RuntimeEnv` structure
+ * @param count number of records the index must accommodate
+ * @return 0 on success, -1 on error
+ */
+static int runtime_index_rebuild(RuntimeEnv *env, size_t count) {
+    size_t index_alloc = RUNTIME_INDEX_MIN_ALLOC;
+    while (index_alloc < count * 2) {
+        index_alloc *= 2;
+    }
+    size_t *index = calloc(index_alloc, sizeof(*index));
+    if (!index) {
+        return -1;
+    }
+    guard_free(env->index);
+    env->index = index;
+    env->index_alloc = index_alloc;
+    for (size_t i = 0; i < strlist_count(env->vars); i++) {
+        runtime_index_insert(env, i);
+    }
+    return 0;
+}
+
+/**
+ * Append a `KEY=VALUE` record
+ * @param env `RuntimeEnv` structure
+ * @param record string to append
+ * @return 0 on success, -1 on error
+ */
+static int runtime_append(RuntimeEnv *env, const char *record) {
+    const size_t count = strlist_count(env->vars) + 1;
+    if (count * 2 > env->index_alloc && runtime_index_rebuild(env, count) < 0) {
+        return -1;
+    }
+    strlist_append(&env->vars, (char *) record);
+    runtime_index_insert(env, count - 1);
+    return 0;
+}
+
 /**
  * Print a shell-specific listing of environment variables to `stdout`
  *
@@ -91,32 +169,23 @@ void runtime_export(RuntimeEnv *env, char **keys) {
         }
     }
 
-    for (size_t i = 0; i < strlist_count(env); i++) {
-        char output[STASIS_BUFSIZ] = {0};
-        char **pair = split(strlist_item(env, i), "=", 0);
-        char *key = pair[0];
-        char *value = NULL;
-
-        // We split a potentially large string by "=" so:
-        // Recombine elements pair[1..N] into a single string by "="
-        if (pair[1] != NULL) {
-            value = join(&pair[1], "=");
-        }
-
-        if (keys != NULL) {
-            for (size_t j = 0; keys[j] != NULL; j++) {
-                if (strcmp(keys[j], key) == 0) {
-                    snprintf(output, sizeof(output), "%s %s=\"%s\"", export_command, key, value ? value : "");
-                    puts(output);
-                }
+    if (keys != NULL) {
+        for (size_t i = 0; keys[i] != NULL; i++) {
+            const ssize_t pos = runtime_contains(env, keys[i]);
+            if (pos < 0) {
+                continue;
             }
+            const char *record = strlist_item(env->vars, pos);
+            const char *value = strchr(record, '=');
+            printf("%s %s=\"%s\"\n", export_command, keys[i], value ? value + 1 : "");
         }
-        else {
-            snprintf(output, sizeof(output), "%s %s=\"%s\"", export_command, key, value ? value : "");
-            puts(output);
-        }
-        guard_free(value);
-        guard_array_free(pair);
+        return;
+    }
+
+    for (size_t i = 0; i < strlist_count(env->vars); i++) {
+        const char *record = strlist_item(env->vars, i);
+        const char *value = strchr(record, '=');
+        printf("%s %.*s=\"%s\"\n", export_command, (int) runtime_key_len(record), record, value ? value + 1 : "");
     }
 }
 
@@ -142,17 +211,65 @@ void runtime_export(RuntimeEnv *env, char **keys) {
  * @return `RuntimeEnv` structure
  */
 RuntimeEnv *runtime_copy(char **env) {
-    RuntimeEnv *rt = NULL;
     size_t env_count;
     for (env_count = 0; env[env_count] != NULL; env_count++) {}
 
-    rt = strlist_init();
+    RuntimeEnv *rt = calloc(1, sizeof(*rt));
+    if (!rt) {
+        return NULL;
+    }
+    rt->vars = strlist_init();
+    if (!rt->vars || strlist_reserve(rt->vars, env_count) < 0 || runtime_index_rebuild(rt, env_count) < 0) {
+        runtime_free(rt);
+        return NULL;
+    }
+
     for (size_t i = 0; i < env_count; i++) {
-        strlist_append(&rt, env[i]);
+        // The first definition of a variable wins, same as getenv()
+        if (runtime_index_lookup(rt, env[i], runtime_key_len(env[i])) >= 0) {
+            continue;
+        }
+        if (runtime_append(rt, env[i]) < 0) {
+            runtime_free(rt);
+            return NULL;
+        }
     }
     return rt;
 }
 
+/**
+ * Retrieve the `KEY=VALUE` records stored in a `RuntimeEnv`
+ *
+ * The array is owned by `env`. It remains valid until `env` is modified or released.
+ *
+ * ~~~{.c}
+ * RuntimeEnv *rt = runtime_copy(environ);
+ * runtime_set(rt, "PYTHONUNBUFFERED", "1");
+ * execve("/usr/bin/python", (char *[]) {"python", "script.py", NULL}, runtime_envp(rt));
+ * ~~~
+ *
+ * @param env `RuntimeEnv` structure
+ * @return NULL terminated array suitable for use as `envp`
+ */
+char **runtime_envp(RuntimeEnv *env) {
+    if (!env) {
+        return NULL;
+    }
+    return env->vars->data;
+}
+
+/**
+ * Get the number of variables stored in a `RuntimeEnv`
+ * @param env `RuntimeEnv` structure
+ * @return count of variables
+ */
+size_t runtime_count(RuntimeEnv *env) {
+    if (!env) {
+        return 0;
+    }
+    return strlist_count(env->vars);
+}
+
 /**
  * Replace the contents of `dest` with `src`
  * @param dest pointer of type `RuntimeEnv`
@@ -165,12 +282,7 @@ int runtime_replace(RuntimeEnv **dest, char **src) {
         return -1;
     }
     runtime_free((*dest));
-
-    (*dest) = runtime_copy(rt_tmp->data);
-    if (!(*dest)) {
-        return -1;
-    }
-    runtime_free(rt_tmp);
+    (*dest) = rt_tmp;
 
     runtime_apply((*dest));
     return 0;
@@ -201,20 +313,10 @@ int runtime_replace(RuntimeEnv **dest, char **src) {
  * @return  -1=no, positive_value=yes
  */
 ssize_t runtime_contains(RuntimeEnv *env, const char *key) {
-    ssize_t result = -1;
-    for (ssize_t i = 0; i < (ssize_t) strlist_count(env); i++) {
-        char **pair = split(strlist_item(env, i), "=", 0);
-        if (pair == NULL) {
-            break;
-        }
-        if (strcmp(pair[0], key) == 0) {
-            result = i;
-            guard_array_free(pair);
-            break;
-        }
-        guard_array_free(pair);
+    if (!env || !key) {
+        return -1;
     }
-    return result;
+    return runtime_index_lookup(env, key, strlen(key));
 }
 
 /**
@@ -240,21 +342,12 @@ ssize_t runtime_contains(RuntimeEnv *env, const char *key) {
  * @return success=string, failure=`NULL`
  */
 char *runtime_get(RuntimeEnv *env, const char *key) {
-    char *result = NULL;
-    ssize_t key_offset = runtime_contains(env, key);
-    if (key_offset != -1) {
-        char **pair = split(strlist_item(env, key_offset), "=", 0);
-        if (!pair) {
-            return NULL;
-        }
-        result = join(&pair[1], "=");
-        if (!result) {
-            guard_array_free(pair);
-            return NULL;
-        }
-        guard_array_free(pair);
+    const ssize_t key_offset = runtime_contains(env, key);
+    if (key_offset < 0) {
+        return NULL;
     }
-    return result;
+    const char *value = strchr(strlist_item(env->vars, key_offset), '=');
+    return strdup(value ? value + 1 : "");
 }
 
 /**
@@ -430,9 +523,12 @@ void runtime_set(RuntimeEnv *env, const char *_key, char *_value) {
     }
 
     if (key_offset < 0) {
-        strlist_append(&env, now);
+        if (runtime_append(env, now) < 0) {
+            SYSERROR("unable to allocate memory for variable index");
+            exit(1);
+        }
     } else {
-        strlist_set(&env, key_offset, now);
+        strlist_set(&env->vars, key_offset, now);
     }
     guard_free(now);
     guard_free(key);
@@ -444,19 +540,21 @@ void runtime_set(RuntimeEnv *env, const char *_key, char *_value) {
  * @param env `RuntimeEnv` structure
  */
 void runtime_apply(RuntimeEnv *env) {
-    for (size_t i = 0; i < strlist_count(env); i++) {
-        const char *item = strlist_item(env, i);
+    for (size_t i = 0; i < runtime_count(env); i++) {
+        char *item = strlist_item(env->vars, i);
         if (!item) {
             SYSERROR("failed to read from env list");
             return;
         }
-        char **pair = split((char *) item, "=", 1);
-        if (!pair) {
-            SYSERROR("unable to allocate memory for key/value pair");
-            return;
+        // Terminate the key in place rather than splitting the record
+        char *sep = strchr(item, '=');
+        if (sep) {
+            *sep = '\0';
+        }
+        setenv(item, sep ? sep + 1 : "", 1);
+        if (sep) {
+            *sep = '=';
         }
-        setenv(pair[0], pair[1], 1);
-        guard_array_free(pair);
     }
 }
 
@@ -468,5 +566,7 @@ void runtime_free(RuntimeEnv *env) {
     if (env == NULL) {
         return;
     }
-    strlist_free(&env);
+    guard_strlist_free(&env->vars);
+    guard_free(env->index);
+    guard_free(env);
 }
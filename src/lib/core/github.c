@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "core.h"
+#include "download.h"
 #include "github.h"
 
 struct GHContent {
@@ -52,7 +53,8 @@ int get_github_release_notes(const char *api_token, const char *repo, const char
     struct curl_slist *list = NULL;
     struct GHContent content;
 
-    CURL *curl = curl_easy_init();
+    // Attach to the shared session (sets the user-agent github requires)
+    CURL *curl = download_handle();
     if (!curl) {
         return -1;
     }
@@ -64,7 +66,6 @@ int get_github_release_notes(const char *api_token, const char *repo, const char
 
     // Begin curl configuration
     curl_easy_setopt(curl, CURLOPT_URL, endpoint_url);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, endpoint_post_fields);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writer);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *) &content);
@@ -75,11 +76,6 @@ int get_github_release_notes(const char *api_token, const char *repo, const char
     list = curl_slist_append(list, endpoint_header_api_version);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
 
-    // Set the user-agent (github requires one)
-    char user_agent[20] = {0};
-    snprintf(user_agent, sizeof(user_agent), "stasis/%s", VERSION);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent);
-
     // Execute curl request
     memset(&content, 0, sizeof(content));
     CURLcode res = curl_easy_perform(curl);
@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include "core.h"
 #include "envctl.h"
+#include "download.h"
 
 const char *VERSION = STASIS_VERSION " (" STASIS_VERSION_BRANCH ")";
 const char *AUTHOR = "Joseph Hunkeler";
@@ -66,7 +67,9 @@ void globals_free() {
     guard_free(globals.jfrog.jfrog_artifactory_product);
     guard_free(globals.jfrog.remote_filename);
     guard_free(globals.workaround.conda_reactivate);
+    guard_free(globals.download_cache_dir);
     if (globals.envctl) {
         envctl_free(&globals.envctl);
     }
+    download_session_cleanup();
 }
@@ -49,6 +49,8 @@ struct JFRT_Upload {
     char *target_props; //!< Properties (separated by semicolons)
     int threads; //!< Thread count
     bool workaround_parent_only; //!< Change directory to local parent directory before uploading files
+    char *manifest; //!< Path to the SHA-256 manifest of uploaded files (NULL uploads every file)
+    bool manifest_verify; //!< Confirm unchanged files with the repository before skipping them
 };
 
 struct JFRT_Download {
@@ -224,6 +226,97 @@ int jfrog_cli_rt_ping(struct JFRT_Auth *auth);
  */
 int jfrog_cli_rt_upload(struct JFRT_Auth *auth, struct JFRT_Upload *ctx, char *src, char *repo_path);
 
+//! A file to be uploaded by jfrog_cli_rt_upload_files()
+struct JFRT_UploadFile {
+    char *src; //!< Local file path
+    char *target; //!< Remote path (repository/path/name)
+    int status; //!< 0 if the file was uploaded, non-zero otherwise
+    char sha256[SHA256_HEX_SIZE]; //!< SHA-256 reported by Artifactory (empty if unknown)
+    char digest[SHA256_HEX_SIZE]; //!< SHA-256 of the local file (computed when a manifest is used)
+    int skipped; //!< Non-zero if the file was unchanged and not uploaded
+};
+
+//! A list of files to be uploaded by jfrog_cli_rt_upload_files()
+struct JFRT_UploadFiles {
+    struct JFRT_UploadFile *file; //!< Array of files
+    size_t num_used; //!< Number of files in use
+    size_t num_alloc; //!< Number of files allocated
+};
+
+/**
+ * Create an empty upload list
+ * @return pointer to JFRT_UploadFiles, or NULL on error
+ */
+struct JFRT_UploadFiles *jfrt_upload_files_init();
+
+/**
+ * Add the files matching a local pattern to an upload list
+ *
+ * The pattern is expanded the way jfrog_cli_rt_upload() uploads it with
+ * `workaround_parent_only` enabled: the path leading up to the first wildcard
+ * is the base directory, and each match is uploaded to `repo_path` under its
+ * path relative to the base. A directory uploads its contents. Files matching
+ * `ctx->exclusions` (separated by semicolons) are skipped. When
+ * `ctx->recursive` is enabled, `*` matches across directories.
+ *
+ * @param files pointer to JFRT_UploadFiles
+ * @param ctx JFRT_Upload structure
+ * @param src local pattern to upload
+ * @param repo_path remote Artifactory destination path
+ * @return number of files added, or -1 on error
+ */
+ssize_t jfrt_upload_files_add(struct JFRT_UploadFiles *files, const struct JFRT_Upload *ctx, const char *src, const char *repo_path);
+
+/**
+ * Release an upload list
+ * @param files pointer to JFRT_UploadFiles pointer (set to NULL)
+ */
+void jfrt_upload_files_free(struct JFRT_UploadFiles **files);
+
+/**
+ * Upload a list of files with one "jf" invocation
+ *
+ * The files are written to a JSON file spec, and jf transfers them with
+ * `ctx->threads` concurrent uploads. The outcome of each file is read from
+ * jf's detailed summary, and recorded in its `status` and `sha256` members.
+ *
+ * When `ctx->manifest` is set, the SHA-256 of each uploaded file is recorded
+ * there under its target. A later upload skips a file whose SHA-256 matches
+ * the one recorded for its target, and reports it as uploaded. With
+ * `ctx->manifest_verify` enabled, the skipped files are first looked up with
+ * one "jf rt search", and only those present in the repository with the same
+ * SHA-256 are skipped.
+ *
+ * Nothing is skipped when `ctx->build_name` or `ctx->target_props` is set,
+ * because a file left out of the upload is not attached to the build info and
+ * does not receive the properties. jf's checksum deploy avoids sending the
+ * contents of those files again.
+ *
+ * ```c
+ * struct JFRT_Upload upload_ctx;
+ * jfrt_upload_init(&upload_ctx);
+ * upload_ctx.threads = 8;
+ * upload_ctx.manifest = "cache/artifactory/uploads";
+ *
+ * struct JFRT_UploadFiles *files = jfrt_upload_files_init();
+ * jfrt_upload_files_add(files, &upload_ctx, "output/wheels/stasis-*.whl", "repo_name/packages/");
+ * if (jfrog_cli_rt_upload_files(&auth_ctx, &upload_ctx, files)) {
+ *     for (size_t i = 0; i < files->num_used; i++) {
+ *         if (files->file[i].status) {
+ *             fprintf(stderr, "Upload failed: %s\n", files->file[i].src);
+ *         }
+ *     }
+ * }
+ * jfrt_upload_files_free(&files);
+ * ```
+ *
+ * @param auth JFRT_Auth structure
+ * @param ctx JFRT_Upload structure
+ * @param files pointer to JFRT_UploadFiles
+ * @return 0 on success, number of files that were not uploaded, or -1 on error
+ */
+int jfrog_cli_rt_upload_files(struct JFRT_Auth *auth, struct JFRT_Upload *ctx, struct JFRT_UploadFiles *files);
+
 /**
  * Download a file from an Artifactory repository
  *
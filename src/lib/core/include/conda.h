@@ -255,6 +255,28 @@ int conda_env_remove(char *name);
  */
 int conda_env_export(char *name, char *output_dir, char *output_filename);
 
+/**
+ * Start exporting a Conda environment in YAML format without waiting for it to finish
+ *
+ * Program output (stdout and stderr) is captured by the returned handle.
+ *
+ * ```c
+ * struct ProcessHandle *proc = conda_env_export_async("myenv", "./", "myenv");
+ * if (!proc || shell_wait(proc)) {
+ *     fprintf(stderr, "Unable to export environment\n");
+ *     exit(1);
+ * }
+ * shell_handle_free(&proc);
+ * ```
+ *
+ * @param name Environment name to export
+ * @param output_dir Destination directory
+ * @param output_filename Destination file name (without extension)
+ * @return pointer to ProcessHandle (see shell_spawn())
+ * @return NULL on error
+ */
+struct ProcessHandle *conda_env_export_async(char *name, char *output_dir, char *output_filename);
+
 /**
  * Run "conda index" on a local conda channel
  *
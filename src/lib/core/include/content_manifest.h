@@ -0,0 +1,136 @@
+//! @file content_manifest.h
+#ifndef STASIS_CONTENT_MANIFEST_H
+#define STASIS_CONTENT_MANIFEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "core.h"
+#include "sha256.h"
+#include "strlist.h"
+
+//! First line of a content manifest file
+#define CONTENT_MANIFEST_HEADER "# stasis content manifest 1"
+
+struct ContentManifestInput {
+    off_t size; ///< Size of the file when it was hashed
+    struct timespec mtime; ///< Modification time of the file when it was hashed
+    char hash[SHA256_HEX_SIZE]; ///< SHA-256 of the file's contents
+    int seen; ///< Non-zero if the input was used during this run
+};
+
+struct ContentManifestOutput {
+    char digest[SHA256_HEX_SIZE]; ///< Digest of the inputs the output was generated from
+    char *value; ///< Data stored alongside the output (may be NULL)
+};
+
+struct ContentManifest {
+    char *filename; ///< Path to the manifest file
+    char *prev_root; ///< Directory holding the outputs of the previous run (NULL disables reuse)
+    char *root; ///< Directory where outputs are generated
+    struct StrList *input_paths; ///< Interned input paths (indexes inputs)
+    struct ContentManifestInput *inputs;
+    size_t inputs_alloc;
+    struct StrList *prev_output_paths; ///< Interned output paths from the previous run (indexes prev_outputs)
+    struct ContentManifestOutput *prev_outputs;
+    size_t prev_outputs_alloc;
+    struct StrList *output_paths; ///< Interned output paths from this run (indexes outputs)
+    struct ContentManifestOutput *outputs;
+    size_t outputs_alloc;
+    size_t reused; ///< Number of outputs restored by content_manifest_reuse()
+    size_t stored; ///< Number of outputs recorded by content_manifest_store()
+};
+
+/**
+ * Load a content manifest
+ *
+ * A content manifest lets a program that regenerates a tree of outputs skip
+ * the outputs whose inputs did not change since the previous run. It keeps:
+ *
+ * - the size, modification time and SHA-256 of each input file, so unchanged
+ *   files are never read twice
+ * - the digest of the inputs of each output, and an optional string value
+ *
+ * Outputs are generated in `root`. The previous run's outputs are expected
+ * in `prev_root` under the same relative paths.
+ *
+ * ```c
+ * struct ContentManifest *manifest = content_manifest_open("/dest/.manifest", "/dest", "/work");
+ * char *inputs[] = {"/work/page.md"};
+ * char digest[SHA256_HEX_SIZE] = {0};
+ * content_manifest_digest(manifest, inputs, 1, "pandoc", digest);
+ * if (!content_manifest_reuse(manifest, "/work/page.html", digest, NULL)) {
+ *     convert("/work/page.md", "/work/page.html");
+ *     content_manifest_store(manifest, "/work/page.html", digest, NULL);
+ * }
+ * // ... copy /work to /dest ...
+ * content_manifest_save(manifest);
+ * content_manifest_free(&manifest);
+ * ```
+ *
+ * @param filename path to manifest file (need not exist)
+ * @param prev_root directory holding previous outputs (NULL regenerates every output)
+ * @param root directory where outputs are generated
+ * @return pointer to ContentManifest, or NULL on error
+ */
+struct ContentManifest *content_manifest_open(const char *filename, const char *prev_root, const char *root);
+
+/**
+ * Compute the digest of a set of input files
+ *
+ * Paths under `root` are recorded relative to it. A file whose size and
+ * modification time match its record is not hashed again. A missing file
+ * contributes a distinct marker, so its appearance changes the digest.
+ *
+ * @param manifest pointer to ContentManifest
+ * @param inputs array of input paths
+ * @param count number of paths in inputs
+ * @param salt additional data that affects the outputs (e.g. program version, options; may be NULL)
+ * @param digest output digest
+ * @return 0 on success, -1 if an input could not be read
+ */
+int content_manifest_digest(struct ContentManifest *manifest, char **inputs, size_t count, const char *salt, char digest[SHA256_HEX_SIZE]);
+
+/**
+ * Restore an output generated by the previous run
+ *
+ * When the previous run recorded `output` with the same digest and the file
+ * still exists in `prev_root`, it is copied into `root` (keeping its
+ * modification time) and recorded for the next run.
+ *
+ * @param manifest pointer to ContentManifest
+ * @param output path of output file (relative paths are relative to root)
+ * @param digest digest returned by content_manifest_digest()
+ * @param value (result) value stored with the output (may be NULL)
+ * @return 1 if the output was restored, 0 if it must be generated
+ */
+int content_manifest_reuse(struct ContentManifest *manifest, const char *output, const char *digest, const char **value);
+
+/**
+ * Record an output generated during this run
+ * @param manifest pointer to ContentManifest
+ * @param output path of output file (relative paths are relative to root)
+ * @param digest digest returned by content_manifest_digest()
+ * @param value string to store with the output (may be NULL)
+ * @return 0 on success, -1 on error
+ */
+int content_manifest_store(struct ContentManifest *manifest, const char *output, const char *digest, const char *value);
+
+/**
+ * Write the inputs and outputs used during this run to the manifest file
+ *
+ * The file is replaced atomically.
+ *
+ * @param manifest pointer to ContentManifest
+ * @return 0 on success, -1 on error
+ */
+int content_manifest_save(struct ContentManifest *manifest);
+
+/**
+ * Release a ContentManifest
+ * @param manifest pointer to ContentManifest pointer (set to NULL)
+ */
+void content_manifest_free(struct ContentManifest **manifest);
+
+#endif //STASIS_CONTENT_MANIFEST_H
@@ -8,12 +8,28 @@
 #include <dirent.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include "core.h"
 
 #define CT_OWNER 1 << 1
 #define CT_PERM 1 << 2
 
+//! Size of the buffer used when the kernel can't copy file data on its own
+#define COPY_BUFFER_SIZE (1024 * 1024)
+
+//! Methods copy2_ex() uses to reproduce a file, fastest first
+enum CopyMethod {
+    COPY_METHOD_NONE = 0,
+    COPY_METHOD_SYMLINK, ///< Source is a symbolic link
+    COPY_METHOD_HARDLINK, ///< Destination is a hard link to the source
+    COPY_METHOD_MKNOD, ///< Source is a device, FIFO or socket
+    COPY_METHOD_REFLINK, ///< Destination shares the source's data blocks (FICLONE)
+    COPY_METHOD_COPY_FILE_RANGE, ///< Data copied in the kernel with copy_file_range()
+    COPY_METHOD_SENDFILE, ///< Data copied in the kernel with sendfile()
+    COPY_METHOD_BUFFER, ///< Data copied with read() and write()
+};
+
 /**
  * Copy a single file
  *
@@ -33,4 +49,37 @@
  */
 int copy2(const char *src, const char *dest, unsigned op);
 
+/**
+ * Copy a single file, and report how it was copied
+ *
+ * Regular file data is copied with the fastest method the kernel and file
+ * system support: a reflink, copy_file_range(), sendfile(), and finally
+ * read()/write() through a COPY_BUFFER_SIZE buffer.
+ *
+ * ```c
+ * enum CopyMethod method;
+ * if (copy2_ex("/source/path/example.txt", "/destination/path/example.txt", CT_PERM, &method)) {
+ *     fprintf(stderr, "Unable to copy file\n");
+ *     exit(1);
+ * }
+ * printf("copied using %s\n", copy_method_str(method));
+ * ```
+ *
+ * @param src source file path
+ * @param dest destination file path
+ * @param op CT_OWNER (preserve ownership)
+ * @param op CT_PERM (preserve permission bits)
+ * @param method_used receives the CopyMethod used (may be NULL)
+ * @return 0 on success, -1 on error
+ */
+int copy2_ex(const char *src, const char *dest, unsigned op, enum CopyMethod *method_used);
+
+/**
+ * Return a CopyMethod's name
+ *
+ * @param method CopyMethod
+ * @return name of the method (i.e. "reflink")
+ */
+const char *copy_method_str(enum CopyMethod method);
+
 #endif // STASIS_COPY_H
\ No newline at end of file
@@ -58,6 +58,7 @@ struct STASIS_GLOBAL {
     char *wheel_builder; ///!< Backend to build wheels (build, cibuildwheel, manylinux)
     char *wheel_builder_manylinux_image; ///!< Image to use for a Manylinux build
     bool force_repeatable; ///!< Reduces surface area of random changes between builds
+    char *download_cache_dir; ///!< Path to the HTTP download cache (NULL disables the cache)
     struct {
         char *tox_posargs;
         char *conda_reactivate;
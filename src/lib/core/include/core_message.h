@@ -7,15 +7,28 @@
 } while (0)
 
 #define SYSWARN(FMT, ...) do { \
-    log_print_warning(EXECPOINT, (FMT), ##__VA_ARGS__); \
+    if (LOG_ENABLED(LOG_LEVEL_WARN)) { \
+        log_print_warning(EXECPOINT, (FMT), ##__VA_ARGS__); \
+    } \
 } while (0)
 
 #define SYSINFO(FMT, ...) do { \
-    log_print_info(EXECPOINT, (FMT), ##__VA_ARGS__); \
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) { \
+        log_print_info(EXECPOINT, (FMT), ##__VA_ARGS__); \
+    } \
 } while (0)
 
 #define SYSDEBUG(FMT, ...) do { \
-    log_print_debug(EXECPOINT, (FMT), ##__VA_ARGS__); \
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG)) { \
+        log_print_debug(EXECPOINT, (FMT), ##__VA_ARGS__); \
+    } \
+} while (0)
+
+//! Print a message followed by key/value pairs (see log_print_record)
+#define SYSRECORD(LEVEL, MSG, ...) do { \
+    if (LOG_ENABLED(LEVEL)) { \
+        log_print_record((LEVEL), EXECPOINT, (MSG), ##__VA_ARGS__, NULL); \
+    } \
 } while (0)
 
 #endif //STASIS_CORE_MESSAGE_H
@@ -86,6 +86,53 @@ int docker_exec(const char *args, unsigned flags);
  */
 int docker_build(const char *dirpath, const char *args, int engine);
 int docker_script(const char *image, char *args, char *data, unsigned flags);
+
+/**
+ * Build the command that compresses a "docker save" stream
+ *
+ * Known compressors are run with `threads` threads, unless the program's
+ * arguments already set a thread count. gzip and bzip2 are replaced by pigz
+ * and pbzip2, when installed. Other arguments, such as the compression level,
+ * are kept.
+ *
+ * | Program | Threads  | Extension |
+ * |---------|----------|-----------|
+ * | zstd    | -T n     | zst       |
+ * | pzstd   | -p n     | zst       |
+ * | xz      | -T n     | xz        |
+ * | pigz    | -p n     | gz        |
+ * | pbzip2  | -p n     | bz2       |
+ * | lbzip2  | -n n     | bz2       |
+ *
+ * ```c
+ * char cmd[PATH_MAX] = {0};
+ * char ext[255] = {0};
+ * docker_compression_command("zstd -10", 8, cmd, sizeof(cmd), ext, sizeof(ext));
+ * // cmd is "zstd -T8 -10", and ext is "zst"
+ * ```
+ *
+ * @param program compression program (with arguments)
+ * @param threads number of threads (0 uses the program's default)
+ * @param cmd output command
+ * @param cmd_maxlen size of cmd
+ * @param ext output file name extension
+ * @param ext_maxlen size of ext
+ * @return 0 on success, -1 if program is empty
+ */
+int docker_compression_command(const char *program, long threads, char *cmd, size_t cmd_maxlen, char *ext, size_t ext_maxlen);
+
+/**
+ * Save a docker image to a tar archive
+ *
+ * The archive is written to `destdir/image.tar`. When `compression_program` is
+ * set, the archive is compressed with it as it is exported, using
+ * `globals.cpu_limit` threads (see docker_compression_command()).
+ *
+ * @param image image name
+ * @param destdir destination directory
+ * @param compression_program compression program (with arguments, may be NULL)
+ * @return exit code from "docker"
+ */
 int docker_save(const char *image, const char *destdir, const char *compression_program);
 void docker_sanitize_tag(char *str);
 int docker_validate_compression_program(char *prog);
@@ -5,8 +5,82 @@
 #include <stdlib.h>
 #include <string.h>
 #include <curl/curl.h>
+#include "sha256.h"
+
+//! Maximum length of DownloadRequest.errmsg
+#define STASIS_DOWNLOAD_ERRMSG_MAX 256
+
+struct DownloadRequest {
+    const char *url; ///< Remote location
+    const char *filename; ///< Local destination
+    const char *sha256; ///< Expected SHA-256 of the file in hex (NULL skips verification)
+    long http_code; ///< (result) HTTP response code, or -1 if the transfer failed
+    char errmsg[STASIS_DOWNLOAD_ERRMSG_MAX]; ///< (result) curl error message (empty on success)
+    size_t attempts; ///< (result) Number of transfer attempts
+    int cached; ///< (result) Non-zero if the file was restored from the download cache
+    char digest[SHA256_HEX_SIZE]; ///< (result) SHA-256 of the file
+};
 
 size_t download_writer(void *fp, size_t size, size_t nmemb, void *stream);
 long download(char *url, const char *filename, char **errmsg);
 
+/**
+ * Download several files concurrently
+ *
+ * Transfers run in parallel over the process-wide session, so requests to the
+ * same host share connections, DNS lookups and TLS sessions. Transfers that
+ * fail are retried per STASIS_DOWNLOAD_RETRY_MAX and
+ * STASIS_DOWNLOAD_RETRY_SECONDS.
+ *
+ * Data is written to "filename.part" and hashed as it arrives. An HTTP retry
+ * resumes from the end of the partial file with a Range request. The file is
+ * renamed into place once complete, and only if its SHA-256 matches
+ * DownloadRequest.sha256 (when set). A mismatch is retried like a failed
+ * transfer.
+ *
+ * When globals.download_cache_dir is set, HTTP(S) responses are cached with
+ * their ETag and Last-Modified validators. A cached file is revalidated with a
+ * conditional request, and a "304 Not Modified" response is served from the
+ * cache. A resumed transfer is cached once the partial file holds the whole
+ * body. Cached files younger than STASIS_DOWNLOAD_CACHE_TTL seconds are used
+ * without contacting the server. When STASIS_DOWNLOAD_OFFLINE is set, only
+ * cached files are available.
+ *
+ * ```c
+ * struct DownloadRequest req[] = {
+ *     {.url = "https://example.tld/a.txt", .filename = "a.txt"},
+ *     {.url = "https://example.tld/b.txt", .filename = "b.txt"},
+ * };
+ * download_batch(req, 2);
+ * for (size_t i = 0; i < 2; i++) {
+ *     if (HTTP_ERROR(req[i].http_code)) {
+ *         fprintf(stderr, "%s: %ld: %s\n", req[i].url, req[i].http_code, req[i].errmsg);
+ *     }
+ * }
+ * ```
+ *
+ * @param requests array of DownloadRequest
+ * @param count number of requests
+ * @return 0 if every transfer completed (check http_code for HTTP errors), the number of transfers that failed, or -1 on error
+ */
+int download_batch(struct DownloadRequest *requests, size_t count);
+
+/**
+ * Create a curl handle attached to the process-wide session
+ *
+ * The handle shares the session's connection cache, DNS cache and TLS
+ * sessions, and uses STASIS' user agent, redirect and timeout settings.
+ * Release it with curl_easy_cleanup().
+ *
+ * @return curl handle, or NULL on error
+ */
+CURL *download_handle(void);
+
+/**
+ * Release the process-wide session
+ *
+ * Called by globals_free(). A later download starts a new session.
+ */
+void download_session_cleanup(void);
+
 #endif //STASIS_DOWNLOAD_H
@@ -9,10 +9,23 @@
 #include <dirent.h>
 #include "environment.h"
 
-typedef struct StrList RuntimeEnv;
+/**
+ * Environment variables indexed by name
+ *
+ * Records are stored in `KEY=VALUE` format in a NULL terminated array, so
+ * `runtime_envp()` can hand them to `execve()` (or assign them to `environ`)
+ * without converting them first.
+ */
+typedef struct RuntimeEnv {
+    struct StrList *vars; ///< `KEY=VALUE` records
+    size_t *index; ///< Hash table of record positions + 1, keyed by variable name
+    size_t index_alloc; ///< Number of slots in index
+} RuntimeEnv;
 
 ssize_t runtime_contains(RuntimeEnv *env, const char *key);
 RuntimeEnv *runtime_copy(char **env);
+char **runtime_envp(RuntimeEnv *env);
+size_t runtime_count(RuntimeEnv *env);
 int runtime_replace(RuntimeEnv **dest, char **src);
 char *runtime_get(RuntimeEnv *env, const char *key);
 void runtime_set(RuntimeEnv *env, const char *_key, char *_value);
@@ -8,6 +8,8 @@
 #define JUNIT_RESULT_STATE_SKIPPED 2
 #define JUNIT_RESULT_STATE_ERROR 3
 
+struct JUNIT_Arena;
+
 /**
  * Represents a failed test case
  */
@@ -84,11 +86,18 @@ struct JUNIT_Testsuite {
     size_t _tc_inuse;
     /// Total number of test cases allocated
     size_t _tc_alloc;
+    /// Storage for every string and record referenced by the test suite
+    struct JUNIT_Arena *_arena;
 };
 
 /**
  * Extract information from a junit XML file
  *
+ * The file is parsed as a stream, so memory use is proportional to the
+ * retained test case data rather than to the size of the document. All
+ * strings and records belong to the returned test suite and are released
+ * together by junitxml_testsuite_free().
+ *
  * ~~~{.c}
  * struct JUNIT_Testsuite *testsuite;
  * const char *filename = "/path/to/result.xml";
@@ -124,7 +133,7 @@ struct JUNIT_Testsuite {
  * ~~~
  *
  * @param filename path to junit XML file
- * @return pointer to JUNIT_Testsuite
+ * @return pointer to JUNIT_Testsuite, or NULL if the file is missing or malformed
  */
 struct JUNIT_Testsuite *junitxml_testsuite_read(const char *filename);
 
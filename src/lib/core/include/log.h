@@ -2,6 +2,7 @@
 #define STASIS_EXECPOINT_H
 
 #include <stdio.h>
+#include <stdarg.h>
 
 enum LogLevel {
     LOG_LEVEL_WARN = 0,
@@ -10,6 +11,17 @@ enum LogLevel {
 };
 extern enum LogLevel LOG_LEVEL;
 
+//! Highest LogLevel compiled into the program (i.e. -DSTASIS_LOG_LEVEL_MAX=0 removes SYSINFO and SYSDEBUG)
+#ifndef STASIS_LOG_LEVEL_MAX
+#define STASIS_LOG_LEVEL_MAX 2
+#endif
+
+//! Non-zero when messages of LEVEL are emitted. Constant zero above STASIS_LOG_LEVEL_MAX.
+#define LOG_ENABLED(LEVEL) ((LEVEL) <= STASIS_LOG_LEVEL_MAX && LOG_LEVEL >= (LEVEL))
+
+//! Number of bytes queued for the log sink before callers wait for the writer
+#define LOG_SINK_QUEUE_MAX (4 * 1024 * 1024)
+
 struct ExecPoint {
     const int line;  // line number
     const char *file;  // file name of origin
@@ -26,4 +38,65 @@ int log_msgv(FILE *stream, struct ExecPoint ep, const char *preface_color, const
 int log_msg(FILE *stream, struct ExecPoint ep, const char *preface_color, const char *preface, const char *fmt, ...);
 const char *log_get_level_str(void);
 
+/**
+ * Print a message with key/value fields
+ *
+ * The fields are NULL terminated pairs of strings. On the terminal they follow
+ * the message as `key=value`. Use the SYSRECORD() macro.
+ *
+ * ```c
+ * SYSRECORD(LOG_LEVEL_INFO, "download complete", "url", url, "attempts", "2");
+ * ```
+ *
+ * @param level LogLevel of the message
+ * @param ep ExecPoint of the caller
+ * @param message message text
+ * @param ... NULL terminated key/value pairs
+ */
+void log_print_record(enum LogLevel level, struct ExecPoint ep, const char *message, ...);
+
+/**
+ * Write log records to a file
+ *
+ * Every message printed by SYSERROR(), SYSWARN(), SYSINFO(), SYSDEBUG(),
+ * SYSRECORD() and msg() is also appended to `filename` as a structured record
+ * (logfmt):
+ *
+ * ```
+ * time=2026-01-01T00:00:00.000Z level=WARNING pid=42 file=download.c line=10 func=download msg="retrying" url=https://example.tld
+ * ```
+ *
+ * Records are queued in memory and written by a background thread, so
+ * callers never wait on the file unless LOG_SINK_QUEUE_MAX bytes are pending.
+ * Child processes write their records directly. The queue is flushed when the
+ * program exits.
+ *
+ * @param filename path to log file (appended to)
+ * @return 0 on success, -1 on error
+ */
+int log_sink_open(const char *filename);
+
+/**
+ * Wait until every queued record has been written to the log file
+ */
+void log_sink_flush(void);
+
+/**
+ * Flush and close the log file
+ */
+void log_sink_close(void);
+
+/**
+ * Queue a structured record for the log file
+ *
+ * Does nothing when no log file is open. Color codes and trailing line
+ * separators are removed from the message.
+ *
+ * @param level level name (i.e. "WARNING")
+ * @param ep ExecPoint of the caller (may be NULL)
+ * @param message message text
+ * @param fields NULL terminated array of key/value pairs (may be NULL)
+ */
+void log_sink_record(const char *level, const struct ExecPoint *ep, const char *message, const char **fields);
+
 #endif // STASIS_EXECPOINT_H
@@ -25,12 +25,14 @@ struct MultiProcessingTask {
     int signaled_by; ///< Last signal received, if any
     int timeout; ///< Seconds to elapse before killing the process
     time_t _startup; ///< Time elapsed since task started
+    long long _trace_start; ///< trace_now() when the task started
     char ident[255]; ///< Identity of the pool task
     char *cmd; ///< Shell command(s) to be executed
     size_t cmd_len; ///< Length of command string (for mmap/munmap)
     char working_dir[PATH_MAX]; ///< Path to directory `cmd` should be executed in
     char log_file[PATH_MAX]; ///< Full path to stdout/stderr log file
     char parent_script[PATH_MAX]; ///< Path to temporary script executing the task
+    char **envp; ///< Task environment (NULL inherits the parent's environment)
     struct MultiProcessingTimer time_data; ///< Wall-time counters
     struct MultiProcessingTimer interval_data; ///< Progress report counters
 };
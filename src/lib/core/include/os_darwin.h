@@ -20,6 +20,9 @@
 #include <sys/syslimits.h>
 #endif
 
+// struct stat timestamps use a different name
+#define st_mtim st_mtimespec
+
 extern char **environ;
 #define __environ environ
 
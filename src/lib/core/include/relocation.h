@@ -18,7 +18,14 @@
 
 #define REPLACE_TRUNCATE_AFTER_MATCH 1
 
+struct ReplaceRule {
+    const char *target; ///< string value to replace
+    const char *replacement; ///< string value to write in its place
+    unsigned flags; ///< REPLACE_TRUNCATE_AFTER_MATCH
+};
+
 int replace_text(char *original, const char *target, const char *replacement, unsigned flags);
 int file_replace_text(const char* filename, const char* target, const char* replacement, unsigned flags);
+int file_replace_text_ex(const char *filename, const struct ReplaceRule *rules, size_t count);
 
 #endif //STASIS_RELOCATION_H
@@ -0,0 +1,66 @@
+//! @file sha256.h
+#ifndef STASIS_SHA256_H
+#define STASIS_SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//! Length of a binary SHA-256 digest
+#define SHA256_DIGEST_SIZE 32
+//! Length of a hexadecimal SHA-256 digest, including the NUL terminator
+#define SHA256_HEX_SIZE (SHA256_DIGEST_SIZE * 2 + 1)
+
+struct SHA256 {
+    uint32_t state[8]; ///< Intermediate hash value
+    uint64_t length; ///< Number of bytes consumed
+    unsigned char block[64]; ///< Partial input block
+    size_t used; ///< Number of bytes in block
+};
+
+/**
+ * Initialize a SHA-256 context
+ * @param ctx pointer to SHA256
+ */
+void sha256_init(struct SHA256 *ctx);
+
+/**
+ * Add data to a SHA-256 context
+ * @param ctx pointer to SHA256
+ * @param data bytes to hash
+ * @param len number of bytes in data
+ */
+void sha256_update(struct SHA256 *ctx, const void *data, size_t len);
+
+/**
+ * Finish a SHA-256 computation
+ * @param ctx pointer to SHA256
+ * @param digest output digest
+ */
+void sha256_final(struct SHA256 *ctx, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+/**
+ * Convert a binary SHA-256 digest to a lowercase hexadecimal string
+ * @param digest binary digest
+ * @param hex output string
+ */
+void sha256_hex(const unsigned char digest[SHA256_DIGEST_SIZE], char hex[SHA256_HEX_SIZE]);
+
+/**
+ * Compute the SHA-256 digest of a file
+ *
+ * ```c
+ * char digest[SHA256_HEX_SIZE] = {0};
+ * if (sha256_file("/path/to/file", digest)) {
+ *     fprintf(stderr, "unable to hash file\n");
+ * } else {
+ *     printf("%s\n", digest);
+ * }
+ * ```
+ *
+ * @param filename path to file
+ * @param hex output string
+ * @return 0 on success, -1 on error
+ */
+int sha256_file(const char *filename, char hex[SHA256_HEX_SIZE]);
+
+#endif //STASIS_SHA256_H
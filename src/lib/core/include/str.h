@@ -17,6 +17,7 @@
 #define STASIS_SORT_NUMERIC 1 << 1
 #define STASIS_SORT_LEN_ASCENDING 1 << 2
 #define STASIS_SORT_LEN_DESCENDING 1 << 3
+#define STASIS_SORT_VERSION 1 << 4
 
 
 char *strdup_maybe_entry(const char * restrict s, struct ExecPoint ep, int exit_code);
@@ -125,6 +126,7 @@ char *substring_between(char *sptr, const char *delims);
  *     - STASIS_SORT_LEN_ASCENDING
  *     - STASIS_SORT_ALPHA
  *     - STASIS_SORT_NUMERIC
+ *     - STASIS_SORT_VERSION (oldest to newest, see version_parse())
  */
 void strsort(char **arr, unsigned int sort_mode);
 
@@ -327,4 +329,13 @@ void unindent(char *s);
 int safe_strncpy(char *dst, const char *src, size_t dsize);
 int safe_strncat(char *dst, const char *src, size_t dsize);
 
+/**
+ * Compute a fast, non-cryptographic hash (FNV-1a) of the first `len` bytes of `sptr`
+ *
+ * @param sptr string to hash
+ * @param len number of bytes to hash
+ * @return hash value
+ */
+size_t strhash(const char *sptr, size_t len);
+
 #endif //STASIS_STR_H
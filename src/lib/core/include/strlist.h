@@ -13,13 +13,23 @@ typedef int (ReaderFn)(size_t line, char **);
 #include "str.h"
 
 
+#define STRLIST_MODE_DEFAULT 0 ///< Records are allocated individually
+#define STRLIST_MODE_INTERN 1 ///< Records are unique, stored in an arena, and indexed by hash
+
+struct StrListArena;
+
 struct StrList {
-    size_t num_alloc;
-    size_t num_inuse;
+    size_t num_alloc; ///< Capacity of data (including the NULL terminator)
+    size_t num_inuse; ///< Number of records stored in data
     char **data;
+    unsigned mode; ///< STRLIST_MODE_*
+    struct StrListArena *arena; ///< Record storage (STRLIST_MODE_INTERN)
+    size_t *index; ///< Hash table of record positions + 1 (STRLIST_MODE_INTERN)
+    size_t index_alloc; ///< Number of slots in index
 };
 
 struct StrList *strlist_init();
+struct StrList *strlist_init_mode(unsigned mode);
 void strlist_remove(struct StrList *pStrList, size_t index);
 long double strlist_item_as_long_double(struct StrList *pStrList, size_t index);
 double strlist_item_as_double(struct StrList *pStrList, size_t index);
@@ -41,10 +51,14 @@ size_t strlist_count(struct StrList *pStrList);
 void strlist_reverse(struct StrList *pStrList);
 void strlist_sort(struct StrList *pStrList, unsigned int mode);
 int strlist_contains(struct StrList *pStrList, const char *value, size_t *index_of);
+int strlist_find(struct StrList *pStrList, const char *value, size_t *index_of);
 int strlist_append_file(struct StrList *pStrList, char *path, ReaderFn *readerFn);
 void strlist_append_strlist(struct StrList *pStrList1, struct StrList *pStrList2);
 void strlist_append(struct StrList **pStrList, char *str);
+void strlist_append_nocopy(struct StrList **pStrList, char *str);
 void strlist_append_array(struct StrList *pStrList, char **arr);
+void strlist_append_array_nocopy(struct StrList *pStrList, char **arr);
+int strlist_reserve(struct StrList *pStrList, size_t count);
 
 int strlist_append_tokenize(struct StrList *pStrList, char *str, char *delim);
 
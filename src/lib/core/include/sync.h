@@ -0,0 +1,107 @@
+//! @file sync.h
+#ifndef STASIS_SYNC_H
+#define STASIS_SYNC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "core.h"
+#include "copy.h"
+#include "strlist.h"
+
+//! Remove destination records that do not exist in any source (rsync --delete)
+#define SYNC_DELETE (1 << 0)
+//! Compare the contents of same-sized files instead of their modification times (rsync --checksum)
+#define SYNC_CHECKSUM (1 << 1)
+//! Print each path as it is transferred or deleted
+#define SYNC_VERBOSE (1 << 2)
+//! Hard link regular files to their source instead of copying them (rsync --link-dest)
+#define SYNC_LINK (1 << 3)
+
+struct SyncOptions {
+    unsigned flags; ///< SYNC_DELETE, SYNC_CHECKSUM, SYNC_VERBOSE, SYNC_LINK
+    char **exclude; ///< NULL terminated array of patterns to ignore (see sync_trees())
+    size_t jobs; ///< Number of files to copy at once (0 uses globals.cpu_limit)
+};
+
+struct SyncStats {
+    size_t files_copied; ///< Number of files transferred
+    size_t files_linked; ///< Number of files transferred as hard links (included in files_copied)
+    size_t files_skipped; ///< Number of files already up to date
+    size_t files_deleted; ///< Number of destination records removed
+    size_t dirs_created; ///< Number of directories created
+    size_t bytes_copied; ///< Number of bytes transferred
+};
+
+/**
+ * Synchronize the contents of one directory with another
+ *
+ * Equivalent to `rsync -a src/ dest/`. See sync_trees().
+ *
+ * @param src source directory
+ * @param dest destination directory (created if it does not exist)
+ * @param opts pointer to SyncOptions (may be NULL)
+ * @param stats pointer to SyncStats to populate (may be NULL)
+ * @return 0 on success, -1 on error
+ */
+int sync_tree(const char *src, const char *dest, const struct SyncOptions *opts, struct SyncStats *stats);
+
+/**
+ * Synchronize the contents of several sources into one directory
+ *
+ * Equivalent to `rsync -a src1/ src2/ file ... dest/`. The contents of each
+ * source directory are merged into `dest`, and a source file is placed in
+ * `dest` under its base name. When sources provide the same path the last one
+ * wins, and a directory replaced by a file loses its contents. Symbolic links
+ * given as sources are followed; links inside a source are copied as links.
+ *
+ * Directories are walked once with openat(2) and fstatat(2). Files whose size
+ * and modification time (or contents, see SYNC_CHECKSUM) match the destination
+ * are skipped. The remaining files are copied with copy2_ex() by a pool of
+ * worker threads, and their modification times are preserved so the next
+ * synchronization can skip them. Each file is written to a temporary name in
+ * its destination directory and renamed over the old file, so a failed copy
+ * leaves the previous destination file in place.
+ *
+ * With SYNC_LINK, regular files are hard linked to their source, so no data
+ * is copied and a destination file linked to its source is always up to date.
+ * Files that can't be linked (i.e. across file systems) are copied, which
+ * shares data blocks with a reflink when the file system supports it. The
+ * destination must not be modified in place, because that would modify the
+ * source as well.
+ *
+ * Exclude patterns are matched against record names with fnmatch(3).
+ * A pattern ending with '/' only matches directories. A pattern containing
+ * '/' is matched against the path relative to the source, and a leading '/'
+ * anchors it to the top of the tree. Excluded destination records are never
+ * deleted.
+ *
+ * ```c
+ * char *sources[] = {"/path/to/a", "/path/to/b", NULL};
+ * char *exclude[] = {"tmp/", "*.log", NULL};
+ * struct SyncOptions opts = {.flags = SYNC_DELETE, .exclude = exclude};
+ * struct SyncStats stats = {0};
+ * if (sync_trees(sources, 2, "/path/to/dest", &opts, &stats)) {
+ *     fprintf(stderr, "synchronization failed\n");
+ *     exit(1);
+ * }
+ * printf("%zu files copied, %zu up to date\n", stats.files_copied, stats.files_skipped);
+ * ```
+ *
+ * @param srcs array of source paths
+ * @param count number of paths in srcs
+ * @param dest destination directory (created if it does not exist)
+ * @param opts pointer to SyncOptions (may be NULL)
+ * @param stats pointer to SyncStats to populate (may be NULL)
+ * @return 0 on success, -1 on error
+ */
+int sync_trees(char **srcs, size_t count, const char *dest, const struct SyncOptions *opts, struct SyncStats *stats);
+
+#endif //STASIS_SYNC_H
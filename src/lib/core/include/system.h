@@ -11,11 +11,21 @@
 #include <errno.h>
 #include <unistd.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
 
 #define STASIS_SHELL_SAFE_RESTRICT ";&|()"
 
+/// Capture stderr into ProcessOutput.err (see shell_capture())
+#define SHELL_CAPTURE_STDERR (1 << 0)
+/// Capture stderr into ProcessOutput.out (see shell_capture())
+#define SHELL_CAPTURE_MERGE (1 << 1)
+/// Inherit stdout from the caller instead of capturing it (see shell_spawn())
+#define SHELL_CAPTURE_NONE (1 << 2)
+
 struct Process {
     // Write stdout stream to file
     char f_stdout[PATH_MAX];
@@ -27,8 +37,152 @@ struct Process {
     int returncode;
 };
 
+struct ProcessOutput {
+    char *out; ///< Captured stdout stream (NUL terminated)
+    size_t out_len; ///< Number of bytes in out
+    char *err; ///< Captured stderr stream (NUL terminated, requires SHELL_CAPTURE_STDERR)
+    size_t err_len; ///< Number of bytes in err
+    int status; ///< Wait status of the program (see waitpid(2))
+};
+
+struct ProcessHandle {
+    pid_t pid; ///< Program PID
+    int fd_out; ///< Read end of the stdout pipe (-1 when closed)
+    int fd_err; ///< Read end of the stderr pipe (-1 when closed)
+    size_t out_alloc; ///< Bytes allocated by output.out
+    size_t err_alloc; ///< Bytes allocated by output.err
+    int finished; ///< Non-zero once the program has exited and its output is complete
+    int failed; ///< Non-zero if the program's output could not be read
+    int returncode; ///< Exit code of the program (see shell_capture())
+    struct ProcessOutput output; ///< Captured output
+    long long trace_start; ///< trace_now() when the program started
+    char trace_name[255]; ///< Trace span name (empty when tracing is disabled)
+};
+
 int shell(struct Process *proc, char *args);
 int shell_safe(struct Process *proc, char *args);
+
+/**
+ * Execute a program and capture its output
+ *
+ * `argv[0]` is resolved using `PATH` and executed directly. No shell is
+ * involved, so arguments do not need to be quoted or escaped. Output is read
+ * through pipes, so nothing is written to disk.
+ *
+ * By default stderr is inherited from the caller. Use SHELL_CAPTURE_STDERR to
+ * capture it separately, or SHELL_CAPTURE_MERGE to interleave it with stdout.
+ *
+ * ```c
+ * struct ProcessOutput proc = {0};
+ * char *argv[] = {"git", "tag", "-l", NULL};
+ * if (shell_capture(argv, &proc, SHELL_CAPTURE_STDERR)) {
+ *     fprintf(stderr, "git failed: %s\n", proc.err);
+ * } else {
+ *     printf("%s", proc.out);
+ * }
+ * shell_capture_free(&proc);
+ * ```
+ *
+ * @param argv NULL terminated program arguments
+ * @param output pointer to ProcessOutput
+ * @param flags SHELL_CAPTURE_STDERR, or SHELL_CAPTURE_MERGE
+ * @return exit code of the program (128 + signal number if the program was killed)
+ * @return 127 if the program could not be executed
+ * @return -1 on error
+ */
+int shell_capture(char *const argv[], struct ProcessOutput *output, unsigned flags);
+
+/**
+ * Release output captured by shell_capture()
+ *
+ * @param output pointer to ProcessOutput
+ */
+void shell_capture_free(struct ProcessOutput *output);
+
+/**
+ * Start a program without waiting for it to finish
+ *
+ * The program is executed the same way as shell_capture(). The returned handle
+ * acts as a future: `handle->output` and `handle->returncode` are valid once
+ * shell_wait(), shell_wait_any() or shell_wait_all() report the program as
+ * finished. Independent programs can be started back to back and collected
+ * later.
+ *
+ * ```c
+ * char *conda_argv[] = {"conda", "--version", NULL};
+ * char *git_argv[] = {"git", "--version", NULL};
+ * struct ProcessHandle *procs[] = {
+ *     shell_spawn(conda_argv, 0),
+ *     shell_spawn(git_argv, 0),
+ * };
+ * if (shell_wait_all(procs, 2) == 0) {
+ *     printf("%s%s", procs[0]->output.out, procs[1]->output.out);
+ * }
+ * shell_handle_free(&procs[0]);
+ * shell_handle_free(&procs[1]);
+ * ```
+ *
+ * @param argv NULL terminated program arguments
+ * @param flags SHELL_CAPTURE_STDERR, SHELL_CAPTURE_MERGE, or SHELL_CAPTURE_NONE
+ * @return pointer to ProcessHandle (caller must free with shell_handle_free())
+ * @return NULL on error
+ */
+struct ProcessHandle *shell_spawn(char *const argv[], unsigned flags);
+
+/**
+ * Wait for a program started by shell_spawn() to finish
+ *
+ * @param handle pointer to ProcessHandle
+ * @return exit code of the program (see shell_capture())
+ * @return -1 on error
+ */
+int shell_wait(struct ProcessHandle *handle);
+
+/**
+ * Wait for any program in `handles` to finish
+ *
+ * NULL records are ignored. A finished handle is returned until the caller
+ * removes it from the array (i.e. `handles[i] = NULL`), so the array can be
+ * drained one program at a time.
+ *
+ * @param handles array of ProcessHandle pointers
+ * @param count number of records in handles
+ * @return pointer to a finished ProcessHandle
+ * @return NULL when no records remain, or on error
+ */
+struct ProcessHandle *shell_wait_any(struct ProcessHandle *handles[], size_t count);
+
+/**
+ * Wait for every program in `handles` to finish
+ *
+ * Output of all programs is read concurrently. NULL records are ignored.
+ *
+ * @param handles array of ProcessHandle pointers
+ * @param count number of records in handles
+ * @return number of programs that exited with a non-zero code
+ * @return -1 on error
+ */
+int shell_wait_all(struct ProcessHandle *handles[], size_t count);
+
+/**
+ * Release a ProcessHandle
+ *
+ * A program that is still running is terminated with SIGTERM and reaped. If
+ * it has not exited after a second (i.e. it ignores SIGTERM), it is killed
+ * with SIGKILL.
+ *
+ * @param handle pointer to ProcessHandle pointer (set to NULL)
+ */
+void shell_handle_free(struct ProcessHandle **handle);
+
+/**
+ * Execute a shell command and return its standard output
+ *
+ * @param command to execute with `/bin/sh -c`
+ * @param status wait status of the command (0 on success)
+ * @return captured output (caller must free)
+ * @return NULL on error
+ */
 char *shell_output(const char *command, int *status);
 
 #endif //STASIS_SYSTEM_H
@@ -49,6 +49,7 @@ struct tplfunc_frame {
     tplfunc *func;             ///< Pointer to the function
     void *data_in;             ///< Pointer to internal data (can be NULL)
     int argc;                  ///< Maximum number of arguments to accept
+    unsigned flags;            ///< TPLFUNC_F_* behavior flags
     union {
         char **t_char_refptr;  ///< &pointer
         char *t_char_ptr;      ///< pointer
@@ -65,6 +66,9 @@ struct tplfunc_frame {
     } argv[10]; // accept up to 10 arguments
 };
 
+/// Function output depends only on its name and arguments. Results are memoized for the remainder of the run.
+#define TPLFUNC_F_PURE (1 << 0)
+
 /**
  * Register a template function
  * @param key function name to expose to "func:" interface
@@ -74,6 +78,27 @@ struct tplfunc_frame {
  */
 void tpl_register_func(char *key, tplfunc *tplfunc_ptr, int argc, void *data_in);
 
+/**
+ * Register a template function with behavior flags
+ *
+ * ```c
+ * // Output of "get_version(name)" never changes during a run, so call it once per argument list
+ * tpl_register_func_ex("get_version", &get_version_entrypoint, 1, NULL, TPLFUNC_F_PURE);
+ * ```
+ *
+ * @param key function name to expose to "func:" interface
+ * @param tplfunc_ptr pointer to function of type tplfunc
+ * @param argc number of function arguments to accept
+ * @param data_in pointer to function input data
+ * @param flags bitmask of TPLFUNC_F_* values
+ */
+void tpl_register_func_ex(char *key, tplfunc *tplfunc_ptr, int argc, void *data_in, unsigned flags);
+
+/**
+ * Discard all memoized template function results
+ */
+void tpl_cache_clear();
+
 /**
  * Get the function frame associated with a template function
  * @param key function name
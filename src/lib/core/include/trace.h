@@ -0,0 +1,113 @@
+//! @file trace.h
+#ifndef STASIS_TRACE_H
+#define STASIS_TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "core.h"
+
+//! Span category of a pipeline stage
+#define TRACE_CAT_STAGE "stage"
+//! Span category of a program executed by shell() or shell_spawn()
+#define TRACE_CAT_EXEC "exec"
+//! Span category of a multiprocessing pool task
+#define TRACE_CAT_TASK "task"
+
+/**
+ * Record a span around a function call
+ *
+ * The span is named after the function.
+ *
+ * ```c
+ * TRACE_CALL(TRACE_CAT_STAGE, setup_conda, &ctx, installer_url, sizeof(installer_url));
+ * ```
+ */
+#define TRACE_CALL(CATEGORY, FUNC, ...) do { \
+    trace_begin((CATEGORY), #FUNC); \
+    FUNC(__VA_ARGS__); \
+    trace_end((CATEGORY), #FUNC); \
+} while (0)
+
+/**
+ * Write trace events to a file
+ *
+ * Events use the Chrome trace-event JSON array format, and can be loaded by
+ * chrome://tracing or https://ui.perfetto.dev. Each event is written as soon
+ * as it is recorded, so a trace of a program that crashed can still be read.
+ * The array is closed when the program exits.
+ *
+ * ```c
+ * if (trace_open("trace.json")) {
+ *     // error
+ * }
+ * trace_begin(TRACE_CAT_STAGE, "build");
+ * // ...
+ * trace_end(TRACE_CAT_STAGE, "build");
+ * trace_close();
+ * ```
+ *
+ * @param filename path to trace file (overwritten)
+ * @return 0 on success, -1 on error
+ */
+int trace_open(const char *filename);
+
+/**
+ * Finish and close the trace file
+ */
+void trace_close(void);
+
+/**
+ * @return non-zero when a trace file is open
+ */
+int trace_enabled(void);
+
+/**
+ * @return current trace time in microseconds
+ */
+long long trace_now(void);
+
+/**
+ * Record the start of a span in the calling process
+ *
+ * Spans started with trace_begin() must be ended in reverse order.
+ *
+ * @param category span category (i.e. TRACE_CAT_STAGE)
+ * @param name span name
+ */
+void trace_begin(const char *category, const char *name);
+
+/**
+ * Record the end of a span started by trace_begin()
+ *
+ * @param category span category
+ * @param name span name
+ */
+void trace_end(const char *category, const char *name);
+
+/**
+ * Record a span that has already finished
+ *
+ * Use this for work that overlaps, like pool tasks. Each `tid` is drawn on
+ * its own track.
+ *
+ * ```c
+ * const long long start = trace_now();
+ * const pid_t pid = fork();
+ * // ...
+ * waitpid(pid, &status, 0);
+ * trace_complete(TRACE_CAT_EXEC, "make", pid, start, trace_now());
+ * ```
+ *
+ * @param category span category
+ * @param name span name
+ * @param tid track to draw the span on (i.e. a child's PID)
+ * @param start trace_now() when the work started
+ * @param end trace_now() when the work ended
+ */
+void trace_complete(const char *category, const char *name, long tid, long long start, long long end);
+
+#endif //STASIS_TRACE_H
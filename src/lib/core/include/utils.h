@@ -100,6 +100,37 @@ char *expandpath(const char *_path);
  */
 int rmtree(char *_path);
 
+/// Remove subdirectories in parallel (see rmtree_ex())
+#define RMTREE_PARALLEL (1 << 0)
+/// Rename the tree aside and remove it in a detached process (see rmtree_ex())
+#define RMTREE_BACKGROUND (1 << 1)
+
+/**
+ * Remove a directory tree recursively
+ *
+ * The tree is walked with directory descriptors and records are removed with
+ * unlinkat(2). Symbolic links are removed, never followed.
+ *
+ * RMTREE_PARALLEL splits the top-level subdirectories of the tree across up
+ * to `globals.cpu_limit` threads.
+ *
+ * RMTREE_BACKGROUND moves the tree to `<globals.tmpdir>/rmtree-XXXXXX` and
+ * returns immediately, leaving a detached process to remove it. `path` can be
+ * reused right away. The tree is removed synchronously if `globals.tmpdir` is
+ * unset or on another file system.
+ *
+ * ```c
+ * if (rmtree_ex("conda_prefix", RMTREE_BACKGROUND)) {
+ *     fprintf(stderr, "Unable to remove conda_prefix\n");
+ * }
+ * ```
+ *
+ * @param path directory to remove
+ * @param flags RMTREE_PARALLEL, RMTREE_BACKGROUND
+ * @return 0 on success, -1 on error (or path is not a directory), 1 if path does not exist
+ */
+int rmtree_ex(const char *path, unsigned flags);
+
 
 char **file_readlines(const char *filename, size_t start, size_t limit, ReaderFn *readerFn);
 
@@ -299,6 +330,25 @@ int isempty_dir(const char *path);
  */
 int xml_pretty_print_in_place(const char *filename, const char *pretty_print_prog, const char *pretty_print_args);
 
+/**
+ * Reformat an XML file in place with libxml2
+ *
+ * Produces the same output as `xmllint --format` without starting a new
+ * process. The result is written to a temporary file next to `filename` and
+ * renamed over it. Safe to call from several threads at once, provided
+ * xmlInitParser() was called beforehand.
+ *
+ * ```c
+ * if (xml_format_in_place("/path/to/results.xml")) {
+ *     fprintf(stderr, "unable to reformat results.xml\n");
+ * }
+ * ```
+ *
+ * @param filename path to modify
+ * @return 0 on success, -1 on error
+ */
+int xml_format_in_place(const char *filename);
+
 /**
  * Applies STASIS fixups to a tox ini config
  * @param filename path to tox.ini
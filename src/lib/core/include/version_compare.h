@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
 #include "str.h"
 
 #define GT 1 << 1
@@ -13,8 +14,89 @@
 #define NOT 1 << 4
 #define EPOCH_MOD 10000
 
+#define VERSION_PRE_NONE 0
+#define VERSION_PRE_ALPHA 1
+#define VERSION_PRE_BETA 2
+#define VERSION_PRE_RC 3
+
+struct Version {
+    unsigned long long epoch;                          ///< N! (or N:) prefix
+    unsigned long long *release;                       ///< Release segments
+    size_t release_count;                              ///< Number of release segments
+    int pre_type;                                      ///< VERSION_PRE_*
+    unsigned long long pre;                            ///< Pre-release number
+    int has_post;                                      ///< Non-zero if post is set
+    unsigned long long post;                           ///< Post-release number
+    int has_dev;                                       ///< Non-zero if dev is set
+    unsigned long long dev;                            ///< Development release number
+    char *local;                                       ///< Normalized local version label (without '+')
+    unsigned char *key;                                ///< Sort key (compare with version_cmp)
+    size_t key_len;                                    ///< Length of key
+    size_t key_alloc;                                  ///< Size of key
+};
+
 int version_sum(const char *str);
 int version_parse_operator(const char *str);
 int version_compare(int flags, const char *aa, const char *bb);
 
+/**
+ * Parse a version string
+ *
+ * Versions are ordered according to PEP 440. Spellings PEP 440 normalizes
+ * are accepted (`v1.0`, `1.0-alpha.1`, `1.0-1`, `1.0.post`, ...), as is
+ * `N:` in place of the `N!` epoch separator. Text following the last
+ * recognized segment (i.e. `w` in `1.1.1w`) is treated as a local version
+ * label. Parsing stops at the first character that cannot be part of a
+ * version.
+ *
+ * The result carries a sort key, sized from the input. Parse each version
+ * once, compare keys as often as needed, then release them with
+ * version_free():
+ *
+ * ```c
+ * struct Version a;
+ * struct Version b;
+ * if (version_parse(&a, "1.0rc1") || version_parse(&b, "1.0")) {
+ *     fprintf(stderr, "invalid version\n");
+ *     exit(1);
+ * }
+ * if (version_cmp(&a, &b) < 0) {
+ *     puts("1.0rc1 is older than 1.0");
+ * }
+ * version_free(&a);
+ * version_free(&b);
+ * ```
+ *
+ * @param result pointer to Version
+ * @param str version string
+ * @return 0 on success, -1 if str is not a version (nothing to free)
+ */
+int version_parse(struct Version *result, const char *str);
+
+/**
+ * Free memory allocated by version_parse()
+ * @param version pointer to Version
+ */
+void version_free(struct Version *version);
+
+/**
+ * Compare parsed versions
+ * @param a pointer to Version
+ * @param b pointer to Version
+ * @return <0 if a is older than b, 0 if they are equal, >0 if a is newer than b
+ */
+int version_cmp(const struct Version *a, const struct Version *b);
+
+/**
+ * Sort an array of version strings from oldest to newest
+ *
+ * Each string is parsed once. Strings that are not versions are moved to
+ * the end of the array in alphabetic order.
+ *
+ * @param arr array of strings
+ * @param count number of strings in arr
+ * @return 0 on success, -1 on error
+ */
+int version_sort(char **arr, size_t count);
+
 #endif //STASIS_VERSION_COMPARE_H
\ No newline at end of file
@@ -1,312 +1,316 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "strlist.h"
+#include <libxml/parser.h>
+#include "core.h"
 #include "junitxml.h"
 
-static void testcase_failure_free(struct JUNIT_Failure **failure) {
-    struct JUNIT_Failure *x = (*failure);
-    guard_free(x->message);
-    guard_free(x);
-}
+//! Minimum number of bytes reserved by each arena block
+#define JUNIT_ARENA_BLOCK_SIZE (64 * 1024)
+//! Number of bytes read from the XML file per parser iteration
+#define JUNIT_READ_SIZE (32 * 1024)
+//! Alignment of arena allocations
+#define JUNIT_ARENA_ALIGN (sizeof(void *) * 2)
 
-static void testcase_error_free(struct JUNIT_Error **error) {
-    struct JUNIT_Error *x = (*error);
-    guard_free(x->message);
-    guard_free(x);
-}
+struct JUNIT_ArenaBlock {
+    struct JUNIT_ArenaBlock *next;
+    size_t size;
+    size_t used;
+    char data[];
+};
 
-static void testcase_skipped_free(struct JUNIT_Skipped **skipped) {
-    struct JUNIT_Skipped *x = (*skipped);
-    guard_free(x->message);
-    guard_free(x);
+/**
+ * Bump allocator backing every record of a test suite
+ *
+ * Records are never released individually. The whole arena is released by
+ * junitxml_testsuite_free().
+ */
+struct JUNIT_Arena {
+    struct JUNIT_ArenaBlock *head;
+};
+
+static void *arena_alloc(struct JUNIT_Arena *arena, size_t size) {
+    size = (size + JUNIT_ARENA_ALIGN - 1) & ~(JUNIT_ARENA_ALIGN - 1);
+    struct JUNIT_ArenaBlock *block = arena->head;
+    if (!block || block->size - block->used < size) {
+        const size_t block_size = size > JUNIT_ARENA_BLOCK_SIZE ? size : JUNIT_ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(*block) + block_size);
+        if (!block) {
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = 0;
+        block->next = arena->head;
+        arena->head = block;
+    }
+    void *result = block->data + block->used;
+    block->used += size;
+    memset(result, 0, size);
+    return result;
 }
 
-static void testcase_result_state_free(struct JUNIT_Testcase **testcase) {
-    struct JUNIT_Testcase *tc = (*testcase);
-    if (tc->tc_result_state_type == JUNIT_RESULT_STATE_FAILURE) {
-        testcase_failure_free(&tc->result_state.failure);
-    } else if (tc->tc_result_state_type == JUNIT_RESULT_STATE_ERROR) {
-        testcase_error_free(&tc->result_state.error);
-    } else if (tc->tc_result_state_type == JUNIT_RESULT_STATE_SKIPPED) {
-        testcase_skipped_free(&tc->result_state.skipped);
+static char *arena_strndup(struct JUNIT_Arena *arena, const char *s, size_t len) {
+    char *result = arena_alloc(arena, len + 1);
+    if (!result) {
+        return NULL;
     }
+    memcpy(result, s, len);
+    result[len] = '\0';
+    return result;
 }
 
-static void testcase_free(struct JUNIT_Testcase **testcase) {
-    struct JUNIT_Testcase *tc = (*testcase);
-    guard_free(tc->name);
-    guard_free(tc->message);
-    guard_free(tc->classname);
-    testcase_result_state_free(&tc);
-    guard_free(tc);
+static void arena_free(struct JUNIT_Arena **arena) {
+    if (!*arena) {
+        return;
+    }
+    struct JUNIT_ArenaBlock *block = (*arena)->head;
+    while (block) {
+        struct JUNIT_ArenaBlock *next = block->next;
+        guard_free(block);
+        block = next;
+    }
+    guard_free(*arena);
 }
 
 void junitxml_testsuite_free(struct JUNIT_Testsuite **testsuite) {
     struct JUNIT_Testsuite *suite = (*testsuite);
-    guard_free(suite->name);
-    guard_free(suite->hostname);
-    guard_free(suite->timestamp);
-    for (size_t i = 0; i < suite->_tc_alloc; i++) {
-        testcase_free(&suite->testcase[i]);
+    if (!suite) {
+        return;
     }
+    // Every string and record is owned by the arena
+    arena_free(&suite->_arena);
     guard_free(suite->testcase);
-    guard_free(suite);
+    guard_free(*testsuite);
 }
 
-static int testsuite_append_testcase(struct JUNIT_Testsuite **testsuite, struct JUNIT_Testcase *testcase) {
-    struct JUNIT_Testsuite *suite = (*testsuite);
-    struct JUNIT_Testcase **tmp = realloc(suite->testcase, (suite->_tc_alloc + 1 ) * sizeof(*testcase));
-    if (tmp == NULL) {
-        return -1;
-    } else {
+static int testsuite_append_testcase(struct JUNIT_Testsuite *suite, struct JUNIT_Testcase *testcase) {
+    if (suite->_tc_inuse == suite->_tc_alloc) {
+        const size_t count = suite->_tc_alloc ? suite->_tc_alloc * 2 : 64;
+        struct JUNIT_Testcase **tmp = realloc(suite->testcase, count * sizeof(*suite->testcase));
+        if (tmp == NULL) {
+            return -1;
+        }
         suite->testcase = tmp;
+        suite->_tc_alloc = count;
     }
     suite->testcase[suite->_tc_inuse] = testcase;
     suite->_tc_inuse++;
-    suite->_tc_alloc++;
     return 0;
 }
 
-static struct JUNIT_Failure *testcase_failure_from_attributes(struct StrList *attrs) {
-    struct JUNIT_Failure *result = calloc(1, sizeof(*result));
-    if(!result) {
-        return NULL;
-    }
-    for (size_t x = 0; x < strlist_count(attrs); x += 2) {
-        const char *attr_name = strlist_item(attrs, x);
-        const char *attr_value = strlist_item(attrs, x + 1);
-        if (attr_name && attr_value) {
-            if (!strcmp(attr_name, "message")) {
-                result->message = strdup(attr_value);
-                if (!result->message) {
-                    SYSERROR("failed to allocate memory for testcase failure message");
-                    break;
-                }
-            }
-        }
+/**
+ * Parser state shared by the SAX callbacks
+ */
+struct JUNIT_ParserState {
+    struct JUNIT_Testsuite *suite;
+    int status; ///< 0 on success, -1 when a record could not be allocated
+};
+
+/**
+ * Attributes are passed as (localname, prefix, URI, value, end) tuples.
+ * Values are not NUL terminated.
+ */
+#define JUNIT_ATTR_NAME(ATTRS, I) ((const char *) (ATTRS)[(I) * 5])
+#define JUNIT_ATTR_VALUE(ATTRS, I) ((const char *) (ATTRS)[(I) * 5 + 3])
+#define JUNIT_ATTR_LEN(ATTRS, I) ((size_t) ((ATTRS)[(I) * 5 + 4] - (ATTRS)[(I) * 5 + 3]))
+
+/**
+ * Copy an attribute value into the arena
+ */
+static char *attr_strdup(struct JUNIT_ParserState *state, const xmlChar **attrs, int i) {
+    char *result = arena_strndup(state->suite->_arena, JUNIT_ATTR_VALUE(attrs, i), JUNIT_ATTR_LEN(attrs, i));
+    if (!result) {
+        SYSERROR("failed to allocate memory for %s attribute", JUNIT_ATTR_NAME(attrs, i));
+        state->status = -1;
     }
     return result;
 }
 
-static struct JUNIT_Error *testcase_error_from_attributes(struct StrList *attrs) {
-    struct JUNIT_Error *result = calloc(1, sizeof(*result));
-    if(!result) {
-        return NULL;
+/**
+ * Convert an attribute value to a number
+ */
+static double attr_number(const xmlChar **attrs, int i) {
+    char buf[64] = {0};
+    size_t len = JUNIT_ATTR_LEN(attrs, i);
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
     }
-    for (size_t x = 0; x < strlist_count(attrs); x += 2) {
-        const char *attr_name = strlist_item(attrs, x);
-        const char *attr_value = strlist_item(attrs, x + 1);
-        if (attr_name && attr_value) {
-            if (!strcmp(attr_name, "message")) {
-                result->message = strdup(attr_value);
-                if (!result->message) {
-                    SYSERROR("failed to allocate memory for testcase error message");
-                    break;
-                }
-            }
+    memcpy(buf, JUNIT_ATTR_VALUE(attrs, i), len);
+    return strtod(buf, NULL);
+}
+
+static void read_testsuite(struct JUNIT_ParserState *state, int nb_attributes, const xmlChar **attrs) {
+    struct JUNIT_Testsuite *suite = state->suite;
+    for (int i = 0; i < nb_attributes; i++) {
+        const char *attr_name = JUNIT_ATTR_NAME(attrs, i);
+        if (!strcmp(attr_name, "name")) {
+            suite->name = attr_strdup(state, attrs, i);
+        } else if (!strcmp(attr_name, "errors")) {
+            suite->errors = (int) attr_number(attrs, i);
+        } else if (!strcmp(attr_name, "failures")) {
+            suite->failures = (int) attr_number(attrs, i);
+        } else if (!strcmp(attr_name, "skipped")) {
+            suite->skipped = (int) attr_number(attrs, i);
+        } else if (!strcmp(attr_name, "tests")) {
+            suite->tests = (int) attr_number(attrs, i);
+        } else if (!strcmp(attr_name, "time")) {
+            suite->time = (float) attr_number(attrs, i);
+        } else if (!strcmp(attr_name, "timestamp")) {
+            suite->timestamp = attr_strdup(state, attrs, i);
+        } else if (!strcmp(attr_name, "hostname")) {
+            suite->hostname = attr_strdup(state, attrs, i);
         }
     }
-    return result;
 }
 
-static struct JUNIT_Skipped *testcase_skipped_from_attributes(struct StrList *attrs) {
-    struct JUNIT_Skipped *result = calloc(1, sizeof(*result));
-    if(!result) {
-        return NULL;
+static void read_testcase(struct JUNIT_ParserState *state, int nb_attributes, const xmlChar **attrs) {
+    struct JUNIT_Testcase *testcase = arena_alloc(state->suite->_arena, sizeof(*testcase));
+    if (!testcase || testsuite_append_testcase(state->suite, testcase)) {
+        SYSERROR("%s", "failed to allocate memory for testcase");
+        state->status = -1;
+        return;
     }
-    for (size_t x = 0; x < strlist_count(attrs); x += 2) {
-        const char *attr_name = strlist_item(attrs, x);
-        const char *attr_value = strlist_item(attrs, x + 1);
-        if (attr_name && attr_value) {
-            if (!strcmp(attr_name, "message")) {
-                result->message = strdup(attr_value);
-                if (!result->message) {
-                    SYSERROR("failed to allocate memory for testcase skip message");
-                    break;
-                }
-            }
+    for (int i = 0; i < nb_attributes; i++) {
+        const char *attr_name = JUNIT_ATTR_NAME(attrs, i);
+        if (!strcmp(attr_name, "name")) {
+            testcase->name = attr_strdup(state, attrs, i);
+        } else if (!strcmp(attr_name, "classname")) {
+            testcase->classname = attr_strdup(state, attrs, i);
+        } else if (!strcmp(attr_name, "time")) {
+            testcase->time = (float) attr_number(attrs, i);
+        } else if (!strcmp(attr_name, "message")) {
+            testcase->message = attr_strdup(state, attrs, i);
         }
     }
-    return result;
 }
 
-static struct JUNIT_Testcase *testcase_from_attributes(struct StrList *attrs) {
-    struct JUNIT_Testcase *result = calloc(1, sizeof(*result));
-    if(!result) {
-        SYSERROR("failed to allocate memory for testcase");
-        return NULL;
+static void read_result_state(struct JUNIT_ParserState *state, int type, int nb_attributes, const xmlChar **attrs) {
+    struct JUNIT_Testsuite *suite = state->suite;
+    if (!suite->_tc_inuse) {
+        // Not inside a test case
+        return;
     }
-    for (size_t x = 0; x < strlist_count(attrs); x += 2) {
-        char *attr_name = strlist_item(attrs, x);
-        char *attr_value = strlist_item(attrs, x + 1);
-        if (attr_name && attr_value) {
-            if (!strcmp(attr_name, "name")) {
-                result->name = strdup(attr_value);
-                if (!result->name) {
-                    SYSERROR("failed to allocate memory for testcase name");
-                    testcase_free(&result);
-                    break;
-                }
-            } else if (!strcmp(attr_name, "classname")) {
-                result->classname = strdup(attr_value);
-                if (!result->classname) {
-                    SYSERROR("failed to allocate memory for testcase class name");
-                    testcase_free(&result);
-                    break;
-                }
-            } else if (!strcmp(attr_name, "time")) {
-                result->time = strtof(attr_value, NULL);
-            } else if (!strcmp(attr_name, "message")) {
-                result->message = strdup(attr_value);
-                if (!result->message) {
-                    SYSERROR("failed to allocate memory for testcase message");
-                    testcase_free(&result);
-                    break;
-                }
-            }
+    struct JUNIT_Testcase *testcase = suite->testcase[suite->_tc_inuse - 1];
+
+    char *message = NULL;
+    char *skip_type = NULL;
+    for (int i = 0; i < nb_attributes; i++) {
+        const char *attr_name = JUNIT_ATTR_NAME(attrs, i);
+        if (!strcmp(attr_name, "message")) {
+            message = attr_strdup(state, attrs, i);
+        } else if (!strcmp(attr_name, "type") && type == JUNIT_RESULT_STATE_SKIPPED) {
+            skip_type = attr_strdup(state, attrs, i);
         }
     }
-    return result;
-}
 
-static struct StrList *attributes_to_strlist(xmlTextReaderPtr reader) {
-    struct StrList *list;
-    xmlNodePtr node = xmlTextReaderCurrentNode(reader);
-    if (!node) {
-        return NULL;
+    void *record = NULL;
+    if (type == JUNIT_RESULT_STATE_FAILURE) {
+        struct JUNIT_Failure *failure = arena_alloc(suite->_arena, sizeof(*failure));
+        if (failure) {
+            failure->message = message;
+            testcase->result_state.failure = failure;
+        }
+        record = failure;
+    } else if (type == JUNIT_RESULT_STATE_ERROR) {
+        struct JUNIT_Error *error = arena_alloc(suite->_arena, sizeof(*error));
+        if (error) {
+            error->message = message;
+            testcase->result_state.error = error;
+        }
+        record = error;
+    } else if (type == JUNIT_RESULT_STATE_SKIPPED) {
+        struct JUNIT_Skipped *skipped = arena_alloc(suite->_arena, sizeof(*skipped));
+        if (skipped) {
+            skipped->type = skip_type;
+            skipped->message = message;
+            testcase->result_state.skipped = skipped;
+        }
+        record = skipped;
     }
 
-    list = strlist_init();
-    if (xmlTextReaderNodeType(reader) == 1 && node->properties) {
-        xmlAttr *attr = node->properties;
-        while (attr && attr->name && attr->children) {
-            char *attr_name = (char *) attr->name;
-            char *attr_value = (char *) xmlNodeListGetString(node->doc, attr->children, 1);
-            strlist_append(&list, attr_name ? attr_name : "");
-            strlist_append(&list, attr_value ? attr_value : "");
-            xmlFree((xmlChar *) attr_value);
-            attr = attr->next;
-        }
+    if (!record) {
+        SYSERROR("%s", "failed to allocate memory for testcase result");
+        state->status = -1;
+        return;
     }
-    return list;
+    testcase->tc_result_state_type = type;
 }
 
-static int read_xml_data(xmlTextReaderPtr reader, struct JUNIT_Testsuite **testsuite) {
-    //const xmlChar *value;
+static void sax_start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+                              int nb_namespaces, const xmlChar **namespaces,
+                              int nb_attributes, int nb_defaulted, const xmlChar **attrs) {
+    (void) prefix;
+    (void) URI;
+    (void) nb_namespaces;
+    (void) namespaces;
+    (void) nb_defaulted;
 
-    const xmlChar *name = xmlTextReaderConstName(reader);
-    if (!name) {
-        // name could not be converted to string
-        name = BAD_CAST "--";
+    xmlParserCtxtPtr parser = ctx;
+    struct JUNIT_ParserState *state = parser->_private;
+    if (state->status) {
+        return;
     }
-    //value = xmlTextReaderConstValue(reader);
-    const char *node_name = (char *) name;
-    //const char *node_value = (char *) value;
-    
-    struct StrList *attrs = attributes_to_strlist(reader);
-    if (attrs && strlist_count(attrs)) {
-        if (!strcmp(node_name, "testsuite")) {
-            for (size_t x = 0; x < strlist_count(attrs); x += 2) {
-                char *attr_name = strlist_item(attrs, x);
-                char *attr_value = strlist_item(attrs, x + 1);
-                if (attr_name && attr_value) {
-                    if (!strcmp(attr_name, "name")) {
-                        (*testsuite)->name = strdup(attr_value);
-                        if (!(*testsuite)->name) {
-                            SYSERROR("%s", "failed to allocate memory for testcase name");
-                            return -1;
-                        }
-                    } else if (!strcmp(attr_name, "errors")) {
-                        (*testsuite)->errors = (int) strtol(attr_value, NULL, 10);
-                    } else if (!strcmp(attr_name, "failures")) {
-                        (*testsuite)->failures = (int) strtol(attr_value, NULL, 0);
-                    } else if (!strcmp(attr_name, "skipped")) {
-                        (*testsuite)->skipped = (int) strtol(attr_value, NULL, 0);
-                    } else if (!strcmp(attr_name, "tests")) {
-                        (*testsuite)->tests = (int) strtol(attr_value, NULL, 0);
-                    } else if (!strcmp(attr_name, "time")) {
-                        (*testsuite)->time = strtof(attr_value, NULL);
-                    } else if (!strcmp(attr_name, "timestamp")) {
-                        (*testsuite)->timestamp = strdup(attr_value);
-                        if (!(*testsuite)->timestamp) {
-                            SYSERROR("%s", "failed to allocate memory for testcase timestamp");
-                            return -1;
-                        }
-                    } else if (!strcmp(attr_name, "hostname")) {
-                        (*testsuite)->hostname = strdup(attr_value);
-                        if (!(*testsuite)->hostname) {
-                            SYSERROR("%s", "failed to allocate memory for testcase hostname");
-                            return -1;
-                        }
-                    }
-                }
-            }
-        } else if (!strcmp(node_name, "testcase")) {
-            struct JUNIT_Testcase *testcase = testcase_from_attributes(attrs);
-            if (!testcase) {
-                SYSERROR("%s", "failed to allocate memory for testcase");
-                return -1;
-            }
-            testsuite_append_testcase(testsuite, testcase);
-        } else if (!strcmp(node_name, "failure")) {
-            size_t cur_tc = (*testsuite)->_tc_inuse > 0 ? (*testsuite)->_tc_inuse - 1 : (*testsuite)->_tc_inuse;
-            struct JUNIT_Failure *failure = testcase_failure_from_attributes(attrs);
-            if (!failure) {
-                SYSERROR("%s", "failed to allocate memory for testcase failure");
-                return -1;
-            }
-            if ((*testsuite)->testcase && (*testsuite)->testcase[cur_tc]) {
-                (*testsuite)->testcase[cur_tc]->tc_result_state_type = JUNIT_RESULT_STATE_FAILURE;
-                (*testsuite)->testcase[cur_tc]->result_state.failure = failure;
-            }
-        } else if (!strcmp(node_name, "error")) {
-            size_t cur_tc = (*testsuite)->_tc_inuse > 0 ? (*testsuite)->_tc_inuse - 1 : (*testsuite)->_tc_inuse;
-            struct JUNIT_Error *error = testcase_error_from_attributes(attrs);
-            if (!error) {
-                SYSERROR("%s", "failed to allocate memory for testcase error");
-                return -1;
-            }
-            if ((*testsuite)->testcase && (*testsuite)->testcase[cur_tc]) {
-                (*testsuite)->testcase[cur_tc]->tc_result_state_type = JUNIT_RESULT_STATE_ERROR;
-                (*testsuite)->testcase[cur_tc]->result_state.error = error;
-            }
-        } else if (!strcmp(node_name, "skipped")) {
-            size_t cur_tc = (*testsuite)->_tc_inuse > 0 ? (*testsuite)->_tc_inuse - 1 : (*testsuite)->_tc_inuse;
-            struct JUNIT_Skipped *skipped = testcase_skipped_from_attributes(attrs);
-            if (!skipped) {
-                SYSERROR("%s", "failed to allocate memory for testcase skipped");
-                return -1;
-            }
-            if ((*testsuite)->testcase && (*testsuite)->testcase[cur_tc]) {
-                (*testsuite)->testcase[cur_tc]->tc_result_state_type = JUNIT_RESULT_STATE_SKIPPED;
-                (*testsuite)->testcase[cur_tc]->result_state.skipped = skipped;
-            }
-        }
+
+    const char *node_name = (const char *) localname;
+    if (!strcmp(node_name, "testsuite")) {
+        read_testsuite(state, nb_attributes, attrs);
+    } else if (!strcmp(node_name, "testcase")) {
+        read_testcase(state, nb_attributes, attrs);
+    } else if (!strcmp(node_name, "failure")) {
+        read_result_state(state, JUNIT_RESULT_STATE_FAILURE, nb_attributes, attrs);
+    } else if (!strcmp(node_name, "error")) {
+        read_result_state(state, JUNIT_RESULT_STATE_ERROR, nb_attributes, attrs);
+    } else if (!strcmp(node_name, "skipped")) {
+        read_result_state(state, JUNIT_RESULT_STATE_SKIPPED, nb_attributes, attrs);
+    }
+
+    if (state->status) {
+        xmlStopParser(parser);
     }
-    (*testsuite)->passed = (*testsuite)->tests - (*testsuite)->failures - (*testsuite)->errors - (*testsuite)->skipped;
-    guard_strlist_free(&attrs);
-    return 0;
 }
 
-static int read_xml_file(const char *filename, struct JUNIT_Testsuite **testsuite) {
-    xmlTextReaderPtr reader = xmlReaderForFile(filename, NULL, 0);
-    if (!reader) {
-        xmlFreeTextReader(reader);
+static int read_xml_file(const char *filename, struct JUNIT_Testsuite *testsuite) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
         return -1;
     }
 
-    int result = xmlTextReaderRead(reader);
-    while (result == 1) {
-        if (read_xml_data(reader, testsuite) < 0) {
-            xmlFreeTextReader(reader);
-            return -1;
-        }
+    // Only element starts are of interest. Text, comments, etc. are discarded by the parser.
+    xmlSAXHandler handler;
+    memset(&handler, 0, sizeof(handler));
+    handler.initialized = XML_SAX2_MAGIC;
+    handler.startElementNs = sax_start_element;
 
-        result = xmlTextReaderRead(reader);
+    struct JUNIT_ParserState state = {.suite = testsuite};
+    xmlParserCtxtPtr parser = xmlCreatePushParserCtxt(&handler, NULL, NULL, 0, filename);
+    if (!parser) {
+        fclose(fp);
+        return -1;
     }
+    parser->_private = &state;
+    // NOENT decodes character references in attribute values. Entity declarations
+    // have no handler, so external entities are never resolved.
+    xmlCtxtUseOptions(parser, XML_PARSE_NOENT | XML_PARSE_NONET | XML_PARSE_HUGE);
 
-    xmlFreeTextReader(reader);
-    return 0;
+    char buf[JUNIT_READ_SIZE];
+    size_t len;
+    int result = 0;
+    while (!result && (len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        result = xmlParseChunk(parser, buf, (int) len, 0);
+    }
+    if (!result) {
+        result = xmlParseChunk(parser, NULL, 0, 1);
+    }
+    if (!result && (ferror(fp) || !parser->wellFormed)) {
+        result = -1;
+    }
+
+    xmlFreeParserCtxt(parser);
+    fclose(fp);
+    if (state.status) {
+        return -1;
+    }
+    return result ? -1 : 0;
 }
 
 struct JUNIT_Testsuite *junitxml_testsuite_read(const char *filename) {
@@ -320,10 +324,17 @@ struct JUNIT_Testsuite *junitxml_testsuite_read(const char *filename) {
     if (!result) {
         return NULL;
     }
+    result->_arena = calloc(1, sizeof(*result->_arena));
+    if (!result->_arena) {
+        guard_free(result);
+        return NULL;
+    }
 
-    if (read_xml_file(filename, &result)) {
+    if (read_xml_file(filename, result)) {
         junitxml_testsuite_free(&result);
+        return NULL;
     }
+    result->passed = result->tests - result->failures - result->errors - result->skipped;
 
     return result;
-}
\ No newline at end of file
+}
@@ -1,51 +1,316 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include "core.h"
 #include "log.h"
 
 enum LogLevel LOG_LEVEL = LOG_LEVEL_WARN;
 
-void log_print_error(const struct ExecPoint ep, const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    log_msgv(stderr, ep, STASIS_COLOR_RED, "ERROR", fmt, ap);
-    va_end(ap);
+//! Text assembled on the caller's stack, moved to the heap if it outgrows it
+struct LogBuffer {
+    char *data;
+    size_t len;
+    size_t alloc;
+    char stack[STASIS_BUFSIZ];
+};
+
+static void log_buffer_init(struct LogBuffer *buf) {
+    buf->data = buf->stack;
+    buf->len = 0;
+    buf->alloc = sizeof(buf->stack);
+    buf->data[0] = '\0';
 }
 
-void log_print_warning(const struct ExecPoint ep, const char *fmt, ...) {
-    if (LOG_LEVEL < LOG_LEVEL_WARN) {
+static void log_buffer_free(struct LogBuffer *buf) {
+    if (buf->data != buf->stack) {
+        guard_free(buf->data);
+    }
+}
+
+static int log_buffer_reserve(struct LogBuffer *buf, size_t len) {
+    if (buf->len + len + 1 <= buf->alloc) {
+        return 0;
+    }
+    size_t alloc = buf->alloc * 2;
+    while (alloc < buf->len + len + 1) {
+        alloc *= 2;
+    }
+    char *tmp = buf->data == buf->stack ? malloc(alloc) : realloc(buf->data, alloc);
+    if (!tmp) {
+        return -1;
+    }
+    if (buf->data == buf->stack) {
+        memcpy(tmp, buf->stack, buf->len + 1);
+    }
+    buf->data = tmp;
+    buf->alloc = alloc;
+    return 0;
+}
+
+static void log_buffer_append(struct LogBuffer *buf, const char *str, size_t len) {
+    if (log_buffer_reserve(buf, len)) {
         return;
     }
+    memcpy(buf->data + buf->len, str, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+}
+
+static int log_buffer_vprintf(struct LogBuffer *buf, const char *fmt, va_list ap) {
+    va_list ap_len;
+    va_copy(ap_len, ap);
+    const int len = vsnprintf(NULL, 0, fmt, ap_len);
+    va_end(ap_len);
+    if (len < 0 || log_buffer_reserve(buf, (size_t) len)) {
+        return -1;
+    }
+    va_list ap_out;
+    va_copy(ap_out, ap);
+    vsnprintf(buf->data + buf->len, buf->alloc - buf->len, fmt, ap_out);
+    va_end(ap_out);
+    buf->len += (size_t) len;
+    return len;
+}
+
+static int log_buffer_printf(struct LogBuffer *buf, const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    log_msgv(stderr, ep, STASIS_COLOR_YELLOW, "WARNING", fmt, ap);
+    const int len = log_buffer_vprintf(buf, fmt, ap);
     va_end(ap);
+    return len;
 }
 
-void log_print_info(const struct ExecPoint ep, const char *fmt, ...) {
-    if (LOG_LEVEL < LOG_LEVEL_INFO) {
+// Append a logfmt value. Color codes and trailing line separators are dropped.
+static void log_buffer_value(struct LogBuffer *buf, const char *value) {
+    size_t end = strlen(value);
+    while (end && (value[end - 1] == '\n' || value[end - 1] == '\r')) {
+        end--;
+    }
+    int quote = !end;
+    for (size_t i = 0; !quote && i < end; i++) {
+        quote = value[i] == ' ' || value[i] == '=' || value[i] == '"' || value[i] == '\\' || (unsigned char) value[i] < ' ';
+    }
+
+    if (quote) {
+        log_buffer_append(buf, "\"", 1);
+    }
+    for (size_t i = 0; i < end; i++) {
+        const char ch = value[i];
+        if (ch == '\x1b' && value[i + 1] == '[') {
+            // Skip the color code
+            i++;
+            while (i + 1 < end && !((value[i + 1] >= 'A' && value[i + 1] <= 'Z') || (value[i + 1] >= 'a' && value[i + 1] <= 'z'))) {
+                i++;
+            }
+            i++;
+            continue;
+        }
+        if (ch == '"' || ch == '\\') {
+            log_buffer_append(buf, "\\", 1);
+            log_buffer_append(buf, &ch, 1);
+        } else if (ch == '\n') {
+            log_buffer_append(buf, "\\n", 2);
+        } else if (ch == '\t') {
+            log_buffer_append(buf, "\\t", 2);
+        } else if ((unsigned char) ch >= ' ') {
+            log_buffer_append(buf, &ch, 1);
+        }
+    }
+    if (quote) {
+        log_buffer_append(buf, "\"", 1);
+    }
+}
+
+static struct LogSink {
+    int fd; ///< Log file descriptor (-1 when closed)
+    pid_t pid; ///< Process running the writer thread
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake; ///< Records were queued, or the sink is closing
+    pthread_cond_t drained; ///< The writer finished a batch
+    char *queue; ///< Records waiting for the writer
+    size_t queue_len;
+    size_t queue_alloc;
+    int writing; ///< The writer is writing a batch
+    int closing;
+} log_sink = {
+    .fd = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .drained = PTHREAD_COND_INITIALIZER,
+};
+
+static void log_sink_write_all(const int fd, const char *data, size_t len) {
+    while (len) {
+        const ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // Nowhere left to report the problem
+            return;
+        }
+        data += n;
+        len -= (size_t) n;
+    }
+}
+
+static void *log_sink_writer(void *arg) {
+    (void) arg;
+    char *batch = NULL;
+    size_t batch_alloc = 0;
+
+    pthread_mutex_lock(&log_sink.lock);
+    while (1) {
+        while (!log_sink.queue_len && !log_sink.closing) {
+            pthread_cond_wait(&log_sink.wake, &log_sink.lock);
+        }
+        if (!log_sink.queue_len) {
+            break;
+        }
+        // Take the queue, and give the callers the previous batch's storage
+        char *data = log_sink.queue;
+        const size_t len = log_sink.queue_len;
+        const size_t alloc = log_sink.queue_alloc;
+        log_sink.queue = batch;
+        log_sink.queue_alloc = batch_alloc;
+        log_sink.queue_len = 0;
+        batch = data;
+        batch_alloc = alloc;
+        log_sink.writing = 1;
+        pthread_mutex_unlock(&log_sink.lock);
+
+        log_sink_write_all(log_sink.fd, batch, len);
+
+        pthread_mutex_lock(&log_sink.lock);
+        log_sink.writing = 0;
+        pthread_cond_broadcast(&log_sink.drained);
+    }
+    pthread_mutex_unlock(&log_sink.lock);
+    guard_free(batch);
+    return NULL;
+}
+
+static void log_sink_enqueue(const char *data, size_t len) {
+    if (log_sink.pid != getpid()) {
+        // A child process has no writer thread
+        log_sink_write_all(log_sink.fd, data, len);
         return;
     }
-    va_list ap;
-    va_start(ap, fmt);
-    log_msgv(stdout, ep, STASIS_COLOR_WHITE, "INFO", fmt, ap);
-    va_end(ap);
+
+    pthread_mutex_lock(&log_sink.lock);
+    while (log_sink.queue_len && log_sink.queue_len + len > LOG_SINK_QUEUE_MAX) {
+        pthread_cond_wait(&log_sink.drained, &log_sink.lock);
+    }
+    if (log_sink.queue_len + len > log_sink.queue_alloc) {
+        size_t alloc = log_sink.queue_alloc ? log_sink.queue_alloc : STASIS_BUFSIZ;
+        while (alloc < log_sink.queue_len + len) {
+            alloc *= 2;
+        }
+        char *tmp = realloc(log_sink.queue, alloc);
+        if (!tmp) {
+            pthread_mutex_unlock(&log_sink.lock);
+            return;
+        }
+        log_sink.queue = tmp;
+        log_sink.queue_alloc = alloc;
+    }
+    memcpy(log_sink.queue + log_sink.queue_len, data, len);
+    log_sink.queue_len += len;
+    pthread_cond_signal(&log_sink.wake);
+    pthread_mutex_unlock(&log_sink.lock);
 }
 
-void log_print_debug(const struct ExecPoint ep, const char *fmt, ...) {
-    if (LOG_LEVEL < LOG_LEVEL_DEBUG) {
+int log_sink_open(const char *filename) {
+    static int registered = 0;
+    log_sink_close();
+
+    const int fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        SYSERROR("%s: %s", filename, strerror(errno));
+        return -1;
+    }
+    log_sink.pid = getpid();
+    log_sink.closing = 0;
+    if (pthread_create(&log_sink.thread, NULL, log_sink_writer, NULL)) {
+        SYSERROR("unable to start log writer thread");
+        close(fd);
+        return -1;
+    }
+    log_sink.fd = fd;
+    if (!registered) {
+        // Write out what's left, however the program exits
+        atexit(log_sink_close);
+        registered = 1;
+    }
+    return 0;
+}
+
+void log_sink_flush(void) {
+    if (log_sink.fd < 0 || log_sink.pid != getpid()) {
         return;
     }
-    va_list ap;
-    va_start(ap, fmt);
-    log_msgv(stderr, ep, STASIS_COLOR_BLUE, "DEBUG", fmt, ap);
-    va_end(ap);
+    pthread_mutex_lock(&log_sink.lock);
+    while (log_sink.queue_len || log_sink.writing) {
+        pthread_cond_wait(&log_sink.drained, &log_sink.lock);
+    }
+    pthread_mutex_unlock(&log_sink.lock);
 }
 
-int log_msgv(FILE *stream, const struct ExecPoint ep, const char *preface_color, const char *preface, const char *fmt, va_list ap) {
-    char header[STASIS_BUFSIZ] = {0};
+void log_sink_close(void) {
+    if (log_sink.fd < 0 || log_sink.pid != getpid()) {
+        return;
+    }
+    pthread_mutex_lock(&log_sink.lock);
+    log_sink.closing = 1;
+    pthread_cond_signal(&log_sink.wake);
+    pthread_mutex_unlock(&log_sink.lock);
+    pthread_join(log_sink.thread, NULL);
+
+    close(log_sink.fd);
+    log_sink.fd = -1;
+    guard_free(log_sink.queue);
+    log_sink.queue_len = 0;
+    log_sink.queue_alloc = 0;
+}
+
+void log_sink_record(const char *level, const struct ExecPoint *ep, const char *message, const char **fields) {
+    if (log_sink.fd < 0) {
+        return;
+    }
+    struct LogBuffer buf;
+    log_buffer_init(&buf);
+
+    struct timespec now;
+    struct tm tm;
+    char stamp[STASIS_TIME_STR_MAX] = {0};
+    clock_gettime(CLOCK_REALTIME, &now);
+    gmtime_r(&now.tv_sec, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+    log_buffer_printf(&buf, "time=%s.%03ldZ level=%s pid=%ld", stamp, now.tv_nsec / 1000000, level, (long) getpid());
+    if (ep) {
+        log_buffer_printf(&buf, " file=%s line=%d func=%s", path_basename((char *) ep->file), ep->line, ep->function);
+    }
+    log_buffer_append(&buf, " msg=", 5);
+    log_buffer_value(&buf, message ? message : "");
+    for (size_t i = 0; fields && fields[i] && fields[i + 1]; i += 2) {
+        log_buffer_printf(&buf, " %s=", fields[i]);
+        log_buffer_value(&buf, fields[i + 1]);
+    }
+    log_buffer_append(&buf, "\n", 1);
+
+    log_sink_enqueue(buf.data, buf.len);
+    log_buffer_free(&buf);
+}
+
+// Format the header and message, and write them to the stream at once
+static int log_write(FILE *stream, const struct ExecPoint *ep, const char *preface_color, const char *preface, const char *fmt, va_list ap, const char **fields) {
+    struct LogBuffer buf;
     const int no_info = LOG_LEVEL < LOG_LEVEL_INFO;
     const int some_info = LOG_LEVEL < LOG_LEVEL_DEBUG;
 
-    int len = snprintf(header, sizeof(header),
+    log_buffer_init(&buf);
+    log_buffer_printf(&buf,
         STASIS_COLOR_RESET
         "%s%s: "
         STASIS_COLOR_RESET,
@@ -53,46 +318,132 @@ int log_msgv(FILE *stream, const struct ExecPoint ep, const char *preface_color,
         preface ? preface : "UNKNOWN");
 
     if (no_info) {
-        len += snprintf(header + strlen(header), sizeof(header) - len,
+        log_buffer_printf(&buf,
             STASIS_COLOR_WHITE
             ""
             STASIS_COLOR_RESET);
     } else if (some_info) {
-        len += snprintf(header + strlen(header), sizeof(header) - len,
+        log_buffer_printf(&buf,
             STASIS_COLOR_WHITE
             "%s(): "
             STASIS_COLOR_RESET,
-            ep.function);
+            ep->function);
     } else {
         // everything
-        len += snprintf(header + strlen(header), sizeof(header) - len,
+        log_buffer_printf(&buf,
             STASIS_COLOR_WHITE
             "%s:%d: %s(): "
             STASIS_COLOR_RESET,
-            path_basename((char *) ep.file),
-            ep.line,
-            ep.function);
+            path_basename((char *) ep->file),
+            ep->line,
+            ep->function);
     }
 
-    if (len >= (int) sizeof(header)) {
-        SYSERROR("header format truncated (%d >= %d)", len, (int) sizeof(header));
+    const size_t message_start = buf.len;
+    const int len = log_buffer_vprintf(&buf, fmt ? fmt : "NO MESSAGE", ap);
+    if (len < 0) {
+        log_buffer_free(&buf);
         return len;
     }
+    // Keep a copy of the message for the log file before fields are appended
+    char *message = log_sink.fd >= 0 ? strdup(buf.data + message_start) : NULL;
+    for (size_t i = 0; fields && fields[i] && fields[i + 1]; i += 2) {
+        log_buffer_printf(&buf, " %s=", fields[i]);
+        log_buffer_value(&buf, fields[i + 1]);
+    }
+    log_buffer_append(&buf, LINE_SEP, strlen(LINE_SEP));
 
-    fprintf(stream, "%s", header);
+    fwrite(buf.data, 1, buf.len, stream);
+    log_buffer_free(&buf);
 
-    va_list ap_out;
-    va_copy(ap_out, ap);
-    len = vfprintf(stream, fmt ? fmt : "NO MESSAGE", ap_out);
-    va_end(ap_out);
-    if (len < 0) {
-        SYSERROR("\nvfprintf failed");
-        return len;
+    if (message) {
+        log_sink_record(preface ? preface : "UNKNOWN", ep, message, fields);
+        guard_free(message);
     }
-    fprintf(stream, LINE_SEP);
     return len;
 }
 
+static int log_write_fields(FILE *stream, const struct ExecPoint *ep, const char *preface_color, const char *preface, const char **fields, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    const int ret = log_write(stream, ep, preface_color, preface, fmt, ap, fields);
+    va_end(ap);
+    return ret;
+}
+
+void log_print_error(const struct ExecPoint ep, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    log_msgv(stderr, ep, STASIS_COLOR_RED, "ERROR", fmt, ap);
+    va_end(ap);
+}
+
+void log_print_warning(const struct ExecPoint ep, const char *fmt, ...) {
+    if (!LOG_ENABLED(LOG_LEVEL_WARN)) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    log_msgv(stderr, ep, STASIS_COLOR_YELLOW, "WARNING", fmt, ap);
+    va_end(ap);
+}
+
+void log_print_info(const struct ExecPoint ep, const char *fmt, ...) {
+    if (!LOG_ENABLED(LOG_LEVEL_INFO)) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    log_msgv(stdout, ep, STASIS_COLOR_WHITE, "INFO", fmt, ap);
+    va_end(ap);
+}
+
+void log_print_debug(const struct ExecPoint ep, const char *fmt, ...) {
+    if (!LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    log_msgv(stderr, ep, STASIS_COLOR_BLUE, "DEBUG", fmt, ap);
+    va_end(ap);
+}
+
+void log_print_record(enum LogLevel level, const struct ExecPoint ep, const char *message, ...) {
+    if (!LOG_ENABLED(level)) {
+        return;
+    }
+    const char *fields[128 + 1] = {0};
+    va_list ap;
+    va_start(ap, message);
+    for (size_t i = 0; i + 2 < sizeof(fields) / sizeof(*fields); i += 2) {
+        const char *key = va_arg(ap, const char *);
+        if (!key) {
+            break;
+        }
+        const char *value = va_arg(ap, const char *);
+        fields[i] = key;
+        fields[i + 1] = value ? value : "";
+    }
+    va_end(ap);
+
+    FILE *stream = stderr;
+    const char *color = STASIS_COLOR_YELLOW;
+    const char *preface = "WARNING";
+    if (level == LOG_LEVEL_INFO) {
+        stream = stdout;
+        color = STASIS_COLOR_WHITE;
+        preface = "INFO";
+    } else if (level >= LOG_LEVEL_DEBUG) {
+        color = STASIS_COLOR_BLUE;
+        preface = "DEBUG";
+    }
+    log_write_fields(stream, &ep, color, preface, fields, "%s", message ? message : "");
+}
+
+int log_msgv(FILE *stream, const struct ExecPoint ep, const char *preface_color, const char *preface, const char *fmt, va_list ap) {
+    return log_write(stream, &ep, preface_color, preface, fmt, ap, NULL);
+}
+
 int log_msg(FILE *stream, const struct ExecPoint ep, const char *preface_color, const char *preface, const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
@@ -1,5 +1,6 @@
 #include "core.h"
 #include "multiprocessing.h"
+#include "trace.h"
 
 /// The sum of all tasks started by mp_task()
 size_t mp_global_task_count = 0;
@@ -125,6 +126,10 @@ int child(struct MultiProcessingPool *pool, struct MultiProcessingTask *task) {
     fflush(stderr);
     char *args[] = {"bash", "--norc", task->parent_script, (char *) NULL};
     semaphore_post(&pool->semaphore);
+    if (task->envp) {
+        // execvp() searches PATH using the environment it replaces, so swap it in first
+        __environ = task->envp;
+    }
     execvp("bash", args);
     SYSERROR("execvp failed (%s)", strerror(errno));
     _exit(127);
@@ -188,6 +193,9 @@ struct MultiProcessingTask *mp_pool_task(struct MultiProcessingPool *pool, const
     // Set default status to "error"
     slot->status = MP_POOL_TASK_STATUS_INITIAL;
 
+    // Inherit the parent's environment unless told otherwise
+    slot->envp = NULL;
+
     // Set task identifier string
     memset(slot->ident, 0, sizeof(slot->ident));
     snprintf(slot->ident, sizeof(slot->ident), "%s", ident);
@@ -372,6 +380,7 @@ int mp_pool_join(struct MultiProcessingPool *pool, size_t jobs, size_t flags) {
             struct MultiProcessingTask *slot = &pool->task[i];
             if (slot->status == MP_POOL_TASK_STATUS_INITIAL) {
                 slot->_startup = time(NULL);
+                slot->_trace_start = trace_now();
                 if (mp_task_fork(pool, slot)) {
                     SYSERROR("%s: mp_task_fork failed", slot->ident);
                     kill(0, SIGTERM);
@@ -483,6 +492,12 @@ int mp_pool_join(struct MultiProcessingPool *pool, size_t jobs, size_t flags) {
                     SYSWARN("%s Unable to remove temporary script '%s': %s", progress, slot->parent_script, strerror(errno));
                 }
 
+                if (trace_enabled()) {
+                    char trace_name[sizeof(pool->ident) + sizeof(slot->ident) + 1] = {0};
+                    snprintf(trace_name, sizeof(trace_name), "%s:%s", pool->ident, slot->ident);
+                    trace_complete(TRACE_CAT_TASK, trace_name, (long) slot->pid, slot->_trace_start, trace_now());
+                }
+
                 // Update progress and tell the poller to ignore the PID. The process is gone.
                 slot->pid = MP_POOL_PID_UNUSED;
             } else if (pid < 0) {
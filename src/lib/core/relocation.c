@@ -1,6 +1,9 @@
 /**
  * @file relocation.c
  */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "relocation.h"
 #include "str.h"
 
@@ -91,68 +94,303 @@ int replace_text(char *original, const char *target, const char *replacement, un
     return 0;
 }
 
+struct ReplaceNode {
+    int next[256]; ///< transition for each byte value
+    int fail; ///< node representing the longest proper suffix of this node
+    int rule; ///< index of the rule whose target ends here, or -1
+    int out; ///< nearest node on the fail chain with a rule, or -1
+    size_t depth; ///< length of the prefix represented by this node
+};
+
+struct ReplaceMatcher {
+    struct ReplaceNode *node;
+    size_t count;
+    size_t capacity;
+};
+
+static int replace_matcher_node_new(struct ReplaceMatcher *m, size_t depth) {
+    if (m->count == m->capacity) {
+        const size_t capacity = m->capacity ? m->capacity * 2 : 64;
+        struct ReplaceNode *tmp = realloc(m->node, capacity * sizeof(*m->node));
+        if (!tmp) {
+            return -1;
+        }
+        m->node = tmp;
+        m->capacity = capacity;
+    }
+    struct ReplaceNode *node = &m->node[m->count];
+    memset(node->next, -1, sizeof(node->next));
+    node->fail = 0;
+    node->rule = -1;
+    node->out = -1;
+    node->depth = depth;
+    return (int) m->count++;
+}
+
 /**
- * Replace `target` with `replacement` in `filename`
+ * Build an Aho-Corasick automaton recognizing every rule target
+ *
+ * The transition table is completed (failure transitions are resolved ahead
+ * of time) so the scanner only performs one lookup per input byte.
+ */
+static int replace_matcher_init(struct ReplaceMatcher *m, const struct ReplaceRule *rules, size_t count) {
+    memset(m, 0, sizeof(*m));
+    if (replace_matcher_node_new(m, 0) < 0) {
+        return -1;
+    }
+
+    for (size_t r = 0; r < count; r++) {
+        const unsigned char *target = (const unsigned char *) rules[r].target;
+        int state = 0;
+        for (size_t i = 0; target[i] != '\0'; i++) {
+            if (m->node[state].next[target[i]] < 0) {
+                const int node = replace_matcher_node_new(m, i + 1);
+                if (node < 0) {
+                    return -1;
+                }
+                m->node[state].next[target[i]] = node;
+            }
+            state = m->node[state].next[target[i]];
+        }
+        // The first rule wins when a target is given more than once
+        if (m->node[state].rule < 0) {
+            m->node[state].rule = (int) r;
+        }
+    }
+
+    // Breadth-first, so a node's fail target is always complete before the node itself
+    int *queue = calloc(m->count, sizeof(*queue));
+    if (!queue) {
+        return -1;
+    }
+    size_t head = 0;
+    size_t tail = 0;
+    for (size_t c = 0; c < 256; c++) {
+        int *next = &m->node[0].next[c];
+        if (*next < 0) {
+            *next = 0;
+        } else {
+            queue[tail++] = *next;
+        }
+    }
+    while (head < tail) {
+        const int u = queue[head++];
+        for (size_t c = 0; c < 256; c++) {
+            const int v = m->node[u].next[c];
+            const int fallback = m->node[m->node[u].fail].next[c];
+            if (v < 0) {
+                m->node[u].next[c] = fallback;
+                continue;
+            }
+            m->node[v].fail = fallback;
+            m->node[v].out = m->node[fallback].rule >= 0 ? fallback : m->node[fallback].out;
+            queue[tail++] = v;
+        }
+    }
+    guard_free(queue);
+    return 0;
+}
+
+static void replace_matcher_free(struct ReplaceMatcher *m) {
+    guard_free(m->node);
+    m->count = 0;
+    m->capacity = 0;
+}
+
+/**
+ * Replace several `target` strings with their `replacement` in `filename`
+ *
+ * The file is mapped into memory and scanned once, regardless of the number
+ * of rules or the length of its lines. Where targets overlap, the match
+ * starting first wins, and the longest target wins among matches starting at
+ * the same position. Replacements are not scanned again.
+ *
+ * When a rule has the REPLACE_TRUNCATE_AFTER_MATCH flag, the remainder of the
+ * line following its match is discarded (the line separator is kept), and the
+ * scan resumes on the next line.
+ *
+ * The result is written to a temporary file next to `filename` and renamed
+ * over it, so readers never observe a partially rewritten file. A file without
+ * any matches is not rewritten. Symbolic links are resolved, and the rewritten
+ * file keeps the permissions of the original.
  *
  * ~~~{.c}
- * if (file_replace_text("/path/to/file.txt", "are", "is")) {
+ * struct ReplaceRule rules[] = {
+ *     {.target = "@NAME@", .replacement = "stasis"},
+ *     {.target = "  url:", .replacement = "  url: https://example.com", .flags = REPLACE_TRUNCATE_AFTER_MATCH},
+ * };
+ * if (file_replace_text_ex("/path/to/file.txt", rules, sizeof(rules) / sizeof(*rules))) {
  *     fprintf(stderr, "failed to replace strings in file\n");
  *     exit(1);
  * }
  * ~~~
  *
  * @param filename path to file
- * @param target string value to replace
- * @param replacement string
- * @param flags REPLACE_TRUNCATE_AFTER_MATCH
+ * @param rules array of ReplaceRule
+ * @param count number of rules
  * @return 0 on success, -1 on error
  */
-int file_replace_text(const char* filename, const char* target, const char* replacement, unsigned flags) {
-    char buffer[STASIS_BUFSIZ];
-    char tempfilename[] = "tempfileXXXXXX";
+int file_replace_text_ex(const char *filename, const struct ReplaceRule *rules, size_t count) {
+    for (size_t r = 0; r < count; r++) {
+        if (!rules[r].target || !*rules[r].target || !rules[r].replacement) {
+            SYSERROR("rule %zu: target must be a non-empty string and replacement must not be NULL", r);
+            errno = EINVAL;
+            return -1;
+        }
+    }
 
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        SYSERROR("unable to open for reading: %s", filename);
+    char *path = realpath(filename, NULL);
+    if (!path) {
+        SYSERROR("unable to resolve path: %s: %s", filename, strerror(errno));
         return -1;
     }
 
-    FILE *tfp = fopen(tempfilename, "w+");
-    if (!tfp) {
-        SYSERROR("unable to open temporary fp for writing: %s", tempfilename);
-        fclose(fp);
-        return -1;
+    int result = -1;
+    int fd = -1;
+    unsigned char *data = MAP_FAILED;
+    size_t size = 0;
+    struct stat st;
+    struct ReplaceMatcher m = {0};
+    FILE *tfp = NULL;
+    char tempfilename[PATH_MAX] = {0};
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        SYSERROR("unable to open for reading: %s: %s", path, strerror(errno));
+        goto done;
     }
+    if (!S_ISREG(st.st_mode)) {
+        SYSERROR("not a regular file: %s", path);
+        errno = EINVAL;
+        goto done;
+    }
+    size = (size_t) st.st_size;
+    if (!size || !count) {
+        result = 0;
+        goto done;
+    }
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        SYSERROR("unable to map %s: %s", path, strerror(errno));
+        goto done;
+    }
+    if (replace_matcher_init(&m, rules, count)) {
+        SYSERROR("unable to allocate bytes for replacement rules");
+        goto done;
+    }
+
+    size_t emitted = 0;
+    size_t i = 0;
+    int state = 0;
+    int best = -1;
+    size_t best_start = 0;
+    while (1) {
+        if (i < size) {
+            state = m.node[state].next[data[i]];
+            // The longest target ending here starts first
+            const int hit = m.node[state].rule >= 0 ? state : m.node[state].out;
+            if (hit >= 0) {
+                const size_t start = i + 1 - m.node[hit].depth;
+                if (best < 0 || start <= best_start) {
+                    best = hit;
+                    best_start = start;
+                }
+            }
+            i++;
+            // Keep going while a longer match starting at or before best_start is still possible
+            if (best < 0 || i - m.node[state].depth <= best_start) {
+                continue;
+            }
+        } else if (best < 0) {
+            break;
+        }
+
+        const struct ReplaceRule *rule = &rules[m.node[best].rule];
+        size_t pos = best_start + m.node[best].depth;
+        if (rule->flags & REPLACE_TRUNCATE_AFTER_MATCH) {
+            const unsigned char *eol = memchr(data + pos, '\n', size - pos);
+            pos = eol ? (size_t) (eol - data) : size;
+        }
 
-    // Write modified strings to temporary file
-    int result = 0;
-    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        if (strstr(buffer, target)) {
-            if (replace_text(buffer, target, replacement, flags)) {
-                result = -1;
+        if (!tfp) {
+            const char *base = strrchr(path, '/');
+            snprintf(tempfilename, sizeof(tempfilename), "%.*s/.%s.XXXXXX", (int) (base - path), path, base + 1);
+            const int tfd = mkstemp(tempfilename);
+            if (tfd < 0 || !(tfp = fdopen(tfd, "w"))) {
+                SYSERROR("unable to create temporary file: %s: %s", tempfilename, strerror(errno));
+                if (tfd >= 0) {
+                    close(tfd);
+                    remove(tempfilename);
+                }
+                goto done;
             }
         }
-        fputs(buffer, tfp);
+        fwrite(data + emitted, 1, best_start - emitted, tfp);
+        fputs(rule->replacement, tfp);
+
+        emitted = pos;
+        i = pos;
+        state = 0;
+        best = -1;
     }
-    fflush(tfp);
 
-    // Replace original with modified copy
-    fclose(fp);
-    fp = fopen(filename, "w+");
-    if (!fp) {
-        SYSERROR("unable to reopen %s for writing", filename);
-        fclose(tfp);
-        return -1;
+    if (!tfp) {
+        // Nothing to replace
+        result = 0;
+        goto done;
     }
 
-    // Update original file
-    rewind(tfp);
-    while (fgets(buffer, sizeof(buffer), tfp) != NULL) {
-        fputs(buffer, fp);
+    fwrite(data + emitted, 1, size - emitted, tfp);
+    if (fflush(tfp) || ferror(tfp) || fchmod(fileno(tfp), st.st_mode & 07777)) {
+        SYSERROR("unable to write temporary file: %s: %s", tempfilename, strerror(errno));
+        fclose(tfp);
+        remove(tempfilename);
+        goto done;
     }
-    fclose(fp);
     fclose(tfp);
 
-    remove(tempfilename);
+    if (rename(tempfilename, path) < 0) {
+        SYSERROR("unable to replace %s: %s", path, strerror(errno));
+        remove(tempfilename);
+        goto done;
+    }
+    result = 0;
+
+    done:
+    replace_matcher_free(&m);
+    if (data != MAP_FAILED) {
+        munmap(data, size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    guard_free(path);
     return result;
-}
\ No newline at end of file
+}
+
+/**
+ * Replace `target` with `replacement` in `filename`
+ *
+ * To replace several targets in the same file, use file_replace_text_ex().
+ *
+ * ~~~{.c}
+ * if (file_replace_text("/path/to/file.txt", "are", "is")) {
+ *     fprintf(stderr, "failed to replace strings in file\n");
+ *     exit(1);
+ * }
+ * ~~~
+ *
+ * @param filename path to file
+ * @param target string value to replace
+ * @param replacement string
+ * @param flags REPLACE_TRUNCATE_AFTER_MATCH
+ * @return 0 on success, -1 on error
+ */
+int file_replace_text(const char* filename, const char* target, const char* replacement, unsigned flags) {
+    const struct ReplaceRule rule = {
+        .target = target,
+        .replacement = replacement,
+        .flags = flags,
+    };
+    return file_replace_text_ex(filename, &rule, 1);
+}
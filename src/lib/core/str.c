@@ -3,6 +3,7 @@
  */
 #include <unistd.h>
 #include "str.h"
+#include "version_compare.h"
 
 
 
@@ -356,6 +357,16 @@ void strsort(char **arr, unsigned int sort_mode) {
         return;
     }
 
+    if (sort_mode == STASIS_SORT_VERSION) {
+        // Each version is parsed once, not on every comparison
+        size_t count = 0;
+        while (arr[count] != NULL) {
+            count++;
+        }
+        version_sort(arr, count);
+        return;
+    }
+
     typedef int (*compar)(const void *, const void *);
     // Default mode is alphabetic sort
     compar fn = strsort_alpha_compare;
@@ -773,4 +784,13 @@ int safe_strncat(char *dst, const char *src, const size_t dsize) {
         SYSWARN("destination truncated: %p", dst);
     }
     return len;
-}
\ No newline at end of file
+}
+
+size_t strhash(const char *sptr, size_t len) {
+    size_t hash = 2166136261U;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) sptr[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
@@ -10,6 +10,121 @@
 
 #include "utils.h"
 
+#define STRLIST_ARENA_CHUNK_SIZE 65536
+#define STRLIST_INDEX_MIN_ALLOC 16
+
+struct StrListArena {
+    struct StrListArena *next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+/**
+ * Copy a string into arena storage
+ * @param arena pointer to arena (a new chunk is allocated as needed)
+ * @param str string to copy
+ * @return pointer to the copy, or NULL on error
+ */
+static char *strlist_arena_strdup(struct StrListArena **arena, const char *str) {
+    const size_t len = strlen(str) + 1;
+    if (!*arena || (*arena)->size - (*arena)->used < len) {
+        const size_t size = len > STRLIST_ARENA_CHUNK_SIZE ? len : STRLIST_ARENA_CHUNK_SIZE;
+        struct StrListArena *chunk = malloc(sizeof(*chunk) + size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = *arena;
+        chunk->size = size;
+        chunk->used = 0;
+        *arena = chunk;
+    }
+    char *result = &(*arena)->data[(*arena)->used];
+    memcpy(result, str, len);
+    (*arena)->used += len;
+    return result;
+}
+
+static void strlist_arena_free(struct StrListArena **arena) {
+    while (*arena) {
+        struct StrListArena *next = (*arena)->next;
+        guard_free(*arena);
+        *arena = next;
+    }
+}
+
+/**
+ * Locate `value` in the hash index
+ * @param pStrList `StrList` (STRLIST_MODE_INTERN)
+ * @param value string to search for
+ * @param index_of (result) position of `value` in `pStrList->data`
+ * @return 1 found, 0 not found
+ */
+static int strlist_index_lookup(struct StrList *pStrList, const char *value, size_t *index_of) {
+    if (!pStrList->index_alloc) {
+        return 0;
+    }
+    const size_t mask = pStrList->index_alloc - 1;
+    for (size_t slot = strhash(value, strlen(value)) & mask; pStrList->index[slot]; slot = (slot + 1) & mask) {
+        const size_t pos = pStrList->index[slot] - 1;
+        if (pStrList->data[pos] && !strcmp(pStrList->data[pos], value)) {
+            if (index_of) {
+                *index_of = pos;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Record position `pos` in the hash index. The first occurrence of a value wins.
+ * @param pStrList `StrList` (STRLIST_MODE_INTERN)
+ * @param pos position of record in `pStrList->data`
+ */
+static void strlist_index_insert(struct StrList *pStrList, size_t pos) {
+    const char *value = pStrList->data[pos];
+    if (!value) {
+        return;
+    }
+    const size_t mask = pStrList->index_alloc - 1;
+    size_t slot;
+    for (slot = strhash(value, strlen(value)) & mask; pStrList->index[slot]; slot = (slot + 1) & mask) {
+        if (!strcmp(pStrList->data[pStrList->index[slot] - 1], value)) {
+            return;
+        }
+    }
+    pStrList->index[slot] = pos + 1;
+}
+
+/**
+ * Regenerate the hash index after records are added, moved, or removed
+ * @param pStrList `StrList` (STRLIST_MODE_INTERN)
+ * @return 0 on success, -1 on error
+ */
+static int strlist_index_rebuild(struct StrList *pStrList) {
+    // Keep the load factor at or below 50%
+    size_t index_alloc = pStrList->index_alloc ? pStrList->index_alloc : STRLIST_INDEX_MIN_ALLOC;
+    while (index_alloc < (pStrList->num_inuse + 1) * 2) {
+        index_alloc *= 2;
+    }
+
+    if (index_alloc != pStrList->index_alloc) {
+        size_t *tmp = realloc(pStrList->index, index_alloc * sizeof(*pStrList->index));
+        if (!tmp) {
+            return -1;
+        }
+        pStrList->index = tmp;
+        pStrList->index_alloc = index_alloc;
+    }
+    memset(pStrList->index, 0, pStrList->index_alloc * sizeof(*pStrList->index));
+
+    for (size_t i = 0; i < pStrList->num_inuse; i++) {
+        strlist_index_insert(pStrList, i);
+    }
+    return 0;
+}
+
 /**
  *
  * @param pStrList `StrList`
@@ -19,9 +134,15 @@ void strlist_free(struct StrList **pStrList) {
         return;
     }
 
-    for (size_t i = 0; i < (*pStrList)->num_inuse; i++) {
-        if ((*pStrList)->data[i]) {
-            guard_free((*pStrList)->data[i]);
+    if ((*pStrList)->mode == STRLIST_MODE_INTERN) {
+        // Records are owned by the arena
+        strlist_arena_free(&(*pStrList)->arena);
+        guard_free((*pStrList)->index);
+    } else {
+        for (size_t i = 0; i < (*pStrList)->num_inuse; i++) {
+            if ((*pStrList)->data[i]) {
+                guard_free((*pStrList)->data[i]);
+            }
         }
     }
     if ((*pStrList)->data) {
@@ -30,29 +151,128 @@ void strlist_free(struct StrList **pStrList) {
     guard_free((*pStrList));
 }
 
+/**
+ * Ensure `pStrList` can store `count` additional records without reallocating
+ *
+ * Capacity grows geometrically, so repeated appends are amortized O(1)
+ *
+ * @param pStrList `StrList`
+ * @param count number of records to make room for
+ * @return 0 on success, -1 on error
+ */
+int strlist_reserve(struct StrList *pStrList, size_t count) {
+    if (pStrList == NULL) {
+        return -1;
+    }
+
+    // One extra record is reserved for the NULL terminator
+    const size_t required = pStrList->num_inuse + count + 1;
+    if (required <= pStrList->num_alloc && pStrList->data) {
+        return 0;
+    }
+
+    size_t num_alloc = pStrList->num_alloc ? pStrList->num_alloc : 1;
+    while (num_alloc < required) {
+        num_alloc *= 2;
+    }
+
+    char **tmp = realloc(pStrList->data, num_alloc * sizeof(*pStrList->data));
+    if (tmp == NULL) {
+        return -1;
+    }
+    memset(&tmp[pStrList->num_inuse], 0, (num_alloc - pStrList->num_inuse) * sizeof(*tmp));
+    pStrList->data = tmp;
+    pStrList->num_alloc = num_alloc;
+    return 0;
+}
+
+static void strlist_push(struct StrList **pStrList, char *item) {
+    if (strlist_reserve(*pStrList, 1) < 0) {
+        guard_strlist_free(pStrList);
+        SYSERROR("failed to append to array: %s", strerror(errno));
+        exit(1);
+    }
+    (*pStrList)->data[(*pStrList)->num_inuse] = item;
+    (*pStrList)->num_inuse++;
+    (*pStrList)->data[(*pStrList)->num_inuse] = NULL;
+}
+
+/**
+ * Append a value to an interned list. Duplicate values are ignored.
+ * @param pStrList `StrList` (STRLIST_MODE_INTERN)
+ * @param str
+ */
+static void strlist_append_interned(struct StrList **pStrList, const char *str) {
+    if (strlist_index_lookup(*pStrList, str, NULL)) {
+        return;
+    }
+
+    char *item = strlist_arena_strdup(&(*pStrList)->arena, str);
+    if (item == NULL) {
+        guard_strlist_free(pStrList);
+        SYSERROR("failed to append to array: %s", strerror(errno));
+        exit(1);
+    }
+    strlist_push(pStrList, item);
+
+    if ((*pStrList)->num_inuse * 2 > (*pStrList)->index_alloc) {
+        if (strlist_index_rebuild(*pStrList) < 0) {
+            guard_strlist_free(pStrList);
+            SYSERROR("failed to grow array index: %s", strerror(errno));
+            exit(1);
+        }
+    } else {
+        strlist_index_insert(*pStrList, (*pStrList)->num_inuse - 1);
+    }
+}
+
+/**
+ * Append a value to the list without copying it
+ *
+ * The list takes ownership of `str`. It will be released by `strlist_free`.
+ * A `STRLIST_MODE_INTERN` list copies `str` into its arena and releases the original immediately.
+ *
+ * @param pStrList `StrList`
+ * @param str heap allocated string
+ */
+void strlist_append_nocopy(struct StrList **pStrList, char *str) {
+    if (pStrList == NULL || *pStrList == NULL) {
+        return;
+    }
+
+    if ((*pStrList)->mode == STRLIST_MODE_INTERN) {
+        strlist_append_interned(pStrList, str);
+        guard_free(str);
+        return;
+    }
+    strlist_push(pStrList, str);
+}
+
 /**
  * Append a value to the list
+ *
+ * A `STRLIST_MODE_INTERN` list ignores values it already contains
+ *
  * @param pStrList `StrList`
  * @param str
  */
 void strlist_append(struct StrList **pStrList, char *str) {
-    char **tmp = NULL;
+    if (pStrList == NULL || *pStrList == NULL) {
+        return;
+    }
 
-    if (pStrList == NULL) {
+    if ((*pStrList)->mode == STRLIST_MODE_INTERN) {
+        strlist_append_interned(pStrList, str);
         return;
     }
 
-    tmp = realloc((*pStrList)->data, ((*pStrList)->num_alloc + 1) * sizeof(char *));
-    if (tmp == NULL) {
+    char *item = strdup(str);
+    if (item == NULL) {
         guard_strlist_free(pStrList);
         SYSERROR("failed to append to array: %s", strerror(errno));
         exit(1);
     }
-    (*pStrList)->data = tmp;
-    (*pStrList)->data[(*pStrList)->num_inuse] = strdup(str);
-    (*pStrList)->data[(*pStrList)->num_alloc] = NULL;
-    (*pStrList)->num_inuse++;
-    (*pStrList)->num_alloc++;
+    strlist_push(pStrList, item);
 }
 
 static int reader_strlist_append_file(size_t lineno, char **line) {
@@ -117,10 +337,8 @@ int strlist_append_file(struct StrList *pStrList, char *_path, ReaderFn *readerF
         retval = 1;
         goto fatal;
     }
-    for (size_t record = 0; data[record] != NULL; record++) {
-        strlist_append(&pStrList, data[record]);
-        guard_free(data[record]);
-    }
+    // The list takes ownership of each line
+    strlist_append_array_nocopy(pStrList, data);
     if (is_url) {
         // remove temporary data
         remove(filename);
@@ -157,6 +375,9 @@ fatal:
  * }
  * ```
  *
+ * The first record containing `value` as a substring is a match. Use
+ * strlist_find() to match whole records.
+ *
  * @param pStrList pointer to `StrList`
  * @param index_of (result) index of string in `pStrList`, if found
  * @param value string to search for in `pStrList`
@@ -186,6 +407,39 @@ int strlist_contains(struct StrList *pStrList, const char *value, size_t *index_
     return 0;
 }
 
+/**
+ * Is a record identical to `value` present in `pStrList`?
+ * The caller should test for success before using the value `index_of`
+ *
+ * A `STRLIST_MODE_INTERN` list is searched in constant time
+ *
+ * @param pStrList pointer to `StrList`
+ * @param value string to search for in `pStrList`
+ * @param index_of (result) index of string in `pStrList`, if found
+ * @return 1 found
+ * @return 0 not found
+ */
+int strlist_find(struct StrList *pStrList, const char *value, size_t *index_of) {
+    if (pStrList == NULL || value == NULL) {
+        return 0;
+    }
+
+    if (pStrList->mode == STRLIST_MODE_INTERN) {
+        return strlist_index_lookup(pStrList, value, index_of);
+    }
+
+    for (size_t i = 0; i < strlist_count(pStrList); i++) {
+        const char *item = strlist_item(pStrList, i);
+        if (item && !strcmp(item, value)) {
+            if (index_of) {
+                *index_of = i;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /**
  * Append the contents of `pStrList2` to `pStrList1`
  * @param pStrList1 `StrList`
@@ -199,6 +453,7 @@ void strlist_append_strlist(struct StrList *pStrList1, struct StrList *pStrList2
     }
 
     count = strlist_count(pStrList2);
+    strlist_reserve(pStrList1, count);
     for (size_t i = 0; i < count; i++) {
         char *item = strlist_item(pStrList2, i);
         strlist_append(&pStrList1, item);
@@ -214,11 +469,42 @@ void strlist_append_strlist(struct StrList *pStrList1, struct StrList *pStrList2
      if (!pStrList || !arr) {
          return;
      }
+     size_t count;
+     for (count = 0; arr[count] != NULL; count++) {}
+     strlist_reserve(pStrList, count);
      for (size_t i = 0; arr[i] != NULL; i++) {
          strlist_append(&pStrList, arr[i]);
      }
  }
 
+/**
+ * Append the contents of an array of pointers to char without copying them
+ *
+ * The list takes ownership of each string in `arr`. The caller remains
+ * responsible for free()ing `arr` itself.
+ *
+ * ```c
+ * char **lines = file_readlines("requirements.txt", 0, 0, NULL);
+ * strlist_append_array_nocopy(list, lines);
+ * guard_free(lines);
+ * ```
+ *
+ * @param pStrList `StrList`
+ * @param arr NULL terminated array of heap allocated strings
+ */
+void strlist_append_array_nocopy(struct StrList *pStrList, char **arr) {
+    if (!pStrList || !arr) {
+        return;
+    }
+    size_t count;
+    for (count = 0; arr[count] != NULL; count++) {}
+    strlist_reserve(pStrList, count);
+    for (size_t i = 0; i < count; i++) {
+        strlist_append_nocopy(&pStrList, arr[i]);
+        arr[i] = NULL;
+    }
+}
+
 /**
  * Append the contents of a newline delimited string
  * @param pStrList `StrList`
@@ -240,6 +526,9 @@ int strlist_append_tokenize(struct StrList *pStrList, char *str, char *delim) {
         guard_free(tmp);
         return -1;
     }
+    size_t count;
+    for (count = 0; token[count] != NULL; count++) {}
+    strlist_reserve(pStrList, count);
     for (size_t i = 0; token[i] != NULL; i++) {
         lstrip(token[i]);
         strlist_append(&pStrList, token[i]);
@@ -273,6 +562,9 @@ int strlist_append_tokenize_raw(struct StrList *pStrList, char *str, char *delim
         return -1;
     }
 
+    size_t count;
+    for (count = 0; token[count] != NULL; count++) {}
+    strlist_reserve(pStrList, count);
     for (size_t i = 0; token[i] != NULL; i++) {
         strlist_append(&pStrList, token[i]);
     }
@@ -298,7 +590,8 @@ int strlist_appendf(struct StrList **pStrList, const char *fmt, ...) {
     va_end(ap);
 
     if (pStrList && *pStrList && len >= 0) {
-        strlist_append(pStrList, s);
+        strlist_append_nocopy(pStrList, s);
+        return len;
     }
     guard_free(s);
     return len;
@@ -315,11 +608,12 @@ struct StrList *strlist_copy(struct StrList *pStrList) {
         return NULL;
     }
 
-    result = strlist_init();
+    result = strlist_init_mode(pStrList->mode);
     if (!result) {
         return NULL;
     }
 
+    strlist_reserve(result, strlist_count(pStrList));
     for (size_t i = 0; i < strlist_count(pStrList); i++) {
         strlist_append(&result, strlist_item(pStrList, i));
     }
@@ -337,13 +631,21 @@ void strlist_remove(struct StrList *pStrList, size_t index) {
         return;
     }
     if (pStrList->data[index] != NULL) {
-        guard_free(pStrList->data[index]);
+        if (pStrList->mode == STRLIST_MODE_INTERN) {
+            // Record storage is owned by the arena
+            pStrList->data[index] = NULL;
+        } else {
+            guard_free(pStrList->data[index]);
+        }
         for (size_t i = index; i < count; i++) {
             pStrList->data[i] = pStrList->data[i + 1];
         }
         if (pStrList->num_inuse) {
             pStrList->num_inuse--;
         }
+        if (pStrList->mode == STRLIST_MODE_INTERN) {
+            strlist_index_rebuild(pStrList);
+        }
     }
 }
 
@@ -362,7 +664,8 @@ int strlist_cmp(struct StrList *a, struct StrList *b) {
         return -2;
     }
 
-    if (a->num_alloc != b->num_alloc || a->num_inuse != b->num_inuse) {
+    // num_alloc is capacity, not content, so it is not compared
+    if (a->num_inuse != b->num_inuse) {
         return 1;
     }
 
@@ -387,6 +690,9 @@ void strlist_sort(struct StrList *pStrList, unsigned int mode) {
         return;
     }
     strsort(pStrList->data, mode);
+    if (pStrList->mode == STRLIST_MODE_INTERN) {
+        strlist_index_rebuild(pStrList);
+    }
 }
 
 /**
@@ -409,6 +715,9 @@ void strlist_reverse(struct StrList *pStrList) {
         pStrList->data[j] = tmp;
         j--;
     }
+    if (pStrList->mode == STRLIST_MODE_INTERN) {
+        strlist_index_rebuild(pStrList);
+    }
 }
 
 /**
@@ -428,6 +737,10 @@ size_t strlist_count(struct StrList *pStrList) {
 
 /**
  * Set value at index
+ *
+ * A `STRLIST_MODE_INTERN` list stays unique. If `value` is already stored at
+ * another index, the record at `index` is removed instead.
+ *
  * @param pStrList
  * @param index pStrlist->data[index] to set
  * @param value string
@@ -440,7 +753,28 @@ void strlist_set(struct StrList **pStrList, size_t index, char *value) {
         return;
     }
 
-    if (value == NULL) {
+    if ((*pStrList)->mode == STRLIST_MODE_INTERN) {
+        size_t existing = 0;
+        if (value != NULL && strlist_index_lookup(*pStrList, value, &existing)) {
+            if (existing != index) {
+                // The value is already a record. Keep the set unique by dropping this one.
+                strlist_remove(*pStrList, index);
+            }
+            return;
+        }
+        // Record storage is owned by the arena. The previous value is abandoned.
+        if (value == NULL) {
+            (*pStrList)->data[index] = NULL;
+        } else {
+            char *item = strlist_arena_strdup(&(*pStrList)->arena, value);
+            if (!item) {
+                SYSERROR("strlist_set replacement allocation failed: %s", strerror(errno));
+                return;
+            }
+            (*pStrList)->data[index] = item;
+        }
+        strlist_index_rebuild(*pStrList);
+    } else if (value == NULL) {
         guard_free((*pStrList)->data[index]);
     } else {
         tmp = realloc((*pStrList)->data[index], (strlen(value) + 1) * sizeof(char *));
@@ -831,13 +1165,44 @@ long double strlist_item_as_long_double(struct StrList *pStrList, size_t index)
  * @return `StrList`
  */
 struct StrList *strlist_init() {
+    return strlist_init_mode(STRLIST_MODE_DEFAULT);
+}
+
+/**
+ * Initialize an empty `StrList` using a specific storage mode
+ *
+ * `STRLIST_MODE_INTERN` lists behave as ordered sets. Records are unique,
+ * copied into a shared arena, and indexed by hash, so `strlist_find` runs
+ * in constant time. The arena is released in one
+ * operation by `strlist_free`.
+ *
+ * ```c
+ * struct StrList *seen = strlist_init_mode(STRLIST_MODE_INTERN);
+ * strlist_append(&seen, "numpy");
+ * strlist_append(&seen, "numpy"); // ignored
+ * if (strlist_find(seen, "numpy", NULL)) {
+ *     // strlist_count(seen) == 1
+ * }
+ * guard_strlist_free(&seen);
+ * ```
+ *
+ * @param mode `STRLIST_MODE_DEFAULT` or `STRLIST_MODE_INTERN`
+ * @return `StrList`
+ */
+struct StrList *strlist_init_mode(unsigned mode) {
     struct StrList *pStrList = calloc(1, sizeof(struct StrList));
     if (pStrList == NULL) {
         SYSERROR("failed to allocate array: %s", strerror(errno));
         return NULL;
     }
+    pStrList->mode = mode;
     pStrList->num_inuse = 0;
     pStrList->num_alloc = 1;
     pStrList->data = calloc(pStrList->num_alloc, sizeof(char *));
+    if (mode == STRLIST_MODE_INTERN && strlist_index_rebuild(pStrList) < 0) {
+        SYSERROR("failed to allocate array index: %s", strerror(errno));
+        guard_strlist_free(&pStrList);
+        return NULL;
+    }
     return pStrList;
 }
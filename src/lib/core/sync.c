@@ -0,0 +1,654 @@
+#include "sync.h"
+#include "utils.h"
+
+struct SyncEntry {
+    char *src; ///< Path to the source record
+    mode_t mode; ///< Source file type and permissions
+    off_t size; ///< Source file size
+    struct timespec mtime; ///< Source modification time
+    dev_t dev; ///< Source device
+    ino_t ino; ///< Source inode
+};
+
+struct SyncPlan {
+    struct StrList *paths; ///< Relative paths (interned; index matches entries)
+    struct SyncEntry *entries;
+    size_t num_alloc;
+};
+
+struct SyncJob {
+    size_t entry; ///< Index of the SyncEntry to copy
+};
+
+struct SyncPool {
+    const struct SyncPlan *plan;
+    const char *dest;
+    const struct SyncJob *jobs;
+    size_t num_jobs;
+    unsigned flags; ///< SyncOptions.flags
+    size_t next; ///< Next job to hand out
+    size_t files_copied;
+    size_t files_linked;
+    size_t bytes_copied;
+    int status;
+    pthread_mutex_t lock;
+};
+
+static void sync_plan_free(struct SyncPlan *plan) {
+    for (size_t i = 0; i < strlist_count(plan->paths); i++) {
+        guard_free(plan->entries[i].src);
+    }
+    guard_free(plan->entries);
+    guard_strlist_free(&plan->paths);
+}
+
+/**
+ * Remove the records below directory `rel` from the plan
+ * @return 0 on success, -1 on error
+ */
+static int sync_plan_prune(struct SyncPlan *plan, const char *rel) {
+    struct StrList *paths = strlist_init_mode(STRLIST_MODE_INTERN);
+    if (!paths) {
+        return -1;
+    }
+    const size_t len = strlen(rel);
+    size_t kept = 0;
+    for (size_t i = 0; i < strlist_count(plan->paths); i++) {
+        char *path = strlist_item(plan->paths, i);
+        if (!strncmp(path, rel, len) && path[len] == '/') {
+            guard_free(plan->entries[i].src);
+            continue;
+        }
+        strlist_append(&paths, path);
+        plan->entries[kept++] = plan->entries[i];
+    }
+    guard_strlist_free(&plan->paths);
+    plan->paths = paths;
+    return 0;
+}
+
+/**
+ * Add (or replace) a record in the plan
+ * @return 0 on success, -1 on error
+ */
+static int sync_plan_add(struct SyncPlan *plan, const char *rel, const char *src, const struct stat *st) {
+    size_t index = 0;
+    if (strlist_find(plan->paths, rel, &index) && S_ISDIR(plan->entries[index].mode) && !S_ISDIR(st->st_mode)) {
+        // A later source replaced the directory, so its contents are not copied
+        if (sync_plan_prune(plan, rel)) {
+            return -1;
+        }
+    }
+    if (!strlist_find(plan->paths, rel, &index)) {
+        index = strlist_count(plan->paths);
+        if (index + 1 > plan->num_alloc) {
+            size_t num_alloc = plan->num_alloc ? plan->num_alloc * 2 : 256;
+            struct SyncEntry *tmp = realloc(plan->entries, num_alloc * sizeof(*tmp));
+            if (!tmp) {
+                return -1;
+            }
+            plan->entries = tmp;
+            plan->num_alloc = num_alloc;
+        }
+        strlist_append(&plan->paths, (char *) rel);
+        memset(&plan->entries[index], 0, sizeof(plan->entries[index]));
+    }
+
+    struct SyncEntry *entry = &plan->entries[index];
+    guard_free(entry->src);
+    entry->src = strdup(src);
+    if (!entry->src) {
+        return -1;
+    }
+    entry->mode = st->st_mode;
+    entry->size = st->st_size;
+    entry->mtime = st->st_mtim;
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    return 0;
+}
+
+static int sync_excluded(char **exclude, const char *rel, const char *name, int is_dir) {
+    for (size_t i = 0; exclude && exclude[i] != NULL; i++) {
+        char pattern[PATH_MAX] = {0};
+        safe_strncpy(pattern, exclude[i], sizeof(pattern));
+
+        const size_t len = strlen(pattern);
+        if (len && pattern[len - 1] == '/') {
+            if (!is_dir) {
+                continue;
+            }
+            pattern[len - 1] = '\0';
+        }
+
+        int match;
+        if (pattern[0] == '/') {
+            match = fnmatch(pattern + 1, rel, FNM_PATHNAME);
+        } else if (strchr(pattern, '/')) {
+            match = fnmatch(pattern, rel, FNM_PATHNAME);
+        } else {
+            match = fnmatch(pattern, name, 0);
+        }
+        if (!match) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void sync_join(char *result, size_t maxlen, const char *base, const char *name) {
+    if (isempty((char *) base)) {
+        snprintf(result, maxlen, "%s", name);
+    } else {
+        snprintf(result, maxlen, "%s/%s", base, name);
+    }
+}
+
+/**
+ * Record the contents of a source directory
+ * @return 0 on success, -1 on error
+ */
+static int sync_walk(struct SyncPlan *plan, const int fd, const char *src, const char *rel, const struct SyncOptions *opts) {
+    DIR *dp = fdopendir(fd);
+    if (!dp) {
+        SYSERROR("%s: %s", src, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    int status = 0;
+    struct dirent *rec;
+    while (!status && (rec = readdir(dp)) != NULL) {
+        if (!strcmp(rec->d_name, ".") || !strcmp(rec->d_name, "..")) {
+            continue;
+        }
+
+        struct stat st;
+        char src_path[PATH_MAX];
+        char rel_path[PATH_MAX];
+        sync_join(src_path, sizeof(src_path), src, rec->d_name);
+        sync_join(rel_path, sizeof(rel_path), rel, rec->d_name);
+
+        if (fstatat(dirfd(dp), rec->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+            SYSERROR("%s: %s", src_path, strerror(errno));
+            status = -1;
+            break;
+        }
+        if (sync_excluded(opts->exclude, rel_path, rec->d_name, S_ISDIR(st.st_mode))) {
+            continue;
+        }
+        if (sync_plan_add(plan, rel_path, src_path, &st)) {
+            SYSERROR("unable to allocate memory for %s", src_path);
+            status = -1;
+            break;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            const int child = openat(dirfd(dp), rec->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child < 0) {
+                SYSERROR("%s: %s", src_path, strerror(errno));
+                status = -1;
+                break;
+            }
+            status = sync_walk(plan, child, src_path, rel_path, opts);
+        }
+    }
+    closedir(dp);
+    return status;
+}
+
+/**
+ * Remove destination records that are absent from the plan, or that have the
+ * wrong type to be updated in place
+ * @return number of records removed, or -1 on error
+ */
+static int sync_delete(const struct SyncPlan *plan, const int fd, const char *dest, const char *rel, const struct SyncOptions *opts) {
+    DIR *dp = fdopendir(fd);
+    if (!dp) {
+        SYSERROR("%s: %s", dest, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    int deleted = 0;
+    struct dirent *rec;
+    while ((rec = readdir(dp)) != NULL) {
+        if (!strcmp(rec->d_name, ".") || !strcmp(rec->d_name, "..")) {
+            continue;
+        }
+
+        struct stat st;
+        char dest_path[PATH_MAX];
+        char rel_path[PATH_MAX];
+        sync_join(dest_path, sizeof(dest_path), dest, rec->d_name);
+        sync_join(rel_path, sizeof(rel_path), rel, rec->d_name);
+
+        if (fstatat(dirfd(dp), rec->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+            continue;
+        }
+        const int is_dir = S_ISDIR(st.st_mode);
+        if (sync_excluded(opts->exclude, rel_path, rec->d_name, is_dir)) {
+            // Excluded records are protected
+            continue;
+        }
+
+        size_t index = 0;
+        const int found = strlist_find(plan->paths, rel_path, &index);
+        if (found && is_dir && S_ISDIR(plan->entries[index].mode)) {
+            const int child = openat(dirfd(dp), rec->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child < 0) {
+                SYSERROR("%s: %s", dest_path, strerror(errno));
+                deleted = -1;
+                break;
+            }
+            const int result = sync_delete(plan, child, dest_path, rel_path, opts);
+            if (result < 0) {
+                deleted = -1;
+                break;
+            }
+            deleted += result;
+            continue;
+        }
+        if (found && !is_dir && !S_ISDIR(plan->entries[index].mode)) {
+            continue;
+        }
+
+        if (opts->flags & SYNC_VERBOSE) {
+            printf("deleting %s%s\n", rel_path, is_dir ? "/" : "");
+        }
+        if (is_dir) {
+            if (rmtree(dest_path) < 0) {
+                SYSERROR("unable to remove %s: %s", dest_path, strerror(errno));
+                deleted = -1;
+                break;
+            }
+        } else if (unlinkat(dirfd(dp), rec->d_name, 0) < 0) {
+            SYSERROR("unable to remove %s: %s", dest_path, strerror(errno));
+            deleted = -1;
+            break;
+        }
+        deleted++;
+    }
+    closedir(dp);
+    return deleted;
+}
+
+/**
+ * Compare the contents of two files
+ * @return 1 if identical, 0 if not (or on error)
+ */
+static int sync_same_contents(const char *a, const char *b) {
+    int result = 0;
+    const size_t bufsize = COPY_BUFFER_SIZE / 2;
+    char *buf_a = NULL;
+    char *buf_b = NULL;
+    FILE *fp_a = fopen(a, "rb");
+    FILE *fp_b = fopen(b, "rb");
+    if (!fp_a || !fp_b) {
+        goto done;
+    }
+    buf_a = malloc(bufsize);
+    buf_b = malloc(bufsize);
+    if (!buf_a || !buf_b) {
+        goto done;
+    }
+
+    while (1) {
+        const size_t len_a = fread(buf_a, 1, bufsize, fp_a);
+        const size_t len_b = fread(buf_b, 1, bufsize, fp_b);
+        if (len_a != len_b || memcmp(buf_a, buf_b, len_a) != 0) {
+            break;
+        }
+        if (!len_a) {
+            result = 1;
+            break;
+        }
+    }
+
+    done:
+    guard_free(buf_a);
+    guard_free(buf_b);
+    if (fp_a) {
+        fclose(fp_a);
+    }
+    if (fp_b) {
+        fclose(fp_b);
+    }
+    return result;
+}
+
+static int sync_up_to_date(const struct SyncEntry *entry, const char *dest_path, const struct stat *st, unsigned flags) {
+    if ((entry->mode & S_IFMT) != (st->st_mode & S_IFMT)) {
+        return 0;
+    }
+    if (S_ISLNK(entry->mode)) {
+        char target_src[PATH_MAX] = {0};
+        char target_dest[PATH_MAX] = {0};
+        if (readlink(entry->src, target_src, sizeof(target_src) - 1) < 0
+            || readlink(dest_path, target_dest, sizeof(target_dest) - 1) < 0) {
+            return 0;
+        }
+        return strcmp(target_src, target_dest) == 0;
+    }
+    if (!S_ISREG(entry->mode)) {
+        return 0;
+    }
+    if (flags & SYNC_LINK && entry->dev == st->st_dev && entry->ino == st->st_ino) {
+        // Already a hard link to the source
+        return 1;
+    }
+    if (entry->size != st->st_size) {
+        return 0;
+    }
+    if (flags & SYNC_CHECKSUM) {
+        return sync_same_contents(entry->src, dest_path);
+    }
+    // Whole seconds, like rsync's default modify window
+    return entry->mtime.tv_sec == st->st_mtim.tv_sec;
+}
+
+/**
+ * Reserve a temporary name (.NAME.XXXXXX) in the directory of `path`
+ * @return 0 on success, -1 on error
+ */
+static int sync_temp_name(char *result, const size_t maxlen, const char *path) {
+    const char *name = strrchr(path, '/');
+    const int dirlen = name ? (int) (name - path + 1) : 0;
+    name = name ? name + 1 : path;
+    if (snprintf(result, maxlen, "%.*s.%s.XXXXXX", dirlen, path, name) >= (int) maxlen) {
+        *result = '\0';
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    const int fd = mkstemp(result);
+    if (fd < 0) {
+        *result = '\0';
+        return -1;
+    }
+    close(fd);
+    // copy2 creates links and special files itself, so only the name is kept
+    unlink(result);
+    return 0;
+}
+
+static void *sync_worker(void *arg) {
+    struct SyncPool *pool = arg;
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->next >= pool->num_jobs) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        const struct SyncJob *job = &pool->jobs[pool->next++];
+        pthread_mutex_unlock(&pool->lock);
+
+        const struct SyncEntry *entry = &pool->plan->entries[job->entry];
+        char dest_path[PATH_MAX];
+        sync_join(dest_path, sizeof(dest_path), pool->dest, strlist_item(pool->plan->paths, job->entry));
+
+        int status = 0;
+        enum CopyMethod method = COPY_METHOD_NONE;
+        // Transfer to a temporary name next to the destination, and replace the
+        // destination only when that succeeds
+        char tmp_path[PATH_MAX];
+        if (sync_temp_name(tmp_path, sizeof(tmp_path), dest_path)) {
+            SYSERROR("unable to create temporary file for %s: %s", dest_path, strerror(errno));
+            status = -1;
+        } else if (pool->flags & SYNC_LINK && S_ISREG(entry->mode) && link(entry->src, tmp_path) == 0) {
+            // Shares the source's modification time
+            method = COPY_METHOD_HARDLINK;
+        } else if (copy2_ex(entry->src, tmp_path, CT_PERM, &method)) {
+            SYSERROR("unable to copy %s to %s: %s", entry->src, dest_path, strerror(errno));
+            status = -1;
+        } else if (!S_ISLNK(entry->mode)) {
+            const struct timespec times[2] = {
+                {.tv_sec = 0, .tv_nsec = UTIME_OMIT},
+                entry->mtime,
+            };
+            if (utimensat(AT_FDCWD, tmp_path, times, AT_SYMLINK_NOFOLLOW) < 0) {
+                SYSWARN("unable to set modification time: %s, %s", dest_path, strerror(errno));
+            }
+        }
+        if (!status && rename(tmp_path, dest_path) < 0) {
+            SYSERROR("unable to replace %s: %s", dest_path, strerror(errno));
+            status = -1;
+        }
+        if (*tmp_path) {
+            // Left behind on failure, or when the destination was already a link to the same file
+            unlink(tmp_path);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (status) {
+            pool->status = -1;
+        } else {
+            pool->files_copied++;
+            if (method == COPY_METHOD_HARDLINK) {
+                pool->files_linked++;
+            } else if (S_ISREG(entry->mode)) {
+                pool->bytes_copied += (size_t) entry->size;
+            }
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+static size_t sync_jobs(const struct SyncOptions *opts) {
+    if (opts->jobs) {
+        return opts->jobs;
+    }
+    if (globals.cpu_limit > 0) {
+        return (size_t) globals.cpu_limit;
+    }
+    const long cpu_count = get_cpu_count();
+    return cpu_count > 0 ? (size_t) cpu_count : 1;
+}
+
+/**
+ * Copy files listed in `jobs` with a pool of threads
+ * @return 0 on success, -1 on error
+ */
+static int sync_copy(const struct SyncPlan *plan, const char *dest, const struct SyncJob *jobs, size_t num_jobs, const struct SyncOptions *opts, struct SyncStats *stats) {
+    struct SyncPool pool = {
+        .plan = plan,
+        .dest = dest,
+        .jobs = jobs,
+        .num_jobs = num_jobs,
+        .flags = opts->flags,
+    };
+    if (!num_jobs) {
+        return 0;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+
+    size_t num_threads = sync_jobs(opts);
+    if (num_threads > num_jobs) {
+        num_threads = num_jobs;
+    }
+    pthread_t *threads = calloc(num_threads, sizeof(*threads));
+    size_t started = 0;
+    for (size_t i = 0; threads && i < num_threads; i++) {
+        if (pthread_create(&threads[i], NULL, sync_worker, &pool)) {
+            break;
+        }
+        started++;
+    }
+    if (!started) {
+        // Couldn't start any threads. Do the work here instead.
+        sync_worker(&pool);
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    guard_free(threads);
+    pthread_mutex_destroy(&pool.lock);
+
+    stats->files_copied += pool.files_copied;
+    stats->files_linked += pool.files_linked;
+    stats->bytes_copied += pool.bytes_copied;
+    return pool.status;
+}
+
+int sync_trees(char **srcs, size_t count, const char *dest, const struct SyncOptions *opts, struct SyncStats *stats) {
+    struct SyncOptions opts_default = {0};
+    struct SyncStats stats_local = {0};
+    struct SyncPlan plan = {0};
+    struct SyncJob *jobs = NULL;
+    size_t num_jobs = 0;
+    int status = 0;
+
+    if (!opts) {
+        opts = &opts_default;
+    }
+    if (!stats) {
+        stats = &stats_local;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    if (!srcs || isempty((char *) dest)) {
+        SYSERROR("source and destination paths are required");
+        return -1;
+    }
+
+    plan.paths = strlist_init_mode(STRLIST_MODE_INTERN);
+    if (!plan.paths) {
+        SYSERROR("unable to allocate memory for file list");
+        return -1;
+    }
+
+    // Gather source records. Symbolic links are followed at the top level only.
+    for (size_t i = 0; i < count && !status; i++) {
+        struct stat st;
+        if (stat(srcs[i], &st) < 0) {
+            SYSERROR("%s: %s", srcs[i], strerror(errno));
+            status = -1;
+            break;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            const int fd = open(srcs[i], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0) {
+                SYSERROR("%s: %s", srcs[i], strerror(errno));
+                status = -1;
+                break;
+            }
+            status = sync_walk(&plan, fd, srcs[i], NULL, opts);
+        } else {
+            // Copy the file a top-level link points to, under the link's name
+            char name[PATH_MAX] = {0};
+            char target[PATH_MAX] = {0};
+            safe_strncpy(name, srcs[i], sizeof(name));
+            if (!realpath(srcs[i], target)) {
+                SYSERROR("%s: %s", srcs[i], strerror(errno));
+                status = -1;
+                break;
+            }
+            status = sync_plan_add(&plan, path_basename(name), target, &st);
+        }
+    }
+    if (status) {
+        goto cleanup;
+    }
+
+    if (access(dest, F_OK) < 0) {
+        if (mkdirs(dest, 0755)) {
+            SYSERROR("unable to create directory: %s, %s", dest, strerror(errno));
+            status = -1;
+            goto cleanup;
+        }
+        stats->dirs_created++;
+    } else if (opts->flags & SYNC_DELETE) {
+        // Clear the way for records that no longer exist, or changed type
+        const int fd = open(dest, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            SYSERROR("%s: %s", dest, strerror(errno));
+            status = -1;
+            goto cleanup;
+        }
+        const int deleted = sync_delete(&plan, fd, dest, NULL, opts);
+        if (deleted < 0) {
+            status = -1;
+            goto cleanup;
+        }
+        stats->files_deleted += (size_t) deleted;
+    }
+
+    const size_t total = strlist_count(plan.paths);
+    jobs = calloc(total + 1, sizeof(*jobs));
+    if (!jobs) {
+        SYSERROR("unable to allocate memory for copy jobs");
+        status = -1;
+        goto cleanup;
+    }
+
+    // Create directories (parents are always recorded before their contents),
+    // and decide which files need to be copied
+    for (size_t i = 0; i < total; i++) {
+        const struct SyncEntry *entry = &plan.entries[i];
+        const char *rel = strlist_item(plan.paths, i);
+        char dest_path[PATH_MAX];
+        sync_join(dest_path, sizeof(dest_path), dest, rel);
+
+        struct stat st;
+        const int exists = lstat(dest_path, &st) == 0;
+        if (exists && (S_ISDIR(st.st_mode) != S_ISDIR(entry->mode))) {
+            // Type changed (only possible without SYNC_DELETE)
+            const int removed = S_ISDIR(st.st_mode) ? rmtree(dest_path) : unlink(dest_path);
+            if (removed < 0) {
+                SYSERROR("unable to remove %s: %s", dest_path, strerror(errno));
+                status = -1;
+                goto cleanup;
+            }
+            stats->files_deleted++;
+        } else if (exists && S_ISDIR(entry->mode)) {
+            continue;
+        } else if (exists && sync_up_to_date(entry, dest_path, &st, opts->flags)) {
+            stats->files_skipped++;
+            continue;
+        }
+
+        if (S_ISDIR(entry->mode)) {
+            if (mkdir(dest_path, (entry->mode & 07777) | S_IRWXU) < 0 && errno != EEXIST) {
+                SYSERROR("unable to create directory: %s, %s", dest_path, strerror(errno));
+                status = -1;
+                goto cleanup;
+            }
+            stats->dirs_created++;
+            continue;
+        }
+
+        if (opts->flags & SYNC_VERBOSE) {
+            printf("%s\n", rel);
+        }
+        jobs[num_jobs++].entry = i;
+    }
+
+    status = sync_copy(&plan, dest, jobs, num_jobs, opts, stats);
+
+    // Apply directory permissions and times last, because populating a
+    // directory changes its modification time
+    for (size_t i = total; i > 0; i--) {
+        const struct SyncEntry *entry = &plan.entries[i - 1];
+        if (!S_ISDIR(entry->mode)) {
+            continue;
+        }
+        char dest_path[PATH_MAX];
+        sync_join(dest_path, sizeof(dest_path), dest, strlist_item(plan.paths, i - 1));
+        const struct timespec times[2] = {
+            {.tv_sec = 0, .tv_nsec = UTIME_OMIT},
+            entry->mtime,
+        };
+        chmod(dest_path, entry->mode & 07777);
+        utimensat(AT_FDCWD, dest_path, times, 0);
+    }
+
+    cleanup:
+    guard_free(jobs);
+    sync_plan_free(&plan);
+    return status;
+}
+
+int sync_tree(const char *src, const char *dest, const struct SyncOptions *opts, struct SyncStats *stats) {
+    char *srcs[] = {(char *) src, NULL};
+    return sync_trees(srcs, 1, dest, opts, stats);
+}
@@ -1,5 +1,39 @@
 #include "system.h"
 #include "core.h"
+#include "trace.h"
+
+/**
+ * Name a program's trace span after its command line's program and subcommand
+ *
+ * Options and later arguments are left out because they may contain credentials.
+ */
+static void shell_trace_name(char *dest, const size_t maxlen, const char *command) {
+    size_t len = 0;
+    int words = 0;
+    dest[0] = '\0';
+    while (*command && words < 2) {
+        while (isspace((unsigned char) *command)) {
+            command++;
+        }
+        const char *word = command;
+        while (*command && !isspace((unsigned char) *command)) {
+            command++;
+        }
+        if (command == word || (words && *word == '-')) {
+            break;
+        }
+        if (!words) {
+            // Drop the program's directory
+            for (const char *ch = word; ch < command; ch++) {
+                if (*ch == '/') {
+                    word = ch + 1;
+                }
+            }
+        }
+        len += snprintf(dest + len, len < maxlen ? maxlen - len : 0, "%s%.*s", words ? " " : "", (int) (command - word), word);
+        words++;
+    }
+}
 
 int shell(struct Process *proc, char *args) {
     struct Process selfproc;
@@ -41,6 +75,12 @@ int shell(struct Process *proc, char *args) {
         SYSWARN("unable to change script permissions: %s, %s", t_name, strerror(errno));
     }
 
+    char trace_name[STASIS_NAME_MAX] = {0};
+    if (trace_enabled()) {
+        shell_trace_name(trace_name, sizeof(trace_name), args);
+    }
+    const long long trace_start = trace_now();
+
     pid_t pid = fork();
     if (pid == -1) {
         SYSERROR("fork failed");
@@ -107,6 +147,7 @@ int shell(struct Process *proc, char *args) {
         } else {
             SYSERROR("waitpid() failed");
         }
+        trace_complete(TRACE_CAT_EXEC, trace_name, (long) pid, trace_start, trace_now());
     }
 
     if (!access(t_name, F_OK)) {
@@ -153,41 +194,426 @@ int shell_safe(struct Process *proc, char *args) {
     return result;
 }
 
-char *shell_output(const char *command, int *status) {
-    const size_t initial_size = STASIS_BUFSIZ;
-    size_t current_size = initial_size;
-    char *result = NULL;
-    char line[STASIS_BUFSIZ];
+/// Minimum number of bytes to request from a pipe per read(2)
+#define SHELL_CAPTURE_READ_MIN 4096
 
-    errno = 0;
-    *status = 0;
-    FILE *pp = popen(command, "r");
-    if (!pp) {
-        *status = -1;
+/// Milliseconds to sleep between checks on processes without open pipes
+#define SHELL_WAIT_INTERVAL 10
+
+/// Milliseconds an abandoned process is given to exit after SIGTERM, before SIGKILL
+#define SHELL_KILL_TIMEOUT 1000
+
+static int capture_buffer_init(char **data, size_t *len, size_t *alloc) {
+    *alloc = STASIS_BUFSIZ;
+    *len = 0;
+    *data = calloc(*alloc, sizeof(**data));
+    if (!*data) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Read available data from `fd` into `data`, doubling its size as needed
+ * @return bytes read, 0 on EOF, -1 on error
+ */
+static ssize_t capture_buffer_read(char **data, size_t *len, size_t *alloc, int fd) {
+    if (*alloc - *len - 1 < SHELL_CAPTURE_READ_MIN) {
+        const size_t alloc_new = *alloc * 2;
+        char *tmp = realloc(*data, alloc_new);
+        if (!tmp) {
+            return -1;
+        }
+        *data = tmp;
+        *alloc = alloc_new;
+    }
+
+    ssize_t nread;
+    do {
+        nread = read(fd, *data + *len, *alloc - *len - 1);
+    } while (nread < 0 && errno == EINTR);
+
+    if (nread > 0) {
+        *len += (size_t) nread;
+    }
+    (*data)[*len] = '\0';
+    return nread;
+}
+
+static int pipe_cloexec(int fds[2]) {
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+}
+
+static void close_fd(int *fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static void close_pipe(int fds[2]) {
+    close_fd(&fds[0]);
+    close_fd(&fds[1]);
+}
+
+void shell_capture_free(struct ProcessOutput *output) {
+    if (!output) {
+        return;
+    }
+    guard_free(output->out);
+    guard_free(output->err);
+    output->out_len = 0;
+    output->err_len = 0;
+}
+
+struct ProcessHandle *shell_spawn(char *const argv[], unsigned flags) {
+    int fd_out[2] = {-1, -1};
+    int fd_err[2] = {-1, -1};
+    const int capture_stdout = !(flags & SHELL_CAPTURE_NONE);
+    const int capture_merge = capture_stdout && (flags & SHELL_CAPTURE_MERGE);
+    const int capture_stderr = (flags & SHELL_CAPTURE_STDERR) && !capture_merge;
+
+    if (!argv || !argv[0]) {
+        return NULL;
+    }
+
+    struct ProcessHandle *handle = calloc(1, sizeof(*handle));
+    if (!handle) {
+        SYSERROR("unable to allocate process handle");
+        return NULL;
+    }
+    handle->fd_out = -1;
+    handle->fd_err = -1;
+    handle->output.status = -1;
+    handle->returncode = -1;
+
+    if (capture_stdout && capture_buffer_init(&handle->output.out, &handle->output.out_len, &handle->out_alloc)) {
+        SYSERROR("unable to allocate output buffer");
+        shell_handle_free(&handle);
+        return NULL;
+    }
+    if (capture_stderr && capture_buffer_init(&handle->output.err, &handle->output.err_len, &handle->err_alloc)) {
+        SYSERROR("unable to allocate output buffer");
+        shell_handle_free(&handle);
+        return NULL;
+    }
+
+    if ((capture_stdout && pipe_cloexec(fd_out)) || (capture_stderr && pipe_cloexec(fd_err))) {
+        SYSERROR("unable to create pipe: %s", strerror(errno));
+        close_pipe(fd_out);
+        close_pipe(fd_err);
+        shell_handle_free(&handle);
+        return NULL;
+    }
+
+    if (trace_enabled()) {
+        // Name "sh -c" commands after the script instead of the shell
+        const int is_script = argv[1] && !strcmp(argv[1], "-c") && argv[2];
+        char command[STASIS_NAME_MAX] = {0};
+        snprintf(command, sizeof(command), "%s %s", is_script ? argv[2] : argv[0], is_script || !argv[1] ? "" : argv[1]);
+        shell_trace_name(handle->trace_name, sizeof(handle->trace_name), command);
+    }
+    handle->trace_start = trace_now();
+
+    const pid_t pid = fork();
+    if (pid == -1) {
+        SYSERROR("fork failed: %s", strerror(errno));
+        close_pipe(fd_out);
+        close_pipe(fd_err);
+        shell_handle_free(&handle);
         return NULL;
     }
 
-    if (errno) {
-        *status = 1;
-    }
-    result = calloc(initial_size, sizeof(result));
-    memset(line, 0, sizeof(line));
-    while (fread(line, sizeof(char), sizeof(line) - 1, pp) != 0) {
-        size_t result_len = strlen(result);
-        size_t need_realloc = (result_len + strlen(line)) > current_size;
-        if (need_realloc) {
-            current_size += initial_size;
-            char *tmp = realloc(result, sizeof(*result) * current_size);
-            if (!tmp) {
-                pclose(pp);
-                guard_free(result);
-                return NULL;
+    if (pid == 0) {
+        if (capture_stdout && dup2(fd_out[1], STDOUT_FILENO) < 0) {
+            _exit(127);
+        }
+        if (capture_merge && dup2(fd_out[1], STDERR_FILENO) < 0) {
+            _exit(127);
+        }
+        if (capture_stderr && dup2(fd_err[1], STDERR_FILENO) < 0) {
+            _exit(127);
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    // Only the child writes to the pipes
+    close_fd(&fd_out[1]);
+    close_fd(&fd_err[1]);
+    handle->pid = pid;
+    handle->fd_out = fd_out[0];
+    handle->fd_err = fd_err[0];
+    return handle;
+}
+
+/**
+ * Record the wait status of a finished process
+ */
+static void shell_handle_finish(struct ProcessHandle *handle, int status) {
+    handle->finished = 1;
+    handle->output.status = status;
+    if (handle->failed) {
+        handle->returncode = -1;
+    } else if (WIFSIGNALED(status)) {
+        handle->returncode = 128 + WTERMSIG(status);
+    } else {
+        handle->returncode = WEXITSTATUS(status);
+    }
+    trace_complete(TRACE_CAT_EXEC, handle->trace_name, (long) handle->pid, handle->trace_start, trace_now());
+}
+
+/**
+ * Reap a process whose pipes have been closed
+ * @return 1 if the process finished, 0 if it is still running, -1 on error
+ */
+static int shell_handle_reap(struct ProcessHandle *handle, int block) {
+    int status = 0;
+    pid_t result;
+    do {
+        result = waitpid(handle->pid, &status, block ? 0 : WNOHANG);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        SYSERROR("waitpid() failed: %s", strerror(errno));
+        handle->failed = 1;
+        shell_handle_finish(handle, -1);
+        return -1;
+    }
+    if (result == 0) {
+        return 0;
+    }
+    shell_handle_finish(handle, status);
+    return 1;
+}
+
+/**
+ * Drain the pipes of all unfinished processes and reap the ones that exited
+ *
+ * Output from every process is consumed concurrently, so a process blocked on
+ * a full pipe can't stall the others.
+ *
+ * @return number of processes that finished, or -1 on error
+ */
+static int shell_pump(struct ProcessHandle *handles[], size_t count) {
+    struct pollfd *pfd = calloc(count * 2 + 1, sizeof(*pfd));
+    if (!pfd) {
+        SYSERROR("unable to allocate poll descriptors");
+        return -1;
+    }
+
+    size_t nfds = 0;
+    int timeout = -1;
+    for (size_t i = 0; i < count; i++) {
+        struct ProcessHandle *handle = handles[i];
+        if (!handle || handle->finished) {
+            continue;
+        }
+        if (handle->fd_out < 0 && handle->fd_err < 0) {
+            // Nothing to read. The process must be checked periodically instead.
+            timeout = SHELL_WAIT_INTERVAL;
+            continue;
+        }
+        if (handle->fd_out >= 0) {
+            pfd[nfds++] = (struct pollfd) {.fd = handle->fd_out, .events = POLLIN};
+        }
+        if (handle->fd_err >= 0) {
+            pfd[nfds++] = (struct pollfd) {.fd = handle->fd_err, .events = POLLIN};
+        }
+    }
+
+    if (nfds || timeout >= 0) {
+        if (poll(pfd, nfds, timeout) < 0 && errno != EINTR) {
+            SYSERROR("poll failed: %s", strerror(errno));
+            guard_free(pfd);
+            return -1;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        struct ProcessHandle *handle = handles[i];
+        if (!handle || handle->finished) {
+            continue;
+        }
+        for (size_t p = 0; p < nfds; p++) {
+            if (!pfd[p].revents) {
+                continue;
+            }
+            int *fd = NULL;
+            ssize_t nread = 0;
+            if (pfd[p].fd == handle->fd_out) {
+                fd = &handle->fd_out;
+                nread = capture_buffer_read(&handle->output.out, &handle->output.out_len, &handle->out_alloc, *fd);
+            } else if (pfd[p].fd == handle->fd_err) {
+                fd = &handle->fd_err;
+                nread = capture_buffer_read(&handle->output.err, &handle->output.err_len, &handle->err_alloc, *fd);
+            } else {
+                continue;
+            }
+            if (nread < 0) {
+                SYSERROR("unable to read output of pid %d: %s", handle->pid, strerror(errno));
+                handle->failed = 1;
+            }
+            if (nread <= 0) {
+                close_fd(fd);
+            }
+        }
+    }
+    guard_free(pfd);
+
+    int finished = 0;
+    for (size_t i = 0; i < count; i++) {
+        struct ProcessHandle *handle = handles[i];
+        if (!handle || handle->finished || handle->fd_out >= 0 || handle->fd_err >= 0) {
+            continue;
+        }
+        if (shell_handle_reap(handle, 0) != 0) {
+            finished++;
+        }
+    }
+    return finished;
+}
+
+int shell_wait(struct ProcessHandle *handle) {
+    if (!handle) {
+        return -1;
+    }
+    while (!handle->finished) {
+        if (handle->fd_out < 0 && handle->fd_err < 0) {
+            shell_handle_reap(handle, 1);
+            break;
+        }
+        if (shell_pump(&handle, 1) < 0) {
+            return -1;
+        }
+    }
+    return handle->returncode;
+}
+
+struct ProcessHandle *shell_wait_any(struct ProcessHandle *handles[], size_t count) {
+    if (!handles) {
+        return NULL;
+    }
+    while (1) {
+        size_t pending = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!handles[i]) {
+                continue;
             }
-            result = tmp;
+            if (handles[i]->finished) {
+                return handles[i];
+            }
+            pending++;
+        }
+        if (!pending || shell_pump(handles, count) < 0) {
+            return NULL;
         }
-        safe_strncat(result, line, current_size);
-        memset(line, 0, sizeof(line));
     }
-    *status = pclose(pp);
+}
+
+int shell_wait_all(struct ProcessHandle *handles[], size_t count) {
+    if (!handles) {
+        return -1;
+    }
+    while (1) {
+        size_t pending = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (handles[i] && !handles[i]->finished) {
+                pending++;
+            }
+        }
+        if (!pending) {
+            break;
+        }
+        if (shell_pump(handles, count) < 0) {
+            return -1;
+        }
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (handles[i] && handles[i]->returncode) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Terminate and reap a running process
+ *
+ * A process that ignores SIGTERM, or doesn't exit within SHELL_KILL_TIMEOUT,
+ * is killed.
+ */
+static void shell_handle_terminate(struct ProcessHandle *handle) {
+    kill(handle->pid, SIGTERM);
+    close_fd(&handle->fd_out);
+    close_fd(&handle->fd_err);
+    for (int waited = 0; waited < SHELL_KILL_TIMEOUT; waited += SHELL_WAIT_INTERVAL) {
+        if (shell_handle_reap(handle, 0) != 0) {
+            return;
+        }
+        usleep(SHELL_WAIT_INTERVAL * 1000);
+    }
+    kill(handle->pid, SIGKILL);
+    shell_handle_reap(handle, 1);
+}
+
+void shell_handle_free(struct ProcessHandle **handle) {
+    if (!handle || !*handle) {
+        return;
+    }
+    struct ProcessHandle *h = *handle;
+    if (h->pid > 0 && !h->finished) {
+        // Abandoned processes are terminated to avoid leaving zombies behind
+        shell_handle_terminate(h);
+    }
+    close_fd(&h->fd_out);
+    close_fd(&h->fd_err);
+    shell_capture_free(&h->output);
+    guard_free(*handle);
+}
+
+int shell_capture(char *const argv[], struct ProcessOutput *output, unsigned flags) {
+    if (!output) {
+        return -1;
+    }
+    memset(output, 0, sizeof(*output));
+    output->status = -1;
+
+    struct ProcessHandle *handle = shell_spawn(argv, flags);
+    if (!handle) {
+        return -1;
+    }
+    const int result = shell_wait(handle);
+    if (result >= 0) {
+        // Transfer ownership of the captured output to the caller
+        *output = handle->output;
+        memset(&handle->output, 0, sizeof(handle->output));
+    }
+    shell_handle_free(&handle);
     return result;
 }
+
+char *shell_output(const char *command, int *status) {
+    struct ProcessOutput proc;
+    *status = 0;
+
+    if (!command) {
+        *status = -1;
+        return calloc(1, sizeof(char));
+    }
+
+    char *argv[] = {"/bin/sh", "-c", (char *) command, NULL};
+    if (shell_capture(argv, &proc, 0) < 0) {
+        *status = -1;
+        return NULL;
+    }
+    *status = proc.status;
+    return proc.out;
+}
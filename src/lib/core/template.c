@@ -19,6 +19,15 @@ unsigned tpl_pool_used = 0;
 struct tplfunc_frame *tpl_pool_func[1024] = {0};
 unsigned tpl_pool_func_used = 0;
 
+struct tpl_cache_item {
+    size_t hash;
+    char *key;
+    char *value;
+};
+struct tpl_cache_item *tpl_cache = NULL;
+size_t tpl_cache_used = 0;
+size_t tpl_cache_alloc = 0;
+
 extern void tpl_reset() {
     SYSDEBUG("Resetting template engine");
     tpl_free();
@@ -26,7 +35,81 @@ extern void tpl_reset() {
     tpl_pool_func_used = 0;
 }
 
+/**
+ * Produce a cache key from a function name and its (stripped) arguments
+ * @param name function name
+ * @param params NULL terminated array of arguments
+ * @return cache key, or NULL on error
+ */
+static char *tpl_cache_key(const char *name, char **params) {
+    size_t len = strlen(name) + 1;
+    for (size_t i = 0; params[i] != NULL; i++) {
+        len += strlen(params[i]) + 1;
+    }
+
+    char *key = calloc(len + 1, sizeof(*key));
+    if (!key) {
+        return NULL;
+    }
+    strcat(key, name);
+    for (size_t i = 0; params[i] != NULL; i++) {
+        // Unit separator can't appear in a template argument
+        strcat(key, "\x1f");
+        strcat(key, params[i]);
+    }
+    return key;
+}
+
+static const char *tpl_cache_get(const char *key) {
+    const size_t hash = strhash(key, strlen(key));
+    for (size_t i = 0; i < tpl_cache_used; i++) {
+        if (tpl_cache[i].hash == hash && !strcmp(tpl_cache[i].key, key)) {
+            return tpl_cache[i].value;
+        }
+    }
+    return NULL;
+}
+
+static int tpl_cache_put(const char *key, const char *value) {
+    if (tpl_cache_used + 1 > tpl_cache_alloc) {
+        const size_t alloc = tpl_cache_alloc ? tpl_cache_alloc * 2 : 16;
+        struct tpl_cache_item *tmp = realloc(tpl_cache, alloc * sizeof(*tpl_cache));
+        if (!tmp) {
+            SYSERROR("unable to grow template function cache: %s", strerror(errno));
+            return -1;
+        }
+        tpl_cache = tmp;
+        tpl_cache_alloc = alloc;
+    }
+
+    struct tpl_cache_item *item = &tpl_cache[tpl_cache_used];
+    item->key = strdup(key);
+    item->value = strdup(value);
+    if (!item->key || !item->value) {
+        guard_free(item->key);
+        guard_free(item->value);
+        return -1;
+    }
+    item->hash = strhash(key, strlen(key));
+    tpl_cache_used++;
+    return 0;
+}
+
+void tpl_cache_clear() {
+    for (size_t i = 0; i < tpl_cache_used; i++) {
+        guard_free(tpl_cache[i].key);
+        guard_free(tpl_cache[i].value);
+    }
+    guard_free(tpl_cache);
+    tpl_cache_used = 0;
+    tpl_cache_alloc = 0;
+}
+
 void tpl_register_func(char *key, tplfunc *tplfunc_ptr, int argc, void *data_in) {
+    tpl_register_func_ex(key, tplfunc_ptr, argc, data_in, 0);
+}
+
+void tpl_register_func_ex(char *key, tplfunc *tplfunc_ptr, int argc, void *data_in, unsigned flags) {
     struct tplfunc_frame *frame = calloc(1, sizeof(*frame));
     if (!frame) {
         SYSERROR("unable to allocate memory for function frame");
@@ -41,7 +124,8 @@ void tpl_register_func(char *key, tplfunc *tplfunc_ptr, int argc, void *data_in)
     frame->argc = argc;
     frame->func = tplfunc_ptr;
     frame->data_in = data_in;
-    SYSDEBUG("Registering function:\n\tkey=%s\n\targc=%d\n\tfunc=%p\n\tdata_in=%p", frame->key, frame->argc, frame->func, frame->data_in);
+    frame->flags = flags;
+    SYSDEBUG("Registering function:\n\tkey=%s\n\targc=%d\n\tfunc=%p\n\tdata_in=%p\n\tflags=%#x", frame->key, frame->argc, frame->func, frame->data_in, frame->flags);
 
     tpl_pool_func[tpl_pool_func_used] = frame;
     tpl_pool_func_used++;
@@ -124,6 +208,7 @@ void tpl_free() {
         SYSDEBUG("freeing template item: %p", item);
         guard_free(item);
     }
+    tpl_cache_clear();
 }
 
 char *tpl_getval(char *key) {
@@ -272,14 +357,34 @@ char *tpl_render(char *str) {
                         strip(params[p]);
                         frame->argv[p].t_char_ptr = params[p];
                     }
-                    char *func_result = NULL;
-                    int func_status = 0;
-                    if ((func_status = frame->func(frame, &func_result))) {
-                        SYSERROR("%s returned non-zero status: %d", frame->key, func_status);
+
+                    char *cache_key = NULL;
+                    const char *cached = NULL;
+                    if (frame->flags & TPLFUNC_F_PURE) {
+                        cache_key = tpl_cache_key(frame->key, params);
+                        if (cache_key) {
+                            cached = tpl_cache_get(cache_key);
+                        }
+                    }
+
+                    if (cached) {
+                        value = strdup(cached);
+                        SYSDEBUG("Returned from cache: %s\nData OUT\n--------\n'%s'", k, value);
+                    } else {
+                        char *func_result = NULL;
+                        int func_status = 0;
+                        if ((func_status = frame->func(frame, &func_result))) {
+                            SYSERROR("%s returned non-zero status: %d", frame->key, func_status);
+                        }
+                        value = strdup(func_result ? func_result : "");
+                        SYSDEBUG("Returned from function: %s (status: %d)\nData OUT\n--------\n'%s'", k, func_status, value);
+                        // Failures are not memoized so they may be retried by the next render
+                        if (cache_key && !func_status && value) {
+                            tpl_cache_put(cache_key, value);
+                        }
+                        guard_free(func_result);
                     }
-                    value = strdup(func_result ? func_result : "");
-                    SYSDEBUG("Returned from function: %s (status: %d)\nData OUT\n--------\n'%s'", k, func_status, value);
-                    guard_free(func_result);
+                    guard_free(cache_key);
                 }
                 guard_array_free(params);
             } else {
@@ -0,0 +1,115 @@
+#include "trace.h"
+
+static int trace_fd = -1;
+static pid_t trace_pid;
+
+// Copy a JSON string value (without quotes) into dest
+static void trace_escape(char *dest, const size_t maxlen, const char *src) {
+    size_t len = 0;
+    for (const char *ch = src; *ch && len + 7 < maxlen; ch++) {
+        if (*ch == '"' || *ch == '\\') {
+            dest[len++] = '\\';
+            dest[len++] = *ch;
+        } else if ((unsigned char) *ch < ' ') {
+            len += snprintf(dest + len, maxlen - len, "\\u%04x", (unsigned char) *ch);
+        } else {
+            dest[len++] = *ch;
+        }
+    }
+    dest[len] = '\0';
+}
+
+// Append one event to the trace file
+static void trace_event(const char *phase, const char *category, const char *name, const long tid, const long long ts, const long long dur) {
+    char event[STASIS_BUFSIZ] = {0};
+    char category_s[STASIS_NAME_MAX] = {0};
+    char name_s[STASIS_NAME_MAX * 4] = {0};
+
+    trace_escape(category_s, sizeof(category_s), category ? category : "");
+    trace_escape(name_s, sizeof(name_s), name ? name : "");
+    int len = snprintf(event, sizeof(event), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%lld,\"pid\":%ld,\"tid\":%ld",
+        name_s, category_s, phase, ts, (long) trace_pid, tid);
+    if (dur >= 0) {
+        len += snprintf(event + len, sizeof(event) - len, ",\"dur\":%lld", dur);
+    }
+    len += snprintf(event + len, sizeof(event) - len, "}");
+
+    // One write per event keeps records from concurrent processes intact
+    if (write(trace_fd, event, len) != len) {
+        SYSDEBUG("unable to write trace event: %s", strerror(errno));
+    }
+}
+
+int trace_open(const char *filename) {
+    static int registered = 0;
+    trace_close();
+
+    const int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        SYSERROR("%s: %s", filename, strerror(errno));
+        return -1;
+    }
+    trace_fd = fd;
+    trace_pid = getpid();
+
+    // The first event names the main track, so every later event can start with a comma
+    char header[STASIS_NAME_MAX] = {0};
+    const int len = snprintf(header, sizeof(header), "[\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":\"main\"}}",
+        (long) trace_pid, (long) trace_pid);
+    if (write(trace_fd, header, len) != len) {
+        SYSERROR("%s: %s", filename, strerror(errno));
+        close(trace_fd);
+        trace_fd = -1;
+        return -1;
+    }
+
+    if (!registered) {
+        // Terminate the array, however the program exits
+        atexit(trace_close);
+        registered = 1;
+    }
+    return 0;
+}
+
+void trace_close(void) {
+    if (trace_fd < 0 || trace_pid != getpid()) {
+        return;
+    }
+    const char *footer = "\n]\n";
+    if (write(trace_fd, footer, strlen(footer)) < 0) {
+        SYSDEBUG("unable to write trace footer: %s", strerror(errno));
+    }
+    close(trace_fd);
+    trace_fd = -1;
+}
+
+int trace_enabled(void) {
+    return trace_fd >= 0;
+}
+
+long long trace_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void trace_begin(const char *category, const char *name) {
+    if (!trace_enabled()) {
+        return;
+    }
+    trace_event("B", category, name, (long) getpid(), trace_now(), -1);
+}
+
+void trace_end(const char *category, const char *name) {
+    if (!trace_enabled()) {
+        return;
+    }
+    trace_event("E", category, name, (long) getpid(), trace_now(), -1);
+}
+
+void trace_complete(const char *category, const char *name, const long tid, const long long start, const long long end) {
+    if (!trace_enabled()) {
+        return;
+    }
+    trace_event("X", category, name, tid, start, end > start ? end - start : 0);
+}
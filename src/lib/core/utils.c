@@ -1,4 +1,9 @@
 #include <stdarg.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
 #include "core.h"
 #include "utils.h"
 
@@ -32,48 +37,282 @@ int popd() {
     return result;
 }
 
-int rmtree(char *_path) {
-    int status = 0;
-    char path[PATH_MAX] = {0};
-    struct dirent *d_entity;
+/// Upper limit on the number of threads used by rmtree_ex()
+#define RMTREE_JOBS_MAX 16
+// Highest descriptor closed by a detached remover when /proc is unavailable
+#define RMTREE_FD_MAX 65536
 
-    safe_strncpy(path, _path, sizeof(path));
+static int rmtree_contents(int fd, size_t jobs);
 
-    DIR *dir = opendir(path);
-    if (!dir) {
-        return 1;
+/**
+ * Open a directory relative to `parent_fd`, granting ourselves permission to
+ * read it if necessary
+ */
+static int rmtree_open_at(int parent_fd, const char *name) {
+    int fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0 && errno == EACCES && !fchmodat(parent_fd, name, S_IRWXU, 0)) {
+        fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
     }
+    return fd;
+}
 
-    while ((d_entity = readdir(dir)) != NULL) {
-        char abspath[PATH_MAX] = {0};
-        safe_strncat(abspath, path, sizeof(abspath));
-        safe_strncat(abspath, DIR_SEP, sizeof(abspath));
-        safe_strncat(abspath, d_entity->d_name, sizeof(abspath));
+/**
+ * Remove a directory, and everything in it, relative to `parent_fd`
+ */
+static int rmtree_at(int parent_fd, const char *name) {
+    const int fd = rmtree_open_at(parent_fd, name);
+    if (fd < 0) {
+        return -1;
+    }
+    int status = rmtree_contents(fd, 1);
+    if (unlinkat(parent_fd, name, AT_REMOVEDIR) < 0) {
+        status = -1;
+    }
+    return status;
+}
 
-        if (!strcmp(d_entity->d_name, ".") || !strcmp(d_entity->d_name, "..") || !strcmp(abspath, path)) {
-            continue;
+/**
+ * Remove any record relative to `dir_fd`
+ *
+ * Records that aren't known to be directories are unlinked straight away, so
+ * a stat() is never needed to find out what they are.
+ */
+static int rmtree_unlink_at(int dir_fd, const char *name, unsigned char d_type) {
+    if (d_type != DT_DIR) {
+        if (!unlinkat(dir_fd, name, 0) || errno == ENOENT) {
+            return 0;
+        }
+        if (errno == EACCES && !fchmod(dir_fd, S_IRWXU) && !unlinkat(dir_fd, name, 0)) {
+            return 0;
         }
+        // Linux reports EISDIR, POSIX permits EPERM
+        if (errno != EISDIR && errno != EPERM) {
+            return -1;
+        }
+    }
+    return rmtree_at(dir_fd, name);
+}
 
-        // Test for sufficient privilege
-        if (access(abspath, F_OK) < 0 && errno == EACCES) {
+struct RmtreePool {
+    int fd; ///< Parent directory
+    struct StrList *names; ///< Subdirectories to remove
+    size_t next; ///< Next record to hand out
+    int status;
+    pthread_mutex_t lock;
+};
+
+static void *rmtree_worker(void *arg) {
+    struct RmtreePool *pool = arg;
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->next >= strlist_count(pool->names)) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        const char *name = strlist_item(pool->names, pool->next++);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (rmtree_unlink_at(pool->fd, name, DT_DIR)) {
+            pthread_mutex_lock(&pool->lock);
+            pool->status = -1;
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Remove the contents of the directory `fd` (consumed), spreading its
+ * subdirectories across `jobs` threads
+ */
+static int rmtree_contents(int fd, size_t jobs) {
+    DIR *dp = fdopendir(fd);
+    if (!dp) {
+        close(fd);
+        return -1;
+    }
+
+    int status = 0;
+    struct StrList *subdirs = jobs > 1 ? strlist_init() : NULL;
+    struct dirent *rec;
+    while ((rec = readdir(dp)) != NULL) {
+        if (!strcmp(rec->d_name, ".") || !strcmp(rec->d_name, "..")) {
+            continue;
+        }
+        if (subdirs && rec->d_type == DT_DIR) {
+            strlist_append(&subdirs, rec->d_name);
             continue;
         }
+        if (rmtree_unlink_at(dirfd(dp), rec->d_name, rec->d_type)) {
+            status = -1;
+        }
+    }
 
-        // Push directories on to the stack first
-        if (d_entity->d_type == DT_DIR) {
-            rmtree(abspath);
-        } else {
-            remove(abspath);
+    if (strlist_count(subdirs)) {
+        struct RmtreePool pool = {
+            .fd = dirfd(dp),
+            .names = subdirs,
+        };
+        pthread_mutex_init(&pool.lock, NULL);
+        if (jobs > strlist_count(subdirs)) {
+            jobs = strlist_count(subdirs);
+        }
+
+        pthread_t threads[RMTREE_JOBS_MAX];
+        size_t started = 0;
+        for (size_t i = 0; i < jobs && i < RMTREE_JOBS_MAX; i++) {
+            if (pthread_create(&threads[i], NULL, rmtree_worker, &pool)) {
+                break;
+            }
+            started++;
+        }
+        // Lend a hand (or do all the work if no threads could be started)
+        rmtree_worker(&pool);
+        for (size_t i = 0; i < started; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_mutex_destroy(&pool.lock);
+        if (pool.status) {
+            status = -1;
         }
     }
-    closedir(dir);
+    guard_strlist_free(&subdirs);
+    closedir(dp);
+    return status;
+}
 
-    if (access(path, F_OK) == 0) {
-        remove(path);
+static size_t rmtree_jobs() {
+    long jobs = globals.cpu_limit > 0 ? globals.cpu_limit : get_cpu_count();
+    if (jobs < 1) {
+        jobs = 1;
+    }
+    if (jobs > RMTREE_JOBS_MAX) {
+        jobs = RMTREE_JOBS_MAX;
+    }
+    return (size_t) jobs;
+}
+
+/**
+ * Detach a process from the descriptors it inherited
+ *
+ * Standard streams are pointed at /dev/null, and everything else is closed,
+ * so a long-lived child doesn't hold pipes, logs or traces open.
+ */
+static void close_inherited_fds() {
+    const int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+        for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++) {
+            dup2(null_fd, fd);
+        }
+        if (null_fd > STDERR_FILENO) {
+            close(null_fd);
+        }
+    }
+
+    // Avoid allocating here. Another thread may have held the heap lock when we forked.
+    DIR *dp = opendir("/proc/self/fd");
+    if (dp) {
+        const int dp_fd = dirfd(dp);
+        struct dirent *rec;
+        while ((rec = readdir(dp)) != NULL) {
+            if (!isdigit((unsigned char) rec->d_name[0])) {
+                continue;
+            }
+            const int fd = (int) strtol(rec->d_name, NULL, 10);
+            if (fd > STDERR_FILENO && fd != dp_fd) {
+                close(fd);
+            }
+        }
+        closedir(dp);
+        return;
+    }
+
+    long max = sysconf(_SC_OPEN_MAX);
+    if (max < 0 || max > RMTREE_FD_MAX) {
+        max = RMTREE_FD_MAX;
+    }
+    for (int fd = STDERR_FILENO + 1; fd < max; fd++) {
+        close(fd);
+    }
+}
+
+/**
+ * Move a directory into a scratch directory and remove it in a detached process
+ *
+ * The scratch directory is created under `globals.tmpdir`, where nothing
+ * looks for build artifacts, so a half-removed tree can't be mistaken for
+ * output.
+ *
+ * @return 0 on success, -1 if the directory could not be moved (i.e. the
+ * temporary directory is on another file system)
+ */
+static int rmtree_background(const char *path) {
+    if (isempty(globals.tmpdir)) {
+        return -1;
+    }
+    char scratch[PATH_MAX] = {0};
+    char aside[PATH_MAX + 6] = {0};
+    snprintf(scratch, sizeof(scratch), "%s/rmtree-XXXXXX", globals.tmpdir);
+    if (!mkdtemp(scratch)) {
+        return -1;
+    }
+    snprintf(aside, sizeof(aside), "%s/tree", scratch);
+    if (rename(path, aside) < 0) {
+        rmdir(scratch);
+        return -1;
+    }
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        // Couldn't detach. Finish the job here.
+        return rmtree_ex(scratch, RMTREE_PARALLEL) ? -1 : 0;
+    }
+    if (pid == 0) {
+        // Fork again so the remover is adopted by init, and never becomes our zombie
+        if (fork() == 0) {
+            close_inherited_fds();
+            const int status = rmtree_ex(scratch, RMTREE_PARALLEL);
+            _exit(status ? 1 : 0);
+        }
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+    return 0;
+}
+
+int rmtree_ex(const char *path, unsigned flags) {
+    struct stat st;
+
+    if (isempty((char *) path)) {
+        return -1;
+    }
+    if (lstat(path, &st) < 0) {
+        return 1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        // Not a directory (or a symbolic link to one, which is never followed)
+        return -1;
+    }
+
+    if ((flags & RMTREE_BACKGROUND) && !rmtree_background(path)) {
+        return 0;
+    }
+
+    const int fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    int status = rmtree_contents(fd, flags & RMTREE_PARALLEL ? rmtree_jobs() : 1);
+    if (rmdir(path) < 0) {
+        status = -1;
     }
     return status;
 }
 
+int rmtree(char *_path) {
+    return rmtree_ex(_path, 0);
+}
+
 char *expandpath(const char *_path) {
     if (_path == NULL) {
         return NULL;
@@ -424,22 +663,19 @@ char *git_rev_parse(const char *path, char *args) {
 }
 
 void msg(unsigned type, char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-
     FILE *stream = NULL;
     char header[255];
     char status[20];
+    const char *color = NULL;
+    const char *level = NULL;
 
     if (type & STASIS_MSG_NOP) {
         // quiet mode
-        va_end(args);
         return;
     }
 
     if (!globals.verbose && type & STASIS_MSG_RESTRICT) {
         // Verbose mode is not active
-        va_end(args);
         return;
     }
 
@@ -447,18 +683,20 @@ void msg(unsigned type, char *fmt, ...) {
     memset(status, 0, sizeof(status));
 
     stream = stdout;
-    fprintf(stream, "%s", STASIS_COLOR_RESET);
     if (type & STASIS_MSG_ERROR) {
         // for error output
         stream = stderr;
-        fprintf(stream, "%s", STASIS_COLOR_RED);
+        color = STASIS_COLOR_RED;
+        level = "ERROR";
         safe_strncpy(status, " ERROR: ", sizeof(status));
     } else if (type & STASIS_MSG_WARN) {
         stream = stderr;
-        fprintf(stream, "%s", STASIS_COLOR_YELLOW);
+        color = STASIS_COLOR_YELLOW;
+        level = "WARNING";
         safe_strncpy(status, " WARNING: ", sizeof(status));
     } else {
-        fprintf(stream, "%s", STASIS_COLOR_GREEN);
+        color = STASIS_COLOR_GREEN;
+        level = "INFO";
         safe_strncpy(status, " ", sizeof(status));
     }
 
@@ -470,22 +708,39 @@ void msg(unsigned type, char *fmt, ...) {
         snprintf(header, sizeof(header), STASIS_COLOR_BLUE "  ->%s" STASIS_COLOR_RESET, status);
     }
 
-    if (fprintf(stream, "%s", header) < 0) {
-        SYSERROR("unable to write message header to stream");
+    // Assemble the whole line so concurrent writers can't interleave it
+    char line[STASIS_BUFSIZ];
+    char *data = line;
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (len < 0) {
+        SYSERROR("unable to format message");
         return;
     }
+    const size_t prefix_len = strlen(STASIS_COLOR_RESET) + strlen(color) + strlen(header);
+    const size_t total = prefix_len + (size_t) len + strlen(STASIS_COLOR_RESET) + 1;
+    if (total > sizeof(line)) {
+        data = malloc(total);
+        if (!data) {
+            SYSERROR("unable to allocate message buffer");
+            return;
+        }
+    }
+    snprintf(data, total, "%s%s%s", STASIS_COLOR_RESET, color, header);
+    va_start(args, fmt);
+    vsnprintf(data + prefix_len, total - prefix_len, fmt, args);
+    va_end(args);
+    log_sink_record(level, NULL, data + prefix_len, NULL);
+    strcat(data + prefix_len + len, STASIS_COLOR_RESET);
 
-    const int len = vfprintf(stream, fmt, args);
-    if (len < 0) {
+    if (fwrite(data, 1, total - 1, stream) != total - 1) {
         SYSERROR("unable to write message to stream");
-        return;
     }
-
-    if (fprintf(stream, "%s", STASIS_COLOR_RESET) < 0) {
-        SYSERROR("unable to write message footer to stream");
-        return;
+    if (data != line) {
+        guard_free(data);
     }
-    va_end(args);
 }
 
 void debug_shell() {
@@ -665,6 +920,44 @@ int xml_pretty_print_in_place(const char *filename, const char *pretty_print_pro
     return status;
 }
 
+int xml_format_in_place(const char *filename) {
+    // Equivalent to "xmllint --format": ignorable whitespace is dropped so the serializer can indent
+    xmlDocPtr doc = xmlReadFile(filename, NULL, XML_PARSE_NOBLANKS | XML_PARSE_NONET | XML_PARSE_HUGE);
+    if (!doc) {
+        SYSERROR("unable to parse XML: %s", filename);
+        return -1;
+    }
+
+    char tempfile[PATH_MAX] = {0};
+    snprintf(tempfile, sizeof(tempfile), "%s.XXXXXX", filename);
+    int fd = mkstemp(tempfile);
+    if (fd < 0) {
+        SYSERROR("unable to create temporary file: %s: %s", tempfile, strerror(errno));
+        xmlFreeDoc(doc);
+        return -1;
+    }
+    close(fd);
+
+    struct stat st;
+    const int have_mode = stat(filename, &st) == 0;
+    const int written = xmlSaveFormatFile(tempfile, doc, 1);
+    xmlFreeDoc(doc);
+    if (written < 0) {
+        SYSERROR("unable to write XML: %s", tempfile);
+        remove(tempfile);
+        return -1;
+    }
+    if (have_mode) {
+        chmod(tempfile, st.st_mode & 07777);
+    }
+    if (rename(tempfile, filename) < 0) {
+        SYSERROR("unable to replace %s: %s", filename, strerror(errno));
+        remove(tempfile);
+        return -1;
+    }
+    return 0;
+}
+
 /**
  *
  * @param filename /path/to/tox.ini
@@ -847,8 +1140,7 @@ struct StrList *listdir(const char *path) {
             closedir(dp);
             return NULL;
         }
-        strlist_append(&node, fullpath);
-        guard_free(fullpath);
+        strlist_append_nocopy(&node, fullpath);
     }
     strlist_sort(node, STASIS_SORT_ALPHA);
     closedir(dp);
@@ -131,9 +131,346 @@ int version_parse_operator(const char *str) {
     return result;
 }
 
-static int version_has_epoch(const char *str) {
-    const char *result = strchr(str, ':');
-    return result ? 1 : 0;
+static const struct {
+    const char *key;
+    int type;
+} VERSION_PRE_TAGS[] = {
+    // Longer spellings first
+    {.key = "alpha", VERSION_PRE_ALPHA},
+    {.key = "a", VERSION_PRE_ALPHA},
+    {.key = "beta", VERSION_PRE_BETA},
+    {.key = "b", VERSION_PRE_BETA},
+    {.key = "preview", VERSION_PRE_RC},
+    {.key = "pre", VERSION_PRE_RC},
+    {.key = "rc", VERSION_PRE_RC},
+    {.key = "c", VERSION_PRE_RC},
+};
+
+static const char *VERSION_POST_TAGS[] = {"post", "rev", "r"};
+
+static int version_is_separator(const char ch) {
+    return ch == '.' || ch == '-' || ch == '_';
+}
+
+/**
+ * Match a case-insensitive tag at `str`, optionally preceded by a separator
+ * @return pointer to the character following the tag, or NULL
+ */
+static const char *version_match_tag(const char *str, const char *tag) {
+    if (version_is_separator(*str)) {
+        str++;
+    }
+    const size_t len = strlen(tag);
+    if (strncasecmp(str, tag, len) != 0 || isalpha((unsigned char) str[len])) {
+        return NULL;
+    }
+    return str + len;
+}
+
+static int version_read_number(const char **str, unsigned long long *result) {
+    if (!isdigit((unsigned char) **str)) {
+        return -1;
+    }
+    char *end = NULL;
+    errno = 0;
+    *result = strtoull(*str, &end, 10);
+    if (errno) {
+        return -1;
+    }
+    *str = end;
+    return 0;
+}
+
+/**
+ * Read the optional number following a pre, post or dev tag (i.e. "rc1", "rc.1", "rc")
+ */
+static int version_read_tag_number(const char **str, unsigned long long *result) {
+    *result = 0;
+    if (version_is_separator(**str) && isdigit((unsigned char) (*str)[1])) {
+        (*str)++;
+    }
+    if (isdigit((unsigned char) **str)) {
+        return version_read_number(str, result);
+    }
+    return 0;
+}
+
+static int version_key_byte(struct Version *version, const unsigned char value) {
+    if (version->key_len >= version->key_alloc) {
+        return -1;
+    }
+    version->key[version->key_len++] = value;
+    return 0;
+}
+
+static int version_key_number(struct Version *version, const unsigned long long value) {
+    // Big-endian, so the bytes compare in the same order as the numbers
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        if (version_key_byte(version, (unsigned char) (value >> shift))) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Generate the sort key of a parsed version
+ *
+ * Every field is encoded so that memcmp orders keys as PEP 440 orders
+ * versions. Absent fields are encoded with a marker that sorts before or
+ * after any value, as the specification requires.
+ */
+static int version_make_key(struct Version *version) {
+    int status = 0;
+    version->key_len = 0;
+    status |= version_key_number(version, version->epoch);
+
+    // Trailing zeros are insignificant: 1.0 == 1.0.0
+    size_t release_count = version->release_count;
+    while (release_count > 1 && !version->release[release_count - 1]) {
+        release_count--;
+    }
+    for (size_t i = 0; i < release_count; i++) {
+        status |= version_key_byte(version, 1);
+        status |= version_key_number(version, version->release[i]);
+    }
+    status |= version_key_byte(version, 0);
+
+    // Pre-release. A development release of a final release sorts before its pre-releases.
+    int pre_type = version->pre_type;
+    if (pre_type == VERSION_PRE_NONE) {
+        pre_type = version->has_dev && !version->has_post ? -1 : VERSION_PRE_RC + 1;
+    }
+    status |= version_key_byte(version, (unsigned char) (pre_type + 1));
+    status |= version_key_number(version, version->pre);
+
+    // Post-release. Absent sorts first.
+    status |= version_key_byte(version, version->has_post ? 1 : 0);
+    status |= version_key_number(version, version->post);
+
+    // Development release. Absent sorts last.
+    status |= version_key_byte(version, version->has_dev ? 0 : 1);
+    status |= version_key_number(version, version->dev);
+
+    // Local version label. Absent sorts first. Numeric segments sort after alphanumeric segments.
+    if (*version->local) {
+        status |= version_key_byte(version, 1);
+        const char *pos = version->local;
+        while (*pos) {
+            const size_t len = strcspn(pos, ".");
+            int numeric = 1;
+            for (size_t i = 0; i < len; i++) {
+                numeric &= isdigit((unsigned char) pos[i]) != 0;
+            }
+            if (numeric) {
+                unsigned long long value = 0;
+                const char *num = pos;
+                status |= version_read_number(&num, &value);
+                status |= version_key_byte(version, 2);
+                status |= version_key_number(version, value);
+            } else {
+                status |= version_key_byte(version, 1);
+                for (size_t i = 0; i < len; i++) {
+                    status |= version_key_byte(version, (unsigned char) pos[i]);
+                }
+                status |= version_key_byte(version, 0);
+            }
+            pos += len;
+            if (*pos) {
+                pos++;
+            }
+        }
+    }
+    status |= version_key_byte(version, 0);
+    return status ? -1 : 0;
+}
+
+/**
+ * Copy a local version label, lowercased, with separators normalized to '.'
+ * @return pointer to the character following the label
+ */
+static const char *version_read_local(struct Version *version, const char *str) {
+    size_t len = 0;
+    while (isalnum((unsigned char) *str) || version_is_separator(*str)) {
+        const char ch = version_is_separator(*str) ? '.' : (char) tolower((unsigned char) *str);
+        str++;
+        // Collapse repeated separators, and drop leading or trailing ones
+        if (ch == '.' && (!len || version->local[len - 1] == '.')) {
+            continue;
+        }
+        version->local[len++] = ch;
+    }
+    while (len && version->local[len - 1] == '.') {
+        len--;
+    }
+    version->local[len] = '\0';
+    return str;
+}
+
+static int version_parse_fields(struct Version *result, const char *str) {
+    const char *pos = str;
+    while (isspace((unsigned char) *pos)) {
+        pos++;
+    }
+    if (*pos == 'v' || *pos == 'V') {
+        pos++;
+    }
+
+    // Epoch and release
+    unsigned long long value = 0;
+    if (version_read_number(&pos, &value)) {
+        return -1;
+    }
+    if ((*pos == '!' || *pos == ':') && isdigit((unsigned char) pos[1])) {
+        result->epoch = value;
+        pos++;
+        if (version_read_number(&pos, &value)) {
+            return -1;
+        }
+    }
+    result->release[result->release_count++] = value;
+    while (*pos == '.' && isdigit((unsigned char) pos[1])) {
+        pos++;
+        if (version_read_number(&pos, &result->release[result->release_count++])) {
+            return -1;
+        }
+    }
+
+    // Pre-release
+    for (size_t i = 0; i < sizeof(VERSION_PRE_TAGS) / sizeof(*VERSION_PRE_TAGS); i++) {
+        const char *next = version_match_tag(pos, VERSION_PRE_TAGS[i].key);
+        if (next) {
+            result->pre_type = VERSION_PRE_TAGS[i].type;
+            pos = next;
+            if (version_read_tag_number(&pos, &result->pre)) {
+                return -1;
+            }
+            break;
+        }
+    }
+
+    // Post-release (1.0-1 is an implicit post-release)
+    if (*pos == '-' && isdigit((unsigned char) pos[1])) {
+        pos++;
+        result->has_post = 1;
+        if (version_read_number(&pos, &result->post)) {
+            return -1;
+        }
+    } else {
+        for (size_t i = 0; i < sizeof(VERSION_POST_TAGS) / sizeof(*VERSION_POST_TAGS); i++) {
+            const char *next = version_match_tag(pos, VERSION_POST_TAGS[i]);
+            if (next) {
+                result->has_post = 1;
+                pos = next;
+                if (version_read_tag_number(&pos, &result->post)) {
+                    return -1;
+                }
+                break;
+            }
+        }
+    }
+
+    // Development release
+    const char *next = version_match_tag(pos, "dev");
+    if (next) {
+        result->has_dev = 1;
+        pos = next;
+        if (version_read_tag_number(&pos, &result->dev)) {
+            return -1;
+        }
+    }
+
+    // Local version label. Unrecognized trailing segments are treated the same way.
+    if (*pos == '+' || isalnum((unsigned char) *pos) || version_is_separator(*pos)) {
+        if (*pos == '+') {
+            pos++;
+        }
+        pos = version_read_local(result, pos);
+    }
+
+    return version_make_key(result);
+}
+
+int version_parse(struct Version *result, const char *str) {
+    memset(result, 0, sizeof(*result));
+    if (!str) {
+        return -1;
+    }
+
+    // Each character of the input adds at most one release segment, one local
+    // label character, and nine key bytes to the fixed-size fields
+    const size_t len = strlen(str);
+    result->release = calloc(len + 1, sizeof(*result->release));
+    result->local = calloc(len + 1, sizeof(*result->local));
+    result->key_alloc = 38 + len * 9;
+    result->key = calloc(result->key_alloc, sizeof(*result->key));
+    if (!result->release || !result->local || !result->key || version_parse_fields(result, str)) {
+        version_free(result);
+        return -1;
+    }
+    return 0;
+}
+
+void version_free(struct Version *version) {
+    guard_free(version->release);
+    guard_free(version->local);
+    guard_free(version->key);
+    version->release_count = 0;
+    version->key_len = 0;
+    version->key_alloc = 0;
+}
+
+int version_cmp(const struct Version *a, const struct Version *b) {
+    const size_t len = a->key_len < b->key_len ? a->key_len : b->key_len;
+    const int result = memcmp(a->key, b->key, len);
+    if (result) {
+        return result;
+    }
+    if (a->key_len == b->key_len) {
+        return 0;
+    }
+    return a->key_len < b->key_len ? -1 : 1;
+}
+
+struct VersionSortRecord {
+    struct Version version;
+    char *str;
+    int valid;
+};
+
+// qsort callback to sort parsed versions. Invalid versions sort last.
+static int version_sort_cmpfn(const void *a, const void *b) {
+    const struct VersionSortRecord *aa = a;
+    const struct VersionSortRecord *bb = b;
+    if (aa->valid != bb->valid) {
+        return aa->valid ? -1 : 1;
+    }
+    if (!aa->valid) {
+        return strcmp(aa->str, bb->str);
+    }
+    const int result = version_cmp(&aa->version, &bb->version);
+    return result ? result : strcmp(aa->str, bb->str);
+}
+
+int version_sort(char **arr, const size_t count) {
+    if (!arr || !count) {
+        return 0;
+    }
+    struct VersionSortRecord *records = calloc(count, sizeof(*records));
+    if (!records) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        records[i].str = arr[i];
+        records[i].valid = !version_parse(&records[i].version, arr[i]);
+    }
+    qsort(records, count, sizeof(*records), version_sort_cmpfn);
+    for (size_t i = 0; i < count; i++) {
+        arr[i] = records[i].str;
+        version_free(&records[i].version);
+    }
+    guard_free(records);
+    return 0;
 }
 
 /**
@@ -149,37 +486,34 @@ int version_compare(const int flags, const char *aa, const char *bb) {
         return -1;
     }
 
-    int result_a = version_sum(aa);
-    if (result_a < 0) {
+    struct Version version_a;
+    if (version_parse(&version_a, aa)) {
         return -1;
     }
 
-    int result_b = version_sum(bb);
-    if (result_b < 0) {
+    struct Version version_b;
+    if (version_parse(&version_b, bb)) {
+        version_free(&version_a);
         return -1;
     }
 
-    if (version_has_epoch(aa) && !version_has_epoch(bb)) {
-        result_a -= EPOCH_MOD;
-    }
-    if (!version_has_epoch(aa) && version_has_epoch(bb)) {
-        result_b -= EPOCH_MOD;
-    }
-
+    const int cmp = version_cmp(&version_a, &version_b);
+    version_free(&version_a);
+    version_free(&version_b);
     int result = 0;
     if (flags & GT && flags & EQ) {
-        result |= result_a >= result_b;
+        result |= cmp >= 0;
     } else if (flags & LT && flags & EQ) {
-        result |= result_a <= result_b;
+        result |= cmp <= 0;
     } else if (flags & NOT && flags & EQ) {
-        result |= result_a != result_b;
+        result |= cmp != 0;
     } else if (flags & GT) {
-        result |= result_a > result_b;
+        result |= cmp > 0;
     } else if (flags & LT) {
-        result |= result_a < result_b;
+        result |= cmp < 0;
     } else if (flags & EQ) {
-        result |= result_a == result_b;
+        result |= cmp == 0;
     }
 
     return result;
-}
\ No newline at end of file
+}
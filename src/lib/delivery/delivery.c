@@ -72,6 +72,12 @@ void delivery_autoresolve_vcs_urls(const char *srcdir) {
                     exit(1);
                 }
 
+                struct ReplaceRule *rules = calloc(strlist_count(matches), sizeof(*rules));
+                if (!rules) {
+                    SYSERROR("unable to allocate bytes for replacement rules");
+                    exit(1);
+                }
+                size_t rules_count = 0;
                 for (size_t m = 0; m < strlist_count(matches); m++) {
                     const char *match = strlist_item(matches, m);
                     // copy the original match string
@@ -83,17 +89,27 @@ void delivery_autoresolve_vcs_urls(const char *srcdir) {
 
                     // Truncate the replacement string at the first space character or @ symbol
                     char *stop = strpbrk(replacement, " @");
+                    if (!stop) {
+                        guard_free(replacement);
+                        continue;
+                    }
                     SYSDEBUG("Found delimiter '%c'", *stop);
+                    *stop = '\0';
+                    printf("[%s] Replacing '%s' with '%s'\n", setup_file, match, replacement);
+                    rules[rules_count].target = match;
+                    rules[rules_count].replacement = replacement;
+                    rules_count++;
+                }
 
-                    if (stop) {
-                        *stop = '\0';
-                        printf("[%s] Replacing '%s' with '%s'\n", setup_file, match, replacement);
-                        if (file_replace_text(setup_file, match, replacement, 0)) {
-                            SYSERROR("%s: replacement failed", setup_file);
-                            exit(1);
-                        }
-                    }
-                    guard_free(replacement);
+                // All records are replaced in a single pass over the file
+                const int status = file_replace_text_ex(setup_file, rules, rules_count);
+                for (size_t r = 0; r < rules_count; r++) {
+                    free((char *) rules[r].replacement);
+                }
+                guard_free(rules);
+                if (status) {
+                    SYSERROR("%s: replacement failed", setup_file);
+                    exit(1);
                 }
             }
         }
@@ -177,11 +193,12 @@ struct Delivery *delivery_duplicate(struct Delivery *ctx) {
 
     // Runtime
     if (ctx->runtime.environ) {
-        result->runtime.environ = runtime_copy(ctx->runtime.environ->data);
+        result->runtime.environ = runtime_copy(runtime_envp(ctx->runtime.environ));
     }
 
     // Storage
     result->storage.tools_dir = strdup_maybe(ctx->storage.tools_dir);
+    result->storage.cache_dir = strdup_maybe(ctx->storage.cache_dir);
     result->storage.package_dir = strdup_maybe(ctx->storage.package_dir);
     result->storage.results_dir = strdup_maybe(ctx->storage.results_dir);
     result->storage.output_dir = strdup_maybe(ctx->storage.output_dir);
@@ -227,6 +244,7 @@ struct Delivery *delivery_duplicate(struct Delivery *ctx) {
     // Docker
     result->deploy.docker.build_args = strlist_copy(ctx->deploy.docker.build_args);
     result->deploy.docker.tags = strlist_copy(ctx->deploy.docker.tags);
+    result->deploy.docker.dockerignore = strlist_copy(ctx->deploy.docker.dockerignore);
     result->deploy.docker.capabilities = ctx->deploy.docker.capabilities;
     result->deploy.docker.dockerfile = strdup_maybe(ctx->deploy.docker.dockerfile);
     result->deploy.docker.image_compression = strdup_maybe(ctx->deploy.docker.image_compression);
@@ -289,7 +307,7 @@ struct Delivery *delivery_duplicate(struct Delivery *ctx) {
         result->tests->test[i]->repository_info_tag = strdup_maybe(ctx->tests->test[i]->repository_info_tag);
         result->tests->test[i]->repository_remove_tags = strlist_copy(ctx->tests->test[i]->repository_remove_tags);
         if (ctx->tests->test[i]->runtime->environ) {
-            result->tests->test[i]->runtime->environ = runtime_copy(ctx->tests->test[i]->runtime->environ->data);
+            result->tests->test[i]->runtime->environ = runtime_copy(runtime_envp(ctx->tests->test[i]->runtime->environ));
         }
         result->tests->test[i]->script = strdup_maybe(ctx->tests->test[i]->script);
         result->tests->test[i]->script_setup = strdup_maybe(ctx->tests->test[i]->script_setup);
@@ -314,6 +332,7 @@ void delivery_free(struct Delivery *ctx) {
     guard_free(ctx->storage.tmpdir);
     guard_free(ctx->storage.delivery_dir);
     guard_free(ctx->storage.tools_dir);
+    guard_free(ctx->storage.cache_dir);
     guard_free(ctx->storage.package_dir);
     guard_free(ctx->storage.results_dir);
     guard_free(ctx->storage.output_dir);
@@ -371,6 +390,7 @@ void delivery_free(struct Delivery *ctx) {
     guard_free(ctx->deploy.docker.image_compression);
     guard_strlist_free(&ctx->deploy.docker.tags);
     guard_strlist_free(&ctx->deploy.docker.build_args);
+    guard_strlist_free(&ctx->deploy.docker.dockerignore);
 
     for (size_t i = 0; i < sizeof(ctx->deploy.jfrog) / sizeof(ctx->deploy.jfrog[0]); i++) {
         guard_free(ctx->deploy.jfrog[i].repo);
@@ -482,6 +502,16 @@ void delivery_defer_packages(struct Delivery *ctx, int type) {
 
     msg(STASIS_MSG_L2, "Filtering %s packages by test definition...\n", mode);
 
+    // Test names are compared in their normalized form
+    for (size_t x = 0; x < ctx->tests->num_used; x++) {
+        normalize_namespace_package_name(ctx->tests->test[x]->name);
+    }
+    struct TestIndex tests;
+    if (tests_index_init(&tests, ctx->tests)) {
+        SYSERROR("unable to index %s package tests", mode);
+        exit(1);
+    }
+
     struct StrList *filtered = NULL;
     filtered = strlist_init();
     for (size_t i = 0; i < strlist_count(dataptr); i++) {
@@ -513,75 +543,69 @@ void delivery_defer_packages(struct Delivery *ctx, int type) {
         msg(STASIS_MSG_L3, "package '%s': ", package_name);
 
         // When spec is present in name, set tests->version to the version detected in the name
-        for (size_t x = 0; x < ctx->tests->num_used; x++) {
-            struct Test *test = ctx->tests->test[x];
-            normalize_namespace_package_name(test->name);
-
-            char nametmp[STASIS_NAME_MAX] = {0};
-
-            safe_strncpy(nametmp, package_name, sizeof(nametmp));
-
-            // Is the [test:NAME] in the package name?
-            if (!strcmp(nametmp, test->name)) {
-                // Override test->version when a version is provided by the (pip|conda)_package list item
-                guard_free(test->version);
-                if (spec_begin && spec_end) {
-                    char *version_at = strrchr(spec_end, '@');
-                    if (version_at) {
-                        if (strlen(version_at)) {
-                            version_at++;
-                        }
-                        test->version = strdup(version_at);
-                    } else {
-                        test->version = strdup(spec_end);
+        char nametmp[STASIS_NAME_MAX] = {0};
+
+        safe_strncpy(nametmp, package_name, sizeof(nametmp));
+
+        // Is the [test:NAME] in the package name?
+        struct Test *test = tests_index_find(&tests, nametmp);
+        if (test) {
+            // Override test->version when a version is provided by the (pip|conda)_package list item
+            guard_free(test->version);
+            if (spec_begin && spec_end) {
+                char *version_at = strrchr(spec_end, '@');
+                if (version_at) {
+                    if (strlen(version_at)) {
+                        version_at++;
                     }
+                    test->version = strdup(version_at);
                 } else {
-                    // There are too many possible default branches nowadays: master, main, develop, xyz, etc.
-                    // HEAD is a safe bet.
-                    test->version = strdup("HEAD");
+                    test->version = strdup(spec_end);
                 }
+            } else {
+                // There are too many possible default branches nowadays: master, main, develop, xyz, etc.
+                // HEAD is a safe bet.
+                test->version = strdup("HEAD");
+            }
 
-                // Is the list item a git+schema:// URL?
-                // TODO: nametmp is just the name so this will never work. but do we want it to? this looks like
-                // TODO:     an unsafe feature. We shouldn't be able to change what's in the config. we should
-                // TODO:     be getting what we asked for, or exit the program with an error.
-                if (strstr(nametmp, "git+") && strstr(nametmp, "://")) {
-                    char *xrepo = strstr(nametmp, "+");
-                    if (xrepo) {
-                        xrepo++;
-                        guard_free(test->repository);
-                        test->repository = strdup(xrepo);
-                        xrepo = NULL;
-                    }
-                    // Extract the name of the package
-                    char *xbasename = path_basename(nametmp);
-                    if (xbasename) {
-                        // Replace the git+schema:// URL with the package name
-                        strlist_set(&dataptr, i, xbasename);
-                        name = strlist_item(dataptr, i);
-                    }
+            // Is the list item a git+schema:// URL?
+            // TODO: nametmp is just the name so this will never work. but do we want it to? this looks like
+            // TODO:     an unsafe feature. We shouldn't be able to change what's in the config. we should
+            // TODO:     be getting what we asked for, or exit the program with an error.
+            if (strstr(nametmp, "git+") && strstr(nametmp, "://")) {
+                char *xrepo = strstr(nametmp, "+");
+                if (xrepo) {
+                    xrepo++;
+                    guard_free(test->repository);
+                    test->repository = strdup(xrepo);
+                    xrepo = NULL;
                 }
-
-                int upstream_exists = 0;
-                if (DEFER_PIP == type) {
-                    upstream_exists = pkg_index_provides(PKG_USE_PIP, PYPI_INDEX_DEFAULT, name, ctx->storage.tmpdir);
-                } else if (DEFER_CONDA == type) {
-                    upstream_exists = pkg_index_provides(PKG_USE_CONDA, NULL, name, ctx->storage.tmpdir);
+                // Extract the name of the package
+                char *xbasename = path_basename(nametmp);
+                if (xbasename) {
+                    // Replace the git+schema:// URL with the package name
+                    strlist_set(&dataptr, i, xbasename);
+                    name = strlist_item(dataptr, i);
                 }
+            }
 
-                if (PKG_INDEX_PROVIDES_FAILED(upstream_exists)) {
-                    SYSERROR("%s's existence command failed for '%s': %s",
-                            mode, name, pkg_index_provides_strerror(upstream_exists));
-                    exit(1);
-                }
+            int upstream_exists = 0;
+            if (DEFER_PIP == type) {
+                upstream_exists = pkg_index_provides(PKG_USE_PIP, PYPI_INDEX_DEFAULT, name, ctx->storage.tmpdir);
+            } else if (DEFER_CONDA == type) {
+                upstream_exists = pkg_index_provides(PKG_USE_CONDA, NULL, name, ctx->storage.tmpdir);
+            }
 
-                if (upstream_exists == PKG_NOT_FOUND) {
-                    build_for_host = 1;
-                } else {
-                    build_for_host = 0;
-                }
+            if (PKG_INDEX_PROVIDES_FAILED(upstream_exists)) {
+                SYSERROR("%s's existence command failed for '%s': %s",
+                        mode, name, pkg_index_provides_strerror(upstream_exists));
+                exit(1);
+            }
 
-                break;
+            if (upstream_exists == PKG_NOT_FOUND) {
+                build_for_host = 1;
+            } else {
+                build_for_host = 0;
             }
         }
 
@@ -612,24 +636,38 @@ void delivery_defer_packages(struct Delivery *ctx, int type) {
     if (filtered) {
         strlist_free(&filtered);
     }
+    tests_index_free(&tests);
 }
 
 int delivery_gather_tool_versions(struct Delivery *ctx) {
-    int status_tool_version = 0;
-    int status_tool_build_version = 0;
+    char *tool_version_argv[] = {"conda", "--version", NULL};
+    char *tool_build_version_argv[] = {"conda", "build", "--version", NULL};
+    char **result[] = {
+        &ctx->conda.tool_version,
+        &ctx->conda.tool_build_version,
+    };
+
+    // The queries are independent, so run them concurrently
+    struct ProcessHandle *procs[] = {
+        shell_spawn(tool_version_argv, 0),
+        shell_spawn(tool_build_version_argv, 0),
+    };
+    const size_t count = sizeof(procs) / sizeof(*procs);
+    int status = shell_wait_all(procs, count) != 0;
 
     // Extract version from tool output
-    ctx->conda.tool_version = shell_output("conda --version", &status_tool_version);
-    if (ctx->conda.tool_version)
-        strip(ctx->conda.tool_version);
-
-    ctx->conda.tool_build_version = shell_output("conda build --version", &status_tool_build_version);
-    if (ctx->conda.tool_build_version)
-        strip(ctx->conda.tool_version);
-
-    if (status_tool_version || status_tool_build_version) {
-        return 1;
+    for (size_t i = 0; i < count; i++) {
+        if (!procs[i]) {
+            status = 1;
+            continue;
+        }
+        *result[i] = procs[i]->output.out;
+        procs[i]->output.out = NULL;
+        if (*result[i]) {
+            strip(*result[i]);
+        }
+        shell_handle_free(&procs[i]);
     }
-    return 0;
+    return status;
 }
 
@@ -57,7 +57,12 @@ int delivery_artifact_upload(struct Delivery *ctx) {
         if (!ctx->deploy.jfrog[i].files || !ctx->deploy.jfrog[i].dest) {
             break;
         }
+        // Keep the configured thread count
+        const int threads = ctx->deploy.jfrog[i].upload_ctx.threads;
         jfrt_upload_init(&ctx->deploy.jfrog[i].upload_ctx);
+        if (threads > 0) {
+            ctx->deploy.jfrog[i].upload_ctx.threads = threads;
+        }
 
         if (!globals.jfrog.repo) {
             SYSWARN("Artifactory repository path is not configured!");
@@ -78,8 +83,11 @@ int delivery_artifact_upload(struct Delivery *ctx) {
         }
 
         ctx->deploy.jfrog[i].upload_ctx.workaround_parent_only = true;
-        ctx->deploy.jfrog[i].upload_ctx.build_name = ctx->info.build_name;
-        ctx->deploy.jfrog[i].upload_ctx.build_number = ctx->info.build_number;
+        if (globals.enable_artifactory_build_info) {
+            // Unchanged files are uploaded too, so the build info lists every artifact
+            ctx->deploy.jfrog[i].upload_ctx.build_name = ctx->info.build_name;
+            ctx->deploy.jfrog[i].upload_ctx.build_number = ctx->info.build_number;
+        }
 
         if (jfrog_cli_rt_ping(&ctx->deploy.jfrog_auth)) {
             SYSERROR("Unable to contact artifactory server: %s", ctx->deploy.jfrog_auth.url);
@@ -87,13 +95,40 @@ int delivery_artifact_upload(struct Delivery *ctx) {
         }
 
         if (strlist_count(ctx->deploy.jfrog[i].files)) {
+            // Upload every file of this target with one jf process
+            struct JFRT_UploadFiles *files = jfrt_upload_files_init();
+            if (!files) {
+                SYSERROR("Unable to allocate upload list");
+                return -1;
+            }
+            char dest[PATH_MAX] = {0};
+            snprintf(dest, sizeof(dest), "%s/%s", ctx->deploy.jfrog[i].repo, ctx->deploy.jfrog[i].dest);
+            char manifest[PATH_MAX] = {0};
+            if (ctx->deploy.jfrog[i].skip_unchanged && ctx->storage.cache_dir && ctx->deploy.jfrog_auth.url) {
+                // Files uploaded by earlier builds are recorded per server
+                char server[SHA256_HEX_SIZE] = {0};
+                unsigned char digest[SHA256_DIGEST_SIZE] = {0};
+                struct SHA256 sha;
+                sha256_init(&sha);
+                sha256_update(&sha, ctx->deploy.jfrog_auth.url, strlen(ctx->deploy.jfrog_auth.url));
+                sha256_final(&sha, digest);
+                sha256_hex(digest, server);
+                snprintf(manifest, sizeof(manifest), "%s/artifactory/%s", ctx->storage.cache_dir, server);
+                ctx->deploy.jfrog[i].upload_ctx.manifest = manifest;
+                ctx->deploy.jfrog[i].upload_ctx.manifest_verify = ctx->deploy.jfrog[i].verify_unchanged;
+            }
             for (size_t f = 0; f < strlist_count(ctx->deploy.jfrog[i].files); f++) {
-                char dest[PATH_MAX] = {0};
-                char files[PATH_MAX] = {0};
-                snprintf(dest, sizeof(dest), "%s/%s", ctx->deploy.jfrog[i].repo, ctx->deploy.jfrog[i].dest);
-                snprintf(files, sizeof(files), "%s", strlist_item(ctx->deploy.jfrog[i].files, f));
-                status += jfrog_cli_rt_upload(&ctx->deploy.jfrog_auth, &ctx->deploy.jfrog[i].upload_ctx, files, dest);
+                const char *pattern = strlist_item(ctx->deploy.jfrog[i].files, f);
+                if (jfrt_upload_files_add(files, &ctx->deploy.jfrog[i].upload_ctx, pattern, dest) < 0) {
+                    SYSERROR("Unable to collect files to upload: %s", pattern);
+                    status++;
+                }
             }
+            msg(STASIS_MSG_L2, "Uploading %zu file(s) to %s\n", files->num_used, dest);
+            const int failed = jfrog_cli_rt_upload_files(&ctx->deploy.jfrog_auth, &ctx->deploy.jfrog[i].upload_ctx, files);
+            status += failed < 0 ? 1 : failed;
+            ctx->deploy.jfrog[i].upload_ctx.manifest = NULL;
+            jfrt_upload_files_free(&files);
         }
     }
 
@@ -58,24 +58,32 @@ int delivery_build_recipes(struct Delivery *ctx) {
                 snprintf(recipe_buildno, sizeof(recipe_buildno), "  number: 0");
 
                 unsigned flags = REPLACE_TRUNCATE_AFTER_MATCH;
+                const char *recipe_file = NULL;
+                struct ReplaceRule rules[4] = {0};
+                size_t rules_count = 0;
                 if (recipe_build_system == RECIPE_BUILD_CONDA_BUILD) {
+                    recipe_file = "meta.yaml";
                     if (ctx->meta.final) { // remove this. i.e. statis cannot deploy a release to conda-forge
                         snprintf(recipe_version, sizeof(recipe_version), "{%% set version = \"%s\" %%}", ctx->tests->test[i]->version);
                         // TODO: replace sha256 of tagged archive
                         // TODO: leave the recipe unchanged otherwise. in theory this should produce the same conda package hash as conda forge.
                         // For now, remove the sha256 requirement
-                        file_replace_text("meta.yaml", "sha256:", "\n", flags);
+                        rules[rules_count++] = (struct ReplaceRule) {"sha256:", "\n", flags};
                     } else {
-                        file_replace_text("meta.yaml", "{% set version = ", recipe_version, flags);
-                        file_replace_text("meta.yaml", "  url:", recipe_git_url, flags);
-                        file_replace_text("meta.yaml", "  sha256:", "\n", flags);
-                        file_replace_text("meta.yaml", "  number:", recipe_buildno, flags);
+                        rules[rules_count++] = (struct ReplaceRule) {"{% set version = ", recipe_version, flags};
+                        rules[rules_count++] = (struct ReplaceRule) {"  url:", recipe_git_url, flags};
+                        rules[rules_count++] = (struct ReplaceRule) {"  sha256:", "\n", flags};
+                        rules[rules_count++] = (struct ReplaceRule) {"  number:", recipe_buildno, flags};
                     }
                 } else if (recipe_build_system == RECIPE_BUILD_RATTLER) {
-                    file_replace_text("recipe.yaml", "  version:", ctx->tests->test[i]->version, flags);
-                    file_replace_text("recipe.yaml", "  url:", recipe_git_url, flags);
-                    file_replace_text("recipe.yaml", "  sha256:", "\n", flags);
-                    file_replace_text("recipe.yaml", "  number:", recipe_buildno, flags);
+                    recipe_file = "recipe.yaml";
+                    rules[rules_count++] = (struct ReplaceRule) {"  version:", ctx->tests->test[i]->version, flags};
+                    rules[rules_count++] = (struct ReplaceRule) {"  url:", recipe_git_url, flags};
+                    rules[rules_count++] = (struct ReplaceRule) {"  sha256:", "\n", flags};
+                    rules[rules_count++] = (struct ReplaceRule) {"  number:", recipe_buildno, flags};
+                }
+                if (recipe_file && file_replace_text_ex(recipe_file, rules, rules_count)) {
+                    SYSERROR("%s: unable to update recipe", recipe_file);
                 }
 
                 char command[PATH_MAX];
@@ -145,8 +153,10 @@ int filter_repo_tags(char *repo, struct StrList *patterns) {
     int result = 0;
 
     if (!pushd(repo)) {
-        int list_status = 0;
-        char *tags_raw = shell_output("git tag -l", &list_status);
+        struct ProcessOutput list_proc = {0};
+        char *list_argv[] = {"git", "tag", "-l", NULL};
+        shell_capture(list_argv, &list_proc, 0);
+        char *tags_raw = list_proc.out;
         struct StrList *tags = strlist_init();
         strlist_append_tokenize(tags, tags_raw, LINE_SEP);
 
@@ -406,6 +416,12 @@ struct StrList *delivery_build_wheels(struct Delivery *ctx) {
         return NULL;
     }
 
+    struct TestIndex tests;
+    if (tests_index_init(&tests, ctx->tests)) {
+        guard_strlist_free(&result);
+        return NULL;
+    }
+
     for (size_t p = 0; p < strlist_count(ctx->conda.pip_packages_defer); p++) {
         char name[100] = {0};
         char *fullspec = strlist_item(ctx->conda.pip_packages_defer, p);
@@ -416,111 +432,120 @@ struct StrList *delivery_build_wheels(struct Delivery *ctx) {
             *spec = '\0';
         }
 
-        for (size_t i = 0; i < ctx->tests->num_used; i++) {
-            if ((ctx->tests->test[i]->name && !strcmp(name, ctx->tests->test[i]->name)) && (!ctx->tests->test[i]->build_recipe && ctx->tests->test[i]->repository)) { // build from source
-                char srcdir[PATH_MAX];
-                char wheeldir[PATH_MAX];
-                memset(srcdir, 0, sizeof(srcdir));
-                memset(wheeldir, 0, sizeof(wheeldir));
-
-                msg(STASIS_MSG_L2, "Building %s (%s)\n", ctx->tests->test[i]->name, ctx->tests->test[i]->version);
-                snprintf(srcdir, sizeof(srcdir), "%s/%s", ctx->storage.build_sources_dir, ctx->tests->test[i]->name);
-                if (git_clone(&proc, ctx->tests->test[i]->repository, srcdir, ctx->tests->test[i]->version)) {
-                    SYSERROR("Unable to checkout tag '%s' for package '%s' from repository '%s'",
-                    ctx->tests->test[i]->version, ctx->tests->test[i]->name, ctx->tests->test[i]->repository);
-                    return NULL;
-                }
+        struct Test *test = tests_index_find(&tests, name);
+        if (test && !test->build_recipe && test->repository) { // build from source
+            char srcdir[PATH_MAX];
+            char wheeldir[PATH_MAX];
+            memset(srcdir, 0, sizeof(srcdir));
+            memset(wheeldir, 0, sizeof(wheeldir));
+
+            msg(STASIS_MSG_L2, "Building %s (%s)\n", test->name, test->version);
+            snprintf(srcdir, sizeof(srcdir), "%s/%s", ctx->storage.build_sources_dir, test->name);
+            if (git_clone(&proc, test->repository, srcdir, test->version)) {
+                SYSERROR("Unable to checkout tag '%s' for package '%s' from repository '%s'",
+                test->version, test->name, test->repository);
+                tests_index_free(&tests);
+                return NULL;
+            }
 
-                if (!ctx->tests->test[i]->repository_info_tag) {
-                    ctx->tests->test[i]->repository_info_tag = strdup(git_describe(srcdir));
-                }
-                if (!ctx->tests->test[i]->repository_info_ref) {
-                    ctx->tests->test[i]->repository_info_ref = strdup(git_rev_parse(srcdir, ctx->tests->test[i]->version));
-                }
-                if (ctx->tests->test[i]->repository_remove_tags && strlist_count(ctx->tests->test[i]->repository_remove_tags)) {
-                    filter_repo_tags(srcdir, ctx->tests->test[i]->repository_remove_tags);
-                }
+            if (!test->repository_info_tag) {
+                test->repository_info_tag = strdup(git_describe(srcdir));
+            }
+            if (!test->repository_info_ref) {
+                test->repository_info_ref = strdup(git_rev_parse(srcdir, test->version));
+            }
+            if (test->repository_remove_tags && strlist_count(test->repository_remove_tags)) {
+                filter_repo_tags(srcdir, test->repository_remove_tags);
+            }
+
+            if (!pushd(srcdir)) {
+                char dname[NAME_MAX] = {0};
+                char outdir[PATH_MAX] = {0};
+                char linkname[PATH_MAX] = {0};
+                char *cmd = NULL;
 
-                if (!pushd(srcdir)) {
-                    char dname[NAME_MAX] = {0};
-                    char outdir[PATH_MAX] = {0};
-                    char linkname[PATH_MAX] = {0};
-                    char *cmd = NULL;
+                delivery_autoresolve_vcs_urls(".");
 
-                    delivery_autoresolve_vcs_urls(".");
+                safe_strncpy(dname, test->name, sizeof(dname));
+                tolower_s(dname);
+                snprintf(outdir, sizeof(outdir), "%s/%s", ctx->storage.wheel_artifact_dir, dname);
 
-                    safe_strncpy(dname, ctx->tests->test[i]->name, sizeof(dname));
-                    tolower_s(dname);
-                    snprintf(outdir, sizeof(outdir), "%s/%s", ctx->storage.wheel_artifact_dir, dname);
+                // Despite generating packages using underscores in names, the directory name must use dashes
+                // instead of underscores.
+                safe_strncpy(linkname, dname, sizeof(linkname));
+                replace_text(linkname, "_", "-", 0);
 
-                    // Despite generating packages using underscores in names, the directory name must use dashes
-                    // instead of underscores.
-                    safe_strncpy(linkname, dname, sizeof(linkname));
-                    replace_text(linkname, "_", "-", 0);
+                if (mkdirs(outdir, 0755)) {
+                    SYSERROR("failed to create output directory: %s", outdir);
+                    guard_strlist_free(&result);
+                    popd();
+                    tests_index_free(&tests);
+                    return NULL;
+                }
+                if (!pushd(ctx->storage.wheel_artifact_dir)) {
+                    symlink(dname, linkname);
+                    popd();
+                } else {
+                    SYSERROR("unable to enter wheel storage directory: %s", ctx->storage.wheel_artifact_dir);
+                    guard_strlist_free(&result);
+                    tests_index_free(&tests);
+                    return NULL;
+                }
 
-                    if (mkdirs(outdir, 0755)) {
-                        SYSERROR("failed to create output directory: %s", outdir);
+                if (use_builder_manylinux) {
+                    if (delivery_build_wheels_manylinux(ctx, outdir)) {
+                        SYSERROR("failed to generate wheel package for %s-%s", test->name,
+                                test->version);
                         guard_strlist_free(&result);
+                        guard_free(cmd);
                         popd();
+                        tests_index_free(&tests);
                         return NULL;
                     }
-                    if (!pushd(ctx->storage.wheel_artifact_dir)) {
-                        symlink(dname, linkname);
-                        popd();
-                    } else {
-                        SYSERROR("unable to enter wheel storage directory: %s", ctx->storage.wheel_artifact_dir);
-                        guard_strlist_free(&result);
-                        return NULL;
-                    }
-
-                    if (use_builder_manylinux) {
-                        if (delivery_build_wheels_manylinux(ctx, outdir)) {
-                            SYSERROR("failed to generate wheel package for %s-%s", ctx->tests->test[i]->name,
-                                    ctx->tests->test[i]->version);
-                            guard_strlist_free(&result);
-                            guard_free(cmd);
+                } else if (use_builder_build || use_builder_cibuildwheel) {
+                    if (use_builder_build) {
+                        if (asprintf(&cmd, "-m build -w -o %s", outdir) < 0) {
+                            SYSERROR("Unable to allocate memory for build command");
                             popd();
+                            tests_index_free(&tests);
                             return NULL;
                         }
-                    } else if (use_builder_build || use_builder_cibuildwheel) {
-                        if (use_builder_build) {
-                            if (asprintf(&cmd, "-m build -w -o %s", outdir) < 0) {
-                                SYSERROR("Unable to allocate memory for build command");
-                                popd();
-                                return NULL;
-                            }
-                        } else if (use_builder_cibuildwheel) {
-                            if (asprintf(&cmd, "-m cibuildwheel --output-dir %s --only cp%s-manylinux_%s",
-                                outdir, ctx->meta.python_compact, ctx->system.arch) < 0) {
-                                SYSERROR("Unable to allocate memory for cibuildwheel command");
-                                popd();
-                                return NULL;
-                            }
-                        }
-
-                        if (python_exec(cmd)) {
-                            SYSERROR("failed to generate wheel package for %s-%s", ctx->tests->test[i]->name,
-                                    ctx->tests->test[i]->version);
-                            guard_strlist_free(&result);
-                            guard_free(cmd);
+                    } else if (use_builder_cibuildwheel) {
+                        if (asprintf(&cmd, "-m cibuildwheel --output-dir %s --only cp%s-manylinux_%s",
+                            outdir, ctx->meta.python_compact, ctx->system.arch) < 0) {
+                            SYSERROR("Unable to allocate memory for cibuildwheel command");
                             popd();
+                            tests_index_free(&tests);
                             return NULL;
                         }
-                    } else {
-                        SYSERROR("unknown wheel builder backend: %s", globals.wheel_builder);
+                    }
+
+                    if (python_exec(cmd)) {
+                        SYSERROR("failed to generate wheel package for %s-%s", test->name,
+                                test->version);
+                        guard_strlist_free(&result);
+                        guard_free(cmd);
                         popd();
+                        tests_index_free(&tests);
                         return NULL;
                     }
-
-                    guard_free(cmd);
-                    popd();
                 } else {
-                    SYSERROR("Unable to enter source directory %s: %s", srcdir, strerror(errno));
-                    guard_strlist_free(&result);
+                    SYSERROR("unknown wheel builder backend: %s", globals.wheel_builder);
+                    popd();
+                    tests_index_free(&tests);
                     return NULL;
                 }
+
+                guard_free(cmd);
+                popd();
+            } else {
+                SYSERROR("Unable to enter source directory %s: %s", srcdir, strerror(errno));
+                guard_strlist_free(&result);
+                tests_index_free(&tests);
+                return NULL;
             }
         }
     }
+    tests_index_free(&tests);
     return result;
 }
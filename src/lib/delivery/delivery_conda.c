@@ -69,7 +69,7 @@ void delivery_install_conda(char *install_script, char *conda_install_dir) {
     if (globals.conda_fresh_start) {
         if (!access(conda_install_dir, F_OK)) {
             // directory exists so remove it
-            if (rmtree(conda_install_dir)) {
+            if (rmtree_ex(conda_install_dir, RMTREE_BACKGROUND | RMTREE_PARALLEL)) {
                 SYSERROR("unable to remove previous installation: %s", strerror(errno));
                 exit(1);
             }
@@ -1,5 +1,114 @@
 #include "delivery.h"
 
+//! Files up to this size are identified by their contents in the context digest
+#define DOCKER_CONTEXT_HASH_MAX (1024 * 1024)
+
+/**
+ * Hash the records of a build context directory
+ *
+ * Small files, like rendered templates, are identified by their contents.
+ * Large files, like packages, are identified by their size and modification
+ * time, which hard links share with their source.
+ *
+ * @return 0 on success, -1 on error
+ */
+static int docker_context_hash(struct SHA256 *sha, const char *dir, size_t root_len) {
+    struct StrList *records = listdir(dir);
+    if (!records) {
+        SYSERROR("%s: %s", dir, strerror(errno));
+        return -1;
+    }
+    int status = 0;
+    for (size_t i = 0; !status && i < strlist_count(records); i++) {
+        const char *path = strlist_item(records, i);
+        struct stat st;
+        if (lstat(path, &st) < 0) {
+            SYSERROR("%s: %s", path, strerror(errno));
+            status = -1;
+            break;
+        }
+        char record[PATH_MAX * 2] = {0};
+        char identity[PATH_MAX] = {0};
+        if (S_ISDIR(st.st_mode)) {
+            snprintf(identity, sizeof(identity), "dir");
+        } else if (S_ISLNK(st.st_mode)) {
+            if (readlink(path, identity, sizeof(identity) - 1) < 0) {
+                status = -1;
+                break;
+            }
+        } else if (st.st_size <= DOCKER_CONTEXT_HASH_MAX) {
+            if (sha256_file(path, identity)) {
+                SYSERROR("%s: unable to read file", path);
+                status = -1;
+                break;
+            }
+        } else {
+            snprintf(identity, sizeof(identity), "%jd %jd.%09ld", (intmax_t) st.st_size, (intmax_t) st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+        }
+        snprintf(record, sizeof(record), "%s %o %s\n", path + root_len, (unsigned) st.st_mode, identity);
+        sha256_update(sha, record, strlen(record));
+        if (S_ISDIR(st.st_mode)) {
+            status = docker_context_hash(sha, path, root_len);
+        }
+    }
+    guard_strlist_free(&records);
+    return status;
+}
+
+/**
+ * Compute the digest of a build context and the arguments it is built with
+ * @return 0 on success, -1 on error
+ */
+static int docker_context_digest(const char *dir, const char *args, char digest[SHA256_HEX_SIZE]) {
+    struct SHA256 sha;
+    unsigned char result[SHA256_DIGEST_SIZE] = {0};
+    sha256_init(&sha);
+    sha256_update(&sha, args, strlen(args));
+    sha256_update(&sha, "\n", 1);
+    if (docker_context_hash(&sha, dir, strlen(dir))) {
+        return -1;
+    }
+    sha256_final(&sha, result);
+    sha256_hex(result, digest);
+    return 0;
+}
+
+/**
+ * Stage a directory of packages in the build context
+ *
+ * Files are hard linked to the output directory, so staging copies no data,
+ * and packages that no longer exist in the output directory are removed.
+ *
+ * @return 0 on success, -1 on error
+ */
+static int docker_context_stage(const char *src, const char *dest) {
+    struct SyncStats stats = {0};
+    const struct SyncOptions opts = {.flags = SYNC_LINK | SYNC_DELETE};
+    if (sync_tree(src, dest, &opts, &stats)) {
+        return -1;
+    }
+    msg(STASIS_MSG_L3, "%zu linked, %zu copied (%zu bytes), %zu up to date, %zu removed\n",
+        stats.files_linked, stats.files_copied - stats.files_linked, stats.bytes_copied,
+        stats.files_skipped, stats.files_deleted);
+    return 0;
+}
+
+static int docker_write_ignore(const char *dir, struct StrList *patterns) {
+    char filename[PATH_MAX] = {0};
+    snprintf(filename, sizeof(filename), "%s/.dockerignore", dir);
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        SYSERROR("%s: %s", filename, strerror(errno));
+        return -1;
+    }
+    fprintf(fp, "# Generated from [deploy:docker] dockerignore\n");
+    for (size_t i = 0; i < strlist_count(patterns); i++) {
+        fprintf(fp, "%s\n", strlist_item(patterns, i));
+    }
+    fclose(fp);
+    return 0;
+}
+
 int delivery_docker(struct Delivery *ctx) {
     if (!docker_capable(&ctx->deploy.docker.capabilities)) {
         return -1;
@@ -61,7 +170,7 @@ int delivery_docker(struct Delivery *ctx) {
     // Build the image
     char delivery_file[PATH_MAX] = {0};
     char dest[PATH_MAX] = {0};
-    char rsync_cmd[PATH_MAX * 2] = {0};
+    char artifact_dir[PATH_MAX] = {0};
     memset(delivery_file, 0, sizeof(delivery_file));
     memset(dest, 0, sizeof(dest));
 
@@ -77,34 +186,67 @@ int delivery_docker(struct Delivery *ctx) {
         return -1;
     }
 
-    memset(dest, 0, sizeof(dest));
-    snprintf(dest, sizeof(dest), "%s/packages", ctx->storage.build_docker_dir);
-
-    msg(STASIS_MSG_L2, "Copying conda packages\n");
-    memset(rsync_cmd, 0, sizeof(rsync_cmd));
-    snprintf(rsync_cmd, sizeof(rsync_cmd), "rsync -avi --progress '%s' '%s'", ctx->storage.conda_artifact_dir, dest);
-    if (system(rsync_cmd)) {
+    msg(STASIS_MSG_L2, "Staging conda packages\n");
+    safe_strncpy(artifact_dir, ctx->storage.conda_artifact_dir, sizeof(artifact_dir));
+    snprintf(dest, sizeof(dest), "%s/packages/%s", ctx->storage.build_docker_dir, path_basename(artifact_dir));
+    if (docker_context_stage(ctx->storage.conda_artifact_dir, dest)) {
         SYSERROR("Failed to copy conda artifacts to docker build directory");
         return -1;
     }
 
-    msg(STASIS_MSG_L2, "Copying wheel packages\n");
-    memset(rsync_cmd, 0, sizeof(rsync_cmd));
-    snprintf(rsync_cmd, sizeof(rsync_cmd), "rsync -avi --progress '%s' '%s'", ctx->storage.wheel_artifact_dir, dest);
-    if (system(rsync_cmd)) {
+    msg(STASIS_MSG_L2, "Staging wheel packages\n");
+    safe_strncpy(artifact_dir, ctx->storage.wheel_artifact_dir, sizeof(artifact_dir));
+    snprintf(dest, sizeof(dest), "%s/packages/%s", ctx->storage.build_docker_dir, path_basename(artifact_dir));
+    if (docker_context_stage(ctx->storage.wheel_artifact_dir, dest)) {
         SYSWARN("Failed to copy wheel artifacts to docker build directory. No wheels produced?");
     }
 
-    if (docker_build(ctx->storage.build_docker_dir, args, ctx->deploy.docker.capabilities.build)) {
+    if (ctx->deploy.docker.dockerignore && docker_write_ignore(ctx->storage.build_docker_dir, ctx->deploy.docker.dockerignore)) {
         return -1;
     }
 
-    // Test the image
-    // All tags point back to the same image so test the first one we see
-    // regardless of how many are defined
+    // An image built from the same context is reused
+    char context_digest[SHA256_HEX_SIZE] = {0};
+    char context_manifest[PATH_MAX] = {0};
+    char *context_digest_prev = NULL;
+    snprintf(context_manifest, sizeof(context_manifest), "%s/docker_context.sha256", ctx->storage.build_dir);
+    if (docker_context_digest(ctx->storage.build_docker_dir, args, context_digest)) {
+        SYSWARN("Unable to compute the digest of the docker build context");
+        context_digest[0] = '\0';
+    } else if (!access(context_manifest, F_OK)) {
+        char **lines = file_readlines(context_manifest, 0, 1, NULL);
+        if (lines && lines[0]) {
+            context_digest_prev = strdup(strip(lines[0]));
+        }
+        guard_array_free(lines);
+    }
+
+    // All tags point back to the same image so inspect (and test) the first
+    // one we see regardless of how many are defined
     safe_strncpy(tag, strlist_item(ctx->deploy.docker.tags, 0), sizeof(tag));
     docker_sanitize_tag(tag);
+    char inspect_cmd[STASIS_NAME_MAX + 32] = {0};
+    snprintf(inspect_cmd, sizeof(inspect_cmd), "image inspect \"%s\"", tag);
+    if (context_digest_prev && !strcmp(context_digest_prev, context_digest)
+        && !docker_exec(inspect_cmd, STASIS_DOCKER_QUIET)) {
+        msg(STASIS_MSG_L2, "Build context is unchanged. Reusing image %s\n", tag);
+    } else {
+        remove(context_manifest);
+        if (docker_build(ctx->storage.build_docker_dir, args, ctx->deploy.docker.capabilities.build)) {
+            guard_free(context_digest_prev);
+            return -1;
+        }
+        if (!isempty(context_digest)) {
+            FILE *fp = fopen(context_manifest, "w");
+            if (fp) {
+                fprintf(fp, "%s\n", context_digest);
+                fclose(fp);
+            }
+        }
+    }
+    guard_free(context_digest_prev);
 
+    // Test the image
     msg(STASIS_MSG_L2, "Executing image test script for %s\n", tag);
     if (ctx->deploy.docker.test_script) {
         if (isempty(ctx->deploy.docker.test_script)) {
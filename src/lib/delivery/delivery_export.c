@@ -51,14 +51,42 @@ static void delivery_export_configuration(const struct Delivery *ctx) {
 void delivery_export(const struct Delivery *ctx, char *envs[]) {
     delivery_export_configuration(ctx);
 
-    for (size_t i = 0; envs[i] != NULL; i++) {
+    size_t count = 0;
+    while (envs[count] != NULL) {
+        count++;
+    }
+
+    // Environments are independent of each other, so export them concurrently
+    struct ProcessHandle **procs = calloc(count + 1, sizeof(*procs));
+    if (!procs) {
+        SYSERROR("unable to allocate memory for export processes");
+        exit(1);
+    }
+    for (size_t i = 0; i < count; i++) {
         char *name = envs[i];
         msg(STASIS_MSG_L2, "Exporting %s\n", name);
-        if (conda_env_export(name, ctx->storage.delivery_dir, name)) {
+        procs[i] = conda_env_export_async(name, ctx->storage.delivery_dir, name);
+        if (!procs[i]) {
             SYSERROR("export failed %s", name);
             exit(1);
         }
     }
+
+    int failed = shell_wait_all(procs, count) != 0;
+    for (size_t i = 0; i < count; i++) {
+        if (procs[i]->returncode) {
+            SYSERROR("export failed %s (exit: %d)", envs[i], procs[i]->returncode);
+            if (procs[i]->output.out) {
+                fprintf(stderr, "%s", procs[i]->output.out);
+            }
+            failed = 1;
+        }
+        shell_handle_free(&procs[i]);
+    }
+    guard_free(procs);
+    if (failed) {
+        exit(1);
+    }
 }
 
 void delivery_rewrite_stage1(struct Delivery *ctx, char *specfile) {
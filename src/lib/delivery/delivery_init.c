@@ -137,6 +137,9 @@ void delivery_init_dirs_stage1(struct Delivery *ctx) {
         // use "stasis" in current working directory
         path_store(&ctx->storage.root, PATH_MAX, "stasis", ctx->info.build_name);
     }
+    path_store(&ctx->storage.cache_dir, PATH_MAX, rootdir ? rootdir : "stasis", "cache");
+    // Downloads are cached across builds
+    path_store(&globals.download_cache_dir, PATH_MAX, ctx->storage.cache_dir, "http");
     path_store(&ctx->storage.tools_dir, PATH_MAX, ctx->storage.root, "tools");
     path_store(&ctx->storage.tmpdir, PATH_MAX, ctx->storage.root, "tmp");
     if (delivery_init_tmpdir(ctx)) {
@@ -3,57 +3,16 @@
 #include "wheel.h"
 #include "version_compare.h"
 
-static struct Test *requirement_from_test(struct Delivery *ctx, const char *name) {
-    struct Test *result = NULL;
-    for (size_t i = 0; i < ctx->tests->num_used; i++) {
-        char *package_name = strdup(name);
-        if (package_name) {
-            char *spec = find_version_spec(package_name);
-            if (spec) {
-                *spec = '\0';
-            }
-            remove_extras(package_name);
-
-            if (ctx->tests->test[i]->name && !strcmp(package_name, ctx->tests->test[i]->name)) {
-                result = ctx->tests->test[i];
-                guard_free(package_name);
-                break;
-            }
-            guard_free(package_name);
-        } else {
-            SYSERROR("unable to allocate memory for package name: %s", name);
-            return NULL;
-        }
-    }
-    return result;
-}
-
-static char *have_spec_in_config(const struct Delivery *ctx, const char *name) {
-    for (size_t x = 0; x < strlist_count(ctx->conda.pip_packages); x++) {
-        char *config_spec = strlist_item(ctx->conda.pip_packages, x);
-        char *op = find_version_spec(config_spec);
-        char package[255] = {0};
-        if (op) {
-            safe_strncpy(package, config_spec, op - config_spec);
-        } else {
-            safe_strncpy(package, config_spec, sizeof(package));
-        }
-        remove_extras(package);
-        if (strncmp(package, name, strlen(name)) == 0) {
-            return config_spec;
-        }
-    }
-    return NULL;
-}
-
 int delivery_overlay_packages_from_env(struct Delivery *ctx, const char *env_name) {
     char *current_env = conda_get_active_environment();
     int need_restore = current_env && strcmp(env_name, current_env) != 0;
 
     conda_activate(ctx->storage.conda_install_prefix, env_name);
     // Retrieve a listing of python packages installed under "env_name"
-    int freeze_status = 0;
-    char *freeze_output = shell_output("python -m pip freeze", &freeze_status);
+    struct ProcessOutput freeze_proc = {0};
+    char *freeze_argv[] = {"python", "-m", "pip", "freeze", NULL};
+    int freeze_status = shell_capture(freeze_argv, &freeze_proc, 0);
+    char *freeze_output = freeze_proc.out;
     if (freeze_status) {
         guard_free(freeze_output);
         guard_free(current_env);
@@ -72,7 +31,25 @@ int delivery_overlay_packages_from_env(struct Delivery *ctx, const char *env_nam
     }
     guard_free(freeze_output);
 
-    struct StrList *new_list = strlist_init();
+    // Look up tests and configured specs by package name
+    struct TestIndex tests;
+    if (tests_index_init(&tests, ctx->tests)) {
+        guard_strlist_free(&frozen_list);
+        return -1;
+    }
+    struct StrList *config_names = strlist_init_mode(STRLIST_MODE_INTERN);
+    char **config_specs = calloc(strlist_count(ctx->conda.pip_packages) + 1, sizeof(*config_specs));
+    // Package specs are unique
+    struct StrList *new_list = strlist_init_mode(STRLIST_MODE_INTERN);
+    if (!config_names || !config_specs || !new_list) {
+        SYSERROR("unable to allocate package lists");
+        tests_index_free(&tests);
+        guard_strlist_free(&config_names);
+        guard_free(config_specs);
+        guard_strlist_free(&new_list);
+        guard_strlist_free(&frozen_list);
+        return -1;
+    }
 
     // - consume package specs that have no test blocks.
     // - these will be third-party packages like numpy, scipy, etc.
@@ -88,7 +65,15 @@ int delivery_overlay_packages_from_env(struct Delivery *ctx, const char *env_nam
             safe_strncpy(spec_name, spec, sizeof(spec_name));
         }
 
-        struct Test *test_block = requirement_from_test(ctx, spec_name);
+        remove_extras(spec_name);
+        const size_t config_count = strlist_count(config_names);
+        strlist_append(&config_names, spec_name);
+        if (strlist_count(config_names) > config_count) {
+            // The first spec for a package wins
+            config_specs[config_count] = spec;
+        }
+
+        struct Test *test_block = tests_index_find(&tests, spec_name);
         if (!test_block) {
             msg(STASIS_MSG_L2 | STASIS_MSG_WARN, "from config without test: %s\n", spec);
             strlist_append(&new_list, spec);
@@ -108,9 +93,10 @@ int delivery_overlay_packages_from_env(struct Delivery *ctx, const char *env_nam
         } else {
             safe_strncpy(frozen_name, frozen_spec, sizeof(frozen_name));
         }
-        struct Test *test = requirement_from_test(ctx, frozen_name);
+        struct Test *test = tests_index_find(&tests, frozen_name);
         if (test && strcmp(test->name, frozen_name) == 0) {
-            char *config_spec = have_spec_in_config(ctx, frozen_name);
+            size_t config_pos = 0;
+            char *config_spec = strlist_find(config_names, frozen_name, &config_pos) ? config_specs[config_pos] : NULL;
             if (config_spec) {
                 msg(STASIS_MSG_L2, "from config: %s\n", config_spec);
                 strlist_append(&new_list, config_spec);
@@ -123,9 +109,14 @@ int delivery_overlay_packages_from_env(struct Delivery *ctx, const char *env_nam
 
     // Replace the package manifest as needed
     if (strlist_count(new_list)) {
+        // The manifest keeps the default list mode
         guard_strlist_free(&ctx->conda.pip_packages);
-        ctx->conda.pip_packages = strlist_copy(new_list);
+        ctx->conda.pip_packages = strlist_init();
+        strlist_append_strlist(ctx->conda.pip_packages, new_list);
     }
+    tests_index_free(&tests);
+    guard_strlist_free(&config_names);
+    guard_free(config_specs);
     guard_strlist_free(&new_list);
     guard_strlist_free(&frozen_list);
     return 0;
@@ -145,11 +136,11 @@ int delivery_conda_enforce_package_version(struct Delivery *ctx, const char *env
         return -1;
     }
 
-    int proc_status = 0;
     char cmd[PATH_MAX] = {0};
-    snprintf(cmd, PATH_MAX, "conda list --name %s", env_name);
-
-    char *output = shell_output(cmd, &proc_status);
+    struct ProcessOutput proc = {0};
+    char *argv[] = {"conda", "list", "--name", (char *) env_name, NULL};
+    int proc_status = shell_capture(argv, &proc, 0);
+    char *output = proc.out;
     if (!output || proc_status) {
         SYSERROR("unable to retreive list of installed packages (exit: %d)", proc_status);
         guard_free(output);
@@ -412,6 +403,13 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
         return -1;
     }
 
+    struct TestIndex tests;
+    if (tests_index_init(&tests, ctx->tests)) {
+        guard_free(args);
+        guard_array_free(wheels);
+        return -1;
+    }
+
     for (size_t x = 0; manifest[x] != NULL; x++) {
         char *name = NULL;
         for (size_t p = 0; p < strlist_count(manifest[x]); p++) {
@@ -422,7 +420,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
             }
             if (INSTALL_PKG_PIP_DEFERRED & type) {
                 SYSDEBUG("Getting requirements for test: %s", name);
-                struct Test *info = requirement_from_test(ctx, name);
+                struct Test *info = tests_index_find(&tests, name);
                 if (info) {
                     if (!strcmp(info->version, "HEAD") || is_git_sha(info->version)) {
                         SYSDEBUG("Using version: %s", info->version);
@@ -431,6 +429,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
                             SYSERROR("Unable to allocate memory for tag data");
                             guard_free(args);
                             guard_array_free(wheels);
+                            tests_index_free(&tests);
                             return -1;
                         }
                         SYSDEBUG("Tokenizing repository info tag: %s", info->repository_info_tag);
@@ -500,6 +499,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
                             SYSERROR("Unable to allocate %d bytes for command arguments", required_len);
                             guard_free(args);
                             guard_array_free(wheels);
+                            tests_index_free(&tests);
                             return -1;
                         }
                     }
@@ -508,6 +508,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
                     SYSERROR("Deferred package '%s' is not present in the tested package list!", name);
                     guard_free(args);
                     guard_array_free(wheels);
+                    tests_index_free(&tests);
                     return -1;
                 }
             } else {
@@ -520,6 +521,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
                             SYSERROR("Unable to allocate %d bytes for command arguments", required_len);
                             guard_free(args);
                             guard_array_free(wheels);
+                            tests_index_free(&tests);
                             return -1;
                         }
                     }
@@ -533,6 +535,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
                             SYSERROR("Unable to allocate %d bytes for command arguments", required_len);
                             guard_free(args);
                             guard_array_free(wheels);
+                            tests_index_free(&tests);
                             return -1;
                         }
                     }
@@ -545,6 +548,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
             SYSERROR("Unable to allocate bytes for command");
             guard_free(args);
             guard_array_free(wheels);
+            tests_index_free(&tests);
             return -1;
         }
 
@@ -554,6 +558,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
         if (status) {
             // fail quickly
             guard_array_free(wheels);
+            tests_index_free(&tests);
             return status;
         }
     }
@@ -576,6 +581,7 @@ int delivery_install_packages(struct Delivery *ctx, char *conda_install_dir, cha
     free(wheels);
 
     guard_free(args);
+    tests_index_free(&tests);
     return 0;
 }
 
@@ -199,6 +199,22 @@ static void normalize_ini_list(struct INIFILE **inip, struct StrList **listp, ch
     (*listp) = list;
 }
 
+// Replace a package list with an interned copy, dropping duplicate entries
+static int intern_package_list(struct StrList **listp) {
+    if (!*listp) {
+        return 0;
+    }
+    struct StrList *list = strlist_init_mode(STRLIST_MODE_INTERN);
+    if (!list) {
+        SYSERROR("unable to allocate package list");
+        return -1;
+    }
+    strlist_append_strlist(list, *listp);
+    guard_strlist_free(listp);
+    *listp = list;
+    return 0;
+}
+
 static int check_package_spec_list(struct StrList *list, const char *ini_section, const char *ini_key) {
     if (!list) {
         // empty lists are OK
@@ -282,6 +298,9 @@ int populate_delivery_ini(struct Delivery *ctx, int render_mode) {
 
     ctx->conda.conda_packages_purge = ini_getval_strlist(ini, "conda", "conda_packages_purge", LINE_SEP, render_mode, &err);
     normalize_ini_list(&ini, &ctx->conda.conda_packages_purge, "conda", "conda_package_purge", render_mode);
+    if (intern_package_list(&ctx->conda.conda_packages_purge)) {
+        return -1;
+    }
 
     ctx->conda.pip_packages = ini_getval_strlist(ini, "conda", "pip_packages", LINE_SEP, render_mode, &err);
     normalize_ini_list(&ini, &ctx->conda.pip_packages, "conda", "pip_packages", render_mode);
@@ -301,6 +320,9 @@ int populate_delivery_ini(struct Delivery *ctx, int render_mode) {
         char *item = strlist_item(ctx->conda.pip_packages_purge, i);
         normalize_namespace_package_name(item);
     }
+    if (intern_package_list(&ctx->conda.pip_packages_purge)) {
+        return -1;
+    }
 
     // Delivery metadata consumed
     if (populate_mission_ini(&ctx, render_mode)) {
@@ -335,10 +357,10 @@ int populate_delivery_ini(struct Delivery *ctx, int render_mode) {
     delivery_init_dirs_stage2(ctx);
 
     if (!ctx->conda.conda_packages_defer) {
-        ctx->conda.conda_packages_defer = strlist_init();
+        ctx->conda.conda_packages_defer = strlist_init_mode(STRLIST_MODE_INTERN);
     }
     if (!ctx->conda.pip_packages_defer) {
-        ctx->conda.pip_packages_defer = strlist_init();
+        ctx->conda.pip_packages_defer = strlist_init_mode(STRLIST_MODE_INTERN);
     }
 
     ctx->tests = tests_init(TEST_NUM_ALLOC_INITIAL);
@@ -370,7 +392,11 @@ int populate_delivery_ini(struct Delivery *ctx, int render_mode) {
             test->repository_remove_tags = ini_getval_strlist(ini, section_name, "repository_remove_tags", LINE_SEP, render_mode, &err);
             test->build_recipe = ini_getval_str(ini, section_name, "build_recipe", render_mode, &err);
 
-            test->runtime->environ = ini_getval_strlist(ini, section_name, "runtime", LINE_SEP, render_mode, &err);
+            struct StrList *runtime_vars = ini_getval_strlist(ini, section_name, "runtime", LINE_SEP, render_mode, &err);
+            if (runtime_vars) {
+                test->runtime->environ = runtime_copy(runtime_vars->data);
+                guard_strlist_free(&runtime_vars);
+            }
             const char *timeout_str = ini_getval_str(ini, section_name, "timeout", render_mode, &err);
             if (timeout_str) {
                 test->timeout = str_to_timeout((char *) timeout_str);
@@ -400,6 +426,12 @@ int populate_delivery_ini(struct Delivery *ctx, int render_mode) {
             jfrog->upload_ctx.recursive = ini_getval_bool(ini, section_name, "recursive", render_mode, &err);
             jfrog->upload_ctx.retries = ini_getval_int(ini, section_name, "retries", render_mode, &err);
             jfrog->upload_ctx.retry_wait_time = ini_getval_int(ini, section_name, "retry_wait_time", render_mode, &err);
+            jfrog->upload_ctx.threads = ini_getval_int(ini, section_name, "threads", render_mode, &err);
+            jfrog->skip_unchanged = ini_getval_bool(ini, section_name, "skip_unchanged", render_mode, &err);
+            jfrog->verify_unchanged = ini_getval_bool(ini, section_name, "verify_unchanged", render_mode, &err);
+            if (err) {
+                jfrog->verify_unchanged = true;
+            }
             jfrog->upload_ctx.detailed_summary = ini_getval_bool(ini, section_name, "detailed_summary", render_mode, &err);
             jfrog->upload_ctx.quiet = ini_getval_bool(ini, section_name, "quiet", render_mode, &err);
             jfrog->upload_ctx.regexp = ini_getval_bool(ini, section_name, "regexp", render_mode, &err);
@@ -423,6 +455,7 @@ int populate_delivery_ini(struct Delivery *ctx, int render_mode) {
             docker->test_script = ini_getval_str(ini, section_name, "test_script", render_mode, &err);
             docker->build_args = ini_getval_strlist(ini, section_name, "build_args", LINE_SEP, render_mode, &err);
             docker->tags = ini_getval_strlist(ini, section_name, "tags", LINE_SEP, render_mode, &err);
+            docker->dockerignore = ini_getval_strlist(ini, section_name, "dockerignore", LINE_SEP, render_mode, &err);
         }
     }
     return 0;
@@ -1,3 +1,4 @@
+#include <glob.h>
 #include "delivery.h"
 #include "log.h"
 #include "conda.h"
@@ -145,45 +146,52 @@ void delivery_rewrite_spec(struct Delivery *ctx, char *filename, unsigned stage)
     } else if (globals.enable_rewrite_spec_stage_2 && stage == DELIVERY_REWRITE_SPEC_STAGE_2) {
         SYSDEBUG("Entering stage 2");
         char output[PATH_MAX] = {0};
+        char conda_channel[PATH_MAX] = {0};
+        struct ReplaceRule rules[2] = {0};
         // Replace "local" channel with the staging URL
         if (ctx->storage.conda_staging_url) {
             SYSDEBUG("Will replace conda channel with staging area url");
-            file_replace_text(filename, "@CONDA_CHANNEL@", ctx->storage.conda_staging_url, 0);
+            rules[0] = (struct ReplaceRule) {"@CONDA_CHANNEL@", ctx->storage.conda_staging_url, 0};
         } else if (globals.jfrog.repo) {
             SYSDEBUG("Will replace conda channel with artifactory repo packages/conda url");
-            snprintf(output, sizeof(output), "%s/%s/%s/%s/packages/conda", globals.jfrog.url, globals.jfrog.repo, ctx->meta.mission, ctx->info.build_name);
-            file_replace_text(filename, "@CONDA_CHANNEL@", output, 0);
+            snprintf(conda_channel, sizeof(conda_channel), "%s/%s/%s/%s/packages/conda", globals.jfrog.url, globals.jfrog.repo, ctx->meta.mission, ctx->info.build_name);
+            rules[0] = (struct ReplaceRule) {"@CONDA_CHANNEL@", conda_channel, 0};
         } else {
             SYSDEBUG("Will replace conda channel with local conda artifact directory");
             SYSWARN("conda_staging_dir is not configured. Using fallback: '%s'", ctx->storage.conda_artifact_dir);
-            file_replace_text(filename, "@CONDA_CHANNEL@", ctx->storage.conda_artifact_dir, 0);
+            rules[0] = (struct ReplaceRule) {"@CONDA_CHANNEL@", ctx->storage.conda_artifact_dir, 0};
         }
 
         if (ctx->storage.wheel_staging_url) {
             SYSDEBUG("Will replace pip arguments with wheel staging url");
             snprintf(output, sizeof(output), "--extra-index-url %s/%s/%s/packages/wheels", ctx->storage.wheel_staging_url, ctx->meta.mission, ctx->info.build_name);
-            file_replace_text(filename, "@PIP_ARGUMENTS@", ctx->storage.wheel_staging_url, 0);
+            rules[1] = (struct ReplaceRule) {"@PIP_ARGUMENTS@", ctx->storage.wheel_staging_url, 0};
         } else if (globals.enable_artifactory && globals.jfrog.url && globals.jfrog.repo) {
             SYSDEBUG("Will replace pip arguments with artifactory repo packages/wheel url");
             snprintf(output, sizeof(output), "--extra-index-url %s/%s/%s/%s/packages/wheels", globals.jfrog.url, globals.jfrog.repo, ctx->meta.mission, ctx->info.build_name);
-            file_replace_text(filename, "@PIP_ARGUMENTS@", output, 0);
+            rules[1] = (struct ReplaceRule) {"@PIP_ARGUMENTS@", output, 0};
         } else {
             SYSDEBUG("Will replace pip arguments with local wheel artifact directory");
             SYSWARN("wheel_staging_dir is not configured. Using fallback: '%s'", ctx->storage.wheel_artifact_dir);
             snprintf(output, sizeof(output), "--extra-index-url file://%s", ctx->storage.wheel_artifact_dir);
-            file_replace_text(filename, "@PIP_ARGUMENTS@", output, 0);
+            rules[1] = (struct ReplaceRule) {"@PIP_ARGUMENTS@", output, 0};
+        }
+
+        if (file_replace_text_ex(filename, rules, sizeof(rules) / sizeof(*rules))) {
+            SYSERROR("%s: unable to replace channel and pip argument placeholders", filename);
+            exit(1);
         }
     }
     SYSDEBUG("Rewriting finished");
 }
 
 int delivery_copy_conda_artifacts(struct Delivery *ctx) {
-    char cmd[STASIS_BUFSIZ];
     char conda_build_dir[PATH_MAX];
-    char subdir[PATH_MAX];
-    memset(cmd, 0, sizeof(cmd));
+    char src[PATH_MAX];
+    char dest[PATH_MAX];
     memset(conda_build_dir, 0, sizeof(conda_build_dir));
-    memset(subdir, 0, sizeof(subdir));
+    memset(src, 0, sizeof(src));
+    memset(dest, 0, sizeof(dest));
 
     snprintf(conda_build_dir, sizeof(conda_build_dir), "%s/%s", ctx->storage.conda_install_prefix, "conda-bld");
     // One must run conda build at least once to create the "conda-bld" directory.
@@ -193,12 +201,16 @@ int delivery_copy_conda_artifacts(struct Delivery *ctx) {
         return 0;
     }
 
-    snprintf(cmd, sizeof(cmd), "rsync -avi --progress %s/%s %s",
-             conda_build_dir,
-             ctx->system.platform[DELIVERY_PLATFORM_CONDA_SUBDIR],
-             ctx->storage.conda_artifact_dir);
+    snprintf(src, sizeof(src), "%s/%s/%s", ctx->storage.conda_install_prefix, "conda-bld", ctx->system.platform[DELIVERY_PLATFORM_CONDA_SUBDIR]);
+    snprintf(dest, sizeof(dest), "%s/%s", ctx->storage.conda_artifact_dir, ctx->system.platform[DELIVERY_PLATFORM_CONDA_SUBDIR]);
 
-    return system(cmd);
+    struct SyncOptions opts = {.flags = SYNC_VERBOSE};
+    struct SyncStats stats = {0};
+    if (sync_tree(src, dest, &opts, &stats)) {
+        return -1;
+    }
+    msg(STASIS_MSG_L3, "%zu file(s) copied (%zu bytes), %zu up to date\n", stats.files_copied, stats.bytes_copied, stats.files_skipped);
+    return 0;
 }
 
 int delivery_index_conda_artifacts(struct Delivery *ctx) {
@@ -206,11 +218,24 @@ int delivery_index_conda_artifacts(struct Delivery *ctx) {
 }
 
 int delivery_copy_wheel_artifacts(struct Delivery *ctx) {
-    char cmd[PATH_MAX] = {0};
-    snprintf(cmd, sizeof(cmd), "rsync -avi --progress %s/*/dist/*.whl %s",
-             ctx->storage.build_sources_dir,
-             ctx->storage.wheel_artifact_dir);
-    return system(cmd);
+    char pattern[PATH_MAX] = {0};
+    glob_t wheels = {0};
+    snprintf(pattern, sizeof(pattern), "%s/*/dist/*.whl", ctx->storage.build_sources_dir);
+    if (glob(pattern, 0, NULL, &wheels)) {
+        SYSERROR("No wheels found: %s", pattern);
+        globfree(&wheels);
+        return -1;
+    }
+
+    struct SyncOptions opts = {.flags = SYNC_VERBOSE};
+    struct SyncStats stats = {0};
+    const int status = sync_trees(wheels.gl_pathv, wheels.gl_pathc, ctx->storage.wheel_artifact_dir, &opts, &stats);
+    globfree(&wheels);
+    if (status) {
+        return -1;
+    }
+    msg(STASIS_MSG_L3, "%zu file(s) copied (%zu bytes), %zu up to date\n", stats.files_copied, stats.bytes_copied, stats.files_skipped);
+    return 0;
 }
 
 int delivery_index_wheel_artifacts(struct Delivery *ctx) {
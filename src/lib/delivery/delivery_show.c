@@ -97,7 +97,7 @@ void delivery_tests_show(struct Delivery *ctx) {
 void delivery_runtime_show(struct Delivery *ctx) {
     printf("\n====RUNTIME====\n");
     struct StrList *rt = NULL;
-    rt = strlist_copy(ctx->runtime.environ);
+    rt = strlist_copy(ctx->runtime.environ ? ctx->runtime.environ->vars : NULL);
     if (!rt) {
         // no data
         return;
@@ -1,3 +1,4 @@
+#include <libxml/parser.h>
 #include "delivery.h"
 
 struct Tests *tests_init(const size_t num_tests) {
@@ -82,6 +83,83 @@ void tests_free(struct Tests **x) {
     guard_free(tests);
 }
 
+int tests_index_init(struct TestIndex *index, const struct Tests *tests) {
+    memset(index, 0, sizeof(*index));
+    index->names = strlist_init_mode(STRLIST_MODE_INTERN);
+    index->test = calloc(tests->num_used + 1, sizeof(*index->test));
+    if (!index->names || !index->test) {
+        SYSERROR("unable to allocate test index");
+        tests_index_free(index);
+        return -1;
+    }
+    for (size_t i = 0; i < tests->num_used; i++) {
+        struct Test *test = tests->test[i];
+        const size_t count = strlist_count(index->names);
+        if (!test || !test->name) {
+            continue;
+        }
+        strlist_append(&index->names, test->name);
+        if (strlist_count(index->names) > count) {
+            index->test[count] = test;
+        }
+    }
+    return 0;
+}
+
+struct Test *tests_index_find(const struct TestIndex *index, const char *name) {
+    char package_name[STASIS_NAME_MAX] = {0};
+    safe_strncpy(package_name, name, sizeof(package_name));
+    char *spec = find_version_spec(package_name);
+    if (spec) {
+        *spec = '\0';
+    }
+    remove_extras(package_name);
+
+    size_t pos = 0;
+    if (!strlist_find(index->names, package_name, &pos)) {
+        return NULL;
+    }
+    return index->test[pos];
+}
+
+void tests_index_free(struct TestIndex *index) {
+    guard_strlist_free(&index->names);
+    guard_free(index->test);
+}
+
+/**
+ * Produce the environment for a test's tasks, i.e. the current environment plus [test:*].runtime
+ * @param test pointer to Test
+ * @return RuntimeEnv, or NULL when the test does not define any runtime variables
+ */
+static RuntimeEnv *delivery_test_runtime(const struct Test *test) {
+    if (!test->runtime || !runtime_count(test->runtime->environ)) {
+        return NULL;
+    }
+
+    RuntimeEnv *env = runtime_copy(__environ);
+    if (!env) {
+        SYSERROR("Unable to allocate runtime environment for %s", test->name);
+        exit(1);
+    }
+
+    char **vars = runtime_envp(test->runtime->environ);
+    for (size_t i = 0; vars[i] != NULL; i++) {
+        if (isempty(vars[i])) {
+            continue;
+        }
+        char *sep = strchr(vars[i], '=');
+        if (!sep || sep == vars[i]) {
+            SYSWARN("Invalid runtime variable ignored in [test:%s]: '%s'", test->name, vars[i]);
+            continue;
+        }
+        *sep = '\0';
+        runtime_set(env, vars[i], sep + 1);
+        *sep = '=';
+    }
+    return env;
+}
+
 void delivery_tests_run(struct Delivery *ctx) {
     static const int SETUP = 0;
     static const int PARALLEL = 1;
@@ -140,6 +218,13 @@ void delivery_tests_run(struct Delivery *ctx) {
         //      grep string file.txt || :
         const char *runner_cmd_fmt = "set -e -x\n%s\n";
 
+        // Per-test environments are handed to the tasks directly. They must outlive the pools.
+        RuntimeEnv **task_env = calloc(ctx->tests->num_used, sizeof(*task_env));
+        if (!task_env) {
+            SYSERROR("Unable to allocate task environment array: %s", strerror(errno));
+            exit(1);
+        }
+
         // Iterate over our test records, retrieving the source code for each package, and assigning its scripted tasks
         // to the appropriate processing pool
         for (size_t i = 0; i < ctx->tests->num_used; i++) {
@@ -159,7 +244,7 @@ void delivery_tests_run(struct Delivery *ctx) {
 
             if (!access(destdir, F_OK)) {
                 msg(STASIS_MSG_L3, "Purging repository %s\n", destdir);
-                if (rmtree(destdir)) {
+                if (rmtree_ex(destdir, RMTREE_BACKGROUND | RMTREE_PARALLEL)) {
                     COE_CHECK_ABORT(1, "Unable to remove repository");
                 }
             }
@@ -243,6 +328,10 @@ void delivery_tests_run(struct Delivery *ctx) {
                     task->timeout = test->timeout;
                 }
 
+                // Apply runtime variables from test block
+                task_env[i] = delivery_test_runtime(test);
+                task->envp = runtime_envp(task_env[i]);
+
                 guard_free(runner_cmd);
                 guard_free(cmd);
                 popd();
@@ -301,6 +390,10 @@ void delivery_tests_run(struct Delivery *ctx) {
                         }
                         exit(1);
                     }
+                    if (!task_env[i]) {
+                        task_env[i] = delivery_test_runtime(test);
+                    }
+                    task->envp = runtime_envp(task_env[i]);
                     guard_free(runner_cmd);
                     guard_free(cmd);
                     popd();
@@ -351,7 +444,37 @@ void delivery_tests_run(struct Delivery *ctx) {
             }
             mp_pool_free(&pool[p]);
         }
+
+        for (size_t i = 0; i < ctx->tests->num_used; i++) {
+            guard_runtime_free(task_env[i]);
+        }
+        guard_free(task_env);
+    }
+}
+
+struct FixupPool {
+    struct StrList *files; ///< Paths to junit XML files
+    size_t next; ///< Next file to hand out
+    pthread_mutex_t lock;
+};
+
+static void *fixup_test_results_worker(void *arg) {
+    struct FixupPool *pool = arg;
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->next >= strlist_count(pool->files)) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        const char *path = strlist_item(pool->files, pool->next++);
+        pthread_mutex_unlock(&pool->lock);
+
+        msg(STASIS_MSG_L3, "%s\n", path_basename((char *) path));
+        if (xml_format_in_place(path)) {
+            SYSWARN("Failed to rewrite file '%s'", path);
+        }
     }
+    return NULL;
 }
 
 int delivery_fixup_test_results(struct Delivery *ctx) {
@@ -363,6 +486,12 @@ int delivery_fixup_test_results(struct Delivery *ctx) {
         return -1;
     }
 
+    struct FixupPool pool = {0};
+    pool.files = strlist_init();
+    if (!pool.files) {
+        closedir(dp);
+        return -1;
+    }
     while ((rec = readdir(dp)) != NULL) {
         char path[PATH_MAX] = {0};
 
@@ -371,13 +500,34 @@ int delivery_fixup_test_results(struct Delivery *ctx) {
         }
 
         snprintf(path, sizeof(path), "%s/%s", ctx->storage.results_dir, rec->d_name);
-        msg(STASIS_MSG_L3, "%s\n", rec->d_name);
-        if (xml_pretty_print_in_place(path, STASIS_XML_PRETTY_PRINT_PROG, STASIS_XML_PRETTY_PRINT_ARGS)) {
-            SYSWARN("Failed to rewrite file '%s'", rec->d_name);
-        }
+        strlist_append(&pool.files, path);
     }
-
     closedir(dp);
+
+    // Reformat the files in process, several at a time
+    size_t num_threads = globals.cpu_limit > 0 ? (size_t) globals.cpu_limit : (size_t) get_cpu_count();
+    if (num_threads > strlist_count(pool.files)) {
+        num_threads = strlist_count(pool.files);
+    }
+    xmlInitParser();
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_t *threads = calloc(num_threads ? num_threads : 1, sizeof(*threads));
+    size_t started = 0;
+    for (size_t i = 0; threads && i < num_threads; i++) {
+        if (pthread_create(&threads[i], NULL, fixup_test_results_worker, &pool)) {
+            break;
+        }
+        started++;
+    }
+    if (!started) {
+        fixup_test_results_worker(&pool);
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    guard_free(threads);
+    pthread_mutex_destroy(&pool.lock);
+    guard_strlist_free(&pool.files);
     return 0;
 }
 
@@ -11,6 +11,7 @@
 #include "ini.h"
 #include "multiprocessing.h"
 #include "conda.h"
+#include "sync.h"
 
 #define DELIVERY_PLATFORM_MAX 4
 #define DELIVERY_PLATFORM_MAXLEN 65
@@ -97,6 +98,7 @@ struct Delivery {
         char *delivery_dir;             ///< Delivery artifact output directory
         char *cfgdump_dir;              ///< Base path to where input configuration dumps are stored
         char *tools_dir;                ///< Tools storage
+        char *cache_dir;                ///< Data kept across builds
         char *mission_dir;              ///< Mission data storage
         char *package_dir;              ///< Base path to where all packages are stored
         char *results_dir;              ///< Base path to where test results are stored
@@ -188,6 +190,8 @@ struct Delivery {
             struct JFRT_Upload upload_ctx;
             char *repo;
             char *dest;
+            bool skip_unchanged; ///< Skip files already uploaded with the same SHA-256
+            bool verify_unchanged; ///< Confirm unchanged files with the repository
         } jfrog[1000];
 
         struct Docker {
@@ -198,6 +202,7 @@ struct Delivery {
             char *test_script;
             struct StrList *build_args;
             struct StrList *tags;
+            struct StrList *dockerignore; ///< Patterns written to the build context's .dockerignore
         } docker;
     } deploy;
 
@@ -543,5 +548,46 @@ void tests_free(struct Tests **x);
  */
 struct Test *test_init();
 
+//! Tests keyed by package name, for repeated lookups
+struct TestIndex {
+    struct StrList *names; ///< Distinct test names (STRLIST_MODE_INTERN)
+    struct Test **test; ///< First test with each name, in the order of `names`
+};
+
+/**
+ * Index tests by name
+ *
+ * The index refers to the names as they are now. Rebuild it after renaming
+ * a test.
+ *
+ * ```c
+ * struct TestIndex index;
+ * if (tests_index_init(&index, ctx->tests)) {
+ *     // error
+ * }
+ * struct Test *test = tests_index_find(&index, "package[extra]>=1.0");
+ * tests_index_free(&index);
+ * ```
+ *
+ * @param index `TestIndex` to populate
+ * @param tests tests to index
+ * @return 0 on success, -1 on error
+ */
+int tests_index_init(struct TestIndex *index, const struct Tests *tests);
+
+/**
+ * Find the test for a package
+ * @param index `TestIndex`
+ * @param name package name. Version specifiers and extras are ignored.
+ * @return the first test named `name`, or NULL
+ */
+struct Test *tests_index_find(const struct TestIndex *index, const char *name);
+
+/**
+ * Free the storage used by a `TestIndex`
+ * @param index `TestIndex`
+ */
+void tests_index_free(struct TestIndex *index);
+
 
 #endif //STASIS_DELIVERY_H
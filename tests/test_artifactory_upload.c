@@ -0,0 +1,329 @@
+#include "testing.h"
+#include "artifactory.h"
+#include "sha256.h"
+
+static struct JFRT_Auth auth = {.url = "http://localhost/artifactory", .access_token = "secret"};
+
+// Stand-in for jf. Records its arguments. An upload reports every file in the
+// spec as uploaded, except files named "fail*", and stores its SHA-256 in
+// remote.txt. A search reports the files of the spec found in remote.txt,
+// with properties that reuse the "path" key and contain braces.
+static const char *jf_standin =
+    "#!/bin/sh\n"
+    "echo \"$@\" >> jf.log\n"
+    "for arg in \"$@\"; do\n"
+    "    case \"$arg\" in --spec=*) spec=\"${arg#--spec=}\";; esac\n"
+    "done\n"
+    "cp \"$spec\" spec.json\n"
+    "touch remote.txt\n"
+    "if [ \"$2\" = search ]; then\n"
+    "    echo '['\n"
+    "    sed -n 's/.*\"pattern\": \"\\([^\"]*\\)\"}.*/\\1/p' \"$spec\" | while read target; do\n"
+    "        grep \" $target\\$\" remote.txt | while read sha path; do\n"
+    "            printf '{\"path\": \"%s\", \"type\": \"file\", \"props\": {\"path\": [\"old}\"]}, \"sha256\": \"%s\"},\\n' \"$path\" \"$sha\"\n"
+    "        done\n"
+    "    done\n"
+    "    echo ']'\n"
+    "    exit 0\n"
+    "fi\n"
+    "echo '{\"status\": \"success\", \"files\": ['\n"
+    "sed -n 's/.*\"pattern\": \"\\([^\"]*\\)\", \"target\": \"\\([^\"]*\\)\".*/\\1 \\2/p' \"$spec\" | while read src target; do\n"
+    "    case \"$(basename \"$src\")\" in fail*) continue;; esac\n"
+    "    sha=$(sha256sum \"$src\" | cut -d' ' -f1)\n"
+    "    grep -v \" $target\\$\" remote.txt > remote.tmp; mv remote.tmp remote.txt\n"
+    "    echo \"$sha $target\" >> remote.txt\n"
+    "    printf '{\"source\": \"%s\", \"target\": \"%s/%s\", \"sha256\": \"%s\"},\\n' \"$src\" \"$JF_URL\" \"$target\" \"$sha\"\n"
+    "done\n"
+    "echo ']}'\n";
+
+static size_t jf_invocations(const char *task) {
+    size_t count = 0;
+    char **log = file_readlines("jf.log", 0, 0, NULL);
+    for (size_t i = 0; log && log[i] != NULL; i++) {
+        if (strstr(log[i], task)) {
+            count++;
+        }
+    }
+    guard_array_free(log);
+    return count;
+}
+
+static const struct JFRT_UploadFile *upload_files_get(const struct JFRT_UploadFiles *files, const char *name) {
+    for (size_t i = 0; i < files->num_used; i++) {
+        if (!strcmp(path_basename(files->file[i].src), name)) {
+            return &files->file[i];
+        }
+    }
+    return NULL;
+}
+
+static void make_tree() {
+    mkdirs("out/sub", 0755);
+    stasis_testing_write_ascii("out/a.whl", "a");
+    stasis_testing_write_ascii("out/fail.whl", "fail");
+    stasis_testing_write_ascii("out/sub/b.whl", "b");
+    stasis_testing_write_ascii("out/sub/c.txt", "c");
+    // A directory cycle that must not be followed
+    symlink("..", "out/sub/loop");
+}
+
+void test_jfrt_upload_files_add() {
+    struct testcase {
+        const char *pattern;
+        bool recursive;
+        bool flat;
+        const char *exclusions;
+        const char *targets[5];
+    };
+    const struct testcase tc[] = {
+        {.pattern = "out/*", .recursive = true, .exclusions = "*.txt",
+         .targets = {"repo/dest/a.whl", "repo/dest/fail.whl", "repo/dest/sub/b.whl"}},
+        {.pattern = "out/*", .recursive = true,
+         .targets = {"repo/dest/a.whl", "repo/dest/fail.whl", "repo/dest/sub/b.whl", "repo/dest/sub/c.txt"}},
+        {.pattern = "out/*.whl", .recursive = false,
+         .targets = {"repo/dest/a.whl", "repo/dest/fail.whl"}},
+        {.pattern = "out/sub/*", .recursive = true, .flat = true,
+         .targets = {"repo/dest/b.whl", "repo/dest/c.txt"}},
+        {.pattern = "out/sub", .recursive = true,
+         .targets = {"repo/dest/b.whl", "repo/dest/c.txt"}},
+        {.pattern = "out/sub/c.txt", .recursive = true,
+         .targets = {"repo/dest/c.txt"}},
+    };
+    make_tree();
+
+    for (size_t i = 0; i < sizeof(tc) / sizeof(*tc); i++) {
+        struct JFRT_Upload upload;
+        jfrt_upload_init(&upload);
+        upload.recursive = tc[i].recursive;
+        upload.flat = tc[i].flat;
+        upload.exclusions = (char *) tc[i].exclusions;
+
+        struct JFRT_UploadFiles *files = jfrt_upload_files_init();
+        STASIS_ASSERT_FATAL(files != NULL, "unable to allocate upload list");
+        size_t expected = 0;
+        while (expected < sizeof(tc[i].targets) / sizeof(*tc[i].targets) && tc[i].targets[expected]) {
+            expected++;
+        }
+        const ssize_t count = jfrt_upload_files_add(files, &upload, tc[i].pattern, "repo/dest");
+        STASIS_ASSERT(count == (ssize_t) expected, "unexpected number of files matched");
+        for (size_t f = 0; count > 0 && f < files->num_used && f < expected; f++) {
+            STASIS_ASSERT(!strcmp(files->file[f].target, tc[i].targets[f]), "unexpected upload target");
+            STASIS_ASSERT(files->file[f].src[0] == '/', "source path should be absolute");
+        }
+        jfrt_upload_files_free(&files);
+        STASIS_ASSERT(files == NULL, "upload list should be NULL after release");
+    }
+    rmtree("out");
+}
+
+void test_jfrog_cli_rt_upload_files() {
+    make_tree();
+    remove("jf.log");
+    remove("remote.txt");
+
+    struct JFRT_Upload upload;
+    jfrt_upload_init(&upload);
+    upload.threads = 5;
+    upload.build_name = "build";
+    upload.build_number = "1";
+
+    struct JFRT_UploadFiles *files = jfrt_upload_files_init();
+    STASIS_ASSERT_FATAL(files != NULL, "unable to allocate upload list");
+    STASIS_ASSERT(jfrt_upload_files_add(files, &upload, "out/*.whl", "repo/dest/") == 3, "unexpected number of files matched");
+    STASIS_ASSERT(jfrog_cli_rt_upload_files(&auth, &upload, files) == 1, "one file should have failed to upload");
+
+    for (size_t i = 0; i < files->num_used; i++) {
+        const struct JFRT_UploadFile *file = &files->file[i];
+        if (strstr(file->src, "fail")) {
+            STASIS_ASSERT(file->status != 0, "failed upload should be reported");
+            STASIS_ASSERT(!strlen(file->sha256), "failed upload should have no checksum");
+        } else {
+            char digest[SHA256_HEX_SIZE] = {0};
+            sha256_file(file->src, digest);
+            STASIS_ASSERT(file->status == 0, "uploaded file should be reported");
+            STASIS_ASSERT(!strcmp(file->sha256, digest), "checksum reported by jf was not recorded");
+        }
+    }
+
+    char **log = file_readlines("jf.log", 0, 0, NULL);
+    STASIS_ASSERT_FATAL(log != NULL, "jf was not executed");
+    size_t invocations = 0;
+    for (size_t i = 0; log[i] != NULL; i++) {
+        invocations++;
+    }
+    STASIS_ASSERT(invocations == 1, "files should be uploaded with one jf invocation");
+    STASIS_ASSERT(strstr(log[0], "rt upload") != NULL, "jf should have been asked to upload");
+    STASIS_ASSERT(strstr(log[0], "--threads=5") != NULL, "thread count was not passed to jf");
+    STASIS_ASSERT(strstr(log[0], "--build-name=build") != NULL, "build name was not passed to jf");
+    STASIS_ASSERT(strstr(log[0], "--detailed-summary") != NULL, "detailed summary was not requested");
+    guard_array_free(log);
+
+    jfrt_upload_files_free(&files);
+    remove("jf.log");
+    remove("remote.txt");
+    rmtree("out");
+}
+
+void test_jfrog_cli_rt_upload_files_spec() {
+    mkdirs("odd", 0755);
+    stasis_testing_write_ascii("odd/w(1)[x]*?.whl", "odd");
+    stasis_testing_write_ascii("odd/tab\t.whl", "tab");
+    stasis_testing_write_ascii("odd/brace}.whl", "brace");
+    remove("spec.json");
+
+    struct JFRT_Upload upload;
+    jfrt_upload_init(&upload);
+    upload.target_props = "a=1\nb=2";
+
+    struct JFRT_UploadFiles *files = jfrt_upload_files_init();
+    STASIS_ASSERT_FATAL(files != NULL, "unable to allocate upload list");
+    STASIS_ASSERT(jfrt_upload_files_add(files, &upload, "odd", "repo/dest") == 3, "unexpected number of files matched");
+    jfrog_cli_rt_upload_files(&auth, &upload, files);
+
+    // A brace in a path does not end the record in the summary
+    const struct JFRT_UploadFile *brace = upload_files_get(files, "brace}.whl");
+    STASIS_ASSERT_FATAL(brace != NULL, "file with a brace in its name was not matched");
+    char digest[SHA256_HEX_SIZE] = {0};
+    sha256_file(brace->src, digest);
+    STASIS_ASSERT(brace->status == 0, "file with a brace in its name should be reported as uploaded");
+    STASIS_ASSERT(!strcmp(brace->sha256, digest), "checksum of a file with a brace in its name was not recorded");
+
+    char *spec = stasis_testing_read_ascii("spec.json");
+    STASIS_ASSERT_FATAL(spec != NULL, "jf did not receive a file spec");
+    STASIS_ASSERT(strstr(spec, "/odd/w\\\\(1\\\\)\\\\[x\\\\]\\\\*\\\\?.whl\"") != NULL, "wildcards in file names should be escaped");
+    STASIS_ASSERT(strstr(spec, "/odd/tab\\t.whl\"") != NULL, "control characters should be escaped");
+    STASIS_ASSERT(strstr(spec, "\"targetProps\": \"a=1\\nb=2\"") != NULL, "control characters should be escaped");
+    guard_free(spec);
+
+    char *python = find_program("python3");
+    if (python) {
+        char cmd[PATH_MAX] = {0};
+        snprintf(cmd, sizeof(cmd), "%s -c 'import json, sys; json.load(open(sys.argv[1]))' spec.json", python);
+        int status = 0;
+        char *result = shell_output(cmd, &status);
+        STASIS_ASSERT(status == 0, "file spec should be valid JSON");
+        guard_free(result);
+    }
+
+    jfrt_upload_files_free(&files);
+    remove("jf.log");
+    remove("spec.json");
+    remove("remote.txt");
+    rmtree("odd");
+}
+
+void test_jfrog_cli_rt_upload_files_unchanged() {
+    struct testcase {
+        const char *modify; // file to change before uploading
+        const char *delete; // file to remove from the repository before uploading
+        bool verify;
+        bool build; // attach the upload to a build
+        size_t searches; // expected number of jf searches
+        size_t uploads; // expected number of jf uploads
+        const char *skipped[3]; // expected skipped files
+    };
+    const struct testcase tc[] = {
+        // Nothing was uploaded yet
+        {.uploads = 1},
+        // fail.whl was never uploaded, so it is retried
+        {.uploads = 1, .skipped = {"a.whl", "b.whl"}},
+        {.verify = true, .searches = 1, .uploads = 1, .skipped = {"a.whl", "b.whl"}},
+        // Unchanged files must be part of the build info
+        {.build = true, .verify = true, .uploads = 1},
+        {.modify = "out/a.whl", .uploads = 1, .skipped = {"b.whl"}},
+        // Without verification, a file removed from the repository is not noticed
+        {.delete = "repo/dest/b.whl", .uploads = 1, .skipped = {"a.whl", "b.whl"}},
+        {.delete = "repo/dest/b.whl", .verify = true, .searches = 1, .uploads = 1, .skipped = {"a.whl"}},
+    };
+    mkdirs("out", 0755);
+    stasis_testing_write_ascii("out/a.whl", "a");
+    stasis_testing_write_ascii("out/b.whl", "b");
+    stasis_testing_write_ascii("out/fail.whl", "fail");
+    remove("jf.log");
+    remove("remote.txt");
+    rmtree("manifest");
+
+    for (size_t i = 0; i < sizeof(tc) / sizeof(*tc); i++) {
+        if (tc[i].modify) {
+            stasis_testing_write_ascii(tc[i].modify, "modified");
+        }
+        if (tc[i].delete) {
+            char cmd[PATH_MAX] = {0};
+            snprintf(cmd, sizeof(cmd), "grep -v ' %s$' remote.txt > remote.tmp; mv remote.tmp remote.txt", tc[i].delete);
+            system(cmd);
+        }
+        remove("jf.log");
+
+        struct JFRT_Upload upload;
+        jfrt_upload_init(&upload);
+        upload.manifest = "manifest/uploads";
+        upload.manifest_verify = tc[i].verify;
+        if (tc[i].build) {
+            upload.build_name = "build";
+            upload.build_number = "2";
+        }
+
+        struct JFRT_UploadFiles *files = jfrt_upload_files_init();
+        STASIS_ASSERT_FATAL(files != NULL, "unable to allocate upload list");
+        STASIS_ASSERT(jfrt_upload_files_add(files, &upload, "out/*.whl", "repo/dest") == 3, "unexpected number of files matched");
+        STASIS_ASSERT(jfrog_cli_rt_upload_files(&auth, &upload, files) == 1, "only fail.whl should have failed to upload");
+        STASIS_ASSERT(jf_invocations("rt search") == tc[i].searches, "unexpected number of searches");
+        STASIS_ASSERT(jf_invocations("rt upload") == tc[i].uploads, "unexpected number of uploads");
+
+        const char *names[] = {"a.whl", "b.whl", "fail.whl"};
+        for (size_t n = 0; n < sizeof(names) / sizeof(*names); n++) {
+            const struct JFRT_UploadFile *file = upload_files_get(files, names[n]);
+            STASIS_ASSERT_FATAL(file != NULL, "file missing from upload list");
+            bool expect_skipped = false;
+            for (size_t k = 0; k < sizeof(tc[i].skipped) / sizeof(*tc[i].skipped) && tc[i].skipped[k]; k++) {
+                expect_skipped |= !strcmp(tc[i].skipped[k], names[n]);
+            }
+            STASIS_ASSERT(!!file->skipped == expect_skipped, "unexpected skip decision");
+            if (!file->skipped) {
+                char *spec = stasis_testing_read_ascii("spec.json");
+                STASIS_ASSERT(spec && strstr(spec, names[n]), "file should be in the upload spec");
+                guard_free(spec);
+            }
+            if (file->skipped) {
+                STASIS_ASSERT(file->status == 0, "skipped file should be reported as uploaded");
+                STASIS_ASSERT(!strcmp(file->sha256, file->digest), "skipped file should report its checksum");
+            }
+        }
+        jfrt_upload_files_free(&files);
+    }
+
+    char *manifest = stasis_testing_read_ascii("manifest/uploads");
+    STASIS_ASSERT_FATAL(manifest != NULL, "manifest was not written");
+    STASIS_ASSERT(strstr(manifest, " repo/dest/a.whl\n") != NULL, "a.whl should be recorded");
+    STASIS_ASSERT(strstr(manifest, " repo/dest/b.whl\n") != NULL, "b.whl should be recorded");
+    STASIS_ASSERT(strstr(manifest, "fail.whl") == NULL, "failed uploads should not be recorded");
+    guard_free(manifest);
+
+    remove("jf.log");
+    remove("remote.txt");
+    rmtree("manifest");
+    rmtree("out");
+}
+
+int main(int argc, char *argv[]) {
+    STASIS_TEST_BEGIN_MAIN();
+    mkdirs("bin", 0755);
+    stasis_testing_write_ascii("bin/jf", jf_standin);
+    chmod("bin/jf", 0755);
+
+    char path[PATH_MAX] = {0};
+    char *cwd = realpath(".", NULL);
+    snprintf(path, sizeof(path), "%s/bin:%s", cwd, getenv("PATH"));
+    setenv("PATH", path, 1);
+    setenv("JF_URL", auth.url, 1);
+    guard_free(cwd);
+
+    STASIS_TEST_FUNC *tests[] = {
+        test_jfrt_upload_files_add,
+        test_jfrog_cli_rt_upload_files,
+        test_jfrog_cli_rt_upload_files_spec,
+        test_jfrog_cli_rt_upload_files_unchanged,
+    };
+    STASIS_TEST_RUN(tests);
+    STASIS_TEST_END_MAIN();
+}
@@ -0,0 +1,101 @@
+#include "testing.h"
+#include "content_manifest.h"
+
+static const char *manifest_file = "content_manifest_test/manifest";
+
+static void setup_tree(void) {
+    mkdirs("content_manifest_test/prev/sub", 0755);
+    mkdirs("content_manifest_test/work/sub", 0755);
+    stasis_testing_write_ascii("content_manifest_test/work/sub/page.md", "# hello");
+    stasis_testing_write_ascii("content_manifest_test/work/style.css", "body {}");
+}
+
+/**
+ * Simulate one run of a program that converts page.md to page.html, then copies the results to prev/
+ * @return 1 if page.html was reused
+ */
+static int run_once(const char *prev_root, const char **value) {
+    char cwd[PATH_MAX] = {0};
+    char work[PATH_MAX] = {0};
+    getcwd(cwd, sizeof(cwd));
+    snprintf(work, sizeof(work), "%s/content_manifest_test/work", cwd);
+
+    struct ContentManifest *manifest = content_manifest_open(manifest_file, prev_root, work);
+    STASIS_ASSERT_FATAL(manifest != NULL, "unable to open manifest");
+    char page_md[PATH_MAX] = {0};
+    snprintf(page_md, sizeof(page_md), "%s/sub/page.md", work);
+    char *inputs[] = {page_md, "content_manifest_test/work/style.css"};
+    char digest[SHA256_HEX_SIZE] = {0};
+    STASIS_ASSERT(content_manifest_digest(manifest, inputs, 2, "converter", digest) == 0, "unable to compute digest");
+
+    static char value_buf[255];
+    const char *result = NULL;
+    int reused = content_manifest_reuse(manifest, "sub/page.html", digest, &result);
+    if (!reused) {
+        char *page = stasis_testing_read_ascii("content_manifest_test/work/sub/page.md");
+        stasis_testing_write_ascii("content_manifest_test/work/sub/page.html", page);
+        guard_free(page);
+        STASIS_ASSERT(content_manifest_store(manifest, "sub/page.html", digest, "row\twith\\special\ncharacters") == 0, "unable to store output");
+        result = "row\twith\\special\ncharacters";
+    }
+    value_buf[0] = '\0';
+    if (result) {
+        safe_strncpy(value_buf, result, sizeof(value_buf));
+    }
+    *value = value_buf;
+
+    STASIS_ASSERT(content_manifest_save(manifest) == 0, "unable to save manifest");
+    content_manifest_free(&manifest);
+    STASIS_ASSERT(manifest == NULL, "manifest pointer should be NULL");
+
+    // Publish the outputs
+    rmtree("content_manifest_test/prev");
+    mkdirs("content_manifest_test/prev/sub", 0755);
+    copy2("content_manifest_test/work/sub/page.html", "content_manifest_test/prev/sub/page.html", CT_PERM);
+    remove("content_manifest_test/work/sub/page.html");
+    return reused;
+}
+
+void test_content_manifest() {
+    const char *value = NULL;
+    setup_tree();
+    const char *prev = "content_manifest_test/prev";
+
+    STASIS_ASSERT(run_once(prev, &value) == 0, "first run should generate the output");
+    STASIS_ASSERT(run_once(prev, &value) == 1, "unchanged inputs should reuse the output");
+    STASIS_ASSERT(strcmp(value, "row\twith\\special\ncharacters") == 0, "value did not survive the round trip");
+    STASIS_ASSERT(access("content_manifest_test/work/sub/page.html", F_OK) != 0, "output should be published");
+
+    // Reuse restores the output under the work directory
+    char *data = stasis_testing_read_ascii("content_manifest_test/prev/sub/page.html");
+    STASIS_ASSERT(data && strcmp(data, "# hello") == 0, "restored output has unexpected contents");
+    guard_free(data);
+
+    // Modifying an input regenerates the output
+    stasis_testing_write_ascii("content_manifest_test/work/style.css", "body {color: red}");
+    STASIS_ASSERT(run_once(prev, &value) == 0, "modified input should regenerate the output");
+    STASIS_ASSERT(run_once(prev, &value) == 1, "output should be reused again");
+
+    // A missing previous output is regenerated
+    remove("content_manifest_test/prev/sub/page.html");
+    STASIS_ASSERT(run_once(prev, &value) == 0, "missing output should be regenerated");
+
+    // Without a previous root, nothing is reused
+    STASIS_ASSERT(run_once(NULL, &value) == 0, "reuse should be disabled");
+
+    // A corrupt manifest is ignored
+    stasis_testing_write_ascii(manifest_file, "garbage\n");
+    STASIS_ASSERT(run_once(prev, &value) == 0, "corrupt manifest should be ignored");
+    STASIS_ASSERT(run_once(prev, &value) == 1, "manifest should be usable after rewrite");
+
+    rmtree("content_manifest_test");
+}
+
+int main(int argc, char *argv[]) {
+    STASIS_TEST_BEGIN_MAIN();
+    STASIS_TEST_FUNC *tests[] = {
+        test_content_manifest,
+    };
+    STASIS_TEST_RUN(tests);
+    STASIS_TEST_END_MAIN();
+}
@@ -26,7 +26,7 @@ void test_copy() {
 
         STASIS_ASSERT(copy2(test->in_file, test->out_file, CT_OWNER | CT_PERM) == test->expect_return, "copy2 failed");
         STASIS_ASSERT(stat(test->in_file, &st_a) == 0, "source stat failed");
-        STASIS_ASSERT(stat(test->in_file, &st_b) == 0, "destination stat failed");
+        STASIS_ASSERT(stat(test->out_file, &st_b) == 0, "destination stat failed");
         STASIS_ASSERT(st_b.st_size == test->expect_size, "destination file is not the expected size");
         STASIS_ASSERT(st_a.st_size == st_b.st_size, "source and destination files should be the same size");
         STASIS_ASSERT(st_a.st_mode == st_b.st_mode, "source and destination files should have the same permissions");
@@ -34,10 +34,57 @@ void test_copy() {
     }
 }
 
+void test_copy2_ex() {
+    const char *in_file = "file_to_copy_ex.bin";
+    const char *out_file = "file_copied_ex.bin";
+    // Larger than COPY_BUFFER_SIZE, and not a multiple of it
+    const size_t size = COPY_BUFFER_SIZE * 3 + 123;
+
+    char *data = malloc(size + 1);
+    STASIS_ASSERT_FATAL(data != NULL, "unable to allocate test data");
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (char) ('a' + (i * 7 + i / 4096) % 26);
+    }
+    data[size] = '\0';
+    stasis_testing_write_ascii(in_file, data);
+
+    enum CopyMethod method = COPY_METHOD_NONE;
+    STASIS_ASSERT(copy2_ex(in_file, out_file, CT_PERM, &method) == 0, "copy2_ex failed");
+    STASIS_ASSERT(method == COPY_METHOD_REFLINK
+                  || method == COPY_METHOD_COPY_FILE_RANGE
+                  || method == COPY_METHOD_SENDFILE
+                  || method == COPY_METHOD_BUFFER, "unexpected copy method for a regular file");
+    STASIS_ASSERT(strcmp(copy_method_str(method), "none") != 0, "copy method should have a name");
+
+    char *copied = stasis_testing_read_ascii(out_file);
+    STASIS_ASSERT_FATAL(copied != NULL, "unable to read destination file");
+    STASIS_ASSERT(strlen(copied) == size && memcmp(copied, data, size) == 0, "destination file content is incorrect");
+    guard_free(copied);
+    guard_free(data);
+
+    // Overwrite an existing destination with an empty file
+    stasis_testing_write_ascii(in_file, "");
+    STASIS_ASSERT(copy2_ex(in_file, out_file, CT_PERM, &method) == 0, "copy2_ex failed on empty file");
+    struct stat st;
+    STASIS_ASSERT(stat(out_file, &st) == 0 && st.st_size == 0, "destination file should be empty");
+
+    const char *link_file = "file_copied_ex.link";
+    remove(link_file);
+    STASIS_ASSERT_FATAL(symlink(in_file, link_file) == 0, "unable to create symlink");
+    STASIS_ASSERT(copy2_ex(link_file, out_file, 0, &method) == 0, "copy2_ex failed on symlink");
+    STASIS_ASSERT(method == COPY_METHOD_SYMLINK, "symbolic link should be reproduced as a link");
+    STASIS_ASSERT(lstat(out_file, &st) == 0 && S_ISLNK(st.st_mode), "destination should be a symbolic link");
+
+    remove(link_file);
+    remove(out_file);
+    remove(in_file);
+}
+
 int main(int argc, char *argv[]) {
     STASIS_TEST_BEGIN_MAIN();
     STASIS_TEST_FUNC *tests[] = {
         test_copy,
+        test_copy2_ex,
     };
     STASIS_TEST_RUN(tests);
     STASIS_TEST_END_MAIN();
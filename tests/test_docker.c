@@ -54,20 +54,61 @@ void test_docker_build_and_script_and_save() {
     }
 }
 
+void test_docker_compression_command() {
+    struct testcase {
+        const char *program;
+        long threads;
+        const char *cmd;
+        const char *ext;
+    };
+    const struct testcase tc[] = {
+        {.program = "zstd", .threads = 4, .cmd = "zstd -T4", .ext = "zst"},
+        {.program = "zstd -10 --long", .threads = 8, .cmd = "zstd -T8 -10 --long", .ext = "zst"},
+        {.program = "zstd -T2", .threads = 8, .cmd = "zstd -T2", .ext = "zst"},
+        {.program = "zstd --threads=2", .threads = 8, .cmd = "zstd --threads=2", .ext = "zst"},
+        {.program = "zstd", .threads = 0, .cmd = "zstd", .ext = "zst"},
+        {.program = "/usr/bin/xz -6", .threads = 3, .cmd = "/usr/bin/xz -T3 -6", .ext = "xz"},
+        {.program = "pigz -9", .threads = 2, .cmd = "pigz -p 2 -9", .ext = "gz"},
+        {.program = "pbzip2", .threads = 2, .cmd = "pbzip2 -p2", .ext = "bz2"},
+        {.program = "lbzip2", .threads = 2, .cmd = "lbzip2 -n 2", .ext = "bz2"},
+        {.program = "gzip -1", .threads = 1, .cmd = "gzip -1", .ext = "gz"},
+        {.program = "lz4 -9", .threads = 4, .cmd = "lz4 -9", .ext = "lz4"},
+    };
+    for (size_t i = 0; i < sizeof(tc) / sizeof(*tc); i++) {
+        char cmd[PATH_MAX] = {0};
+        char ext[255] = {0};
+        STASIS_ASSERT(docker_compression_command(tc[i].program, tc[i].threads, cmd, sizeof(cmd), ext, sizeof(ext)) == 0, "unable to build compression command");
+        STASIS_ASSERT(!strcmp(cmd, tc[i].cmd), "unexpected compression command");
+        STASIS_ASSERT(!strcmp(ext, tc[i].ext), "unexpected file name extension");
+    }
+
+    char cmd[PATH_MAX] = {0};
+    char ext[255] = {0};
+    STASIS_ASSERT(docker_compression_command("", 1, cmd, sizeof(cmd), ext, sizeof(ext)) != 0, "empty program should be rejected");
+    // gzip is only replaced when pigz is available
+    STASIS_ASSERT(docker_compression_command("gzip -9", 4, cmd, sizeof(cmd), ext, sizeof(ext)) == 0, "unable to build compression command");
+    STASIS_ASSERT(!strcmp(cmd, find_program("pigz") ? "pigz -p 4 -9" : "gzip -9"), "unexpected gzip replacement");
+}
+
 void test_docker_validate_compression_program() {
     STASIS_ASSERT(docker_validate_compression_program(STASIS_DOCKER_IMAGE_COMPRESSION) == 0, "baked-in compression program does not exist");
 }
 
 int main(int argc, char *argv[]) {
     STASIS_TEST_BEGIN_MAIN();
+    // These tests do not need a docker daemon
+    STASIS_TEST_FUNC *tests_offline[] = {
+            test_docker_sanitize_tag,
+            test_docker_compression_command,
+    };
+    STASIS_TEST_RUN(tests_offline);
     if (!docker_capable(&cap_suite)) {
-        return STASIS_TEST_SUITE_SKIP;
+        return stasis_testing_has_failed() ? STASIS_TEST_SUITE_FATAL : STASIS_TEST_SUITE_SKIP;
     }
     STASIS_TEST_FUNC *tests[] = {
             test_docker_capable,
             test_docker_exec,
             test_docker_build_and_script_and_save,
-            test_docker_sanitize_tag,
             test_docker_validate_compression_program,
     };
     STASIS_TEST_RUN(tests);
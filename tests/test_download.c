@@ -1,6 +1,135 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include "testing.h"
 #include "download.h"
 
+// A minimal HTTP server standing in for a remote host
+struct StandIn {
+    pid_t pid;
+    int port;
+};
+
+static const char *standin_log = "standin.log";
+static const char *standin_body = "It works!\n";
+static const char *standin_etag = "\"v1\"";
+
+static char standin_large_body[32768];
+
+static void standin_serve(const int sock) {
+    size_t flaky_hits = 0;
+    while (1) {
+        const int client = accept(sock, NULL, NULL);
+        if (client < 0) {
+            continue;
+        }
+        char request[STASIS_BUFSIZ] = {0};
+        size_t len = 0;
+        while (len < sizeof(request) - 1 && !strstr(request, "\r\n\r\n")) {
+            const ssize_t n = read(client, request + len, sizeof(request) - 1 - len);
+            if (n <= 0) {
+                break;
+            }
+            len += n;
+        }
+
+        char header[STASIS_BUFSIZ] = {0};
+        const char *body = "";
+        size_t body_len = 0;
+        int status = 200;
+        if (startswith(request, "GET /resource ")) {
+            if (strstr(request, standin_etag)) {
+                status = 304;
+                snprintf(header, sizeof(header),
+                    "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nConnection: close\r\n\r\n", standin_etag);
+            } else {
+                body = standin_body;
+                body_len = strlen(body);
+                snprintf(header, sizeof(header),
+                    "HTTP/1.1 200 OK\r\nETag: %s\r\nLast-Modified: Mon, 05 Oct 2023 00:00:00 GMT\r\n"
+                    "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                    standin_etag, body_len);
+            }
+        } else if (startswith(request, "GET /flaky ") && strstr(request, "If-None-Match:")) {
+            status = 304;
+            snprintf(header, sizeof(header),
+                "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nConnection: close\r\n\r\n", standin_etag);
+        } else if (startswith(request, "GET /flaky ")) {
+            // The first response is cut off halfway through the body
+            const char *range = strstr(request, "Range: bytes=");
+            const size_t offset = range ? strtoul(range + strlen("Range: bytes="), NULL, 10) : 0;
+            const size_t total = sizeof(standin_large_body);
+            body = standin_large_body + offset;
+            body_len = flaky_hits++ ? total - offset : total / 2;
+            if (range) {
+                status = 206;
+                snprintf(header, sizeof(header),
+                    "HTTP/1.1 206 Partial Content\r\nETag: %s\r\nContent-Range: bytes %zu-%zu/%zu\r\n"
+                    "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                    standin_etag, offset, total - 1, total, total - offset);
+            } else {
+                snprintf(header, sizeof(header),
+                    "HTTP/1.1 200 OK\r\nETag: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                    standin_etag, total);
+            }
+        } else {
+            status = 404;
+            snprintf(header, sizeof(header),
+                "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        }
+        // Record the request before responding, so the client never sees a stale log
+        FILE *fp = fopen(standin_log, "a");
+        if (fp) {
+            fprintf(fp, "%d\n", status);
+            fclose(fp);
+        }
+        write(client, header, strlen(header));
+        write(client, body, body_len);
+        close(client);
+    }
+}
+
+static int standin_start(struct StandIn *standin) {
+    struct sockaddr_in addr = {0};
+    socklen_t addr_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    const int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0
+        || bind(sock, (struct sockaddr *) &addr, sizeof(addr))
+        || listen(sock, 16)
+        || getsockname(sock, (struct sockaddr *) &addr, &addr_len)) {
+        return -1;
+    }
+    standin->port = ntohs(addr.sin_port);
+    remove(standin_log);
+    for (size_t i = 0; i < sizeof(standin_large_body); i++) {
+        standin_large_body[i] = (char) ('a' + i % 26);
+    }
+
+    standin->pid = fork();
+    if (standin->pid == 0) {
+        standin_serve(sock);
+        _exit(0);
+    }
+    close(sock);
+    return standin->pid < 0 ? -1 : 0;
+}
+
+static void standin_stop(struct StandIn *standin) {
+    kill(standin->pid, SIGTERM);
+    waitpid(standin->pid, NULL, 0);
+    remove(standin_log);
+}
+
+static char *standin_history() {
+    char *data = stasis_testing_read_ascii(standin_log);
+    return data ? data : strdup("");
+}
+
 void test_download() {
     enum MATCH_STYLE {
         match_begins=0,
@@ -53,10 +182,230 @@ void test_download() {
     }
 }
 
+void test_download_batch() {
+    char cwd[PATH_MAX] = {0};
+    STASIS_ASSERT_FATAL(getcwd(cwd, sizeof(cwd)) != NULL, "unable to determine working directory");
+    setenv("STASIS_DOWNLOAD_RETRY_MAX", "2", 1);
+    setenv("STASIS_DOWNLOAD_RETRY_SECONDS", "0", 1);
+
+    const char *sources[] = {
+        "batch_source_a.txt",
+        "batch_source_b.txt",
+        "batch_source_c.txt",
+    };
+    const char *contents[] = {
+        "first\n",
+        "second\n",
+        "third\n",
+    };
+    struct DownloadRequest req[4] = {0};
+    char urls[4][PATH_MAX] = {0};
+    char filenames[4][PATH_MAX] = {0};
+    const size_t count = sizeof(req) / sizeof(*req);
+    for (size_t i = 0; i < count; i++) {
+        if (i < sizeof(sources) / sizeof(*sources)) {
+            stasis_testing_write_ascii(sources[i], contents[i]);
+            snprintf(urls[i], sizeof(urls[i]), "file://%s/%s", cwd, sources[i]);
+        } else {
+            snprintf(urls[i], sizeof(urls[i]), "file://%s/%s", cwd, "batch_source_missing.txt");
+        }
+        snprintf(filenames[i], sizeof(filenames[i]), "batch_output_%zu.txt", i);
+        req[i].url = urls[i];
+        req[i].filename = filenames[i];
+    }
+
+    STASIS_ASSERT(download_batch(req, count) == 1, "one transfer should have failed");
+    for (size_t i = 0; i < count; i++) {
+        char *data = stasis_testing_read_ascii(filenames[i]);
+        if (i < sizeof(sources) / sizeof(*sources)) {
+            STASIS_ASSERT(req[i].http_code == 0, "file transfers should not report an HTTP code");
+            STASIS_ASSERT(req[i].attempts == 1, "successful transfer should not be retried");
+            STASIS_ASSERT(!strlen(req[i].errmsg), "unexpected error thrown by curl");
+            STASIS_ASSERT(data && !strcmp(data, contents[i]), "downloaded data does not match the source");
+            remove(sources[i]);
+        } else {
+            STASIS_ASSERT(req[i].http_code == -1, "http_code should be -1 on fatal curl error");
+            STASIS_ASSERT(req[i].attempts == 2, "failed transfer should be retried STASIS_DOWNLOAD_RETRY_MAX times");
+            STASIS_ASSERT(strlen(req[i].errmsg), "an error should have been thrown by curl, but wasn't");
+        }
+        guard_free(data);
+        remove(filenames[i]);
+    }
+
+    // download() runs as a batch of one
+    stasis_testing_write_ascii(sources[0], contents[0]);
+    char *errmsg = NULL;
+    STASIS_ASSERT(download(urls[0], filenames[0], &errmsg) == 0, "file transfer should not report an HTTP code");
+    STASIS_ASSERT(errmsg == NULL, "errmsg should not be allocated on success");
+    STASIS_ASSERT(download(urls[count - 1], filenames[0], &errmsg) == -1, "http_code should be -1 on fatal curl error");
+    STASIS_ASSERT(errmsg && strlen(errmsg), "errmsg should be allocated on fatal curl error");
+    guard_free(errmsg);
+    remove(sources[0]);
+    remove(filenames[0]);
+
+    unsetenv("STASIS_DOWNLOAD_RETRY_MAX");
+    unsetenv("STASIS_DOWNLOAD_RETRY_SECONDS");
+    download_session_cleanup();
+}
+
+void test_download_cache() {
+    struct StandIn standin = {0};
+    STASIS_ASSERT_FATAL(standin_start(&standin) == 0, "unable to start HTTP stand-in server");
+
+    char cwd[PATH_MAX] = {0};
+    STASIS_ASSERT_FATAL(getcwd(cwd, sizeof(cwd)) != NULL, "unable to determine working directory");
+    char cache_dir[PATH_MAX] = {0};
+    snprintf(cache_dir, sizeof(cache_dir), "%s/http_cache", cwd);
+    globals.download_cache_dir = strdup(cache_dir);
+
+    char url[PATH_MAX] = {0};
+    char url_missing[PATH_MAX] = {0};
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/resource", standin.port);
+    snprintf(url_missing, sizeof(url_missing), "http://127.0.0.1:%d/other", standin.port);
+    const char *filename = "cached.txt";
+
+    struct testcase {
+        const char *ttl;
+        const char *offline;
+        const char *url;
+        long http_code;
+        int cached;
+        const char *history;
+    };
+    const struct testcase tc[] = {
+        // Fetched from the server and stored
+        {.url = url, .http_code = 200, .cached = 0, .history = "200\n"},
+        // Revalidated with If-None-Match and served from the cache
+        {.url = url, .http_code = 200, .cached = 1, .history = "200\n304\n"},
+        // Fresh entries skip the server
+        {.ttl = "3600", .url = url, .http_code = 200, .cached = 1, .history = "200\n304\n"},
+        // Offline mode serves cached files only
+        {.offline = "1", .url = url, .http_code = 200, .cached = 1, .history = "200\n304\n"},
+        {.offline = "1", .url = url_missing, .http_code = -1, .cached = 0, .history = "200\n304\n"},
+        // Errors are not cached
+        {.url = url_missing, .http_code = 404, .cached = 0, .history = "200\n304\n404\n"},
+        {.url = url_missing, .http_code = 404, .cached = 0, .history = "200\n304\n404\n404\n"},
+    };
+
+    for (size_t i = 0; i < sizeof(tc) / sizeof(*tc); i++) {
+        if (tc[i].ttl) {
+            setenv("STASIS_DOWNLOAD_CACHE_TTL", tc[i].ttl, 1);
+        } else {
+            unsetenv("STASIS_DOWNLOAD_CACHE_TTL");
+        }
+        if (tc[i].offline) {
+            setenv("STASIS_DOWNLOAD_OFFLINE", tc[i].offline, 1);
+        } else {
+            unsetenv("STASIS_DOWNLOAD_OFFLINE");
+        }
+
+        struct DownloadRequest req = {.url = tc[i].url, .filename = filename};
+        download_batch(&req, 1);
+        STASIS_ASSERT(req.http_code == tc[i].http_code, "unexpected HTTP code");
+        STASIS_ASSERT(req.cached == tc[i].cached, "unexpected cache usage");
+        if (req.http_code == 200) {
+            char *data = stasis_testing_read_ascii(filename);
+            STASIS_ASSERT(data && !strcmp(data, standin_body), "downloaded data does not match the server's");
+            guard_free(data);
+        }
+        char *history = standin_history();
+        STASIS_ASSERT(!strcmp(history, tc[i].history), "unexpected requests sent to the server");
+        guard_free(history);
+        remove(filename);
+    }
+
+    unsetenv("STASIS_DOWNLOAD_CACHE_TTL");
+    unsetenv("STASIS_DOWNLOAD_OFFLINE");
+    standin_stop(&standin);
+    rmtree(cache_dir);
+    guard_free(globals.download_cache_dir);
+    download_session_cleanup();
+}
+
+void test_download_resume() {
+    struct StandIn standin = {0};
+    STASIS_ASSERT_FATAL(standin_start(&standin) == 0, "unable to start HTTP stand-in server");
+    setenv("STASIS_DOWNLOAD_RETRY_MAX", "3", 1);
+    setenv("STASIS_DOWNLOAD_RETRY_SECONDS", "0", 1);
+
+    char url[PATH_MAX] = {0};
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/flaky", standin.port);
+    const char *filename = "resumed.bin";
+    char part[PATH_MAX] = {0};
+    snprintf(part, sizeof(part), "%s.part", filename);
+
+    struct SHA256 ctx;
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    char expected[SHA256_HEX_SIZE] = {0};
+    sha256_init(&ctx);
+    sha256_update(&ctx, standin_large_body, sizeof(standin_large_body));
+    sha256_final(&ctx, digest);
+    sha256_hex(digest, expected);
+
+    // The interrupted transfer resumes where it stopped
+    struct DownloadRequest req = {.url = url, .filename = filename, .sha256 = expected};
+    STASIS_ASSERT(download_batch(&req, 1) == 0, "transfer should have been resumed");
+    STASIS_ASSERT(req.http_code == 206, "resumed transfer should end with a partial content response");
+    STASIS_ASSERT(req.attempts == 2, "transfer should have needed two attempts");
+    STASIS_ASSERT(!strcmp(req.digest, expected), "digest computed during the transfer is incorrect");
+    STASIS_ASSERT(access(part, F_OK) != 0, "partial file should have been renamed");
+    char *history = standin_history();
+    STASIS_ASSERT(!strcmp(history, "200\n206\n"), "unexpected requests sent to the server");
+    guard_free(history);
+
+    char hash[SHA256_HEX_SIZE] = {0};
+    STASIS_ASSERT(sha256_file(filename, hash) == 0 && !strcmp(hash, expected), "resumed file is corrupt");
+    remove(filename);
+
+    // The resumed file is complete, so it was cached
+    char cwd[PATH_MAX] = {0};
+    STASIS_ASSERT_FATAL(getcwd(cwd, sizeof(cwd)) != NULL, "unable to determine working directory");
+    char cache_dir[PATH_MAX] = {0};
+    snprintf(cache_dir, sizeof(cache_dir), "%s/http_cache_resume", cwd);
+    globals.download_cache_dir = strdup(cache_dir);
+    standin_stop(&standin);
+    STASIS_ASSERT_FATAL(standin_start(&standin) == 0, "unable to restart HTTP stand-in server");
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/flaky", standin.port);
+    struct DownloadRequest req_first = {.url = url, .filename = filename, .sha256 = expected};
+    STASIS_ASSERT(download_batch(&req_first, 1) == 0, "transfer should have been resumed");
+    STASIS_ASSERT(req_first.http_code == 206 && !req_first.cached, "first transfer should come from the server");
+    struct DownloadRequest req_again = {.url = url, .filename = filename, .sha256 = expected};
+    STASIS_ASSERT(download_batch(&req_again, 1) == 0, "cached transfer should succeed");
+    STASIS_ASSERT(req_again.cached, "resumed file should have been served from the cache");
+    STASIS_ASSERT(req_again.http_code == 200, "cached resumed file should report a complete response");
+    STASIS_ASSERT(sha256_file(filename, hash) == 0 && !strcmp(hash, expected), "cached file is corrupt");
+    history = standin_history();
+    STASIS_ASSERT(!strcmp(history, "200\n206\n304\n"), "unexpected requests sent to the server");
+    guard_free(history);
+    remove(filename);
+    rmtree(cache_dir);
+    guard_free(globals.download_cache_dir);
+
+    // A digest mismatch never reaches the destination
+    char wrong[SHA256_HEX_SIZE] = {0};
+    memset(wrong, '0', SHA256_HEX_SIZE - 1);
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/resource", standin.port);
+    struct DownloadRequest req_bad = {.url = url, .filename = filename, .sha256 = wrong};
+    STASIS_ASSERT(download_batch(&req_bad, 1) == 1, "digest mismatch should fail the transfer");
+    STASIS_ASSERT(req_bad.http_code == -1, "http_code should be -1 on digest mismatch");
+    STASIS_ASSERT(req_bad.attempts == 3, "digest mismatch should be retried");
+    STASIS_ASSERT(strstr(req_bad.errmsg, "sha256 mismatch") != NULL, "errmsg should describe the digest mismatch");
+    STASIS_ASSERT(access(filename, F_OK) != 0, "file with a mismatched digest should not exist");
+    STASIS_ASSERT(access(part, F_OK) != 0, "partial file should have been removed");
+
+    unsetenv("STASIS_DOWNLOAD_RETRY_MAX");
+    unsetenv("STASIS_DOWNLOAD_RETRY_SECONDS");
+    standin_stop(&standin);
+    download_session_cleanup();
+}
+
 int main(int argc, char *argv[]) {
     STASIS_TEST_BEGIN_MAIN();
     STASIS_TEST_FUNC *tests[] = {
             test_download,
+            test_download_batch,
+            test_download_cache,
+            test_download_resume,
     };
     STASIS_TEST_RUN(tests);
     STASIS_TEST_END_MAIN();
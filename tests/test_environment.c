@@ -4,10 +4,10 @@
 
 void test_runtime_copy() {
     RuntimeEnv *env = runtime_copy(environ);
-    STASIS_ASSERT(env->data != environ, "copied array is not unique");
+    STASIS_ASSERT(runtime_envp(env) != environ, "copied array is not unique");
     int difference = 0;
-    for (size_t i = 0; i < strlist_count(env); i++) {
-        char *item = strlist_item(env, i);
+    for (size_t i = 0; i < runtime_count(env); i++) {
+        char *item = runtime_envp(env)[i];
         if (!strstr_array(environ, item)) {
             difference++;
         }
@@ -19,7 +19,7 @@ void test_runtime_copy() {
 void test_runtime_copy_empty() {
     char **empty_env = calloc(1, sizeof(empty_env));
     RuntimeEnv *env = runtime_copy(empty_env);
-    STASIS_ASSERT(env->num_inuse == 0, "copied array isn't empty");
+    STASIS_ASSERT(runtime_count(env) == 0, "copied array isn't empty");
     guard_array_free(empty_env);
     runtime_free(env);
 }
@@ -29,7 +29,7 @@ void test_runtime() {
     runtime_set(env, "CUSTOM_KEY", "Very custom");
     ssize_t idx;
     STASIS_ASSERT((idx = runtime_contains(env, "CUSTOM_KEY")) >= 0, "CUSTOM_KEY should exist in object");
-    STASIS_ASSERT(strcmp(strlist_item(env, idx), "CUSTOM_KEY=Very custom") == 0, "Incorrect index returned by runtime_contains");
+    STASIS_ASSERT(strcmp(runtime_envp(env)[idx], "CUSTOM_KEY=Very custom") == 0, "Incorrect index returned by runtime_contains");
 
     char *custom_value = runtime_get(env, "CUSTOM_KEY");
     STASIS_ASSERT_FATAL(custom_value != NULL, "CUSTOM_KEY should not be NULL");
@@ -71,12 +71,49 @@ void test_runtime() {
     // requires dumping stdout to a file and comparing it with the current environment array
 }
 
+void test_runtime_envp() {
+    char *vars[] = {
+        "A=1",
+        "B=2=3",
+        "A_LONGER_NAME=4",
+        "A=ignored",
+        NULL,
+    };
+    RuntimeEnv *env = runtime_copy(vars);
+    STASIS_ASSERT_FATAL(env != NULL, "runtime_copy failed");
+    STASIS_ASSERT(runtime_count(env) == 3, "duplicate variable should not be copied");
+
+    char *value = runtime_get(env, "A");
+    STASIS_ASSERT(value && strcmp(value, "1") == 0, "first definition of a variable should win");
+    guard_free(value);
+    value = runtime_get(env, "B");
+    STASIS_ASSERT(value && strcmp(value, "2=3") == 0, "value containing '=' was truncated");
+    guard_free(value);
+    STASIS_ASSERT(runtime_get(env, "A_") == NULL, "partial variable name should not match");
+
+    // Enough new variables to force the index to grow
+    for (size_t i = 0; i < 1000; i++) {
+        char key[32] = {0};
+        snprintf(key, sizeof(key), "VAR_%zu", i);
+        runtime_set(env, key, "value");
+    }
+    runtime_set(env, "A", "${B}");
+    STASIS_ASSERT(runtime_count(env) == 1003, "unexpected number of variables");
+    STASIS_ASSERT(runtime_contains(env, "VAR_999") == 1002, "variable index is incorrect");
+
+    char **envp = runtime_envp(env);
+    STASIS_ASSERT(envp[runtime_count(env)] == NULL, "envp is not NULL terminated");
+    STASIS_ASSERT(strcmp(envp[0], "A=2=3") == 0, "runtime_set did not replace the record in place");
+    guard_runtime_free(env);
+}
+
 int main(int argc, char *argv[], char *arge[]) {
     STASIS_TEST_BEGIN_MAIN();
     STASIS_TEST_FUNC *tests[] = {
         test_runtime_copy,
         test_runtime_copy_empty,
         test_runtime,
+        test_runtime_envp,
     };
     STASIS_TEST_RUN(tests);
     STASIS_TEST_END_MAIN();
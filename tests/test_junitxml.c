@@ -77,11 +77,61 @@ void test_junitxml_testsuite_read_error() {
     junitxml_testsuite_free(&testsuite);
 }
 
+void test_junitxml_testsuite_read_large() {
+    const char *filename = "test_junitxml_large.xml";
+    const size_t count = 20000;
+    FILE *fp = fopen(filename, "w");
+    STASIS_ASSERT_FATAL(fp != NULL, "unable to create test suite data");
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"utf-8\"?><testsuites>"
+                "<testsuite name=\"large\" errors=\"0\" failures=\"1\" skipped=\"1\" tests=\"%zu\" time=\"1.5\">", count);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(fp, "<testcase classname=\"test_large\" name=\"test_%zu\" time=\"0.25\">", i);
+        if (i == 1) {
+            fprintf(fp, "<failure message=\"assert 1 &lt; 0 &amp;&amp; &quot;x&quot;\">%s</failure>", "traceback");
+        } else if (i == 2) {
+            fprintf(fp, "<skipped type=\"pytest.skip\" message=\"skip\"/>");
+        } else {
+            fprintf(fp, "<system-out>output</system-out>");
+        }
+        fprintf(fp, "</testcase>");
+    }
+    fprintf(fp, "</testsuite></testsuites>\n");
+    fclose(fp);
+
+    struct JUNIT_Testsuite *testsuite = junitxml_testsuite_read(filename);
+    STASIS_ASSERT_FATAL(testsuite != NULL, "failed to load testsuite data");
+    STASIS_ASSERT(testsuite->name && strcmp(testsuite->name, "large") == 0, "test suite name is incorrect");
+    STASIS_ASSERT(testsuite->_tc_inuse == count, "test cases are missing");
+    STASIS_ASSERT(testsuite->passed == (int) count - 2, "passed count is incorrect");
+    STASIS_ASSERT(testsuite->time == 1.5f, "test suite duration is incorrect");
+
+    struct JUNIT_Testcase *testcase = testsuite->testcase[count - 1];
+    STASIS_ASSERT(strcmp(testcase->name, "test_19999") == 0, "last test case name is incorrect");
+    STASIS_ASSERT(testcase->time == 0.25f, "test case duration is incorrect");
+    STASIS_ASSERT(testcase->tc_result_state_type == JUNIT_RESULT_STATE_NONE, "test case should have passed");
+
+    testcase = testsuite->testcase[1];
+    STASIS_ASSERT_FATAL(testcase->tc_result_state_type == JUNIT_RESULT_STATE_FAILURE, "test case should have failed");
+    STASIS_ASSERT(strcmp(testcase->result_state.failure->message, "assert 1 < 0 && \"x\"") == 0, "entities in message were not decoded");
+
+    testcase = testsuite->testcase[2];
+    STASIS_ASSERT_FATAL(testcase->tc_result_state_type == JUNIT_RESULT_STATE_SKIPPED, "test case should have been skipped");
+    STASIS_ASSERT(strcmp(testcase->result_state.skipped->type, "pytest.skip") == 0, "skip type is incorrect");
+    junitxml_testsuite_free(&testsuite);
+    STASIS_ASSERT(testsuite == NULL, "test suite should be NULL after free");
+
+    // Truncated document
+    stasis_testing_write_ascii(filename, "<testsuites><testsuite name=\"broken\"><testcase name=\"x\">");
+    STASIS_ASSERT(junitxml_testsuite_read(filename) == NULL, "malformed document should not be accepted");
+    remove(filename);
+}
+
 int main(int argc, char *argv[]) {
     STASIS_TEST_BEGIN_MAIN();
     STASIS_TEST_FUNC *tests[] = {
         test_junitxml_testsuite_read,
         test_junitxml_testsuite_read_error,
+        test_junitxml_testsuite_read_large,
     };
     STASIS_TEST_RUN(tests);
     STASIS_TEST_END_MAIN();
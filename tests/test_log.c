@@ -0,0 +1,127 @@
+#include "testing.h"
+#include <pthread.h>
+#include <sys/wait.h>
+
+static const char *log_file = "test_log.log";
+
+static size_t log_count(const char *value) {
+    size_t count = 0;
+    char **lines = file_readlines(log_file, 0, 0, NULL);
+    for (size_t i = 0; lines && lines[i] != NULL; i++) {
+        if (strstr(lines[i], value)) {
+            count++;
+        }
+    }
+    guard_array_free(lines);
+    return count;
+}
+
+static int evaluated = 0;
+static const char *mark_evaluated(void) {
+    evaluated++;
+    return "evaluated";
+}
+
+void test_log_sink_record() {
+    remove(log_file);
+    STASIS_ASSERT_FATAL(log_sink_open(log_file) == 0, "unable to open log file");
+
+    SYSWARN("plain warning %d", 1);
+    SYSRECORD(LOG_LEVEL_INFO, "download complete", "url", "https://example.tld/a b", "attempts", "2");
+    msg(STASIS_MSG_L2, "Step message\n");
+    log_sink_record("INFO", NULL, STASIS_COLOR_RED "quote \"this\"\n", NULL);
+    log_sink_close();
+
+    STASIS_ASSERT(log_count("level=WARNING") == 1, "warning record missing");
+    STASIS_ASSERT(log_count("file=test_log.c") == 2, "records should name the source file");
+    STASIS_ASSERT(log_count("msg=\"plain warning 1\"") == 1, "message should be quoted");
+    STASIS_ASSERT(log_count("msg=\"download complete\" url=\"https://example.tld/a b\" attempts=2") == 1, "fields should follow the message");
+    STASIS_ASSERT(log_count("func=") == 2, "msg() and unattributed records should not name a source");
+    STASIS_ASSERT(log_count("msg=\"Step message\"") == 1, "msg() record missing");
+    STASIS_ASSERT(log_count("msg=\"quote \\\"this\\\"\"") == 1, "color codes and line separators should be removed");
+    STASIS_ASSERT(log_count("time=") == 4, "every record should have a time");
+
+    // Nothing happens when the sink is closed
+    SYSWARN("not recorded");
+    STASIS_ASSERT(log_count("not recorded") == 0, "closed sink should not record");
+    remove(log_file);
+}
+
+void test_log_enabled() {
+    const enum LogLevel level = LOG_LEVEL;
+    LOG_LEVEL = LOG_LEVEL_WARN;
+    evaluated = 0;
+    SYSINFO("%s", mark_evaluated());
+    SYSDEBUG("%s", mark_evaluated());
+    SYSRECORD(LOG_LEVEL_DEBUG, "skipped", "value", mark_evaluated());
+    STASIS_ASSERT(evaluated == 0, "arguments of disabled levels should not be evaluated");
+    STASIS_ASSERT(LOG_ENABLED(LOG_LEVEL_WARN), "warnings should be enabled");
+    STASIS_ASSERT(!LOG_ENABLED(LOG_LEVEL_INFO), "info should be disabled");
+
+    LOG_LEVEL = LOG_LEVEL_DEBUG;
+    SYSDEBUG("%s", mark_evaluated());
+    STASIS_ASSERT(evaluated == 1, "arguments of enabled levels should be evaluated");
+    LOG_LEVEL = level;
+}
+
+#define LOG_THREADS 4
+#define LOG_THREAD_RECORDS 1000
+
+static void *log_thread(void *arg) {
+    const size_t id = (size_t) arg;
+    for (size_t i = 0; i < LOG_THREAD_RECORDS; i++) {
+        char value[32] = {0};
+        snprintf(value, sizeof(value), "%zu", id);
+        log_sink_record("INFO", NULL, "from thread", (const char *[]) {"thread", value, NULL});
+    }
+    return NULL;
+}
+
+void test_log_sink_concurrent() {
+    remove(log_file);
+    STASIS_ASSERT_FATAL(log_sink_open(log_file) == 0, "unable to open log file");
+
+    // Fork before starting the threads. A child forked while another thread
+    // holds a libc lock (i.e. in gmtime_r()) could deadlock.
+    const pid_t pid = fork();
+    if (pid == 0) {
+        for (size_t i = 0; i < LOG_THREAD_RECORDS; i++) {
+            log_sink_record("INFO", NULL, "from child", NULL);
+        }
+        _exit(0);
+    }
+
+    // The child writes directly to the file while the threads queue their records
+    pthread_t threads[LOG_THREADS];
+    for (size_t i = 0; i < LOG_THREADS; i++) {
+        pthread_create(&threads[i], NULL, log_thread, (void *) i);
+    }
+    for (size_t i = 0; i < LOG_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    STASIS_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child failed");
+    log_sink_flush();
+    STASIS_ASSERT(log_count("msg=\"from thread\"") == LOG_THREADS * LOG_THREAD_RECORDS, "thread records were lost");
+    STASIS_ASSERT(log_count("msg=\"from child\"") == LOG_THREAD_RECORDS, "child records were lost");
+    for (size_t i = 0; i < LOG_THREADS; i++) {
+        char value[32] = {0};
+        snprintf(value, sizeof(value), "thread=%zu\n", i);
+        STASIS_ASSERT(log_count(value) == LOG_THREAD_RECORDS, "records should not be interleaved");
+    }
+    log_sink_close();
+    remove(log_file);
+}
+
+int main(int argc, char *argv[]) {
+    STASIS_TEST_BEGIN_MAIN();
+    STASIS_TEST_FUNC *tests[] = {
+        test_log_sink_record,
+        test_log_enabled,
+        test_log_sink_concurrent,
+    };
+    STASIS_TEST_RUN(tests);
+    STASIS_TEST_END_MAIN();
+}
@@ -184,6 +184,22 @@ static void test_mp_timeout() {
     mp_pool_free(&p);
 }
 
+static void test_mp_task_envp() {
+    struct MultiProcessingPool *p = NULL;
+    char *envp[] = {
+        "PATH=/usr/bin:/bin",
+        "MP_TASK_ENVP=hello",
+        NULL,
+    };
+    STASIS_ASSERT_FATAL((p = mp_pool_init("envp", "envplogs")) != NULL, "Failed to initialize pool");
+    struct MultiProcessingTask *task = mp_pool_task(p, "envp", NULL, "test \"$MP_TASK_ENVP\" = hello");
+    STASIS_ASSERT_FATAL(task != NULL, "Failed to queue task");
+    STASIS_ASSERT(task->envp == NULL, "Task environment should be inherited by default");
+    task->envp = envp;
+    STASIS_ASSERT(mp_pool_join(p, 1, 0) == 0, "Task did not receive its environment");
+    mp_pool_free(&p);
+}
+
 static void test_mp_seconds_to_human_readable() {
     const struct testcase {
         int seconds;
@@ -250,6 +266,7 @@ int main(int argc, char *argv[]) {
         test_mp_pool_workflow,
         test_mp_fail_fast,
         test_mp_timeout,
+        test_mp_task_envp,
         test_mp_seconds_to_human_readable,
         test_mp_stop_continue
     };
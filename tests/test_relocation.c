@@ -57,11 +57,79 @@ void test_file_replace_text() {
     }
 }
 
+void test_file_replace_text_ex() {
+    const char *filename = "test_file_replace_text_ex.txt";
+    const char *data = "name: @NAME@\n"
+                       "  url: https://example.com/old.tar.gz\n"
+                       "  sha256: 0123456789abcdef\n"
+                       "@NAME@@NAME@ and @NAMES@ and @NAM\n"
+                       "  number: 5";
+    const char *expected = "name: stasis\n"
+                           "  url: https://example.com/new.tar.gz\n"
+                           "\n\n"
+                           "stasisstasis and many and @NAM\n"
+                           "  number: 0";
+    struct ReplaceRule rules[] = {
+        {.target = "@NAME@", .replacement = "stasis"},
+        // Overlaps with @NAME@. The longest match wins.
+        {.target = "@NAMES@", .replacement = "many"},
+        {.target = "  url:", .replacement = "  url: https://example.com/new.tar.gz", .flags = REPLACE_TRUNCATE_AFTER_MATCH},
+        {.target = "  sha256:", .replacement = "\n", .flags = REPLACE_TRUNCATE_AFTER_MATCH},
+        {.target = "  number:", .replacement = "  number: 0", .flags = REPLACE_TRUNCATE_AFTER_MATCH},
+    };
+
+    stasis_testing_write_ascii(filename, data);
+    chmod(filename, 0640);
+    STASIS_ASSERT(file_replace_text_ex(filename, rules, sizeof(rules) / sizeof(*rules)) == 0, "string replacement failed");
+    char *result = stasis_testing_read_ascii(filename);
+    STASIS_ASSERT_FATAL(result != NULL, "unable to read result");
+    STASIS_ASSERT(strcmp(result, expected) == 0, "unexpected replacement");
+    guard_free(result);
+
+    struct stat st;
+    stat(filename, &st);
+    STASIS_ASSERT((st.st_mode & 0777) == 0640, "file permissions were not preserved");
+
+    // Lines longer than any fixed-size buffer
+    const size_t len = STASIS_BUFSIZ * 4;
+    char *line = calloc(len + 1, sizeof(*line));
+    STASIS_ASSERT_FATAL(line != NULL, "unable to allocate line");
+    memset(line, 'x', len);
+    memcpy(line + len - strlen("@NAME@"), "@NAME@", strlen("@NAME@"));
+    stasis_testing_write_ascii(filename, line);
+    STASIS_ASSERT(file_replace_text_ex(filename, rules, 1) == 0, "string replacement failed");
+    result = stasis_testing_read_ascii(filename);
+    STASIS_ASSERT_FATAL(result != NULL, "unable to read result");
+    STASIS_ASSERT(strlen(result) == len - strlen("@NAME@") + strlen("stasis"), "long line was truncated");
+    STASIS_ASSERT(endswith(result, "xstasis"), "match at the end of a long line was not replaced");
+    guard_free(result);
+    guard_free(line);
+
+    // Through a symbolic link, the target file is updated
+    unlink("test_file_replace_text_ex.lnk");
+    symlink(filename, "test_file_replace_text_ex.lnk");
+    stasis_testing_write_ascii(filename, "@NAME@");
+    STASIS_ASSERT(file_replace_text_ex("test_file_replace_text_ex.lnk", rules, 1) == 0, "string replacement failed");
+    struct stat lst;
+    STASIS_ASSERT(lstat("test_file_replace_text_ex.lnk", &lst) == 0 && S_ISLNK(lst.st_mode), "symbolic link was replaced");
+    result = stasis_testing_read_ascii(filename);
+    STASIS_ASSERT(result && strcmp(result, "stasis") == 0, "target of symbolic link was not updated");
+    guard_free(result);
+
+    struct ReplaceRule empty = {.target = "", .replacement = "nothing"};
+    STASIS_ASSERT(file_replace_text_ex(filename, &empty, 1) < 0, "empty target should be rejected");
+    STASIS_ASSERT(file_replace_text_ex("test_file_replace_text_ex.missing", rules, 1) < 0, "missing file should fail");
+
+    remove("test_file_replace_text_ex.lnk");
+    remove(filename);
+}
+
 int main(int argc, char *argv[]) {
     STASIS_TEST_BEGIN_MAIN();
     STASIS_TEST_FUNC *tests[] = {
         test_replace_text,
         test_file_replace_text,
+        test_file_replace_text_ex,
     };
     STASIS_TEST_RUN(tests);
     STASIS_TEST_END_MAIN();
@@ -0,0 +1,59 @@
+#include "testing.h"
+#include "sha256.h"
+
+static const char *vectors[] = {
+    "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+    "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+};
+
+static void digest_string(const char *data, size_t chunk, char hex[SHA256_HEX_SIZE]) {
+    struct SHA256 ctx;
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    const size_t len = strlen(data);
+    sha256_init(&ctx);
+    for (size_t i = 0; i < len; i += chunk) {
+        sha256_update(&ctx, data + i, len - i < chunk ? len - i : chunk);
+    }
+    sha256_final(&ctx, digest);
+    sha256_hex(digest, hex);
+}
+
+void test_sha256() {
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(*vectors); i += 2) {
+        // Feed the data all at once, one byte at a time, then in uneven chunks
+        const size_t chunks[] = {SIZE_MAX, 1, 7};
+        for (size_t c = 0; c < sizeof(chunks) / sizeof(*chunks); c++) {
+            char hex[SHA256_HEX_SIZE] = {0};
+            digest_string(vectors[i], chunks[c], hex);
+            STASIS_ASSERT(strcmp(hex, vectors[i + 1]) == 0, "unexpected digest");
+        }
+    }
+}
+
+void test_sha256_file() {
+    const char *filename = "test_sha256_file.txt";
+    // One million "a", spanning several read buffers
+    FILE *fp = fopen(filename, "w");
+    STASIS_ASSERT_FATAL(fp != NULL, "unable to create test file");
+    for (size_t i = 0; i < 1000000; i++) {
+        fputc('a', fp);
+    }
+    fclose(fp);
+
+    char hex[SHA256_HEX_SIZE] = {0};
+    STASIS_ASSERT(sha256_file(filename, hex) == 0, "unable to hash file");
+    STASIS_ASSERT(strcmp(hex, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0") == 0, "unexpected digest");
+    STASIS_ASSERT(sha256_file("test_sha256_file.missing", hex) < 0, "missing file should fail");
+    remove(filename);
+}
+
+int main(int argc, char *argv[]) {
+    STASIS_TEST_BEGIN_MAIN();
+    STASIS_TEST_FUNC *tests[] = {
+        test_sha256,
+        test_sha256_file,
+    };
+    STASIS_TEST_RUN(tests);
+    STASIS_TEST_END_MAIN();
+}
@@ -48,7 +48,8 @@ void test_strlist_append() {
     for (size_t i = 0; i < sizeof(tc) / sizeof(*tc); i++) {
         strlist_append(&list, (char *) tc[i].data);
         STASIS_ASSERT(list->num_inuse == tc[i].expected_in_use, "incorrect number of records in use");
-        STASIS_ASSERT(list->num_alloc == tc[i].expected_in_use + 1, "incorrect number of records allocated");
+        STASIS_ASSERT(list->num_alloc >= tc[i].expected_in_use + 1, "incorrect number of records allocated");
+        STASIS_ASSERT(list->data[list->num_inuse] == NULL, "list is not NULL terminated");
         STASIS_ASSERT(strcmp(strlist_item(list, i), tc[i].data) == 0, "value was appended incorrectly. data mismatch.");
     }
     guard_strlist_free(&list);
@@ -66,6 +67,95 @@ void test_strlist_append_many_records() {
     guard_strlist_free(&list);
 }
 
+void test_strlist_reserve() {
+    struct StrList *list;
+    list = strlist_init();
+    STASIS_ASSERT(strlist_reserve(NULL, 10) < 0, "NULL list should return an error");
+    STASIS_ASSERT(strlist_reserve(list, 100) == 0, "reserve failed");
+    STASIS_ASSERT(list->num_alloc >= 101, "reserve did not allocate enough records");
+    char **data_before = list->data;
+    for (size_t i = 0; i < 100; i++) {
+        strlist_appendf(&list, "%zu", i);
+    }
+    STASIS_ASSERT(list->data == data_before, "appending within reserved capacity should not reallocate");
+    STASIS_ASSERT(strlist_count(list) == 100, "record count mismatch");
+    STASIS_ASSERT(strcmp(strlist_item(list, 99), "99") == 0, "last record is incorrect");
+    STASIS_ASSERT(list->data[100] == NULL, "list is not NULL terminated");
+    guard_strlist_free(&list);
+}
+
+void test_strlist_append_nocopy() {
+    struct StrList *list;
+    list = strlist_init();
+    char *data = strdup("owned by the list");
+    strlist_append_nocopy(&list, data);
+    STASIS_ASSERT(strlist_item(list, 0) == data, "string should not have been copied");
+
+    char **arr = calloc(4, sizeof(*arr));
+    arr[0] = strdup("one");
+    arr[1] = strdup("two");
+    arr[2] = strdup("three");
+    char *second = arr[1];
+    strlist_append_array_nocopy(list, arr);
+    STASIS_ASSERT(strlist_count(list) == 4, "record count mismatch");
+    STASIS_ASSERT(strlist_item(list, 2) == second, "array strings should not have been copied");
+    STASIS_ASSERT(arr[0] == NULL && arr[1] == NULL && arr[2] == NULL, "ownership of array strings was not transferred");
+    STASIS_ASSERT(list->data[strlist_count(list)] == NULL, "list is not NULL terminated");
+    guard_free(arr);
+    guard_strlist_free(&list);
+}
+
+void test_strlist_intern() {
+    struct StrList *list = strlist_init_mode(STRLIST_MODE_INTERN);
+    STASIS_ASSERT_FATAL(list != NULL, "failed to create interned list");
+    const size_t maxrec = 1000;
+    for (size_t pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < maxrec; i++) {
+            strlist_appendf(&list, "record_%zu", i);
+        }
+    }
+    STASIS_ASSERT(strlist_count(list) == maxrec, "duplicate records should be ignored");
+    STASIS_ASSERT(list->data[strlist_count(list)] == NULL, "list is not NULL terminated");
+
+    size_t index_of = 0;
+    STASIS_ASSERT(strlist_find(list, "record_500", &index_of) && index_of == 500, "record not found at expected index");
+    STASIS_ASSERT(!strlist_find(list, "record_5000", NULL), "record should not exist");
+    STASIS_ASSERT(strlist_contains(list, "record_", &index_of) && index_of == 0, "substring search should not depend on the list mode");
+
+    strlist_remove(list, 0);
+    STASIS_ASSERT(!strlist_find(list, "record_0", NULL), "removed record is still indexed");
+    STASIS_ASSERT(strlist_find(list, "record_500", &index_of) && index_of == 499, "index was not updated after removal");
+
+    strlist_reverse(list);
+    STASIS_ASSERT(strlist_find(list, "record_999", &index_of) && index_of == 0, "index was not updated after reversal");
+
+    strlist_set(&list, 0, "replaced");
+    STASIS_ASSERT(strlist_find(list, "replaced", &index_of) && index_of == 0, "index was not updated after set");
+    STASIS_ASSERT(!strlist_find(list, "record_999", NULL), "replaced record is still indexed");
+
+    const size_t count = strlist_count(list);
+    strlist_set(&list, 1, "replaced");
+    STASIS_ASSERT(strlist_count(list) == count - 1, "set should not create a duplicate record");
+    STASIS_ASSERT(strlist_find(list, "replaced", &index_of) && index_of == 0, "existing record should keep its position");
+    STASIS_ASSERT(!strlist_find(list, "record_998", NULL), "record replaced by a duplicate is still indexed");
+
+    struct StrList *copy = strlist_copy(list);
+    STASIS_ASSERT(copy->mode == STRLIST_MODE_INTERN, "copy should preserve storage mode");
+    STASIS_ASSERT(strlist_cmp(list, copy) == 0, "copy is not identical");
+    guard_strlist_free(&copy);
+    guard_strlist_free(&list);
+}
+
+void test_strlist_find() {
+    struct StrList *list = strlist_init();
+    strlist_append(&list, "abc123");
+    strlist_append(&list, "abc");
+    size_t index_of = 0;
+    STASIS_ASSERT(strlist_find(list, "abc", &index_of) && index_of == 1, "find should match whole records only");
+    STASIS_ASSERT(!strlist_find(list, "ab", NULL), "partial record should not be found");
+    guard_strlist_free(&list);
+}
+
 void test_strlist_set() {
     struct StrList *list;
     list = strlist_init();
@@ -647,6 +737,10 @@ int main(int argc, char *argv[]) {
         test_strlist_free,
         test_strlist_append,
         test_strlist_append_many_records,
+        test_strlist_reserve,
+        test_strlist_append_nocopy,
+        test_strlist_intern,
+        test_strlist_find,
         test_strlist_set,
         test_strlist_append_file,
         test_strlist_append_strlist,
@@ -0,0 +1,265 @@
+#include "testing.h"
+#include "sync.h"
+
+static const char *tree[] = {
+    "a.txt",
+    "sub/b.txt",
+    "sub/deeper/c.txt",
+    "tmp/scratch.txt",
+    "sub/build.log",
+    NULL,
+};
+
+static void make_tree(const char *root, const char *files[]) {
+    for (size_t i = 0; files[i] != NULL; i++) {
+        char path[PATH_MAX] = {0};
+        snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+        char dir[PATH_MAX] = {0};
+        safe_strncpy(dir, path, sizeof(dir));
+        mkdirs(path_dirname(dir), 0755);
+        stasis_testing_write_ascii(path, files[i]);
+    }
+}
+
+static int file_contains(const char *filename, const char *value) {
+    char *data = stasis_testing_read_ascii(filename);
+    if (!data) {
+        return 0;
+    }
+    const int result = strcmp(data, value) == 0;
+    guard_free(data);
+    return result;
+}
+
+void test_sync_tree() {
+    struct SyncStats stats = {0};
+    make_tree("sync_src", tree);
+    STASIS_ASSERT_FATAL(symlink("a.txt", "sync_src/link") == 0, "unable to create symlink");
+
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", NULL, &stats) == 0, "sync failed");
+    STASIS_ASSERT(stats.files_copied == 6, "all files and links should be copied");
+    STASIS_ASSERT(stats.files_skipped == 0, "nothing should be skipped");
+    for (size_t i = 0; tree[i] != NULL; i++) {
+        char path[PATH_MAX] = {0};
+        snprintf(path, sizeof(path), "sync_dest/%s", tree[i]);
+        STASIS_ASSERT(file_contains(path, tree[i]), "destination file content is incorrect");
+    }
+
+    struct stat st_src, st_dest;
+    STASIS_ASSERT(lstat("sync_dest/link", &st_dest) == 0 && S_ISLNK(st_dest.st_mode), "symbolic link was not preserved");
+    stat("sync_src/sub/b.txt", &st_src);
+    stat("sync_dest/sub/b.txt", &st_dest);
+    STASIS_ASSERT(st_src.st_mtim.tv_sec == st_dest.st_mtim.tv_sec, "modification time was not preserved");
+
+    // Nothing changed
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", NULL, &stats) == 0, "sync failed");
+    STASIS_ASSERT(stats.files_copied == 0, "unchanged files should not be copied");
+    STASIS_ASSERT(stats.files_skipped == 6, "unchanged files should be skipped");
+
+    // One file changed size
+    stasis_testing_write_ascii("sync_src/sub/b.txt", "modified");
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", NULL, &stats) == 0, "sync failed");
+    STASIS_ASSERT(stats.files_copied == 1, "only the modified file should be copied");
+    STASIS_ASSERT(file_contains("sync_dest/sub/b.txt", "modified"), "modified file was not copied");
+
+    rmtree("sync_src");
+    rmtree("sync_dest");
+}
+
+void test_sync_tree_checksum() {
+    struct SyncStats stats = {0};
+    struct SyncOptions opts = {.flags = SYNC_CHECKSUM};
+    make_tree("sync_src", tree);
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", &opts, &stats) == 0, "sync failed");
+
+    // Same size and time, different content
+    struct stat st;
+    stat("sync_src/a.txt", &st);
+    stasis_testing_write_ascii("sync_src/a.txt", "A.TXT");
+    const struct timespec times[2] = {st.st_atim, st.st_mtim};
+    utimensat(AT_FDCWD, "sync_src/a.txt", times, 0);
+
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", NULL, &stats) == 0, "sync failed");
+    STASIS_ASSERT(stats.files_copied == 0, "size and time comparison should skip the file");
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", &opts, &stats) == 0, "sync failed");
+    STASIS_ASSERT(stats.files_copied == 1, "content comparison should copy the file");
+    STASIS_ASSERT(file_contains("sync_dest/a.txt", "A.TXT"), "modified file was not copied");
+
+    rmtree("sync_src");
+    rmtree("sync_dest");
+}
+
+void test_sync_tree_exclude_delete() {
+    struct SyncStats stats = {0};
+    char *exclude[] = {"tmp/", "*.log", NULL};
+    struct SyncOptions opts = {.flags = SYNC_DELETE, .exclude = exclude, .jobs = 2};
+    make_tree("sync_src", tree);
+    make_tree("sync_dest", (const char *[]) {"stale.txt", "stale/d.txt", "tmp/keep.txt", NULL});
+    // A directory where the source has a file
+    mkdirs("sync_dest/a.txt", 0755);
+
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", &opts, &stats) == 0, "sync failed");
+    STASIS_ASSERT(access("sync_dest/tmp/scratch.txt", F_OK) != 0, "excluded directory should not be copied");
+    STASIS_ASSERT(access("sync_dest/sub/build.log", F_OK) != 0, "excluded file should not be copied");
+    STASIS_ASSERT(access("sync_dest/stale.txt", F_OK) != 0, "stale file should be deleted");
+    STASIS_ASSERT(access("sync_dest/stale", F_OK) != 0, "stale directory should be deleted");
+    STASIS_ASSERT(access("sync_dest/tmp/keep.txt", F_OK) == 0, "excluded destination records should be kept");
+    STASIS_ASSERT(file_contains("sync_dest/a.txt", "a.txt"), "directory should be replaced by the source file");
+    STASIS_ASSERT(stats.files_deleted == 3, "unexpected number of deleted records");
+    STASIS_ASSERT(stats.files_copied == 3, "unexpected number of copied files");
+
+    rmtree("sync_src");
+    rmtree("sync_dest");
+}
+
+void test_sync_tree_link() {
+    struct SyncStats stats = {0};
+    struct SyncOptions opts = {.flags = SYNC_LINK | SYNC_DELETE};
+    make_tree("sync_src", tree);
+    STASIS_ASSERT_FATAL(symlink("a.txt", "sync_src/link") == 0, "unable to create symlink");
+    // A copy made before linking was enabled
+    make_tree("sync_dest", (const char *[]) {"a.txt", NULL});
+    struct stat st;
+    stat("sync_src/a.txt", &st);
+    const struct timespec times[2] = {st.st_atim, st.st_mtim};
+    utimensat(AT_FDCWD, "sync_dest/a.txt", times, 0);
+
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", &opts, &stats) == 0, "sync failed");
+    STASIS_ASSERT(stats.files_copied == 5, "unexpected number of copied files");
+    STASIS_ASSERT(stats.files_linked == 4, "regular files should be linked");
+    STASIS_ASSERT(stats.files_skipped == 1, "up to date copy should be skipped");
+    STASIS_ASSERT(stats.bytes_copied == 0, "no data should be copied");
+    for (size_t i = 0; tree[i] != NULL; i++) {
+        char path_src[PATH_MAX] = {0};
+        char path_dest[PATH_MAX] = {0};
+        snprintf(path_src, sizeof(path_src), "sync_src/%s", tree[i]);
+        snprintf(path_dest, sizeof(path_dest), "sync_dest/%s", tree[i]);
+        STASIS_ASSERT(file_contains(path_dest, tree[i]), "destination file content is incorrect");
+        if (!strcmp(tree[i], "a.txt")) {
+            continue;
+        }
+        struct stat st_src, st_dest;
+        stat(path_src, &st_src);
+        stat(path_dest, &st_dest);
+        STASIS_ASSERT(st_src.st_ino == st_dest.st_ino, "destination should be a hard link to the source");
+    }
+    STASIS_ASSERT(lstat("sync_dest/link", &st) == 0 && S_ISLNK(st.st_mode), "symbolic link was not preserved");
+
+    // Nothing changed
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", &opts, &stats) == 0, "sync failed");
+    STASIS_ASSERT(stats.files_copied == 0, "linked files should not be transferred again");
+    STASIS_ASSERT(stats.files_skipped == 6, "linked files should be skipped");
+
+    // A replaced source file is linked again
+    stasis_testing_write_ascii("sync_src/sub/new.txt", "new");
+    rename("sync_src/sub/new.txt", "sync_src/sub/b.txt");
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", &opts, &stats) == 0, "sync failed");
+    STASIS_ASSERT(stats.files_linked == 1, "replaced file should be linked");
+    STASIS_ASSERT(file_contains("sync_dest/sub/b.txt", "new"), "replaced file was not linked");
+
+    rmtree("sync_src");
+    rmtree("sync_dest");
+}
+
+static size_t count_hidden(const char *dir) {
+    size_t count = 0;
+    struct StrList *records = listdir((char *) dir);
+    for (size_t i = 0; i < strlist_count(records); i++) {
+        count += *strlist_item(records, i) == '.';
+    }
+    guard_strlist_free(&records);
+    return count;
+}
+
+void test_sync_tree_failed_copy() {
+    struct SyncStats stats = {0};
+    make_tree("sync_src", tree);
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", NULL, &stats) == 0, "sync failed");
+    STASIS_ASSERT(count_hidden("sync_dest/sub") == 0, "temporary files should not be left behind");
+    if (geteuid() == 0) {
+        rmtree("sync_src");
+        rmtree("sync_dest");
+    }
+
+    STASIS_SKIP_IF(geteuid() == 0, "unreadable files can be read by root");
+    stasis_testing_write_ascii("sync_src/sub/b.txt", "modified");
+    chmod("sync_src/sub/b.txt", 0);
+    STASIS_ASSERT(sync_tree("sync_src", "sync_dest", NULL, &stats) != 0, "sync of an unreadable file should fail");
+    STASIS_ASSERT(file_contains("sync_dest/sub/b.txt", "sub/b.txt"), "destination should be kept when the copy fails");
+    STASIS_ASSERT(count_hidden("sync_dest/sub") == 0, "temporary files should be removed on failure");
+    chmod("sync_src/sub/b.txt", 0644);
+
+    rmtree("sync_src");
+    rmtree("sync_dest");
+}
+
+void test_sync_trees() {
+    struct SyncStats stats = {0};
+    make_tree("sync_src1", (const char *[]) {"one.txt", "same.txt", NULL});
+    make_tree("sync_src2", (const char *[]) {"two/two.txt", NULL});
+    stasis_testing_write_ascii("sync_src2/same.txt", "from sync_src2");
+    stasis_testing_write_ascii("single.whl", "single.whl");
+
+    char *srcs[] = {"sync_src1", "sync_src2", "single.whl"};
+    STASIS_ASSERT(sync_trees(srcs, 3, "sync_dest", NULL, &stats) == 0, "sync failed");
+    STASIS_ASSERT(file_contains("sync_dest/one.txt", "one.txt"), "first source was not copied");
+    STASIS_ASSERT(file_contains("sync_dest/two/two.txt", "two/two.txt"), "second source was not copied");
+    STASIS_ASSERT(file_contains("sync_dest/same.txt", "from sync_src2"), "the last source should win");
+    STASIS_ASSERT(file_contains("sync_dest/single.whl", "single.whl"), "file source should be copied by name");
+    STASIS_ASSERT(stats.files_copied == 4, "unexpected number of copied files");
+
+    char *missing[] = {"sync_src_missing"};
+    STASIS_ASSERT(sync_trees(missing, 1, "sync_dest", NULL, &stats) != 0, "missing source should fail");
+
+    rmtree("sync_src1");
+    rmtree("sync_src2");
+    rmtree("sync_dest");
+    remove("single.whl");
+}
+
+void test_sync_trees_links_replace() {
+    struct SyncStats stats = {0};
+    make_tree("sync_src1", (const char *[]) {"one.txt", "two/two.txt", "two/deeper/three.txt", NULL});
+    make_tree("sync_src2", (const char *[]) {"two", NULL});
+    stasis_testing_write_ascii("single.whl", "single.whl");
+    STASIS_ASSERT_FATAL(symlink("sync_src1", "sync_src_link") == 0, "unable to create directory symlink");
+    STASIS_ASSERT_FATAL(symlink("single.whl", "single_link.whl") == 0, "unable to create file symlink");
+
+    // Top-level links are followed
+    char *srcs[] = {"sync_src_link", "single_link.whl"};
+    STASIS_ASSERT(sync_trees(srcs, 2, "sync_dest", NULL, &stats) == 0, "sync failed");
+    struct stat st;
+    STASIS_ASSERT(lstat("sync_dest/one.txt", &st) == 0 && S_ISREG(st.st_mode), "linked source directory should be copied");
+    STASIS_ASSERT(lstat("sync_dest/single_link.whl", &st) == 0 && S_ISREG(st.st_mode), "linked source file should be copied");
+    STASIS_ASSERT(file_contains("sync_dest/single_link.whl", "single.whl"), "linked source file content is incorrect");
+    rmtree("sync_dest");
+
+    // A later source replaces a directory with a file
+    char *replace[] = {"sync_src1", "sync_src2"};
+    STASIS_ASSERT(sync_trees(replace, 2, "sync_dest", NULL, &stats) == 0, "sync failed");
+    STASIS_ASSERT(lstat("sync_dest/two", &st) == 0 && S_ISREG(st.st_mode), "the last source should win");
+    STASIS_ASSERT(file_contains("sync_dest/two", "two"), "replacement file content is incorrect");
+    STASIS_ASSERT(stats.files_copied == 2, "contents of the replaced directory should not be copied");
+
+    rmtree("sync_src1");
+    rmtree("sync_src2");
+    rmtree("sync_dest");
+    remove("sync_src_link");
+    remove("single_link.whl");
+    remove("single.whl");
+}
+
+int main(int argc, char *argv[]) {
+    STASIS_TEST_BEGIN_MAIN();
+    STASIS_TEST_FUNC *tests[] = {
+        test_sync_tree,
+        test_sync_tree_checksum,
+        test_sync_tree_exclude_delete,
+        test_sync_tree_link,
+        test_sync_tree_failed_copy,
+        test_sync_trees,
+        test_sync_trees_links_replace,
+    };
+    STASIS_TEST_RUN(tests);
+    STASIS_TEST_END_MAIN();
+}
@@ -39,6 +39,116 @@ void test_shell_output() {
     guard_free(result);
 }
 
+void test_shell_output_large() {
+    char *result;
+    int status;
+    const size_t count = 200000;
+    char cmd[255] = {0};
+    snprintf(cmd, sizeof(cmd), "seq 1 %zu", count);
+    result = shell_output(cmd, &status);
+    STASIS_ASSERT_FATAL(result != NULL, "output should not be NULL");
+    STASIS_ASSERT(status == 0, "expected zero exit code");
+    STASIS_ASSERT(num_chars(result, '\n') == (int) count, "output is incomplete");
+    STASIS_ASSERT(endswith(result, "\n200000\n"), "output was truncated");
+    guard_free(result);
+}
+
+void test_shell_capture() {
+    struct ProcessOutput proc = {0};
+    char *argv[] = {"/bin/sh", "-c", "printf 'test_stdout'; printf 'test_stderr' >&2; exit 3", NULL};
+
+    STASIS_ASSERT(shell_capture(argv, &proc, SHELL_CAPTURE_STDERR) == 3, "expected exit code 3");
+    STASIS_ASSERT(proc.out && strcmp(proc.out, "test_stdout") == 0, "stdout was not captured");
+    STASIS_ASSERT(proc.out_len == strlen("test_stdout"), "stdout length is incorrect");
+    STASIS_ASSERT(proc.err && strcmp(proc.err, "test_stderr") == 0, "stderr was not captured");
+    STASIS_ASSERT(proc.err_len == strlen("test_stderr"), "stderr length is incorrect");
+    STASIS_ASSERT(WIFEXITED(proc.status) && WEXITSTATUS(proc.status) == 3, "wait status is incorrect");
+    shell_capture_free(&proc);
+
+    STASIS_ASSERT(shell_capture(argv, &proc, SHELL_CAPTURE_MERGE) == 3, "expected exit code 3");
+    STASIS_ASSERT(proc.out && strcmp(proc.out, "test_stdouttest_stderr") == 0, "merged output was not captured");
+    STASIS_ASSERT(proc.err == NULL, "stderr should not be captured separately");
+    shell_capture_free(&proc);
+
+    // Arguments are passed through verbatim without a shell
+    char *argv_literal[] = {"echo", "$HOME; false", NULL};
+    STASIS_ASSERT(shell_capture(argv_literal, &proc, 0) == 0, "expected zero exit code");
+    STASIS_ASSERT(proc.out && strcmp(proc.out, "$HOME; false\n") == 0, "argument was interpreted by a shell");
+    shell_capture_free(&proc);
+
+    char *argv_missing[] = {"stasis_program_does_not_exist", NULL};
+    STASIS_ASSERT(shell_capture(argv_missing, &proc, 0) == 127, "expected exit code 127 for missing program");
+    shell_capture_free(&proc);
+
+    STASIS_ASSERT(shell_capture(NULL, &proc, 0) < 0, "expected an error due to NULL arguments");
+}
+
+void test_shell_spawn() {
+    // Each program writes more than a pipe can hold, so outputs must be read concurrently
+    char *argv_seq[] = {"seq", "1", "100000", NULL};
+    char *argv_err[] = {"/bin/sh", "-c", "seq 1 100000 >&2; exit 2", NULL};
+    char *argv_none[] = {"true", NULL};
+    struct ProcessHandle *procs[] = {
+        shell_spawn(argv_seq, 0),
+        shell_spawn(argv_err, SHELL_CAPTURE_STDERR),
+        shell_spawn(argv_none, SHELL_CAPTURE_NONE),
+    };
+    const size_t count = sizeof(procs) / sizeof(*procs);
+    for (size_t i = 0; i < count; i++) {
+        STASIS_ASSERT_FATAL(procs[i] != NULL, "failed to spawn process");
+    }
+
+    STASIS_ASSERT(shell_wait_all(procs, count) == 1, "expected one program to fail");
+    STASIS_ASSERT(procs[0]->finished && procs[0]->returncode == 0, "seq should not fail");
+    STASIS_ASSERT(num_chars(procs[0]->output.out, '\n') == 100000, "stdout is incomplete");
+    STASIS_ASSERT(procs[1]->finished && procs[1]->returncode == 2, "expected exit code 2");
+    STASIS_ASSERT(procs[1]->output.out_len == 0, "stdout should be empty");
+    STASIS_ASSERT(num_chars(procs[1]->output.err, '\n') == 100000, "stderr is incomplete");
+    STASIS_ASSERT(procs[2]->finished && procs[2]->returncode == 0, "true should not fail");
+    STASIS_ASSERT(procs[2]->output.out == NULL, "stdout should not be captured");
+    STASIS_ASSERT(shell_wait(procs[0]) == 0, "waiting on a finished program should return its exit code");
+
+    for (size_t i = 0; i < count; i++) {
+        shell_handle_free(&procs[i]);
+        STASIS_ASSERT(procs[i] == NULL, "handle should be NULL after free");
+    }
+}
+
+void test_shell_wait_any() {
+    char *argv_slow[] = {"sleep", "2", NULL};
+    char *argv_fast[] = {"echo", "fast", NULL};
+    struct ProcessHandle *procs[] = {
+        shell_spawn(argv_slow, 0),
+        shell_spawn(argv_fast, 0),
+    };
+    const size_t count = sizeof(procs) / sizeof(*procs);
+    struct ProcessHandle *slow = procs[0];
+
+    struct ProcessHandle *done = shell_wait_any(procs, count);
+    STASIS_ASSERT_FATAL(done != NULL, "expected a finished program");
+    STASIS_ASSERT(done == procs[1], "the fast program should finish first");
+    STASIS_ASSERT(strcmp(done->output.out, "fast\n") == 0, "output is incorrect");
+    shell_handle_free(&procs[1]);
+
+    STASIS_ASSERT(slow->finished == 0, "slow program should still be running");
+    // A running program is terminated when its handle is released
+    shell_handle_free(&procs[0]);
+    STASIS_ASSERT(shell_wait_any(procs, count) == NULL, "no programs should remain");
+}
+
+void test_shell_handle_free_kill() {
+    // A program that ignores SIGTERM must not block the caller
+    char *argv[] = {"/bin/sh", "-c", "trap '' TERM; exec sleep 30", NULL};
+    struct ProcessHandle *proc = shell_spawn(argv, 0);
+    STASIS_ASSERT_FATAL(proc != NULL, "failed to spawn process");
+    usleep(200000);
+    const pid_t pid = proc->pid;
+    const time_t start = time(NULL);
+    shell_handle_free(&proc);
+    STASIS_ASSERT(time(NULL) - start < 10, "releasing the handle should not wait for the program");
+    STASIS_ASSERT(kill(pid, 0) < 0 && errno == ESRCH, "program should be killed and reaped");
+}
+
 void test_shell_safe() {
     struct Process proc;
     memset(&proc, 0, sizeof(proc));
@@ -135,6 +245,11 @@ int main(int argc, char *argv[]) {
         test_shell_output_null_args,
         test_shell_output_non_zero_exit,
         test_shell_output,
+        test_shell_output_large,
+        test_shell_capture,
+        test_shell_spawn,
+        test_shell_wait_any,
+        test_shell_handle_free_kill,
         test_shell_safe_verify_restrictions,
         test_shell_safe,
         test_shell_null_proc,
@@ -46,6 +46,16 @@ static int divider(struct tplfunc_frame *frame, void *result) {
     return 0;
 }
 
+static int counter_calls = 0;
+static int counter(struct tplfunc_frame *frame, void *result) {
+    char **ptr = (char **) result;
+    const size_t sz = 100;
+    counter_calls++;
+    *ptr = calloc(sz, sizeof(*ptr));
+    snprintf(*ptr, sz, "%s:%d", frame->argv[0].t_char_ptr, counter_calls);
+    return 0;
+}
+
 void test_tpl_workflow() {
     char *data = strdup("Hello world!");
     tpl_reset();
@@ -133,11 +143,41 @@ void test_tpl_register_func() {
     guard_free(result);
 }
 
+void test_tpl_register_func_pure() {
+    tpl_reset();
+    tpl_register_func_ex("pure_counter", &counter, 1, NULL, TPLFUNC_F_PURE);
+    tpl_register_func("counter", &counter, 1, NULL);
+
+    counter_calls = 0;
+    char *result = NULL;
+    result = tpl_render("{{ func:pure_counter(a) }} {{ func:pure_counter( a ) }} {{ func:pure_counter(b) }}");
+    STASIS_ASSERT(result != NULL && strcmp(result, "a:1 a:1 b:2") == 0, "pure function result was not memoized by argument list");
+    guard_free(result);
+    STASIS_ASSERT(counter_calls == 2, "pure function should execute once per unique argument list");
+
+    result = tpl_render("{{ func:pure_counter(a) }}");
+    STASIS_ASSERT(result != NULL && strcmp(result, "a:1") == 0, "memoized result did not persist between renders");
+    guard_free(result);
+    STASIS_ASSERT(counter_calls == 2, "pure function executed again on a later render");
+
+    counter_calls = 0;
+    result = tpl_render("{{ func:counter(a) }} {{ func:counter(a) }}");
+    STASIS_ASSERT(result != NULL && strcmp(result, "a:1 a:2") == 0, "impure function result should never be memoized");
+    guard_free(result);
+
+    tpl_cache_clear();
+    counter_calls = 0;
+    result = tpl_render("{{ func:pure_counter(a) }}");
+    STASIS_ASSERT(result != NULL && strcmp(result, "a:1") == 0, "tpl_cache_clear did not discard memoized results");
+    guard_free(result);
+}
+
 int main(int argc, char *argv[]) {
     STASIS_TEST_BEGIN_MAIN();
     STASIS_TEST_FUNC *tests[] = {
         test_tpl_workflow,
         test_tpl_register_func,
+        test_tpl_register_func_pure,
         test_tpl_register,
     };
     STASIS_TEST_RUN(tests);
@@ -42,10 +42,34 @@ void test_tests() {
     tests_free(&tests);
 }
 
+void test_tests_index() {
+    struct Tests *tests = tests_init(TEST_NUM_ALLOC_INITIAL);
+    STASIS_ASSERT_FATAL(tests != NULL, "tests structure allocation failed");
+    for (int i = 0; i < 3; i++) {
+        tests_add(tests, mock_test(i));
+    }
+    // A duplicate name, and a test without a name
+    struct Test *duplicate = mock_test(1);
+    tests_add(tests, duplicate);
+    tests_add(tests, test_init());
+
+    struct TestIndex index;
+    STASIS_ASSERT_FATAL(tests_index_init(&index, tests) == 0, "index allocation failed");
+    STASIS_ASSERT(strlist_count(index.names) == 3, "names should be unique");
+    STASIS_ASSERT(tests_index_find(&index, "test_0") == tests->test[0], "exact name not found");
+    STASIS_ASSERT(tests_index_find(&index, "test_1") == tests->test[1], "the first test with a name should be found");
+    STASIS_ASSERT(tests_index_find(&index, "test_2[extra]>=1.0") == tests->test[2], "extras and version spec should be ignored");
+    STASIS_ASSERT(tests_index_find(&index, "test_") == NULL, "partial names should not match");
+    STASIS_ASSERT(tests_index_find(&index, "missing") == NULL, "unknown name should not match");
+    tests_index_free(&index);
+    tests_free(&tests);
+}
+
 int main(int argc, char *argv[]) {
     STASIS_TEST_BEGIN_MAIN();
     STASIS_TEST_FUNC *tests[] = {
         test_tests,
+        test_tests_index,
     };
     STASIS_TEST_RUN(tests);
     STASIS_TEST_END_MAIN();
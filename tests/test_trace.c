@@ -0,0 +1,103 @@
+#include "testing.h"
+#include "trace.h"
+#include "multiprocessing.h"
+
+static const char *trace_file = "test_trace.json";
+
+static size_t trace_count(const char *value) {
+    size_t count = 0;
+    char **lines = file_readlines(trace_file, 0, 0, NULL);
+    for (size_t i = 0; lines && lines[i] != NULL; i++) {
+        if (strstr(lines[i], value)) {
+            count++;
+        }
+    }
+    guard_array_free(lines);
+    return count;
+}
+
+static void stage_sleep(int msec) {
+    usleep(msec * 1000);
+}
+
+void test_trace_disabled() {
+    remove(trace_file);
+    STASIS_ASSERT(!trace_enabled(), "tracing should be disabled by default");
+    trace_begin(TRACE_CAT_STAGE, "nothing");
+    trace_end(TRACE_CAT_STAGE, "nothing");
+    trace_complete(TRACE_CAT_TASK, "nothing", 1, 0, 1);
+    STASIS_ASSERT(access(trace_file, F_OK) != 0, "no file should be written");
+}
+
+void test_trace_spans() {
+    remove(trace_file);
+    STASIS_ASSERT_FATAL(trace_open(trace_file) == 0, "unable to open trace file");
+    STASIS_ASSERT(trace_enabled(), "tracing should be enabled");
+
+    TRACE_CALL(TRACE_CAT_STAGE, stage_sleep, 10);
+    trace_complete(TRACE_CAT_TASK, "pool:\"quoted\"", 1234, 100, 350);
+
+    STASIS_ASSERT(shell(NULL, "/bin/true --secret=value") == 0, "shell failed");
+    char *argv[] = {"/bin/sh", "-c", "echo hello secret", NULL};
+    struct ProcessOutput output;
+    STASIS_ASSERT(shell_capture(argv, &output, 0) == 0, "shell_capture failed");
+    shell_capture_free(&output);
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        trace_complete(TRACE_CAT_TASK, "child", (long) getpid(), 0, 1);
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+    trace_close();
+    STASIS_ASSERT(!trace_enabled(), "tracing should be disabled after close");
+
+    STASIS_ASSERT(trace_count("\"name\":\"stage_sleep\",\"cat\":\"stage\",\"ph\":\"B\"") == 1, "stage begin missing");
+    STASIS_ASSERT(trace_count("\"name\":\"stage_sleep\",\"cat\":\"stage\",\"ph\":\"E\"") == 1, "stage end missing");
+    STASIS_ASSERT(trace_count("\"name\":\"pool:\\\"quoted\\\"\",\"cat\":\"task\",\"ph\":\"X\",\"ts\":100,") == 1, "names should be escaped");
+    STASIS_ASSERT(trace_count("\"tid\":1234,\"dur\":250}") == 1, "complete event duration is wrong");
+    STASIS_ASSERT(trace_count("\"name\":\"true\",\"cat\":\"exec\"") == 1, "shell() span missing");
+    STASIS_ASSERT(trace_count("\"name\":\"echo hello\",\"cat\":\"exec\"") == 1, "shell_capture() span missing");
+    STASIS_ASSERT(trace_count("secret") == 0, "span names should not include later arguments");
+    STASIS_ASSERT(trace_count("\"name\":\"child\"") == 1, "child process event missing");
+
+    char *python = find_program("python3");
+    if (python) {
+        char cmd[PATH_MAX] = {0};
+        snprintf(cmd, sizeof(cmd), "%s -c 'import json, sys; json.load(open(sys.argv[1]))' %s", python, trace_file);
+        int status = 0;
+        char *result = shell_output(cmd, &status);
+        STASIS_ASSERT(status == 0, "trace file should be valid JSON");
+        guard_free(result);
+    }
+    remove(trace_file);
+}
+
+void test_trace_pool() {
+    remove(trace_file);
+    STASIS_ASSERT_FATAL(trace_open(trace_file) == 0, "unable to open trace file");
+
+    struct MultiProcessingPool *pool = mp_pool_init("trace", "trace_logs");
+    STASIS_ASSERT_FATAL(pool != NULL, "pool init failed");
+    STASIS_ASSERT(mp_pool_task(pool, "one", NULL, "true") != NULL, "task one failed");
+    STASIS_ASSERT(mp_pool_task(pool, "two", NULL, "true") != NULL, "task two failed");
+    STASIS_ASSERT(mp_pool_join(pool, 2, 0) == 0, "pool failed");
+    mp_pool_free(&pool);
+    trace_close();
+
+    STASIS_ASSERT(trace_count("\"name\":\"trace:one\",\"cat\":\"task\",\"ph\":\"X\"") == 1, "first task span missing");
+    STASIS_ASSERT(trace_count("\"name\":\"trace:two\",\"cat\":\"task\",\"ph\":\"X\"") == 1, "second task span missing");
+    rmtree("trace_logs");
+    remove(trace_file);
+}
+
+int main(int argc, char *argv[]) {
+    STASIS_TEST_BEGIN_MAIN();
+    STASIS_TEST_FUNC *tests[] = {
+        test_trace_disabled,
+        test_trace_spans,
+        test_trace_pool,
+    };
+    STASIS_TEST_RUN(tests);
+    STASIS_TEST_END_MAIN();
+}
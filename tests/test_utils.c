@@ -113,6 +113,36 @@ void test_xml_pretty_print_in_place() {
     fclose(fp);
 }
 
+void test_xml_format_in_place() {
+    const char *filename = "ugly_in_process.xml";
+    const char *data = "<?xml version=\"1.0\" encoding=\"utf-8\"?><things><abc a=\"&lt;1&gt;\">123</abc><abc>321</abc></things>";
+    const char *expected = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                           "<things>\n"
+                           "  <abc a=\"&lt;1&gt;\">123</abc>\n"
+                           "  <abc>321</abc>\n"
+                           "</things>\n";
+
+    stasis_testing_write_ascii(filename, data);
+    chmod(filename, 0640);
+    STASIS_ASSERT(xml_format_in_place(filename) == 0, "xml formatting failed");
+    char *result = stasis_testing_read_ascii(filename);
+    STASIS_ASSERT_FATAL(result != NULL, "unable to read formatted xml file");
+    STASIS_ASSERT(strcmp(expected, result) == 0, "xml file was not reformatted");
+    guard_free(result);
+
+    struct stat st;
+    stat(filename, &st);
+    STASIS_ASSERT((st.st_mode & 0777) == 0640, "file permissions were not preserved");
+
+    // Malformed documents are left alone
+    stasis_testing_write_ascii(filename, "<things><abc>");
+    STASIS_ASSERT(xml_format_in_place(filename) != 0, "malformed xml should not be accepted");
+    result = stasis_testing_read_ascii(filename);
+    STASIS_ASSERT(result && strcmp(result, "<things><abc>") == 0, "malformed xml file was modified");
+    guard_free(result);
+    remove(filename);
+}
+
 void test_path_store() {
     char *dest = NULL;
     chdir(cwd_workspace);
@@ -383,6 +413,79 @@ void test_rmtree() {
     STASIS_ASSERT(access(root, F_OK) < 0, "the directory is still present");
 }
 
+static void make_rmtree_fixture(const char *root) {
+    char path[PATH_MAX];
+    for (size_t i = 0; i < 8; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            snprintf(path, sizeof(path), "%s/dir%zu/sub%zu", root, i, j);
+            mkdirs(path, 0755);
+            snprintf(path, sizeof(path), "%s/dir%zu/sub%zu/file.txt", root, i, j);
+            touch(path);
+        }
+    }
+    snprintf(path, sizeof(path), "%s/top.txt", root);
+    touch(path);
+    // A read-only directory, and a link that must not be followed
+    snprintf(path, sizeof(path), "%s/dir0/readonly", root);
+    mkdirs(path, 0755);
+    snprintf(path, sizeof(path), "%s/dir0/readonly/file.txt", root);
+    touch(path);
+    snprintf(path, sizeof(path), "%s/dir0/readonly", root);
+    chmod(path, 0555);
+    snprintf(path, sizeof(path), "%s/dir1/link", root);
+    symlink(cwd_workspace, path);
+}
+
+void test_rmtree_ex() {
+    const char *root = "rmtree_ex_dir";
+    chdir(cwd_workspace);
+
+    make_rmtree_fixture(root);
+    STASIS_ASSERT(rmtree_ex(root, 0) == 0, "rmtree_ex should have been able to remove the directory");
+    STASIS_ASSERT(access(root, F_OK) < 0, "the directory is still present");
+    STASIS_ASSERT(access(cwd_workspace, F_OK) == 0, "symbolic link target should not be removed");
+
+    make_rmtree_fixture(root);
+    STASIS_ASSERT(rmtree_ex(root, RMTREE_PARALLEL) == 0, "parallel rmtree_ex should have been able to remove the directory");
+    STASIS_ASSERT(access(root, F_OK) < 0, "the directory is still present");
+
+    // Without a temporary directory the tree is removed synchronously
+    char *tmpdir_orig = globals.tmpdir;
+    globals.tmpdir = NULL;
+    make_rmtree_fixture(root);
+    STASIS_ASSERT(rmtree_ex(root, RMTREE_BACKGROUND) == 0, "background rmtree_ex should fall back to removing the tree");
+    STASIS_ASSERT(access(root, F_OK) < 0, "the directory is still present");
+
+    const char *scratch = "rmtree_ex_scratch";
+    mkdir(scratch, 0755);
+    globals.tmpdir = (char *) scratch;
+    make_rmtree_fixture(root);
+    STASIS_ASSERT(rmtree_ex(root, RMTREE_BACKGROUND) == 0, "background rmtree_ex should succeed");
+    STASIS_ASSERT(access(root, F_OK) < 0, "the directory should be moved aside immediately");
+    STASIS_ASSERT(mkdir(root, 0755) == 0, "the path should be reusable immediately");
+    rmdir(root);
+    struct StrList *siblings = listdir(".");
+    int moved_beside = 0;
+    for (size_t i = 0; siblings && i < strlist_count(siblings); i++) {
+        moved_beside |= strstr(strlist_item(siblings, i), "rmtree_ex_dir.") != NULL;
+    }
+    guard_strlist_free(&siblings);
+    STASIS_ASSERT(!moved_beside, "the tree should not be moved beside the original path");
+    // Wait for the detached remover
+    for (size_t i = 0; i < 100 && rmdir(scratch) < 0; i++) {
+        usleep(100000);
+    }
+    STASIS_ASSERT(access(scratch, F_OK) < 0, "the tree should be removed from the temporary directory");
+    globals.tmpdir = tmpdir_orig;
+
+    STASIS_ASSERT(rmtree_ex(root, 0) == 1, "a missing directory should not be an error");
+    STASIS_ASSERT(rmtree_ex("", 0) < 0, "an empty path is an error");
+    touch("rmtree_ex_file");
+    STASIS_ASSERT(rmtree_ex("rmtree_ex_file", 0) < 0, "a file is not a directory");
+    STASIS_ASSERT(access("rmtree_ex_file", F_OK) == 0, "a file should not be removed");
+    remove("rmtree_ex_file");
+}
+
 void test_dirstack() {
     const char *data[] = {
         "testdir",
@@ -510,6 +613,7 @@ int main(int argc, char *argv[]) {
             test_redact_sensitive,
             test_fix_tox_conf,
             test_xml_pretty_print_in_place,
+            test_xml_format_in_place,
             test_path_store,
             test_isempty_dir,
             test_xmkstemp,
@@ -522,6 +626,7 @@ int main(int argc, char *argv[]) {
             test_path_basename,
             test_expandpath,
             test_rmtree,
+            test_rmtree_ex,
             test_dirstack,
             test_pushd_popd,
             test_pushd_popd_suggested_workflow,
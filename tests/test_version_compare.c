@@ -70,11 +70,12 @@ struct TestCase_version_compare test_cases_version_compare[] = {
     {"1.0dev1", ">=", "1.0.0dev1", 1},
     {"1.0dev1", "!=", "1.0.0dev1", 0},
 
+    // Pre-releases (1.0a == 1.0a0) are older than the release
     {"1.0a", "=", "1.0.0", 0},
-    {"1.0a", "<", "1.0.0", 0},
-    {"1.0a", "<=", "1.0.0", 0},
-    {"1.0a", ">", "1.0.0", 1},
-    {"1.0a", ">=", "1.0.0", 1},
+    {"1.0a", "<", "1.0.0", 1},
+    {"1.0a", "<=", "1.0.0", 1},
+    {"1.0a", ">", "1.0.0", 0},
+    {"1.0a", ">=", "1.0.0", 0},
     {"1.0a", "!=", "1.0.0", 1},
 
     {"1.0.3", "=", "2.0.0", 0},
@@ -91,11 +92,12 @@ struct TestCase_version_compare test_cases_version_compare[] = {
     {"2022.1", ">=", "2022.4", 0},
     {"2022.1", "!=", "2022.4", 1},
 
+    // Any epoch is newer than the implicit epoch 0
     {"1:2022.1", "=", "2022.4", 0},
-    {"1:2022.1", "<", "2022.4", 1},
-    {"1:2022.1", "<=", "2022.4", 1},
-    {"1:2022.1", ">", "2022.4", 0},
-    {"1:2022.1", ">=", "2022.4", 0},
+    {"1:2022.1", "<", "2022.4", 0},
+    {"1:2022.1", "<=", "2022.4", 0},
+    {"1:2022.1", ">", "2022.4", 1},
+    {"1:2022.1", ">=", "2022.4", 1},
     {"1:2022.1", "!=", "2022.4", 1},
 
     {"1:2022.1", "=", "2:2022.4", 0},
@@ -126,6 +128,16 @@ struct TestCase_version_compare test_cases_version_compare[] = {
     {"2022.4", ">=", "2022.1", 1},
     {"2022.4", "!=", "2022.1", 1},
 
+    {"1.1.1w", ">", "1.1.1", 1},
+    {"1.1.1w", "<", "1.1.1x", 1},
+    {"1.0.0-alpha.1", "=", "1.0a1", 1},
+    {"1.0-1", "=", "1.0.post1", 1},
+    {"v1.0", "=", "1.0", 1},
+    {"1!1.0", "=", "1:1.0", 1},
+    {"1.0RC1", "=", "1.0rc1", 1},
+    {"1.0.dev1", "<", "1.0a1", 1},
+    {"25.3.1\n", ">", "25.1.0", 1},
+
     // Error cases
     {NULL, "", "", -1},
     {"", NULL, "", -1},
@@ -161,10 +173,106 @@ void run_cases_version_compare(void) {
     }
 }
 
+// Ordering examples from PEP 440
+static const char *pep440_order[] = {
+    "1.0.dev456",
+    "1.0a1",
+    "1.0a2.dev456",
+    "1.0a12.dev456",
+    "1.0a12",
+    "1.0b1.dev456",
+    "1.0b2",
+    "1.0b2.post345.dev456",
+    "1.0b2.post345",
+    "1.0rc1.dev456",
+    "1.0rc1",
+    "1.0",
+    "1.0+abc.5",
+    "1.0+abc.7",
+    "1.0+5",
+    "1.0.post456.dev34",
+    "1.0.post456",
+    "1.0.15",
+    "1.1.dev1",
+    NULL,
+};
+
+void test_version_parse() {
+    struct Version version;
+    STASIS_ASSERT(version_parse(&version, "2!1.2.3rc4.post5.dev6+Ubuntu-1") == 0, "valid version rejected");
+    STASIS_ASSERT(version.epoch == 2, "unexpected epoch");
+    STASIS_ASSERT(version.release_count == 3 && version.release[0] == 1 && version.release[1] == 2 && version.release[2] == 3, "unexpected release");
+    STASIS_ASSERT(version.pre_type == VERSION_PRE_RC && version.pre == 4, "unexpected pre-release");
+    STASIS_ASSERT(version.has_post && version.post == 5, "unexpected post-release");
+    STASIS_ASSERT(version.has_dev && version.dev == 6, "unexpected development release");
+    STASIS_ASSERT(strcmp(version.local, "ubuntu.1") == 0, "unexpected local version label");
+    version_free(&version);
+
+    STASIS_ASSERT(version_parse(&version, NULL) < 0, "NULL should be rejected");
+    STASIS_ASSERT(version_parse(&version, "") < 0, "empty string should be rejected");
+    STASIS_ASSERT(version_parse(&version, "rc1") < 0, "missing release should be rejected");
+    STASIS_ASSERT(version_parse(&version, "99999999999999999999999") < 0, "overflow should be rejected");
+
+    for (size_t i = 1; pep440_order[i] != NULL; i++) {
+        struct Version older;
+        struct Version newer;
+        STASIS_ASSERT_FATAL(version_parse(&older, pep440_order[i - 1]) == 0, "valid version rejected");
+        STASIS_ASSERT_FATAL(version_parse(&newer, pep440_order[i]) == 0, "valid version rejected");
+        STASIS_ASSERT(version_cmp(&older, &newer) < 0, pep440_order[i]);
+        STASIS_ASSERT(version_cmp(&newer, &older) > 0, pep440_order[i]);
+        STASIS_ASSERT(version_cmp(&newer, &newer) == 0, pep440_order[i]);
+        version_free(&older);
+        version_free(&newer);
+    }
+}
+
+void test_version_parse_long() {
+    // Long release and local segments are not limited to a fixed key size
+    char older_s[STASIS_BUFSIZ] = {0};
+    char newer_s[STASIS_BUFSIZ] = {0};
+    safe_strncpy(older_s, "1", sizeof(older_s));
+    for (size_t i = 0; i < 100; i++) {
+        strcat(older_s, ".1");
+    }
+    strcat(older_s, "+");
+    for (size_t i = 0; i < 100; i++) {
+        strcat(older_s, "1.");
+    }
+    safe_strncpy(newer_s, older_s, sizeof(newer_s));
+    strcat(older_s, "1");
+    strcat(newer_s, "2");
+
+    struct Version older;
+    struct Version newer;
+    STASIS_ASSERT_FATAL(version_parse(&older, older_s) == 0, "long version rejected");
+    STASIS_ASSERT_FATAL(version_parse(&newer, newer_s) == 0, "long version rejected");
+    STASIS_ASSERT(older.release_count == 101, "unexpected number of release segments");
+    STASIS_ASSERT(version_cmp(&older, &newer) < 0, "long versions should be ordered by their last segment");
+    version_free(&older);
+    version_free(&newer);
+
+    STASIS_ASSERT(version_compare(LT, older_s, newer_s) == 1, "long versions should compare");
+    char *arr[] = {newer_s, "not a version", older_s, NULL};
+    strsort(arr, STASIS_SORT_VERSION);
+    STASIS_ASSERT(arr[0] == older_s && arr[1] == newer_s, "long versions should sort as versions");
+}
+
+void test_strsort_version() {
+    char *arr[] = {"1.0+5", "not a version", "1.0a1", "1.0.15", "1.0", "1.0.dev456", "1.0rc1", NULL};
+    const char *expected[] = {"1.0.dev456", "1.0a1", "1.0rc1", "1.0", "1.0+5", "1.0.15", "not a version", NULL};
+    strsort(arr, STASIS_SORT_VERSION);
+    for (size_t i = 0; expected[i] != NULL; i++) {
+        STASIS_ASSERT(arr[i] && strcmp(arr[i], expected[i]) == 0, "unexpected sort order");
+    }
+}
+
 int main(void) {
     STASIS_TEST_BEGIN_MAIN();
     STASIS_TEST_FUNC *tests[] = {
         run_cases_version_compare,
+        test_version_parse,
+        test_version_parse_long,
+        test_strsort_version,
     };
     STASIS_TEST_RUN(tests);
 